@@ -0,0 +1,25 @@
+#pragma once
+
+#include <cstdint>
+#include <zasm/program/node.hpp>
+
+namespace zasm::analysis
+{
+    constexpr uint32_t kInvalidBlock = 0xFFFFFFFFu;
+
+    /// <summary>
+    /// Range of nodes that execute in sequence, blocks are identified by their index in list order.
+    /// </summary>
+    struct BasicBlock
+    {
+        const Node* head{};
+        const Node* tail{};
+        // Fallthrough and branch target, kInvalidBlock if not present.
+        uint32_t succs[2]{ kInvalidBlock, kInvalidBlock };
+        // Control leaves to an unknown location, e.g. ret or an indirect jump.
+        bool hasUnknownSucc{};
+        // Contains data, embedded labels or nothing but labels before data.
+        bool isData{};
+    };
+
+} // namespace zasm::analysis
@@ -0,0 +1,108 @@
+#pragma once
+
+#include "basicblock.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct ControlFlowGraphState;
+    }
+
+    namespace analysis
+    {
+        constexpr uint32_t kInvalidLoop = 0xFFFFFFFFu;
+
+        /// <summary>
+        /// Natural loop formed by the back edges into its header.
+        /// </summary>
+        struct Loop
+        {
+            uint32_t header{ kInvalidBlock };
+            // The innermost loop containing this loop, kInvalidLoop for outermost loops.
+            uint32_t parent{ kInvalidLoop };
+            // Nesting depth starting at 1 for outermost loops.
+            uint32_t depth{};
+        };
+
+        /// <summary>
+        /// Control flow graph of a Program. Blocks are stored in list order and referenced by index,
+        /// branch targets are resolved through the label bindings. Dominators are computed over
+        /// all entry blocks, blocks that can not be reached from any entry have no dominator.
+        /// </summary>
+        class ControlFlowGraph
+        {
+            detail::ControlFlowGraphState* _state;
+
+        public:
+            ControlFlowGraph();
+            ControlFlowGraph(const ControlFlowGraph&) = delete;
+            ~ControlFlowGraph();
+
+            ControlFlowGraph& operator=(const ControlFlowGraph&) = delete;
+
+        public:
+            /// <summary>
+            /// Builds the graph, dominator tree and loops of the program, previous results are
+            /// discarded. The results are invalid once the program is modified.
+            /// </summary>
+            Error build(const Program& program);
+
+            size_t getBlockCount() const noexcept;
+
+            const BasicBlock& getBlock(uint32_t blockIdx) const noexcept;
+
+            /// <summary>
+            /// Returns the index of the block containing the node, kInvalidBlock if the node was not
+            /// part of the program at the time of the build.
+            /// </summary>
+            uint32_t getBlockOf(const Node* node) const noexcept;
+
+            size_t getPredecessorCount(uint32_t blockIdx) const noexcept;
+
+            uint32_t getPredecessor(uint32_t blockIdx, size_t index) const noexcept;
+
+            /// <summary>
+            /// Returns the blocks control may enter from outside of the graph, the first block,
+            /// sections and blocks whose label is called or has its address taken.
+            /// </summary>
+            size_t getEntryCount() const noexcept;
+
+            uint32_t getEntry(size_t index) const noexcept;
+
+            /// <summary>
+            /// Returns the immediate dominator, kInvalidBlock for entry blocks and unreachable blocks.
+            /// </summary>
+            uint32_t getImmediateDominator(uint32_t blockIdx) const noexcept;
+
+            /// <summary>
+            /// Returns true if every path from an entry to blockB passes blockA. A block dominates itself
+            /// if it is reachable.
+            /// </summary>
+            bool dominates(uint32_t blockA, uint32_t blockB) const noexcept;
+
+            bool isReachable(uint32_t blockIdx) const noexcept;
+
+            size_t getLoopCount() const noexcept;
+
+            /// <summary>
+            /// Returns the loop, inner loops always have a lower index than their parents.
+            /// </summary>
+            const Loop& getLoop(uint32_t loopIdx) const noexcept;
+
+            /// <summary>
+            /// Returns the innermost loop containing the block, kInvalidLoop if it is in no loop.
+            /// </summary>
+            uint32_t getLoopOf(uint32_t blockIdx) const noexcept;
+
+            uint32_t getLoopDepth(uint32_t blockIdx) const noexcept;
+        };
+
+    } // namespace analysis
+
+} // namespace zasm
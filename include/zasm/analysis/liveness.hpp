@@ -0,0 +1,100 @@
+#pragma once
+
+#include "regset.hpp"
+
+#include <cstdint>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct LivenessState;
+    }
+
+    namespace analysis
+    {
+        // All cpu flags, used where the flags read by unknown code have to be assumed.
+        constexpr uint32_t kAllFlags = ~0u;
+
+        /// <summary>
+        /// Registers and flags accessed by a single instruction, registers are keyed by their root.
+        /// </summary>
+        struct RegAccess
+        {
+            // Registers read, including the base and index of memory operands.
+            RegSet use;
+            // Registers that are entirely overwritten, partial and conditional writes are not included.
+            RegSet def;
+            // Registers written in any way.
+            RegSet write;
+            uint32_t flagsUse{};
+            // Flags modified or left undefined.
+            uint32_t flagsDef{};
+        };
+
+        /// <summary>
+        /// Returns the registers and flags the instruction accesses based on its meta data. Calls are
+        /// assumed to read every register and flag, instructions without meta data are assumed to
+        /// read and partially write their explicit register operands and to read all flags.
+        /// </summary>
+        RegAccess getRegAccess(const Instruction& instr, ZydisMachineMode mode) noexcept;
+
+        struct LiveSet
+        {
+            RegSet regs;
+            uint32_t flags{};
+
+            bool operator==(const LiveSet& other) const noexcept
+            {
+                return regs == other.regs && flags == other.flags;
+            }
+
+            bool operator!=(const LiveSet& other) const noexcept
+            {
+                return !(*this == other);
+            }
+        };
+
+        /// <summary>
+        /// Computes which registers and flags are live at each node of a Program. The program is
+        /// split into basic blocks and solved with a worklist over the blocks, results are stored
+        /// per block and refined per node on query.
+        /// Everything is considered live where control leaves to unknown code, this includes
+        /// returns, indirect jumps, data and the end of the program.
+        /// </summary>
+        class Liveness
+        {
+            detail::LivenessState* _state;
+
+        public:
+            Liveness();
+            Liveness(const Liveness&) = delete;
+            ~Liveness();
+
+            Liveness& operator=(const Liveness&) = delete;
+
+        public:
+            /// <summary>
+            /// Analyzes the program, previous results are discarded. The results are invalid once
+            /// the program is modified.
+            /// </summary>
+            Error analyze(const Program& program);
+
+            /// <summary>
+            /// Returns the registers and flags live before the node executes.
+            /// </summary>
+            LiveSet getLiveIn(const Node* node) const noexcept;
+
+            /// <summary>
+            /// Returns the registers and flags live after the node executes.
+            /// </summary>
+            LiveSet getLiveOut(const Node* node) const noexcept;
+
+            size_t getBlockCount() const noexcept;
+        };
+
+    } // namespace analysis
+
+} // namespace zasm
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <Zydis/Zydis.h>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <zasm/core/math.hpp>
+#include <zasm/program/register.hpp>
+
+namespace zasm::analysis
+{
+    /// <summary>
+    /// Fixed size set of registers with one bit per register id, all set operations work on whole
+    /// words. Analyses key the set by the root register, see Reg::getRoot.
+    /// </summary>
+    class RegSet
+    {
+        static constexpr size_t kNumBits = ZYDIS_REGISTER_MAX_VALUE + 1;
+        static constexpr size_t kNumWords = (kNumBits + 63) / 64;
+
+        std::array<uint64_t, kNumWords> _words{};
+
+    public:
+        constexpr RegSet() noexcept = default;
+
+        /// <summary>
+        /// Returns a set with every register.
+        /// </summary>
+        static constexpr RegSet all() noexcept
+        {
+            RegSet res;
+            for (size_t i = 0; i < kNumWords; ++i)
+            {
+                res._words[i] = ~uint64_t{ 0 };
+            }
+            // Keep the bits past the last register clear so count and equality are exact.
+            if constexpr (kNumBits % 64 != 0)
+            {
+                res._words[kNumWords - 1] = (uint64_t{ 1 } << (kNumBits % 64)) - 1;
+            }
+            // None is never part of the set.
+            res._words[0] &= ~uint64_t{ 1 };
+            return res;
+        }
+
+        constexpr void add(const operands::Reg& reg) noexcept
+        {
+            const auto bit = getBit(reg);
+            if (bit <= 0)
+                return;
+            _words[bit / 64] |= uint64_t{ 1 } << (bit % 64);
+        }
+
+        constexpr void remove(const operands::Reg& reg) noexcept
+        {
+            const auto bit = getBit(reg);
+            if (bit <= 0)
+                return;
+            _words[bit / 64] &= ~(uint64_t{ 1 } << (bit % 64));
+        }
+
+        constexpr bool contains(const operands::Reg& reg) const noexcept
+        {
+            const auto bit = getBit(reg);
+            if (bit <= 0)
+                return false;
+            return (_words[bit / 64] & (uint64_t{ 1 } << (bit % 64))) != 0;
+        }
+
+        constexpr bool empty() const noexcept
+        {
+            uint64_t res = 0;
+            for (const auto word : _words)
+            {
+                res |= word;
+            }
+            return res == 0;
+        }
+
+        constexpr void clear() noexcept
+        {
+            _words = {};
+        }
+
+        size_t count() const noexcept
+        {
+            size_t res = 0;
+            for (const auto word : _words)
+            {
+                res += static_cast<size_t>(math::popCount(word));
+            }
+            return res;
+        }
+
+        /// <summary>
+        /// Calls func with every register in the set in ascending order of the id.
+        /// </summary>
+        template<typename F> void forEach(F&& func) const
+        {
+            for (size_t i = 0; i < kNumWords; ++i)
+            {
+                auto word = _words[i];
+                while (word != 0)
+                {
+                    const auto bit = math::findFirstSet(word);
+                    word &= word - 1;
+                    func(operands::Reg(static_cast<ZydisRegister>(i * 64 + bit)));
+                }
+            }
+        }
+
+        /// <summary>
+        /// Returns true if both sets have at least one register in common.
+        /// </summary>
+        constexpr bool intersects(const RegSet& other) const noexcept
+        {
+            uint64_t res = 0;
+            for (size_t i = 0; i < kNumWords; ++i)
+            {
+                res |= _words[i] & other._words[i];
+            }
+            return res != 0;
+        }
+
+        constexpr RegSet& operator|=(const RegSet& other) noexcept
+        {
+            for (size_t i = 0; i < kNumWords; ++i)
+            {
+                _words[i] |= other._words[i];
+            }
+            return *this;
+        }
+
+        constexpr RegSet& operator&=(const RegSet& other) noexcept
+        {
+            for (size_t i = 0; i < kNumWords; ++i)
+            {
+                _words[i] &= other._words[i];
+            }
+            return *this;
+        }
+
+        constexpr RegSet& operator-=(const RegSet& other) noexcept
+        {
+            for (size_t i = 0; i < kNumWords; ++i)
+            {
+                _words[i] &= ~other._words[i];
+            }
+            return *this;
+        }
+
+        constexpr RegSet operator|(const RegSet& other) const noexcept
+        {
+            auto res = *this;
+            return res |= other;
+        }
+
+        constexpr RegSet operator&(const RegSet& other) const noexcept
+        {
+            auto res = *this;
+            return res &= other;
+        }
+
+        constexpr RegSet operator-(const RegSet& other) const noexcept
+        {
+            auto res = *this;
+            return res -= other;
+        }
+
+        constexpr bool operator==(const RegSet& other) const noexcept
+        {
+            for (size_t i = 0; i < kNumWords; ++i)
+            {
+                if (_words[i] != other._words[i])
+                    return false;
+            }
+            return true;
+        }
+
+        constexpr bool operator!=(const RegSet& other) const noexcept
+        {
+            return !(*this == other);
+        }
+
+    private:
+        static constexpr int32_t getBit(const operands::Reg& reg) noexcept
+        {
+            const auto bit = static_cast<int32_t>(reg.getId());
+            if (reg.isVirtual() || bit >= static_cast<int32_t>(kNumBits))
+                return -1;
+            return bit;
+        }
+    };
+
+} // namespace zasm::analysis
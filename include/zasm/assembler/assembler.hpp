@@ -1,6 +1,7 @@
 #pragma once
 
 #include <zasm/core/errors.hpp>
+#include <zasm/program/align.hpp>
 #include <zasm/program/instruction.hpp>
 #include <zasm/program/operand.hpp>
 #include <zasm/program/section.hpp>
@@ -10,13 +11,26 @@ namespace zasm
     class Program;
     class Node;
     class InstrGenerator;
+    class CodeStream;
 
     class Assembler
     {
+    public:
+        struct GeneratorStats
+        {
+            // Instructions served from the cache without encoding and decoding.
+            size_t cacheHits{};
+            // Instructions that required a full encode and decode.
+            size_t cacheMisses{};
+        };
+
+    private:
         Program& _program;
         const Node* _cursor{};
         Instruction::Attribs _attribState{};
         InstrGenerator* _generator{};
+        bool _recordOnly{};
+        CodeStream* _stream{};
 
     public:
         Assembler(Program& _program);
@@ -25,13 +39,38 @@ namespace zasm
         void setCursor(const Node* pos);
         const Node* getCursor() const;
 
+        GeneratorStats getGeneratorStats() const noexcept;
+
+        // In record-only mode instructions are appended without encoding or decoding them, they have
+        // no meta data and are validated when serialized, the Serializer reports the failing node.
+        void setRecordOnly(bool enable) noexcept;
+        bool isRecordOnly() const noexcept;
+
+        // In streaming mode instructions, data and labels are encoded directly into the stream, the
+        // program is only used to create labels. Sections are not supported, pass nullptr to stop
+        // streaming. The stream must use the same mode as the program.
+        Error setStream(CodeStream* stream) noexcept;
+        CodeStream* getStream() const noexcept;
+
     public:
         Label createLabel(const char* name = nullptr);
         Error bind(const Label& label);
 
+    public:
+        // Virtual registers, see Program::createVirtualGp. Instructions using them are generated
+        // with physical placeholders to obtain the meta data and store the virtual registers.
+        operands::Gp8 createVirtualGp8();
+        operands::Gp16 createVirtualGp16();
+        operands::Gp32 createVirtualGp32();
+        operands::Gp64 createVirtualGp64();
+
     public:
         Error section(const char* name, Section::Attribs attribs = Section::Attribs::Code, int32_t align = 0x1000);
 
+        // Pads to the next multiple of align which must be a power of two, code is padded with nops and data with
+        // zeros. The padding is computed by the Serializer from the final address.
+        Error align(int32_t align, Align::Type type = Align::Type::Code);
+
     public:
         // Data emitter.
         Error db(uint8_t val);
@@ -51,6 +90,9 @@ namespace zasm
             return emit_(attribs, id, sizeof...(TArgs), { args... });
         }
 
+        // Emits an instruction with operands only known at runtime, pending attribs are combined with attribs.
+        Error emit(Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps, const Operand* ops);
+
     private:
         Error emit_(
             Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps,
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/core/bitsize.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/encoder/encoder.hpp>
+#include <zasm/program/align.hpp>
+#include <zasm/program/label.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct CodeStreamState;
+    }
+
+    /// <summary>
+    /// Output buffer for the Assembler in streaming mode. Instructions are encoded directly
+    /// into the buffer at their final address, no nodes are created and no serialization is
+    /// required. References to labels that are not yet bound are encoded with a rel32/disp32
+    /// placeholder and patched once the label is bound, references to bound labels use the
+    /// shortest encoding.
+    /// </summary>
+    class CodeStream
+    {
+        detail::CodeStreamState* _state;
+
+    public:
+        CodeStream(ZydisMachineMode mode, int64_t base);
+        CodeStream(const CodeStream&) = delete;
+        ~CodeStream();
+
+        CodeStream& operator=(const CodeStream&) = delete;
+
+    public:
+        ZydisMachineMode getMode() const noexcept;
+
+        /// <summary>
+        /// Returns the virtual address of the first byte.
+        /// </summary>
+        int64_t getBase() const noexcept;
+
+        /// <summary>
+        /// Returns the virtual address of the next byte emitted.
+        /// </summary>
+        int64_t getAddress() const noexcept;
+
+        const uint8_t* getCode() const noexcept;
+        size_t getCodeSize() const noexcept;
+
+        /// <summary>
+        /// Returns the address of a bound label, -1 if the label is not bound.
+        /// </summary>
+        int64_t getLabelAddress(Label::Id labelId) const noexcept;
+
+        /// <summary>
+        /// Returns the amount of references to labels which are not yet bound. The code is only
+        /// complete once this is zero.
+        /// </summary>
+        size_t getUnresolvedCount() const noexcept;
+
+        /// <summary>
+        /// Removes all code, labels and pending references, the base address is kept.
+        /// </summary>
+        void clear() noexcept;
+
+    public:
+        Error emit(
+            Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps, const EncoderOperands& operands) noexcept;
+
+        Error embed(const void* data, size_t len);
+        Error embedLabel(Label label, BitSize size);
+        Error embedLabelRel(Label label, Label relativeTo, BitSize size);
+
+        /// <summary>
+        /// Pads to the next multiple of align relative to the address, see Assembler::align.
+        /// </summary>
+        Error align(int32_t align, Align::Type type);
+
+        /// <summary>
+        /// Binds the label to the current address and patches all references to it.
+        /// </summary>
+        /// <returns>Error::LabelAlreadyBound if bound before, Error::InvalidLabel if a reference is out of range</returns>
+        Error bind(Label label);
+    };
+
+} // namespace zasm
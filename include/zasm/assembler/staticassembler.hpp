@@ -0,0 +1,721 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+#include <zasm/core/errors.hpp>
+#include <zasm/encoder/direct.hpp>
+#include <zasm/program/immediate.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/memory.hpp>
+#include <zasm/program/register.hpp>
+
+namespace zasm
+{
+    /// <summary>
+    /// Location of a patchable field in code produced by the StaticAssembler.
+    /// </summary>
+    struct StaticPatch
+    {
+        size_t offset{};
+        uint8_t size{};
+    };
+
+    /// <summary>
+    /// Code assembled at compile time, see assembleStatic.
+    /// </summary>
+    template<size_t TCodeSize, size_t TNumPatches> struct StaticCode
+    {
+        std::array<uint8_t, TCodeSize> code{};
+        std::array<StaticPatch, TNumPatches> patches{};
+
+        /// <summary>
+        /// Writes the value little endian into the field of the patch, dst is expected to hold a copy
+        /// of the code.
+        /// </summary>
+        constexpr void patch(uint8_t* dst, size_t index, uint64_t value) const noexcept
+        {
+            const auto& field = patches[index];
+            for (uint8_t i = 0; i < field.size; ++i)
+            {
+                dst[field.offset + i] = static_cast<uint8_t>(value >> (i * 8));
+            }
+        }
+    };
+
+    /// <summary>
+    /// Assembler for fixed instruction sequences such as trampolines, prologues and thunks that can be
+    /// used in constant expressions. It uses the same encoding as the Assembler for the forms it supports:
+    /// mov and arithmetic with 32/64 bit gp registers, lea, push, pop, ret and branches in long mode.
+    /// The code is position independent, labels can only be referenced by branches and rip-relative
+    /// memory operands. The first error is kept and all following calls are ignored.
+    /// </summary>
+    template<size_t TCapacity> class StaticAssembler
+    {
+        static constexpr size_t kMaxLabels = 32;
+        static constexpr size_t kMaxFixups = 64;
+        static constexpr size_t kMaxPatches = 16;
+
+        using DirectOperand = detail::direct::Operand;
+
+        // A rel32/disp32 field that refers to a label which was not bound when it was emitted.
+        struct Fixup
+        {
+            size_t offset{};
+            Label::Id label{ Label::Id::Invalid };
+            int64_t addend{};
+            bool resolved{};
+        };
+
+        // Label referenced by a rip-relative memory operand.
+        struct LabelRef
+        {
+            Label::Id label{ Label::Id::Invalid };
+            int64_t disp{};
+        };
+
+        struct Writer
+        {
+            StaticAssembler& assembler;
+
+            constexpr void emit8(uint8_t val) noexcept
+            {
+                if (assembler._length >= TCapacity)
+                {
+                    assembler._overflow = true;
+                    return;
+                }
+                assembler._code[assembler._length++] = val;
+            }
+
+            constexpr void emit16(uint16_t val) noexcept
+            {
+                emit8(static_cast<uint8_t>(val));
+                emit8(static_cast<uint8_t>(val >> 8));
+            }
+
+            constexpr void emit32(uint32_t val) noexcept
+            {
+                emit16(static_cast<uint16_t>(val));
+                emit16(static_cast<uint16_t>(val >> 16));
+            }
+
+            constexpr void emit64(uint64_t val) noexcept
+            {
+                emit32(static_cast<uint32_t>(val));
+                emit32(static_cast<uint32_t>(val >> 32));
+            }
+
+            constexpr void emitImm(uint64_t val, uint8_t size) noexcept
+            {
+                assembler._lastField = StaticPatch{ assembler._length, size };
+                for (uint8_t i = 0; i < size; ++i)
+                {
+                    emit8(static_cast<uint8_t>(val >> (i * 8)));
+                }
+            }
+        };
+
+        std::array<uint8_t, TCapacity> _code{};
+        size_t _length{};
+        bool _overflow{};
+        Error _error{};
+
+        std::array<int64_t, kMaxLabels> _labelOffsets{};
+        size_t _labelCount{};
+
+        std::array<Fixup, kMaxFixups> _fixups{};
+        size_t _fixupCount{};
+        size_t _unresolvedCount{};
+
+        std::array<StaticPatch, kMaxPatches> _patches{};
+        size_t _patchCount{};
+
+        // Immediate, relative or data field of the last instruction, size is 0 if there is none.
+        StaticPatch _lastField{};
+
+    public:
+        constexpr StaticAssembler() noexcept = default;
+
+    public:
+        constexpr Error getError() const noexcept
+        {
+            return _error;
+        }
+
+        constexpr const uint8_t* getCode() const noexcept
+        {
+            return _code.data();
+        }
+
+        constexpr size_t getCodeSize() const noexcept
+        {
+            return _length;
+        }
+
+        constexpr size_t getPatchCount() const noexcept
+        {
+            return _patchCount;
+        }
+
+        constexpr StaticPatch getPatch(size_t index) const noexcept
+        {
+            return _patches[index];
+        }
+
+        /// <summary>
+        /// Returns the amount of references to labels which are not yet bound.
+        /// </summary>
+        constexpr size_t getUnresolvedCount() const noexcept
+        {
+            return _unresolvedCount;
+        }
+
+        /// <summary>
+        /// Returns the offset of a bound label, -1 if the label is not bound.
+        /// </summary>
+        constexpr int64_t getLabelOffset(const Label& label) const noexcept
+        {
+            const auto labelIdx = static_cast<size_t>(label.getId());
+            if (!label.isValid() || labelIdx >= _labelCount)
+            {
+                return -1;
+            }
+            return _labelOffsets[labelIdx] - 1;
+        }
+
+    public:
+        constexpr Label createLabel() noexcept
+        {
+            if (_labelCount >= kMaxLabels)
+            {
+                fail(Error::OutOfBounds);
+                return Label{};
+            }
+            return Label{ static_cast<Label::Id>(_labelCount++) };
+        }
+
+        /// <summary>
+        /// Binds the label to the current offset and patches all references to it.
+        /// </summary>
+        constexpr Error bind(const Label& label) noexcept
+        {
+            if (_error != Error::None)
+                return _error;
+
+            const auto labelIdx = static_cast<size_t>(label.getId());
+            if (!label.isValid() || labelIdx >= _labelCount)
+                return fail(Error::InvalidLabel);
+
+            if (_labelOffsets[labelIdx] != 0)
+                return fail(Error::LabelAlreadyBound);
+
+            // Offsets are stored biased by one so zero initialized entries are unbound.
+            _labelOffsets[labelIdx] = static_cast<int64_t>(_length) + 1;
+
+            for (size_t i = 0; i < _fixupCount; ++i)
+            {
+                auto& fixup = _fixups[i];
+                if (fixup.resolved || fixup.label != label.getId())
+                    continue;
+
+                writeRel32(fixup.offset, static_cast<int64_t>(_length) + fixup.addend);
+                fixup.resolved = true;
+                _unresolvedCount--;
+            }
+
+            return _error;
+        }
+
+        /// <summary>
+        /// Marks the immediate, the relative target or the data of the last emitted instruction as patchable.
+        /// The patches are reported in the order they are marked.
+        /// </summary>
+        constexpr Error markPatch() noexcept
+        {
+            if (_error != Error::None)
+                return _error;
+
+            if (_lastField.size == 0)
+                return fail(Error::InvalidOperation);
+
+            if (_patchCount >= kMaxPatches)
+                return fail(Error::OutOfBounds);
+
+            _patches[_patchCount++] = _lastField;
+            return Error::None;
+        }
+
+    public:
+        constexpr Error db(uint8_t val) noexcept
+        {
+            return emitData(val, 1);
+        }
+
+        constexpr Error dw(uint16_t val) noexcept
+        {
+            return emitData(val, 2);
+        }
+
+        constexpr Error dd(uint32_t val) noexcept
+        {
+            return emitData(val, 4);
+        }
+
+        constexpr Error dq(uint64_t val) noexcept
+        {
+            return emitData(val, 8);
+        }
+
+    public:
+        template<typename TDst, typename TSrc> constexpr Error mov(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_MOV, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error add(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_ADD, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error or_(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_OR, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error adc(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_ADC, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error sbb(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_SBB, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error and_(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_AND, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error sub(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_SUB, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error xor_(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_XOR, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error cmp(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_CMP, dst, src);
+        }
+
+        template<typename TDst, typename TSrc> constexpr Error test(const TDst& dst, const TSrc& src) noexcept
+        {
+            return emitBinary(ZYDIS_MNEMONIC_TEST, dst, src);
+        }
+
+        /// <summary>
+        /// Always encodes the 64 bit immediate form so the value can be patched.
+        /// </summary>
+        constexpr Error movabs(const operands::Gp64& dst, const operands::Imm& src) noexcept
+        {
+            detail::direct::Gp gp{};
+            const bool isGp = detail::direct::getGp(dst.getId(), gp);
+
+            return emitInstr(LabelRef{}, [&](Writer& w) {
+                if (!isGp)
+                    return false;
+                detail::direct::emitRex(w, true, 0, 0, gp.index);
+                w.emit8(0xB8 + (gp.index & 7));
+                w.emitImm(src.value<uint64_t>(), 8);
+                return true;
+            });
+        }
+
+        constexpr Error lea(const operands::Gp& dst, const operands::Mem& src) noexcept
+        {
+            LabelRef ref{};
+            const auto dstOp = getOperand(dst, ref);
+            const auto srcOp = getOperand(src, ref);
+
+            return emitInstr(ref, [&](Writer& w) {
+                if (dstOp.kind != DirectOperand::Kind::Gp || srcOp.kind != DirectOperand::Kind::Mem)
+                    return false;
+
+                detail::direct::emitRegMem(w, dstOp.gp.is64, 0x8D, dstOp.gp.index, srcOp.mem);
+                return true;
+            });
+        }
+
+        constexpr Error push(const operands::Gp64& src) noexcept
+        {
+            return emitPushPop(0x50, src);
+        }
+
+        constexpr Error pop(const operands::Gp64& dst) noexcept
+        {
+            return emitPushPop(0x58, dst);
+        }
+
+        constexpr Error ret() noexcept
+        {
+            return emitInstr(LabelRef{}, [](Writer& w) {
+                w.emit8(0xC3);
+                return true;
+            });
+        }
+
+        constexpr Error ret(const operands::Imm& imm) noexcept
+        {
+            const auto val = imm.value<int64_t>();
+            return emitInstr(LabelRef{}, [&](Writer& w) {
+                if (val < 0 || val > 0xFFFF)
+                    return false;
+
+                w.emit8(0xC2);
+                w.emitImm(static_cast<uint64_t>(val), 2);
+                return true;
+            });
+        }
+
+        constexpr Error nop() noexcept
+        {
+            return emitInstr(LabelRef{}, [](Writer& w) {
+                w.emit8(0x90);
+                return true;
+            });
+        }
+
+        constexpr Error int3() noexcept
+        {
+            return emitInstr(LabelRef{}, [](Writer& w) {
+                w.emit8(0xCC);
+                return true;
+            });
+        }
+
+        constexpr Error jmp(const Label& label) noexcept
+        {
+            return emitBranch(ZYDIS_MNEMONIC_JMP, label);
+        }
+
+        template<typename TTarget> constexpr Error jmp(const TTarget& target) noexcept
+        {
+            return emitIndirect(4, target);
+        }
+
+        constexpr Error call(const Label& label) noexcept
+        {
+            return emitBranch(ZYDIS_MNEMONIC_CALL, label);
+        }
+
+        template<typename TTarget> constexpr Error call(const TTarget& target) noexcept
+        {
+            return emitIndirect(2, target);
+        }
+
+        // clang-format off
+        constexpr Error jo(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JO, label); }
+        constexpr Error jno(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JNO, label); }
+        constexpr Error jb(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JB, label); }
+        constexpr Error jnb(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JNB, label); }
+        constexpr Error jz(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JZ, label); }
+        constexpr Error jnz(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JNZ, label); }
+        constexpr Error jbe(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JBE, label); }
+        constexpr Error jnbe(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JNBE, label); }
+        constexpr Error js(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JS, label); }
+        constexpr Error jns(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JNS, label); }
+        constexpr Error jp(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JP, label); }
+        constexpr Error jnp(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JNP, label); }
+        constexpr Error jl(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JL, label); }
+        constexpr Error jnl(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JNL, label); }
+        constexpr Error jle(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JLE, label); }
+        constexpr Error jnle(const Label& label) noexcept { return emitBranch(ZYDIS_MNEMONIC_JNLE, label); }
+        // clang-format on
+
+    private:
+        constexpr Error fail(Error err) noexcept
+        {
+            if (_error == Error::None)
+            {
+                _error = err;
+            }
+            return _error;
+        }
+
+        constexpr void writeRel32(size_t offset, int64_t value) noexcept
+        {
+            if (!detail::direct::isInt32(value))
+            {
+                fail(Error::InvalidLabel);
+                return;
+            }
+            for (size_t i = 0; i < 4; ++i)
+            {
+                _code[offset + i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8));
+            }
+        }
+
+        // Patches the rel32/disp32 field now if the label is bound, otherwise once it is bound.
+        constexpr void addReference(size_t offset, Label::Id label, int64_t addend) noexcept
+        {
+            const auto labelOffset = getLabelOffset(Label{ label });
+            if (labelOffset != -1)
+            {
+                writeRel32(offset, labelOffset + addend);
+                return;
+            }
+
+            if (_fixupCount >= kMaxFixups)
+            {
+                fail(Error::OutOfBounds);
+                return;
+            }
+
+            _fixups[_fixupCount++] = Fixup{ offset, label, addend, false };
+            _unresolvedCount++;
+        }
+
+        template<typename T> constexpr DirectOperand getOperand(const T& op, LabelRef& ref) const noexcept
+        {
+            DirectOperand res{};
+            if constexpr (std::is_base_of_v<operands::Reg, T>)
+            {
+                if (detail::direct::getGp(op.getId(), res.gp))
+                    res.kind = DirectOperand::Kind::Gp;
+            }
+            else if constexpr (std::is_base_of_v<operands::Imm, T>)
+            {
+                res.imm = op.template value<int64_t>();
+                res.kind = DirectOperand::Kind::Imm;
+            }
+            else
+            {
+                static_assert(std::is_same_v<T, operands::Mem>, "Unsupported operand type");
+
+                if (op.getSegment().isValid() || !detail::direct::isInt32(op.getDisplacement()))
+                    return res;
+
+                if (op.getBase().isVirtual() || op.getIndex().isVirtual())
+                    return res;
+
+                res.mem.size = op.getByteSize();
+                res.mem.disp = static_cast<int32_t>(op.getDisplacement());
+
+                const auto baseId = op.getBase().getId();
+                const auto indexId = op.getIndex().getId();
+                if (op.hasLabel() || baseId == ZYDIS_REGISTER_RIP)
+                {
+                    if (indexId != ZYDIS_REGISTER_NONE || (baseId != ZYDIS_REGISTER_RIP && baseId != ZYDIS_REGISTER_NONE))
+                        return res;
+
+                    if (op.hasLabel())
+                    {
+                        ref = LabelRef{ op.getLabelId(), op.getDisplacement() };
+                    }
+
+                    res.mem.isRipRel = true;
+                    res.kind = DirectOperand::Kind::Mem;
+                    return res;
+                }
+
+                if (baseId < ZYDIS_REGISTER_RAX || baseId > ZYDIS_REGISTER_R15)
+                    return res;
+
+                res.mem.base = static_cast<uint8_t>(baseId - ZYDIS_REGISTER_RAX);
+                if (indexId != ZYDIS_REGISTER_NONE)
+                {
+                    if (indexId < ZYDIS_REGISTER_RAX || indexId > ZYDIS_REGISTER_R15 || indexId == ZYDIS_REGISTER_RSP)
+                        return res;
+
+                    res.mem.index = static_cast<int8_t>(indexId - ZYDIS_REGISTER_RAX);
+                    if (!detail::direct::getScaleBits(op.getScale(), res.mem.scaleBits))
+                        return res;
+                }
+
+                res.kind = DirectOperand::Kind::Mem;
+            }
+            return res;
+        }
+
+        template<typename TEncode> constexpr Error emitInstr(const LabelRef& ref, TEncode&& encode) noexcept
+        {
+            if (_error != Error::None)
+                return _error;
+
+            const auto start = _length;
+            _lastField = {};
+
+            Writer w{ *this };
+            if (!encode(w))
+            {
+                _length = start;
+                _lastField = {};
+                return fail(Error::ImpossibleInstruction);
+            }
+
+            if (_overflow)
+                return fail(Error::OutOfBounds);
+
+            if (ref.label != Label::Id::Invalid)
+            {
+                if (static_cast<size_t>(ref.label) >= _labelCount)
+                    return fail(Error::InvalidLabel);
+
+                // The disp32 of rip-relative operands is followed only by the immediate.
+                const auto end = static_cast<int64_t>(_length);
+                addReference(_length - _lastField.size - 4, ref.label, ref.disp - end);
+            }
+
+            return _error;
+        }
+
+        constexpr Error emitData(uint64_t val, uint8_t size) noexcept
+        {
+            return emitInstr(LabelRef{}, [&](Writer& w) {
+                w.emitImm(val, size);
+                return true;
+            });
+        }
+
+        template<typename TDst, typename TSrc>
+        constexpr Error emitBinary(ZydisMnemonic id, const TDst& dst, const TSrc& src) noexcept
+        {
+            LabelRef ref{};
+            const auto dstOp = getOperand(dst, ref);
+            const auto srcOp = getOperand(src, ref);
+
+            return emitInstr(ref, [&](Writer& w) { return detail::direct::encodeBinary(w, id, dstOp, srcOp); });
+        }
+
+        constexpr Error emitPushPop(uint8_t opcode, const operands::Gp64& reg) noexcept
+        {
+            detail::direct::Gp gp{};
+            const bool isGp = detail::direct::getGp(reg.getId(), gp);
+
+            return emitInstr(LabelRef{}, [&](Writer& w) {
+                if (!isGp)
+                    return false;
+                detail::direct::emitRex(w, false, 0, 0, gp.index);
+                w.emit8(opcode + (gp.index & 7));
+                return true;
+            });
+        }
+
+        // jmp and call with a 64 bit register or memory operand, ext is the opcode extension of 0xFF.
+        template<typename TTarget> constexpr Error emitIndirect(uint8_t ext, const TTarget& target) noexcept
+        {
+            LabelRef ref{};
+            const auto op = getOperand(target, ref);
+
+            return emitInstr(ref, [&](Writer& w) {
+                if (op.kind == DirectOperand::Kind::Gp && op.gp.is64)
+                {
+                    detail::direct::emitRegReg(w, false, 0xFF, ext, op.gp.index);
+                    return true;
+                }
+                if (op.kind == DirectOperand::Kind::Mem && op.mem.size == 8)
+                {
+                    detail::direct::emitRegMem(w, false, 0xFF, ext, op.mem);
+                    return true;
+                }
+                return false;
+            });
+        }
+
+        // Same selection as the Assembler in streaming mode, rel8 only for bound labels in range.
+        constexpr Error emitBranch(ZydisMnemonic id, const Label& label) noexcept
+        {
+            if (_error != Error::None)
+                return _error;
+
+            if (!label.isValid() || static_cast<size_t>(label.getId()) >= _labelCount)
+                return fail(Error::InvalidLabel);
+
+            const auto cc = detail::direct::getConditionCode(id);
+            const auto start = static_cast<int64_t>(_length);
+            const auto labelOffset = getLabelOffset(label);
+
+            if (labelOffset != -1 && id != ZYDIS_MNEMONIC_CALL && detail::direct::isInt8(labelOffset - (start + 2)))
+            {
+                const auto rel = labelOffset - (start + 2);
+                return emitInstr(LabelRef{}, [&](Writer& w) {
+                    w.emit8(id == ZYDIS_MNEMONIC_JMP ? 0xEB : static_cast<uint8_t>(0x70 | cc));
+                    w.emitImm(static_cast<uint64_t>(rel), 1);
+                    return true;
+                });
+            }
+
+            const auto err = emitInstr(LabelRef{}, [&](Writer& w) {
+                if (id == ZYDIS_MNEMONIC_JMP)
+                {
+                    w.emit8(0xE9);
+                }
+                else if (id == ZYDIS_MNEMONIC_CALL)
+                {
+                    w.emit8(0xE8);
+                }
+                else
+                {
+                    w.emit8(0x0F);
+                    w.emit8(static_cast<uint8_t>(0x80 | cc));
+                }
+                w.emitImm(0, 4);
+                return true;
+            });
+            if (err != Error::None)
+                return err;
+
+            addReference(_length - 4, label.getId(), -static_cast<int64_t>(_length));
+            return _error;
+        }
+    };
+
+    namespace detail
+    {
+        template<size_t TCapacity, typename TFunc> constexpr StaticAssembler<TCapacity> runStaticAssembler(TFunc func)
+        {
+            StaticAssembler<TCapacity> assembler;
+            func(assembler);
+            return assembler;
+        }
+
+    } // namespace detail
+
+    /// <summary>
+    /// Assembles the code emitted by func at compile time. func receives a StaticAssembler and must
+    /// be usable in constant expressions, usually a lambda without captures. Errors and unbound
+    /// labels fail the compilation.
+    ///
+    /// Example:
+    ///   constexpr auto kStub = zasm::assembleStatic([](auto& a) {
+    ///       a.movabs(rax, Imm(0));
+    ///       a.markPatch();
+    ///       a.jmp(rax);
+    ///   });
+    /// </summary>
+    /// <returns>StaticCode with the exact code size and the offsets of all marked patches</returns>
+    template<size_t TCapacity = 256, typename TFunc> constexpr auto assembleStatic(TFunc func)
+    {
+        constexpr auto assembler = detail::runStaticAssembler<TCapacity>(func);
+        static_assert(assembler.getError() == Error::None, "Static assembly failed, check getError of the StaticAssembler");
+        static_assert(assembler.getUnresolvedCount() == 0, "Static assembly has references to unbound labels");
+
+        StaticCode<assembler.getCodeSize(), assembler.getPatchCount()> res{};
+        for (size_t i = 0; i < res.code.size(); ++i)
+        {
+            res.code[i] = assembler.getCode()[i];
+        }
+        for (size_t i = 0; i < res.patches.size(); ++i)
+        {
+            res.patches[i] = assembler.getPatch(i);
+        }
+        return res;
+    }
+
+} // namespace zasm
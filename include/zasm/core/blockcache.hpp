@@ -0,0 +1,206 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+
+namespace zasm::detail
+{
+    // Block sizes are rounded up to this granularity so pools with similar
+    // block sizes end up sharing the same caches.
+    inline constexpr size_t kBlockSizeClassGranularity = 64 * 1024;
+
+    // Upper bound of memory a single thread keeps around per size class.
+    inline constexpr size_t kMaxThreadCacheBytes = 8 * 1024 * 1024;
+
+    // Upper bound of memory kept in the shared depot per size class.
+    inline constexpr size_t kMaxDepotBytes = 64 * 1024 * 1024;
+
+    constexpr size_t getBlockSizeClass(size_t size) noexcept
+    {
+        return ((size + kBlockSizeClassGranularity - 1) / kBlockSizeClassGranularity) * kBlockSizeClassGranularity;
+    }
+
+    /// <summary>
+    /// Thread-local cache of raw memory blocks for a single size class. Blocks are
+    /// served from the calling thread's cache without any locking, the shared depot
+    /// is only touched when the local cache runs empty or overflows. A block may
+    /// be released on a different thread than the one it was acquired on, it simply
+    /// becomes part of the releasing thread's cache.
+    /// </summary>
+    template<size_t TSizeClass> class BlockCache
+    {
+        static_assert(TSizeClass % kBlockSizeClassGranularity == 0);
+
+        struct FreeBlock
+        {
+            FreeBlock* next;
+        };
+
+        struct FreeList
+        {
+            FreeBlock* head{};
+            size_t count{};
+
+            void push(void* mem) noexcept
+            {
+                auto* block = static_cast<FreeBlock*>(mem);
+                block->next = head;
+                head = block;
+                count++;
+            }
+
+            void* pop() noexcept
+            {
+                auto* block = head;
+                head = block->next;
+                count--;
+                return block;
+            }
+
+            void freeAll() noexcept
+            {
+                while (head != nullptr)
+                {
+                    ::operator delete(pop());
+                }
+            }
+        };
+
+        // Receives the overflow of thread caches and the caches of exiting threads.
+        struct Depot
+        {
+            std::mutex lock;
+            FreeList blocks;
+
+            ~Depot()
+            {
+                blocks.freeAll();
+            }
+        };
+
+        struct ThreadCache
+        {
+            FreeList blocks;
+
+            ~ThreadCache()
+            {
+                flush(blocks, 0);
+                _threadCacheDestroyed = true;
+            }
+        };
+
+        static constexpr size_t kMaxThreadBlocks = kMaxThreadCacheBytes / TSizeClass > 0
+                                                       ? kMaxThreadCacheBytes / TSizeClass
+                                                       : 1;
+        static constexpr size_t kMaxDepotBlocks = kMaxDepotBytes / TSizeClass;
+
+        // Trivially destructible so it remains valid after the thread cache is gone.
+        static inline thread_local bool _threadCacheDestroyed = false;
+
+        static Depot& getDepot() noexcept
+        {
+            static Depot depot;
+            return depot;
+        }
+
+        static ThreadCache& getThreadCache() noexcept
+        {
+            static thread_local ThreadCache cache;
+            return cache;
+        }
+
+        // Moves blocks from the list into the depot until only keep remain,
+        // anything the depot can not hold goes back to the heap.
+        static void flush(FreeList& list, size_t keep) noexcept
+        {
+            auto& depot = getDepot();
+
+            std::lock_guard<std::mutex> guard(depot.lock);
+            while (list.count > keep)
+            {
+                void* mem = list.pop();
+                if (depot.blocks.count < kMaxDepotBlocks)
+                    depot.blocks.push(mem);
+                else
+                    ::operator delete(mem);
+            }
+        }
+
+        static void* acquireShared() noexcept
+        {
+            auto& depot = getDepot();
+
+            std::lock_guard<std::mutex> guard(depot.lock);
+            if (depot.blocks.head == nullptr)
+                return nullptr;
+
+            return depot.blocks.pop();
+        }
+
+        static void refill(FreeList& list) noexcept
+        {
+            auto& depot = getDepot();
+
+            std::lock_guard<std::mutex> guard(depot.lock);
+            for (size_t i = 0; i < kMaxThreadBlocks / 2 && depot.blocks.head != nullptr; i++)
+            {
+                list.push(depot.blocks.pop());
+            }
+        }
+
+    public:
+        static constexpr size_t kBlockSize = TSizeClass;
+
+        /// <summary>
+        /// Returns a block of kBlockSize bytes, the memory is uninitialized.
+        /// </summary>
+        static void* acquire()
+        {
+            if (_threadCacheDestroyed)
+            {
+                if (void* mem = acquireShared(); mem != nullptr)
+                    return mem;
+                return ::operator new(TSizeClass);
+            }
+
+            auto& cache = getThreadCache();
+            if (cache.blocks.head == nullptr)
+            {
+                refill(cache.blocks);
+            }
+
+            if (cache.blocks.head != nullptr)
+                return cache.blocks.pop();
+
+            return ::operator new(TSizeClass);
+        }
+
+        /// <summary>
+        /// Returns a block obtained by acquire to the cache of the calling thread.
+        /// </summary>
+        static void release(void* mem) noexcept
+        {
+            if (mem == nullptr)
+                return;
+
+            if (_threadCacheDestroyed)
+            {
+                FreeList list;
+                list.push(mem);
+                flush(list, 0);
+                return;
+            }
+
+            auto& cache = getThreadCache();
+            cache.blocks.push(mem);
+
+            if (cache.blocks.count > kMaxThreadBlocks)
+            {
+                flush(cache.blocks, kMaxThreadBlocks / 2);
+            }
+        }
+    };
+
+} // namespace zasm::detail
@@ -28,6 +28,8 @@ namespace zasm
         // Serialization.
         EmptyState,
         ImpossibleRelocation,
+        // Parser.
+        InvalidSyntax,
     };
 
     inline constexpr const char* getErrorName(Error err) noexcept
@@ -54,6 +56,7 @@ namespace zasm
             ERROR_STRING(Error::ImpossibleInstruction);
             ERROR_STRING(Error::EmptyState);
             ERROR_STRING(Error::ImpossibleRelocation);
+            ERROR_STRING(Error::InvalidSyntax);
             default:
                 assert(false);
                 break;
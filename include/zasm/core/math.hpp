@@ -1,5 +1,11 @@
 #pragma once
 
+#include <cstdint>
+
+#ifdef _MSC_VER
+#    include <intrin.h>
+#endif
+
 namespace zasm::math
 {
 
@@ -10,4 +16,25 @@ namespace zasm::math
         return val + (align - (val % align));
     }
 
-} // namespace zasm::math
\ No newline at end of file
+    // Index of the lowest set bit, val must not be zero.
+    inline int32_t findFirstSet(uint64_t val) noexcept
+    {
+#ifdef _MSC_VER
+        unsigned long index;
+        _BitScanForward64(&index, val);
+        return static_cast<int32_t>(index);
+#else
+        return __builtin_ctzll(val);
+#endif
+    }
+
+    inline int32_t popCount(uint64_t val) noexcept
+    {
+#ifdef _MSC_VER
+        return static_cast<int32_t>(__popcnt64(val));
+#else
+        return __builtin_popcountll(val);
+#endif
+    }
+
+} // namespace zasm::math
@@ -1,5 +1,7 @@
 ﻿#pragma once
 
+#include "blockcache.hpp"
+
 #include <array>
 #include <cassert>
 #include <cstdint>
@@ -35,9 +37,31 @@ namespace zasm
             size_t used;
         };
 
-        std::vector<std::unique_ptr<Block>> _blocks;
+        // Blocks are recycled through a thread-local cache shared by all pools of the same size class.
+        using BlockCache = detail::BlockCache<detail::getBlockSizeClass(sizeof(Block))>;
+
+        std::vector<Block*> _blocks;
         Entry* _freeItem = nullptr;
 
+        static Block* acquireBlock(BlockId id)
+        {
+            // Only the header fields need to be initialized, entries are set up on allocation.
+            auto* block = ::new (BlockCache::acquire()) Block;
+            block->id = id;
+            block->slot = 0;
+            block->used = 0;
+            return block;
+        }
+
+        void releaseBlocks() noexcept
+        {
+            for (auto* block : _blocks)
+            {
+                BlockCache::release(block);
+            }
+            _blocks.clear();
+        }
+
     public:
         typedef ObjectPool<_Ty> other;
 
@@ -53,9 +77,10 @@ namespace zasm
 
         typedef size_t size_type;
 
-        ObjectPool<_Ty> select_on_container_copy_construction() const
+        // Pools own their blocks and can not be copied, a copied container gets a pool of its own.
+        ObjectPool select_on_container_copy_construction() const
         {
-            return (*this);
+            return ObjectPool{};
         }
 
         template<class _Other> struct rebind
@@ -65,7 +90,39 @@ namespace zasm
 
         ObjectPool()
         {
-            _blocks.push_back(std::make_unique<Block>());
+            _blocks.reserve(1);
+            _blocks.push_back(acquireBlock(0));
+        }
+
+        ObjectPool(const ObjectPool&) = delete;
+        ObjectPool& operator=(const ObjectPool&) = delete;
+
+        // The blocks move along with the pool, the moved-from pool is empty and acquires a new block
+        // on the next allocation.
+        ObjectPool(ObjectPool&& other) noexcept
+            : _blocks(std::move(other._blocks))
+            , _freeItem(other._freeItem)
+        {
+            other._blocks.clear();
+            other._freeItem = nullptr;
+        }
+
+        ObjectPool& operator=(ObjectPool&& other) noexcept
+        {
+            if (this != &other)
+            {
+                releaseBlocks();
+                _blocks = std::move(other._blocks);
+                _freeItem = other._freeItem;
+                other._blocks.clear();
+                other._freeItem = nullptr;
+            }
+            return *this;
+        }
+
+        ~ObjectPool()
+        {
+            releaseBlocks();
         }
 
         pointer address(reference _Val) const noexcept
@@ -78,7 +135,9 @@ namespace zasm
             return std::addressof(_Val);
         }
 
-        template<class _Other> ObjectPool(const ObjectPool<_Other>&)
+        template<class _Other>
+        ObjectPool(const ObjectPool<_Other>&)
+            : ObjectPool()
         {
         }
 
@@ -92,7 +151,7 @@ namespace zasm
             Entry* entry = reinterpret_cast<Entry*>(reinterpret_cast<std::byte*>(_Ptr) - sizeof(EntryHead));
             entry->prev = _freeItem;
 
-            auto* block = _blocks[entry->blockId].get();
+            auto* block = _blocks[entry->blockId];
             block->used--;
 
             _freeItem = entry;
@@ -107,21 +166,22 @@ namespace zasm
                 auto* entry = _freeItem;
                 _freeItem = entry->prev;
 
-                auto* block = _blocks[entry->blockId].get();
+                auto* block = _blocks[entry->blockId];
                 block->used++;
 
                 return reinterpret_cast<pointer>(entry->data);
             }
 
-            auto* block = _blocks.back().get();
-            if (block->slot >= _TBlockSize)
+            auto* block = _blocks.empty() ? nullptr : _blocks.back();
+            if (block == nullptr || block->slot >= _TBlockSize)
             {
                 const BlockId id = static_cast<BlockId>(_blocks.size());
 
-                _blocks.push_back(std::make_unique<Block>());
-
-                block = _blocks.back().get();
-                block->id = id;
+                // Reserved first so the block can not leak if the vector fails to grow.
+                if (_blocks.size() == _blocks.capacity())
+                    _blocks.reserve(_blocks.size() * 2 + 1);
+                block = acquireBlock(id);
+                _blocks.push_back(block);
             }
 
             auto& entry = block->storage[block->slot];
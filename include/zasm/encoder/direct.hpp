@@ -0,0 +1,340 @@
+#pragma once
+
+#include <Zydis/Zydis.h>
+#include <cstdint>
+#include <limits>
+
+namespace zasm::detail::direct
+{
+    // Encoding primitives for the most common gp register forms in long mode. All functions are
+    // constexpr so they are shared by the runtime encoder and the StaticAssembler.
+    //
+    // Writers have to provide:
+    //   void emit8(uint8_t), emit16(uint16_t), emit32(uint32_t), emit64(uint64_t)
+    //   void emitImm(uint64_t value, uint8_t size) for immediate fields.
+
+    struct Gp
+    {
+        uint8_t index{};
+        bool is64{};
+    };
+
+    struct Mem
+    {
+        uint8_t base{};
+        int8_t index{ -1 };
+        uint8_t scaleBits{};
+        int32_t disp{};
+        int32_t size{};
+        // disp32 relative to the end of the instruction, base and index are ignored.
+        bool isRipRel{};
+    };
+
+    struct Operand
+    {
+        enum class Kind : uint8_t
+        {
+            None,
+            Gp,
+            Mem,
+            Imm,
+        };
+
+        Kind kind{};
+        Gp gp{};
+        Mem mem{};
+        int64_t imm{};
+    };
+
+    constexpr bool isInt8(int64_t val) noexcept
+    {
+        return val >= std::numeric_limits<int8_t>::min() && val <= std::numeric_limits<int8_t>::max();
+    }
+
+    constexpr bool isInt32(int64_t val) noexcept
+    {
+        return val >= std::numeric_limits<int32_t>::min() && val <= std::numeric_limits<int32_t>::max();
+    }
+
+    constexpr bool getGp(ZydisRegister id, Gp& gp) noexcept
+    {
+        if (id >= ZYDIS_REGISTER_EAX && id <= ZYDIS_REGISTER_R15D)
+        {
+            gp = Gp{ static_cast<uint8_t>(id - ZYDIS_REGISTER_EAX), false };
+            return true;
+        }
+        if (id >= ZYDIS_REGISTER_RAX && id <= ZYDIS_REGISTER_R15)
+        {
+            gp = Gp{ static_cast<uint8_t>(id - ZYDIS_REGISTER_RAX), true };
+            return true;
+        }
+        return false;
+    }
+
+    constexpr bool getScaleBits(uint8_t scale, uint8_t& scaleBits) noexcept
+    {
+        switch (scale)
+        {
+            case 1:
+                scaleBits = 0;
+                return true;
+            case 2:
+                scaleBits = 1;
+                return true;
+            case 4:
+                scaleBits = 2;
+                return true;
+            case 8:
+                scaleBits = 3;
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    template<typename TWriter>
+    constexpr void emitRex(TWriter& w, bool is64, uint8_t reg, uint8_t index, uint8_t base) noexcept
+    {
+        const uint8_t rex = (is64 ? 0x08 : 0) | ((reg & 8) >> 1) | ((index & 8) >> 2) | ((base & 8) >> 3);
+        if (rex != 0)
+        {
+            w.emit8(0x40 | rex);
+        }
+    }
+
+    template<typename TWriter>
+    constexpr void emitRegReg(TWriter& w, bool is64, uint8_t opcode, uint8_t reg, uint8_t rm) noexcept
+    {
+        emitRex(w, is64, reg, 0, rm);
+        w.emit8(opcode);
+        w.emit8(0xC0 | ((reg & 7) << 3) | (rm & 7));
+    }
+
+    template<typename TWriter>
+    constexpr void emitRegMem(TWriter& w, bool is64, uint8_t opcode, uint8_t reg, const Mem& mem) noexcept
+    {
+        if (mem.isRipRel)
+        {
+            emitRex(w, is64, reg, 0, 0);
+            w.emit8(opcode);
+            w.emit8(((reg & 7) << 3) | 5);
+            w.emit32(static_cast<uint32_t>(mem.disp));
+            return;
+        }
+
+        const bool hasIndex = mem.index != -1;
+        const uint8_t index = hasIndex ? static_cast<uint8_t>(mem.index) : 0;
+
+        emitRex(w, is64, reg, index, mem.base);
+        w.emit8(opcode);
+
+        // rbp and r13 as base can not be encoded without a displacement.
+        uint8_t mod = 2;
+        if (mem.disp == 0 && (mem.base & 7) != 5)
+            mod = 0;
+        else if (isInt8(mem.disp))
+            mod = 1;
+
+        // rsp and r12 as base always require a SIB byte.
+        if (hasIndex || (mem.base & 7) == 4)
+        {
+            w.emit8((mod << 6) | ((reg & 7) << 3) | 4);
+            w.emit8((mem.scaleBits << 6) | ((hasIndex ? (index & 7) : 4) << 3) | (mem.base & 7));
+        }
+        else
+        {
+            w.emit8((mod << 6) | ((reg & 7) << 3) | (mem.base & 7));
+        }
+
+        if (mod == 1)
+            w.emit8(static_cast<uint8_t>(mem.disp));
+        else if (mod == 2)
+            w.emit32(static_cast<uint32_t>(mem.disp));
+    }
+
+    constexpr int8_t getAluIndex(ZydisMnemonic id) noexcept
+    {
+        switch (id)
+        {
+            case ZYDIS_MNEMONIC_ADD:
+                return 0;
+            case ZYDIS_MNEMONIC_OR:
+                return 1;
+            case ZYDIS_MNEMONIC_ADC:
+                return 2;
+            case ZYDIS_MNEMONIC_SBB:
+                return 3;
+            case ZYDIS_MNEMONIC_AND:
+                return 4;
+            case ZYDIS_MNEMONIC_SUB:
+                return 5;
+            case ZYDIS_MNEMONIC_XOR:
+                return 6;
+            case ZYDIS_MNEMONIC_CMP:
+                return 7;
+            default:
+                return -1;
+        }
+    }
+
+    constexpr int8_t getConditionCode(ZydisMnemonic id) noexcept
+    {
+        switch (id)
+        {
+            case ZYDIS_MNEMONIC_JO:
+                return 0x0;
+            case ZYDIS_MNEMONIC_JNO:
+                return 0x1;
+            case ZYDIS_MNEMONIC_JB:
+                return 0x2;
+            case ZYDIS_MNEMONIC_JNB:
+                return 0x3;
+            case ZYDIS_MNEMONIC_JZ:
+                return 0x4;
+            case ZYDIS_MNEMONIC_JNZ:
+                return 0x5;
+            case ZYDIS_MNEMONIC_JBE:
+                return 0x6;
+            case ZYDIS_MNEMONIC_JNBE:
+                return 0x7;
+            case ZYDIS_MNEMONIC_JS:
+                return 0x8;
+            case ZYDIS_MNEMONIC_JNS:
+                return 0x9;
+            case ZYDIS_MNEMONIC_JP:
+                return 0xA;
+            case ZYDIS_MNEMONIC_JNP:
+                return 0xB;
+            case ZYDIS_MNEMONIC_JL:
+                return 0xC;
+            case ZYDIS_MNEMONIC_JNL:
+                return 0xD;
+            case ZYDIS_MNEMONIC_JLE:
+                return 0xE;
+            case ZYDIS_MNEMONIC_JNLE:
+                return 0xF;
+            default:
+                return -1;
+        }
+    }
+
+    // mov, add, or, adc, sbb, and, sub, xor, cmp and test with 32/64 bit gp registers.
+    // Returns false if the form is not supported, the writer may be partially written in that case.
+    template<typename TWriter>
+    constexpr bool encodeBinary(TWriter& w, ZydisMnemonic id, const Operand& dst, const Operand& src) noexcept
+    {
+        const auto aluIndex = getAluIndex(id);
+        const bool isMov = id == ZYDIS_MNEMONIC_MOV;
+        const bool isTest = id == ZYDIS_MNEMONIC_TEST;
+        if (aluIndex == -1 && !isMov && !isTest)
+            return false;
+
+        // Opcode of the r/m, reg form.
+        const uint8_t opcodeMr = isMov ? 0x89 : isTest ? 0x85 : static_cast<uint8_t>(aluIndex * 8 + 1);
+
+        if (dst.kind == Operand::Kind::Gp)
+        {
+            const auto& dstGp = dst.gp;
+            if (src.kind == Operand::Kind::Gp)
+            {
+                if (src.gp.is64 != dstGp.is64)
+                    return false;
+
+                emitRegReg(w, dstGp.is64, opcodeMr, src.gp.index, dstGp.index);
+                return true;
+            }
+
+            if (src.kind == Operand::Kind::Mem)
+            {
+                if (isTest || src.mem.size != (dstGp.is64 ? 8 : 4))
+                    return false;
+
+                emitRegMem(w, dstGp.is64, opcodeMr + 2, dstGp.index, src.mem);
+                return true;
+            }
+
+            if (src.kind != Operand::Kind::Imm)
+                return false;
+
+            const auto imm = src.imm;
+            if (isMov)
+            {
+                if (dstGp.is64 && isInt32(imm))
+                {
+                    emitRegReg(w, true, 0xC7, 0, dstGp.index);
+                    w.emitImm(static_cast<uint64_t>(imm), 4);
+                }
+                else if (dstGp.is64)
+                {
+                    emitRex(w, true, 0, 0, dstGp.index);
+                    w.emit8(0xB8 + (dstGp.index & 7));
+                    w.emitImm(static_cast<uint64_t>(imm), 8);
+                }
+                else if (isInt32(imm))
+                {
+                    emitRex(w, false, 0, 0, dstGp.index);
+                    w.emit8(0xB8 + (dstGp.index & 7));
+                    w.emitImm(static_cast<uint64_t>(imm), 4);
+                }
+                else
+                {
+                    return false;
+                }
+                return true;
+            }
+
+            if (!isInt32(imm))
+                return false;
+
+            if (!isTest && isInt8(imm))
+            {
+                emitRegReg(w, dstGp.is64, 0x83, aluIndex, dstGp.index);
+                w.emitImm(static_cast<uint64_t>(imm), 1);
+            }
+            else if (dstGp.index == 0)
+            {
+                // Short form for the accumulator.
+                emitRex(w, dstGp.is64, 0, 0, 0);
+                w.emit8(isTest ? 0xA9 : static_cast<uint8_t>(aluIndex * 8 + 5));
+                w.emitImm(static_cast<uint64_t>(imm), 4);
+            }
+            else
+            {
+                emitRegReg(w, dstGp.is64, isTest ? 0xF7 : 0x81, isTest ? 0 : aluIndex, dstGp.index);
+                w.emitImm(static_cast<uint64_t>(imm), 4);
+            }
+            return true;
+        }
+
+        if (dst.kind != Operand::Kind::Mem || (dst.mem.size != 4 && dst.mem.size != 8))
+            return false;
+
+        const auto& mem = dst.mem;
+        const bool is64 = mem.size == 8;
+        if (src.kind == Operand::Kind::Gp)
+        {
+            if (src.gp.is64 != is64)
+                return false;
+
+            emitRegMem(w, is64, opcodeMr, src.gp.index, mem);
+            return true;
+        }
+
+        if (src.kind != Operand::Kind::Imm || !isInt32(src.imm))
+            return false;
+
+        const auto imm = src.imm;
+        if (!isMov && !isTest && isInt8(imm))
+        {
+            emitRegMem(w, is64, 0x83, aluIndex, mem);
+            w.emitImm(static_cast<uint64_t>(imm), 1);
+        }
+        else
+        {
+            emitRegMem(w, is64, isMov ? 0xC7 : isTest ? 0xF7 : 0x81, isMov || isTest ? 0 : aluIndex, mem);
+            w.emitImm(static_cast<uint64_t>(imm), 4);
+        }
+        return true;
+    }
+
+} // namespace zasm::detail::direct
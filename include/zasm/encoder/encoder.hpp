@@ -2,7 +2,9 @@
 
 #include <array>
 #include <cstdint>
+#include <cstddef>
 #include <zasm/core/errors.hpp>
+#include <zasm/program/align.hpp>
 #include <zasm/program/instruction.hpp>
 
 namespace zasm
@@ -36,9 +38,32 @@ namespace zasm
         EncoderResult& buf, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps,
         const EncoderOperands& operands) noexcept;
 
+    // Same as encodeEstimated but always encodes with Zydis, the specialized encoders for common
+    // forms are skipped. This is the reference the specialized encoders are verified against.
+    Error encodeEstimatedGeneric(
+        EncoderResult& buf, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps,
+        const EncoderOperands& operands) noexcept;
+
+    // Encodes only with the specialized encoders, these cover the most common gp register forms of
+    // mov, arithmetic, test, lea, push, pop, ret and relative branches in long mode.
+    // Returns false if the form has no specialized encoder, encodeEstimated and encodeFull fall back
+    // to Zydis in that case.
+    bool encodeEstimatedDirect(
+        EncoderResult& buf, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps,
+        const EncoderOperands& operands) noexcept;
+
     // Encodes with full context. This function still allows labels to be unbound and will not error
     // instead a temporary value be usually encoded. It is expected for the serialization to handle this
     // with multiple passes.
     Error encodeFull(EncoderResult& buf, EncoderContext& ctx, ZydisMachineMode mode, const Instruction& instr) noexcept;
 
+    // Same as above but from operands, this is used when no instruction exists such as for streamed code.
+    Error encodeFull(
+        EncoderResult& buf, EncoderContext& ctx, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id,
+        size_t numOps, const EncoderOperands& operands) noexcept;
+
+    // Writes len bytes of padding to buf, code is padded with the fewest multi-byte nops of at most 11 bytes
+    // and data with zeros. 16 bit modes use single byte nops as the multi-byte forms have a different length.
+    void encodePadding(uint8_t* buf, size_t len, ZydisMachineMode mode, Align::Type type) noexcept;
+
 } // namespace zasm
\ No newline at end of file
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <string_view>
+#include <zasm/core/errors.hpp>
+
+namespace zasm
+{
+    class Assembler;
+
+    namespace detail
+    {
+        struct ParserState;
+    }
+
+    /// <summary>
+    /// Parses Intel syntax assembly text and emits it through the assembler, the output
+    /// of the formatter is accepted as input. Each line holds a label, a section, a data
+    /// directive or an instruction, text after ';' is ignored.
+    /// Labels are referenced by name, labels created by the parser are reused across calls.
+    /// </summary>
+    class Parser
+    {
+        detail::ParserState* _state;
+
+    public:
+        Parser(Assembler& assembler);
+        Parser(const Parser&) = delete;
+        ~Parser();
+
+        Parser& operator=(const Parser&) = delete;
+
+    public:
+        /// <summary>
+        /// Parses the text and emits each line at the current cursor of the assembler.
+        /// Parsing stops at the first line that fails.
+        /// </summary>
+        /// <param name="text">Assembly text, lines separated by '\n'</param>
+        /// <returns>Error::None on success, Error::InvalidSyntax or the error of the assembler otherwise</returns>
+        Error parse(std::string_view text);
+
+        /// <summary>
+        /// Returns the line number of the last parsed line, starting at 1. When parse fails
+        /// this is the line that caused the error.
+        /// </summary>
+        size_t getLine() const noexcept;
+    };
+
+} // namespace zasm
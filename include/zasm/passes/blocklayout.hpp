@@ -0,0 +1,89 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct BlockLayoutState;
+    }
+
+    namespace passes
+    {
+        struct BlockLayoutStats
+        {
+            size_t numHotBlocks{};
+            size_t numColdBlocks{};
+            // Chains of hot blocks after merging, every chain is laid out without jumps between its blocks.
+            size_t numChains{};
+            // Jumps inserted for blocks no longer followed by their fallthrough.
+            size_t numJumpsInserted{};
+            // Encoded size of the instructions in hot and cold blocks, including inserted jumps.
+            size_t hotSize{};
+            size_t coldSize{};
+        };
+
+        /// <summary>
+        /// Orders the basic blocks by their execution counts. Hot blocks are merged into chains
+        /// along the heaviest edges and the chains are placed by weight, as in Pettis and Hansen.
+        /// Cold blocks are moved into a separate code section at the end of the program. The first
+        /// block of the program and of each section stays in place. Blocks no longer followed by
+        /// their fallthrough get a jump to it. Running JumpThreading afterwards inverts conditional
+        /// branches over these jumps.
+        /// Weights can be given for any node and apply to its block. Blocks without a weight take the
+        /// weight of the block falling into them, all others have a weight of zero. Runs of code that
+        /// fall into data are left unchanged.
+        /// </summary>
+        class BlockLayout
+        {
+            detail::BlockLayoutState* _state;
+
+        public:
+            BlockLayout();
+            BlockLayout(const BlockLayout&) = delete;
+            ~BlockLayout();
+
+            BlockLayout& operator=(const BlockLayout&) = delete;
+
+        public:
+            /// <summary>
+            /// Sets the execution count of the block the label is bound in.
+            /// </summary>
+            void setWeight(const Label& label, uint64_t weight);
+
+            /// <summary>
+            /// Sets the execution count of the block containing the node.
+            /// </summary>
+            void setWeight(const Node* node, uint64_t weight);
+
+            /// <summary>
+            /// Removes all weights.
+            /// </summary>
+            void clearWeights() noexcept;
+
+            /// <summary>
+            /// Blocks with a weight at or below the threshold are cold, the default is zero.
+            /// </summary>
+            void setColdThreshold(uint64_t threshold) noexcept;
+
+            /// <summary>
+            /// Sets the name of the section created for cold blocks, the default is ".text.cold".
+            /// </summary>
+            void setColdSectionName(const char* name);
+
+            /// <summary>
+            /// Reorders the blocks, nothing is changed if no weights were given.
+            /// </summary>
+            Error run(Program& program);
+
+            const BlockLayoutStats& getStats() const noexcept;
+        };
+
+    } // namespace passes
+
+} // namespace zasm
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/label.hpp>
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct DeadCodeEliminationState;
+    }
+
+    namespace passes
+    {
+        struct DeadCodeEliminationStats
+        {
+            // Blocks that can not be reached from any entry.
+            size_t numUnreachableBlocks{};
+            // Instructions removed, including the ones of unreachable blocks.
+            size_t numRemovedInstructions{};
+            size_t numRemovedLabels{};
+            // Encoded size saved in bytes.
+            size_t bytesSaved{};
+        };
+
+        /// <summary>
+        /// Removes code that has no effect on the program: blocks unreachable from the entries of the
+        /// analysis::ControlFlowGraph, instructions without side effects whose registers and flags are
+        /// dead and labels no longer referenced by anything. Labels with a name are kept.
+        /// Instructions that access memory, use lock or rep prefixes, can fault or write anything else
+        /// than general purpose registers and flags are never removed.
+        /// </summary>
+        class DeadCodeElimination
+        {
+            detail::DeadCodeEliminationState* _state;
+
+        public:
+            DeadCodeElimination();
+            DeadCodeElimination(const DeadCodeElimination&) = delete;
+            ~DeadCodeElimination();
+
+            DeadCodeElimination& operator=(const DeadCodeElimination&) = delete;
+
+        public:
+            /// <summary>
+            /// Keeps the code at the label reachable, for labels entered from outside of the program
+            /// such as functions looked up by their address after serialization.
+            /// </summary>
+            void addEntry(const Label& label);
+
+            /// <summary>
+            /// Removes the dead code, the analysis is done once so removing an instruction does not make
+            /// instructions of other blocks dead in the same run.
+            /// </summary>
+            Error run(Program& program);
+
+            const DeadCodeEliminationStats& getStats() const noexcept;
+        };
+
+    } // namespace passes
+
+} // namespace zasm
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstddef>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct JumpThreadingState;
+    }
+
+    namespace passes
+    {
+        struct JumpThreadingStats
+        {
+            // Branches retargeted to the end of a jump chain.
+            size_t numThreaded{};
+            // Conditional branches over a jump replaced by the inverted branch.
+            size_t numInverted{};
+            // Branches to the directly following node removed.
+            size_t numRemoved{};
+        };
+
+        /// <summary>
+        /// Shortens the paths taken by direct jumps. Branches to a label whose code starts with an
+        /// unconditional jump are retargeted to the final destination of the chain, a conditional
+        /// branch over an unconditional jump becomes the inverted branch to the jump target and
+        /// branches to the next node are removed. Chains are resolved once per label, cycles of jumps
+        /// are left as they are.
+        /// Short only branches such as loop and jrcxz are never changed as their target could
+        /// become out of range.
+        /// </summary>
+        class JumpThreading
+        {
+            detail::JumpThreadingState* _state;
+
+        public:
+            JumpThreading();
+            JumpThreading(const JumpThreading&) = delete;
+            ~JumpThreading();
+
+            JumpThreading& operator=(const JumpThreading&) = delete;
+
+        public:
+            Error run(Program& program);
+
+            const JumpThreadingStats& getStats() const noexcept;
+        };
+
+    } // namespace passes
+
+} // namespace zasm
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/program.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct PeepholeState;
+    }
+
+    namespace passes
+    {
+        struct PeepholeStats
+        {
+            // Instructions removed without replacement.
+            size_t numRemoved{};
+            // Instructions or sequences replaced by shorter instructions.
+            size_t numReplaced{};
+            // Encoded size saved in bytes.
+            size_t bytesSaved{};
+        };
+
+        /// <summary>
+        /// Rewrites short instruction sequences into cheaper equivalents. Rules are looked up by the
+        /// mnemonic of each instruction and may inspect the following nodes, the program is walked once.
+        /// Rules that change flags only apply where the flags are dead according to analysis::Liveness.
+        /// Instructions without meta data are left as is.
+        /// </summary>
+        class Peephole
+        {
+            detail::PeepholeState* _state;
+
+        public:
+            Peephole();
+            Peephole(const Peephole&) = delete;
+            ~Peephole();
+
+            Peephole& operator=(const Peephole&) = delete;
+
+        public:
+            /// <summary>
+            /// Applies the rules to the program, the following rewrites are done:
+            /// mov of a register to itself is removed, except for 32 bit registers in 64 bit mode.
+            /// mov reg, 0 becomes xor reg32, reg32 if the flags are dead.
+            /// mov reg64, imm becomes mov reg32, imm if the value fits in 32 bits unsigned.
+            /// jmp to a label bound directly after it is removed.
+            /// Chains of add and sub with immediates on the same register are folded into a single
+            /// add, inc or dec if the flags are dead.
+            /// </summary>
+            Error run(Program& program);
+
+            const PeepholeStats& getStats() const noexcept;
+        };
+
+    } // namespace passes
+
+} // namespace zasm
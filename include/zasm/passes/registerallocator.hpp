@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <zasm/analysis/regset.hpp>
+#include <zasm/core/errors.hpp>
+#include <zasm/program/program.hpp>
+#include <zasm/program/register.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct RegisterAllocatorState;
+    }
+
+    namespace passes
+    {
+        struct RegisterAllocatorStats
+        {
+            // Virtual registers found in the program.
+            size_t numVirtualRegs{};
+            // Virtual registers kept in memory for their entire lifetime.
+            size_t numSpilled{};
+            // Loads and stores inserted for spilled registers.
+            size_t numSpillInstructions{};
+            // Bytes used at the spill area, see RegisterAllocator::setSpillArea.
+            int32_t spillAreaSize{};
+        };
+
+        /// <summary>
+        /// Replaces the virtual registers of a Program with physical general purpose registers using
+        /// linear scan allocation over live intervals. Physical registers used by the program, including
+        /// hidden operands such as rdx of mul, are never assigned while they are live. Registers written
+        /// by the program are considered live at calls and where control leaves the program.
+        /// Registers that do not fit are spilled to the spill area, a few allocatable registers are then
+        /// reserved to load and store them around each instruction.
+        /// </summary>
+        class RegisterAllocator
+        {
+            detail::RegisterAllocatorState* _state;
+
+        public:
+            RegisterAllocator();
+            RegisterAllocator(const RegisterAllocator&) = delete;
+            ~RegisterAllocator();
+
+            RegisterAllocator& operator=(const RegisterAllocator&) = delete;
+
+        public:
+            /// <summary>
+            /// Sets the registers that may be assigned, keyed by root. Defaults to all general purpose
+            /// registers except the stack and frame pointer.
+            /// </summary>
+            void setAllocatable(const analysis::RegSet& regs);
+
+            /// <summary>
+            /// Sets the registers a call may modify, virtual registers live across a call are never kept
+            /// in them. Defaults to all allocatable registers as no calling convention is known.
+            /// </summary>
+            void setCallClobbered(const analysis::RegSet& regs);
+
+            /// <summary>
+            /// Spilled registers are stored at [base + offset + slot * width], the caller has to reserve
+            /// RegisterAllocatorStats::spillAreaSize bytes there. Defaults to the stack pointer. The program
+            /// may not modify the base other than by calls and returns, push and pop move the stack pointer.
+            /// </summary>
+            void setSpillArea(const operands::Gp& base, int32_t offset);
+
+            /// <summary>
+            /// Allocates and rewrites all instructions of the program that use virtual registers.
+            /// </summary>
+            /// <returns>Error::None on success, Error::InvalidParameter if too few registers are allocatable,
+            /// Error::InvalidOperation if registers are spilled and the program modifies the spill base</returns>
+            Error run(Program& program);
+
+            const RegisterAllocatorStats& getStats() const noexcept;
+        };
+
+    } // namespace passes
+
+} // namespace zasm
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstdint>
+
+namespace zasm
+{
+    /// <summary>
+    /// Pads the code to the next multiple of the alignment when serialized, the padding depends on
+    /// the final address and is recomputed in every pass of the serializer.
+    /// </summary>
+    class Align
+    {
+    public:
+        enum class Type : uint8_t
+        {
+            // Padded with the fewest multi-byte nops, the padding may be executed.
+            Code,
+            // Padded with zeros.
+            Data,
+        };
+
+    private:
+        Type _type{ Type::Code };
+        int32_t _align{};
+
+    public:
+        constexpr Align() noexcept = default;
+        constexpr Align(Type type, int32_t align) noexcept
+            : _type{ type }
+            , _align{ align }
+        {
+        }
+
+        constexpr Type getType() const noexcept
+        {
+            return _type;
+        }
+
+        constexpr int32_t getAlign() const noexcept
+        {
+            return _align;
+        }
+    };
+
+} // namespace zasm
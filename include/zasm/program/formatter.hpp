@@ -1,7 +1,12 @@
 #pragma once
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdio>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
 #include <zasm/core/enumflags.hpp>
 
 namespace zasm
@@ -9,6 +14,7 @@ namespace zasm
     class Program;
     class Node;
     class Instruction;
+    class Serializer;
 } // namespace zasm
 
 namespace zasm::formatter
@@ -20,6 +26,8 @@ namespace zasm::formatter
             None = 0,
             HexOffsets = (1u << 0),
             HexImmediates = (1u << 1),
+            // Prints the names of named labels instead of L<id>, always on in annotated output.
+            LabelNames = (1u << 2),
         };
         ZASM_ENABLE_ENUM_OPERATORS(FormatOptions);
 
@@ -27,6 +35,157 @@ namespace zasm::formatter
 
     using Options = detail::FormatOptions;
 
+    /// <summary>
+    /// Receives the formatted text in chunks, the data is not null terminated.
+    /// </summary>
+    using WriteCallback = void (*)(void* userData, const char* data, size_t len);
+
+    /// <summary>
+    /// Growable text buffer made of fixed size chunks, clearing it keeps the
+    /// chunks around so the buffer can be reused without allocating again.
+    /// </summary>
+    class Buffer
+    {
+        static constexpr size_t kChunkSize = 64 * 1024;
+
+        std::vector<std::unique_ptr<char[]>> _chunks;
+        size_t _size{};
+
+    public:
+        void append(const char* data, size_t len);
+
+        /// <summary>
+        /// Resets the size to zero, previously allocated chunks are retained.
+        /// </summary>
+        void clear() noexcept;
+
+        size_t size() const noexcept;
+
+        size_t getChunkCount() const noexcept;
+
+        /// <summary>
+        /// Returns the used part of the chunk at the specified index.
+        /// </summary>
+        std::string_view getChunk(size_t index) const noexcept;
+
+        /// <summary>
+        /// Returns the entire content as a single string.
+        /// </summary>
+        std::string str() const;
+    };
+
+    /// <summary>
+    /// Formats the specified range and passes the text to the callback, 'to' is not inclusive.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="from">First node</param>
+    /// <param name="to">Last node</param>
+    /// <param name="callback">Receives the text in chunks</param>
+    /// <param name="userData">Passed to the callback</param>
+    /// <param name="options">Format options</param>
+    /// <returns>Amount of characters written</returns>
+    size_t format(Program& program, const Node* from, const Node* to, WriteCallback callback, void* userData, Options options = {});
+
+    /// <summary>
+    /// Formats the entire program and passes the text to the callback.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="callback">Receives the text in chunks</param>
+    /// <param name="userData">Passed to the callback</param>
+    /// <param name="options">Format options</param>
+    /// <returns>Amount of characters written</returns>
+    size_t format(Program& program, WriteCallback callback, void* userData, Options options = {});
+
+    /// <summary>
+    /// Formats the entire program annotated with the layout of the serialized program, each line
+    /// is prefixed with the address, length and encoded bytes of the node. Branch targets are resolved
+    /// to the labels bound at that address. The serializer must hold the result of serializing this
+    /// program, if the program changed since then the output is not annotated.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="serializer">Serializer holding the serialized program</param>
+    /// <param name="callback">Receives the text in chunks</param>
+    /// <param name="userData">Passed to the callback</param>
+    /// <param name="options">Format options</param>
+    /// <returns>Amount of characters written</returns>
+    size_t format(
+        Program& program, const Serializer& serializer, WriteCallback callback, void* userData, Options options = {});
+
+    /// <summary>
+    /// Formats the entire program annotated with the serialized layout and results the generated text.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="serializer">Serializer holding the serialized program</param>
+    /// <param name="options">Format options</param>
+    std::string toString(Program& program, const Serializer& serializer, Options options = {});
+
+    /// <summary>
+    /// Formats the entire program annotated with the serialized layout directly into the file.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="serializer">Serializer holding the serialized program</param>
+    /// <param name="file">The file to write to</param>
+    /// <param name="options">Format options</param>
+    /// <returns>Amount of characters written</returns>
+    size_t toFile(Program& program, const Serializer& serializer, std::FILE* file, Options options = {});
+
+    /// <summary>
+    /// Formats the entire program using multiple threads, the node list is split into
+    /// ranges which are formatted concurrently. The callback is invoked on the calling
+    /// thread in program order, the result is identical to format.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="callback">Receives the text in chunks</param>
+    /// <param name="userData">Passed to the callback</param>
+    /// <param name="options">Format options</param>
+    /// <param name="threadCount">Maximum amount of threads, 0 uses the hardware concurrency</param>
+    /// <returns>Amount of characters written</returns>
+    size_t formatParallel(
+        Program& program, WriteCallback callback, void* userData, Options options = {}, size_t threadCount = 0);
+
+    /// <summary>
+    /// Formats the entire program using multiple threads and results the generated text.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="options">Format options</param>
+    /// <param name="threadCount">Maximum amount of threads, 0 uses the hardware concurrency</param>
+    std::string toStringParallel(Program& program, Options options = {}, size_t threadCount = 0);
+
+    /// <summary>
+    /// Formats the entire program directly into the file.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="file">The file to write to</param>
+    /// <param name="options">Format options</param>
+    /// <returns>Amount of characters written</returns>
+    size_t toFile(Program& program, std::FILE* file, Options options = {});
+
+    /// <summary>
+    /// Formats the entire program and appends the text to the buffer.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="buffer">The buffer that receives the text</param>
+    /// <param name="options">Format options</param>
+    /// <returns>Amount of characters written</returns>
+    size_t toBuffer(Program& program, Buffer& buffer, Options options = {});
+
+    /// <summary>
+    /// Formats the entire program into the output iterator.
+    /// </summary>
+    /// <param name="program">The program to print as text</param>
+    /// <param name="out">Output iterator receiving the characters</param>
+    /// <param name="options">Format options</param>
+    /// <returns>The output iterator past the last written character</returns>
+    template<typename TOutputIt> TOutputIt toOutput(Program& program, TOutputIt out, Options options = {})
+    {
+        const auto writeFn = [](void* userData, const char* data, size_t len) {
+            auto& it = *static_cast<TOutputIt*>(userData);
+            it = std::copy(data, data + len, it);
+        };
+        format(program, writeFn, &out, options);
+        return out;
+    }
+
     /// <summary>
     /// Formats the entire program and results the generated text.
     /// </summary>
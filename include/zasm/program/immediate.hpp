@@ -18,7 +18,7 @@ namespace zasm::operands
         {
         }
         constexpr Imm(uint32_t imm) noexcept
-            : u{ imm }
+            : s{ imm }
         {
         }
         constexpr Imm(int32_t imm) noexcept
@@ -30,7 +30,7 @@ namespace zasm::operands
         {
         }
         constexpr Imm(uint64_t imm) noexcept
-            : u{ imm }
+            : s{ static_cast<int64_t>(imm) }
         {
         }
 
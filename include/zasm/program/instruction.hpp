@@ -150,6 +150,30 @@ namespace zasm
             XSAVEOPT = ZYDIS_CATEGORY_XSAVEOPT,
         };
 
+        struct InstructionFlags
+        {
+            uint32_t read;
+            uint32_t write;
+            uint32_t undefined;
+        };
+
+        // Meta data that is identical for all instructions of the same form, instructions only
+        // reference an interned copy.
+        struct InstructionMeta
+        {
+            std::array<ZydisOperandActions, ZYDIS_MAX_OPERAND_COUNT> access{};
+            std::array<Operand::Visibility, ZYDIS_MAX_OPERAND_COUNT> opsVisibility{};
+            std::array<Operand::Encoding, ZYDIS_MAX_OPERAND_COUNT> opsEncoding{};
+            InstructionFlags flags{};
+            InstructionEncoding encoding{};
+            InstructionCategory category{};
+        };
+
+        inline constexpr InstructionMeta kEmptyInstructionMeta{};
+
+        // Returns the shared copy of meta, entries are never released. Thread safe.
+        const InstructionMeta* internInstructionMeta(const InstructionMeta& meta);
+
     } // namespace detail
 
 #pragma pack(push, 1)
@@ -164,54 +188,75 @@ namespace zasm
         using Mnemonic = uint16_t;
 #endif
         using Operands = std::array<Operand, ZYDIS_MAX_OPERAND_COUNT>;
-        using Access = std::array<ZydisOperandActions, ZYDIS_MAX_OPERAND_COUNT>;
-        using OperandsVisibility = std::array<Operand::Visibility, ZYDIS_MAX_OPERAND_COUNT>;
-        using OperandsEncoding = std::array<Operand::Encoding, ZYDIS_MAX_OPERAND_COUNT>;
+        using Access = decltype(detail::InstructionMeta::access);
+        using OperandsVisibility = decltype(detail::InstructionMeta::opsVisibility);
+        using OperandsEncoding = decltype(detail::InstructionMeta::opsEncoding);
         using Encoding = detail::InstructionEncoding;
         using Length = uint8_t;
         using Attribs = detail::InstructionAttribs;
         using Category = detail::InstructionCategory;
-
-        struct Flags
-        {
-            uint32_t read;
-            uint32_t write;
-            uint32_t undefined;
-        };
+        using Flags = detail::InstructionFlags;
 
     private:
         const Operands _operands{};
         const size_t _opCount{};
+        // Shared by all instructions of the same form, never null.
+        const detail::InstructionMeta* _meta{ &detail::kEmptyInstructionMeta };
         const Mnemonic _id{};
-        const Access _access{};
-        const OperandsVisibility _opsVisibility{};
-        const OperandsEncoding _opsEncoding{};
-        const Encoding _encoding{};
-        const Flags _flags{};
-        const Category _category{};
         const Attribs _attribs{};
         const Length _length{};
 
     public:
         constexpr Instruction() noexcept = default;
-        constexpr Instruction(
+        Instruction(
             Attribs attribs, ZydisMnemonic mnemonic, size_t opCount, const Operands& operands, const Access& access,
             const OperandsVisibility& opsVisibility, const OperandsEncoding& opsEncoding, const Flags& flags,
-            const Encoding& encoding, const Category& category, Length length = 0) noexcept
+            const Encoding& encoding, const Category& category, Length length = 0)
             : _operands{ operands }
             , _opCount{ opCount }
+            , _meta{ detail::internInstructionMeta({ access, opsVisibility, opsEncoding, flags, encoding, category }) }
             , _id{ static_cast<Mnemonic>(mnemonic) }
-            , _access{ access }
-            , _opsVisibility{ opsVisibility }
-            , _opsEncoding{ opsEncoding }
-            , _encoding{ encoding }
-            , _flags{ flags }
-            , _category{ category }
             , _attribs{ attribs }
             , _length{ length }
         {
         }
 
+        /// <summary>
+        /// Creates an instruction with the meta data of form and different operands, the operands
+        /// must be of the same kind as the ones of form.
+        /// </summary>
+        constexpr Instruction(const Instruction& form, const Operands& operands) noexcept
+            : _operands{ operands }
+            , _opCount{ form._opCount }
+            , _meta{ form._meta }
+            , _id{ form._id }
+            , _attribs{ form._attribs }
+            , _length{ form._length }
+        {
+        }
+
+        /// <summary>
+        /// Creates an instruction without meta data, it holds only what is required to encode it.
+        /// The instruction is not validated, invalid instructions fail when serialized.
+        /// </summary>
+        constexpr Instruction(Attribs attribs, ZydisMnemonic mnemonic, size_t opCount, const Operands& operands) noexcept
+            : _operands{ operands }
+            , _opCount{ opCount }
+            , _id{ static_cast<Mnemonic>(mnemonic) }
+            , _attribs{ attribs }
+        {
+        }
+
+        /// <summary>
+        /// Returns true if the instruction has access, visibility, encoding, flags and category
+        /// information. Generated and decoded instructions always have a length, instructions
+        /// created without meta data have none.
+        /// </summary>
+        constexpr bool hasMetaData() const noexcept
+        {
+            return _length != 0;
+        }
+
         constexpr ZydisMnemonic getId() const noexcept
         {
             return static_cast<ZydisMnemonic>(_id);
@@ -224,12 +269,12 @@ namespace zasm
 
         constexpr Encoding getEncoding() const noexcept
         {
-            return _encoding;
+            return _meta->encoding;
         }
 
         constexpr Category getCategory() const noexcept
         {
-            return _category;
+            return _meta->category;
         }
 
         constexpr bool hasAttrib(Attribs attrib) const noexcept
@@ -289,57 +334,57 @@ namespace zasm
 
         constexpr const OperandsVisibility& getOperandsVisibility() const noexcept
         {
-            return _opsVisibility;
+            return _meta->opsVisibility;
         }
 
         constexpr const Operand::Visibility getOperandVisibility(size_t index) const noexcept
         {
-            if (index >= _opsVisibility.size())
+            if (index >= _meta->opsVisibility.size())
                 return Operand::Visibility::Invalid;
-            return _opsVisibility[index];
+            return _meta->opsVisibility[index];
         }
 
         constexpr bool isOperandHidden(size_t index) const noexcept
         {
             if (index >= _opCount)
                 return true;
-            return _opsVisibility[index] == Operand::Visibility::Hidden;
+            return _meta->opsVisibility[index] == Operand::Visibility::Hidden;
         }
 
         constexpr bool isOperandExplicit(size_t index) const noexcept
         {
             if (index >= _opCount)
                 return false;
-            return _opsVisibility[index] == Operand::Visibility::Explicit;
+            return _meta->opsVisibility[index] == Operand::Visibility::Explicit;
         }
 
         constexpr bool isOperandImplicit(size_t index) const noexcept
         {
             if (index >= _opCount)
                 return false;
-            return _opsVisibility[index] == Operand::Visibility::Implicit;
+            return _meta->opsVisibility[index] == Operand::Visibility::Implicit;
         }
 
         constexpr const OperandsEncoding& getOperandsEncoding() const noexcept
         {
-            return _opsEncoding;
+            return _meta->opsEncoding;
         }
 
         constexpr const Operand::Encoding getOperandEncoding(size_t index) const noexcept
         {
             if (index >= _opCount)
                 return Operand::Encoding::None;
-            return _opsEncoding[index];
+            return _meta->opsEncoding[index];
         }
 
         constexpr const Access& getAccess() const noexcept
         {
-            return _access;
+            return _meta->access;
         }
 
         constexpr const Flags& getFlags() const noexcept
         {
-            return _flags;
+            return _meta->flags;
         }
     };
 #pragma pack(pop)
@@ -7,40 +7,40 @@
 
 namespace zasm::operands
 {
-#pragma pack(push, 1)
     class Mem
     {
-        BitSize _bitSize{};
+        // Ordered by size, keeps the displacement aligned without padding between fields.
+        int64_t _disp{};
+        Label::Id _label{ Label::Id::Invalid };
         Seg::Id _seg{};
         Reg::Id _base{};
         Reg::Id _index{};
+        BitSize _bitSize{};
         uint8_t _scale{};
-        int64_t _disp{};
-        Label::Id _label{ Label::Id::Invalid };
 
     public:
         constexpr explicit Mem(
             BitSize bitSize, const Seg& seg, const Reg& base, const Reg& index, int32_t scale, int64_t disp) noexcept
-            : _bitSize{ bitSize }
+            : _disp{ disp }
+            , _label{ Label::Id::Invalid }
             , _seg{ static_cast<Seg::Id>(seg.getId()) }
-            , _base{ static_cast<Reg::Id>(base.getId()) }
-            , _index{ static_cast<Reg::Id>(index.getId()) }
+            , _base{ base._reg }
+            , _index{ index._reg }
+            , _bitSize{ bitSize }
             , _scale{ static_cast<uint8_t>(scale) }
-            , _disp{ disp }
-            , _label{ Label::Id::Invalid }
         {
         }
 
         constexpr explicit Mem(
             BitSize bitSize, const Seg& seg, const Label& label, const Reg& base, const Reg& index, int32_t scale,
             int64_t disp) noexcept
-            : _bitSize{ bitSize }
+            : _disp{ disp }
+            , _label{ label.getId() }
             , _seg{ static_cast<Seg::Id>(seg.getId()) }
-            , _base{ static_cast<Reg::Id>(base.getId()) }
-            , _index{ static_cast<Reg::Id>(index.getId()) }
+            , _base{ base._reg }
+            , _index{ index._reg }
+            , _bitSize{ bitSize }
             , _scale{ static_cast<uint8_t>(scale) }
-            , _disp{ disp }
-            , _label{ label.getId() }
         {
         }
 
@@ -62,7 +62,7 @@ namespace zasm::operands
         constexpr uint8_t getScale() const noexcept
         {
             // In case no index is assigned scale has to be zero.
-            if (_index == static_cast<Reg::Id>(ZYDIS_REGISTER_NONE))
+            if (_index == Reg::Id::None)
                 return 0;
 
             return _scale;
@@ -98,7 +98,6 @@ namespace zasm::operands
             return _label != Label::Id::Invalid;
         }
     };
-#pragma pack(pop)
 
     // Default Segment.
     static constexpr Mem ptr(BitSize bitSize, const Gp& base, int64_t disp = 0) noexcept
@@ -164,47 +163,47 @@ namespace zasm::operands
     }
 
     // Generic.
-    template<typename... TArgs> static Mem byte_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem byte_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_8, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem word_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem word_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_16, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem dword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem dword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_32, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem fword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem fword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_48, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem qword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem qword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_64, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem tbyte_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem tbyte_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_80, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem tword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem tword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_80, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem oword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem oword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_128, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem xmmword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem xmmword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_128, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem ymmword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem ymmword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_256, std::forward<TArgs>(args)...);
     };
-    template<typename... TArgs> static Mem zmmword_ptr(TArgs&&... args) noexcept
+    template<typename... TArgs> static constexpr Mem zmmword_ptr(TArgs&&... args) noexcept
     {
         return ptr(BitSize::_512, std::forward<TArgs>(args)...);
     };
@@ -1,11 +1,14 @@
 #pragma once
 
+#include "align.hpp"
 #include "data.hpp"
 #include "embeddedlabel.hpp"
 #include "instruction.hpp"
 #include "label.hpp"
 #include "section.hpp"
 
+#include <cstdint>
+#include <utility>
 #include <variant>
 
 namespace zasm
@@ -19,10 +22,17 @@ namespace zasm
 
     class Node
     {
+    public:
+        enum class Id : uint32_t
+        {
+            Invalid = 0xFFFFFFFFu,
+        };
+
     protected:
         const Node* _prev{};
         const Node* _next{};
-        const std::variant<NodePoint, Instruction, Label, EmbeddedLabel, Data, Section> _data{};
+        Id _id{ Id::Invalid };
+        const std::variant<NodePoint, Instruction, Label, EmbeddedLabel, Data, Section, Align> _data{};
 
     protected:
         constexpr Node(const NodePoint& val) noexcept
@@ -30,7 +40,7 @@ namespace zasm
         {
         }
         constexpr Node(NodePoint&& val) noexcept
-            : _data{ val }
+            : _data{ std::move(val) }
         {
         }
         constexpr Node(const Instruction& val) noexcept
@@ -38,7 +48,7 @@ namespace zasm
         {
         }
         constexpr Node(Instruction&& val) noexcept
-            : _data{ val }
+            : _data{ std::move(val) }
         {
         }
         constexpr Node(const Label& val) noexcept
@@ -54,13 +64,23 @@ namespace zasm
         {
         }
         constexpr Node(Data&& val) noexcept
-            : _data{ val }
+            : _data{ std::move(val) }
         {
         }
         constexpr Node(const EmbeddedLabel& val) noexcept
             : _data{ val }
         {
         }
+        constexpr Node(const Align& val) noexcept
+            : _data{ val }
+        {
+        }
+        // Constructs the value in place, not noexcept as constructing an Instruction may allocate its meta data.
+        template<typename T, typename... TArgs>
+        constexpr Node(std::in_place_type_t<T> type, TArgs&&... args)
+            : _data{ type, std::forward<TArgs>(args)... }
+        {
+        }
 
     public:
         constexpr Node() = default;
@@ -75,6 +95,15 @@ namespace zasm
             return _next;
         }
 
+        /// <summary>
+        /// Returns the id assigned by the Program on creation, ids are unique per Program and
+        /// increase with every created node. They can be used to index per node data.
+        /// </summary>
+        Id getId() const noexcept
+        {
+            return _id;
+        }
+
         template<typename T> bool holds() const noexcept
         {
             return std::holds_alternative<T>(_data);
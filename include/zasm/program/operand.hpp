@@ -6,6 +6,7 @@
 #include "register.hpp"
 
 #include <cstdint>
+#include <type_traits>
 #include <variant>
 
 namespace zasm
@@ -69,53 +70,106 @@ namespace zasm
 
     class Operand
     {
-        using Variant = std::variant<operands::None, operands::Reg, operands::Mem, operands::Imm, operands::Label>;
-
-        Variant _data;
-
     public:
         using Visibility = detail::OperandVisibility;
         using Encoding = detail::OperandEncoding;
 
-    public:
-        constexpr Operand() noexcept
-            : _data{ operands::None{} }
-        {
-        }
-        constexpr Operand(Operand&& other) noexcept
-            : _data{ std::move(other._data) }
+        enum class Kind : uint8_t
         {
-        }
-        constexpr Operand(const Operand& other) noexcept
-            : _data{ other._data }
+            None,
+            Reg,
+            Mem,
+            Imm,
+            Label,
+        };
+
+    private:
+        union Storage
         {
-        }
+            operands::None none;
+            operands::Reg reg;
+            operands::Mem mem;
+            operands::Imm imm;
+            operands::Label label;
+
+            constexpr Storage(const operands::None& val) noexcept
+                : none{ val }
+            {
+            }
+            constexpr Storage(const operands::Reg& val) noexcept
+                : reg{ val }
+            {
+            }
+            constexpr Storage(const operands::Mem& val) noexcept
+                : mem{ val }
+            {
+            }
+            constexpr Storage(const operands::Imm& val) noexcept
+                : imm{ val }
+            {
+            }
+            constexpr Storage(const operands::Label& val) noexcept
+                : label{ val }
+            {
+            }
+        };
 
+        // Maps derived types such as Gp64 or ImmT and integral values to the stored type.
         template<typename T>
-        constexpr Operand(const T& val) noexcept
-            : _data{ val }
+        using StoredType = std::conditional_t<
+            std::is_base_of_v<operands::Reg, T>, operands::Reg,
+            std::conditional_t<std::is_base_of_v<operands::Imm, T> || std::is_integral_v<T>, operands::Imm, T>>;
+
+        template<typename T> static constexpr Kind getKindOf() noexcept
         {
+            if constexpr (std::is_same_v<T, operands::Reg>)
+                return Kind::Reg;
+            else if constexpr (std::is_same_v<T, operands::Mem>)
+                return Kind::Mem;
+            else if constexpr (std::is_same_v<T, operands::Imm>)
+                return Kind::Imm;
+            else if constexpr (std::is_same_v<T, operands::Label>)
+                return Kind::Label;
+            else
+            {
+                static_assert(std::is_same_v<T, operands::None>, "Unsupported operand type");
+                return Kind::None;
+            }
         }
 
-        template<typename T>
-        constexpr Operand(T&& val) noexcept
-            : _data{ std::move(val) }
+        Storage _storage;
+        Kind _kind;
+
+    public:
+        constexpr Operand() noexcept
+            : _storage{ operands::None{} }
+            , _kind{ Kind::None }
         {
         }
 
-        Operand& operator=(Operand&& other) noexcept
+        template<typename T, typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, Operand>>>
+        constexpr Operand(const T& val) noexcept
+            : _storage{ StoredType<T>(val) }
+            , _kind{ getKindOf<StoredType<T>>() }
         {
-            _data = std::move(other._data);
-            return *this;
         }
 
-        Operand& operator=(const Operand& other) noexcept
+        constexpr Operand(const Operand& other) noexcept = default;
+        constexpr Operand(Operand&& other) noexcept = default;
+
+        Operand& operator=(const Operand& other) noexcept = default;
+        Operand& operator=(Operand&& other) noexcept = default;
+
+        constexpr Kind getKind() const noexcept
         {
-            _data = other._data;
-            return *this;
+            return _kind;
         }
 
-        template<typename T> const T& get() const
+        /// <summary>
+        /// Returns the held value, throws std::bad_variant_access if the operand holds a different type.
+        /// Use getIf when the type is not known.
+        /// </summary>
+        template<typename T> constexpr const T& get() const
         {
             if constexpr (std::is_same_v<T, Operand>)
             {
@@ -123,11 +177,13 @@ namespace zasm
             }
             else
             {
-                return std::get<T>(_data);
+                if (!holds<T>())
+                    throw std::bad_variant_access();
+                return getUnchecked<T>();
             }
         }
 
-        template<typename T> const T* getIf() const noexcept
+        template<typename T> constexpr const T* getIf() const noexcept
         {
             if constexpr (std::is_same_v<T, Operand>)
             {
@@ -135,7 +191,9 @@ namespace zasm
             }
             else
             {
-                return std::get_if<T>(&_data);
+                if (!holds<T>())
+                    return nullptr;
+                return &getUnchecked<T>();
             }
         }
 
@@ -147,14 +205,43 @@ namespace zasm
             }
             else
             {
-                return std::holds_alternative<T>(_data);
+                return _kind == getKindOf<T>();
+            }
+        }
+
+        template<typename F> constexpr decltype(auto) visit(F&& f) const
+        {
+            switch (_kind)
+            {
+                case Kind::Reg:
+                    return f(_storage.reg);
+                case Kind::Mem:
+                    return f(_storage.mem);
+                case Kind::Imm:
+                    return f(_storage.imm);
+                case Kind::Label:
+                    return f(_storage.label);
+                default:
+                    return f(_storage.none);
             }
         }
 
-        template<typename F> auto visit(F&& f) const
+    private:
+        template<typename T> constexpr const T& getUnchecked() const noexcept
         {
-            return std::visit(std::forward<F>(f), _data);
+            if constexpr (std::is_same_v<T, operands::Reg>)
+                return _storage.reg;
+            else if constexpr (std::is_same_v<T, operands::Mem>)
+                return _storage.mem;
+            else if constexpr (std::is_same_v<T, operands::Imm>)
+                return _storage.imm;
+            else if constexpr (std::is_same_v<T, operands::Label>)
+                return _storage.label;
+            else
+                return _storage.none;
         }
     };
 
+    static_assert(std::is_trivially_copyable_v<Operand>);
+
 } // namespace zasm
\ No newline at end of file
@@ -1,5 +1,6 @@
 #pragma once
 
+#include "align.hpp"
 #include "data.hpp"
 #include "embeddedlabel.hpp"
 #include "label.hpp"
@@ -111,6 +112,12 @@ namespace zasm
         /// <returns>Node count</returns>
         size_t size() const noexcept;
 
+        /// <summary>
+        /// Returns a counter that changes whenever a node is inserted, moved or removed.
+        /// </summary>
+        /// <returns>Modification count</returns>
+        uint64_t getModificationCount() const noexcept;
+
         /// <summary>
         /// Clears the entire program state, pools will keep their
         /// capacity.
@@ -124,9 +131,24 @@ namespace zasm
         /// <param name="value">The data to place inside the node</param>
         /// <returns>Newly allocated node containing value</returns>
         const Node* createNode(const Instruction& value);
+        const Node* createNode(Instruction&& value);
         const Node* createNode(const Data& value);
         const Node* createNode(Data&& value);
         const Node* createNode(const EmbeddedLabel& value);
+        const Node* createNode(const Align& value);
+
+        /// <summary>
+        /// Allocates a new unlinked node with an instruction that has the meta data of form and the
+        /// specified operands, the instruction is constructed in place.
+        /// </summary>
+        const Node* createNode(const Instruction& form, const Instruction::Operands& operands);
+
+        /// <summary>
+        /// Allocates a new unlinked node with an instruction without meta data, the instruction is
+        /// constructed in place.
+        /// </summary>
+        const Node* createNode(
+            Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t opCount, const Instruction::Operands& operands);
 
     public:
         /// <summary>
@@ -144,6 +166,13 @@ namespace zasm
         /// <returns>The new node which contains the label</returns>
         Expected<const Node*, Error> bindLabel(const Label& label);
 
+        /// <summary>
+        /// Gets the label name.
+        /// </summary>
+        /// <param name="label">Label to get the name for</param>
+        /// <returns>Name of the label, nullptr if the label has no name or is invalid</returns>
+        const char* getLabelName(const Label& label) const noexcept;
+
         /// <summary>
         /// Creates a Data object that can be stored in a Node. The data object
         /// can hold up to 32 bytes of data before it will use the heap.
@@ -153,6 +182,20 @@ namespace zasm
         /// <returns>Data object containing a copy of the specified data</returns>
         const Data createData(const void* ptr, size_t len);
 
+        /// <summary>
+        /// Creates a new virtual general purpose register. Virtual registers can be used like physical
+        /// registers with the Assembler and must be replaced before serialization, see
+        /// passes::RegisterAllocator. Gp::r8 to Gp::r64 access the same virtual register with other sizes.
+        /// </summary>
+        /// <param name="size">Size of the register, 8, 16, 32 or 64 bit</param>
+        /// <returns>The virtual register, invalid if the size is not supported or all virtual registers are used</returns>
+        operands::Gp createVirtualGp(BitSize size);
+
+        /// <summary>
+        /// Returns the number of virtual registers created, all virtual register indices are below it.
+        /// </summary>
+        size_t getVirtualRegCount() const noexcept;
+
     public:
         /// <summary>
         /// Creates a new section that can be used to segment code and data.
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "register.table.hpp"
+
 #include <Zydis/Zydis.h>
 #include <cstdint>
 #include <zasm/core/bitsize.hpp>
@@ -14,19 +16,17 @@ namespace zasm::operands
         static_assert(kGp8HiStartIndex == 4, "This should be 4, if this triggers the definition probably changed");
 
     public:
-        // For debug builds this makes inspection easier.
-        // For release builds size matters more.
-#ifdef _DEBUG
-        using Id = ZydisRegister;
-#else
+        // Fixed storage in all configurations, virtual register ids are outside of the ZydisRegister range.
         enum class Id : int16_t
         {
             None = ZYDIS_REGISTER_NONE,
             Invalid = -1,
         };
-#endif
+
     protected:
-        Id _reg{ ZYDIS_REGISTER_NONE };
+        friend class Mem;
+
+        Id _reg{ Id::None };
 
     public:
         constexpr Reg() noexcept = default;
@@ -34,24 +34,30 @@ namespace zasm::operands
             : _reg{ static_cast<Id>(reg) }
         {
         }
-#ifndef _DEBUG
         constexpr explicit Reg(const Id reg) noexcept
             : _reg{ reg }
         {
         }
-#endif
-        BitSize getSize(ZydisMachineMode mode) const noexcept
+
+        constexpr BitSize getSize(ZydisMachineMode mode) const noexcept
         {
-            return toBitSize(ZydisRegisterGetWidth(mode, getId()));
+            const auto& info = getInfo();
+            return toBitSize(mode == ZYDIS_MACHINE_MODE_LONG_64 ? info.width64 : info.width);
         }
 
-        ZydisRegisterClass getClass() const noexcept
+        constexpr ZydisRegisterClass getClass() const noexcept
         {
-            return ZydisRegisterGetClass(getId());
+            return getInfo().regClass;
         }
 
+        /// <summary>
+        /// Returns the Zydis register id, virtual registers have no Zydis equivalent and
+        /// return ZYDIS_REGISTER_NONE.
+        /// </summary>
         constexpr ZydisRegister getId() const noexcept
         {
+            if (isVirtual())
+                return ZYDIS_REGISTER_NONE;
             return static_cast<ZydisRegister>(_reg);
         }
 
@@ -59,25 +65,18 @@ namespace zasm::operands
         /// Returns the index per register class
         /// NOTE: For Gp8 there are 20 registers, hi/lo regs are in the same class.
         /// </summary>
-        int8_t getIndex() const noexcept
+        constexpr int8_t getIndex() const noexcept
         {
-            return ZydisRegisterGetId(getId());
+            return getInfo().index;
         }
 
         /// <summary>
         /// Returns the physical index which is also used for the encoding.
         /// </summary>
         /// <returns>Physical index, typically 0 to 31. Returns -1 if it has no index.</returns>
-        int8_t getPhysicalIndex() const noexcept
+        constexpr int8_t getPhysicalIndex() const noexcept
         {
-            const auto regIndex = ZydisRegisterGetId(getId());
-            if (regIndex == -1)
-                return -1;
-            if (isGp8() && regIndex >= kGp8HiStartIndex)
-            {
-                return regIndex - kGp8HiStartIndex;
-            }
-            return regIndex;
+            return getInfo().physIndex;
         }
 
         /// <summary>
@@ -86,17 +85,7 @@ namespace zasm::operands
         /// </summary>
         constexpr int8_t getOffset() const noexcept
         {
-            switch (getId())
-            {
-                case ZYDIS_REGISTER_AH:
-                case ZYDIS_REGISTER_CH:
-                case ZYDIS_REGISTER_BH:
-                case ZYDIS_REGISTER_DH:
-                    return 1;
-                default:
-                    return 0;
-            }
-            return 0;
+            return getInfo().isGp8Hi ? 1 : 0;
         }
 
         /// <summary>
@@ -104,86 +93,93 @@ namespace zasm::operands
         /// would be eax on 32 bit mode and rax on 64 bit.
         /// In case the register has no root it will return Reg::None.
         /// </summary>
-        Reg getRoot(ZydisMachineMode mode) const noexcept
+        constexpr Reg getRoot(ZydisMachineMode mode) const noexcept
         {
-            return Reg{ ZydisRegisterGetLargestEnclosing(mode, getId()) };
+            const auto modeIndex = ::zasm::detail::getRegModeIndex(mode);
+            if (modeIndex == -1)
+                return Reg{};
+
+            // The root of a virtual register is the same virtual register with the width of the mode.
+            if (isVirtual())
+                return Reg{ static_cast<Id>(::zasm::detail::getVirtualRegId(getVirtualIndex(), modeIndex + 1)) };
+
+            return Reg{ getInfo().root[modeIndex] };
         }
 
         constexpr bool isValid() const noexcept
         {
-            return getId() != ZYDIS_REGISTER_NONE;
+            return _reg != Id::None;
+        }
+
+        /// <summary>
+        /// Returns true if this is a virtual general purpose register, virtual registers have to be
+        /// replaced by physical registers before the program is serialized.
+        /// See Assembler::createVirtualGp64 and passes::RegisterAllocator.
+        /// </summary>
+        constexpr bool isVirtual() const noexcept
+        {
+            return ::zasm::detail::isVirtualRegId(static_cast<int32_t>(_reg));
+        }
+
+        /// <summary>
+        /// Returns the index of the virtual register, all sizes of a virtual register share the index.
+        /// Returns 0 for physical registers.
+        /// </summary>
+        constexpr uint32_t getVirtualIndex() const noexcept
+        {
+            if (!isVirtual())
+                return 0;
+            return static_cast<uint32_t>(static_cast<int32_t>(_reg) - ::zasm::detail::kVirtualRegBase) >> 2;
         }
 
-        bool isGp8() const noexcept
+        constexpr bool isGp8() const noexcept
         {
             return getClass() == ZydisRegisterClass::ZYDIS_REGCLASS_GPR8;
         }
 
-        bool isGp8Lo() const noexcept
+        constexpr bool isGp8Lo() const noexcept
         {
-            if (!isGp8())
-                return false;
-            switch (getId())
-            {
-                case ZYDIS_REGISTER_AH:
-                case ZYDIS_REGISTER_CH:
-                case ZYDIS_REGISTER_BH:
-                case ZYDIS_REGISTER_DH:
-                    return false;
-                default:
-                    return true;
-            }
-            return true;
+            return isGp8() && !getInfo().isGp8Hi;
         }
 
-        bool isGp8Hi() const noexcept
+        constexpr bool isGp8Hi() const noexcept
         {
-            if (!isGp8())
-                return false;
-            switch (getId())
-            {
-                case ZYDIS_REGISTER_AH:
-                case ZYDIS_REGISTER_CH:
-                case ZYDIS_REGISTER_BH:
-                case ZYDIS_REGISTER_DH:
-                    return true;
-                default:
-                    return false;
-            }
-            return false;
+            return getInfo().isGp8Hi;
         }
 
-        bool isGp16() const noexcept
+        constexpr bool isGp16() const noexcept
         {
             return getClass() == ZydisRegisterClass::ZYDIS_REGCLASS_GPR16;
         }
 
-        bool isGp32() const noexcept
+        constexpr bool isGp32() const noexcept
         {
             return getClass() == ZydisRegisterClass::ZYDIS_REGCLASS_GPR32;
         }
 
-        bool isGp64() const noexcept
+        constexpr bool isGp64() const noexcept
         {
             return getClass() == ZydisRegisterClass::ZYDIS_REGCLASS_GPR64;
         }
 
-        bool isGp() const noexcept
+        constexpr bool isGp() const noexcept
         {
-            return isGp8() || isGp16() || isGp32() || isGp64();
+            const auto regClass = getClass();
+            return regClass >= ZydisRegisterClass::ZYDIS_REGCLASS_GPR8
+                && regClass <= ZydisRegisterClass::ZYDIS_REGCLASS_GPR64;
         }
 
-        bool isXmm() const noexcept
+        constexpr bool isXmm() const noexcept
         {
             return getClass() == ZydisRegisterClass::ZYDIS_REGCLASS_XMM;
         }
 
-        bool isYmm() const noexcept
+        constexpr bool isYmm() const noexcept
         {
             return getClass() == ZydisRegisterClass::ZYDIS_REGCLASS_YMM;
         }
 
-        bool isZmm() const noexcept
+        constexpr bool isZmm() const noexcept
         {
             return getClass() == ZydisRegisterClass::ZYDIS_REGCLASS_ZMM;
         }
@@ -215,7 +211,13 @@ namespace zasm::operands
 
         template<typename T> constexpr const T& as() const noexcept
         {
-            return static_cast<T&>(*this);
+            return static_cast<const T&>(*this);
+        }
+
+    private:
+        constexpr const ::zasm::detail::RegInfo& getInfo() const noexcept
+        {
+            return ::zasm::detail::getRegInfo(static_cast<int32_t>(_reg));
         }
     };
 
@@ -225,54 +227,71 @@ namespace zasm::operands
     public:
         using Reg::Reg;
 
-        Gp r8lo() const noexcept
+        constexpr Gp r8lo() const noexcept
         {
+            if (isVirtual())
+                return fromVirtual(0);
+
             auto regIndex = getPhysicalIndex();
+            if (regIndex == -1)
+                return Gp{};
             if (regIndex >= kGp8HiStartIndex)
             {
                 // Skip the hi ones.
                 regIndex += kGp8HiStartIndex;
             }
-            auto reg = ZydisRegisterEncode(ZYDIS_REGCLASS_GPR8, regIndex);
-            return Gp{ reg };
+            return Gp{ static_cast<ZydisRegister>(ZYDIS_REGISTER_AL + regIndex) };
         }
 
-        Gp r8() const noexcept
+        constexpr Gp r8() const noexcept
         {
             return r8lo();
         }
 
-        Gp r8hi() const noexcept
+        constexpr Gp r8hi() const noexcept
         {
             auto regIndex = getPhysicalIndex();
-            if (regIndex >= kGp8HiStartIndex)
+            if (regIndex == -1 || regIndex >= kGp8HiStartIndex)
             {
                 // Unsupported.
                 return Gp{};
             }
-            auto reg = ZydisRegisterEncode(ZYDIS_REGCLASS_GPR8, regIndex + kGp8HiStartIndex);
-            return Gp{ reg };
+            return Gp{ static_cast<ZydisRegister>(ZYDIS_REGISTER_AH + regIndex) };
         }
 
-        Gp r16() const noexcept
+        constexpr Gp r16() const noexcept
         {
-            auto regIndex = getPhysicalIndex();
-            auto reg = ZydisRegisterEncode(ZYDIS_REGCLASS_GPR16, regIndex);
-            return Gp{ reg };
+            if (isVirtual())
+                return fromVirtual(1);
+            return fromIndex(ZYDIS_REGISTER_AX);
         }
 
-        Gp r32() const noexcept
+        constexpr Gp r32() const noexcept
         {
-            auto regIndex = getPhysicalIndex();
-            auto reg = ZydisRegisterEncode(ZYDIS_REGCLASS_GPR32, regIndex);
-            return Gp{ reg };
+            if (isVirtual())
+                return fromVirtual(2);
+            return fromIndex(ZYDIS_REGISTER_EAX);
         }
 
-        Gp r64() const noexcept
+        constexpr Gp r64() const noexcept
         {
-            auto regIndex = getPhysicalIndex();
-            auto reg = ZydisRegisterEncode(ZYDIS_REGCLASS_GPR64, regIndex);
-            return Gp{ reg };
+            if (isVirtual())
+                return fromVirtual(3);
+            return fromIndex(ZYDIS_REGISTER_RAX);
+        }
+
+    private:
+        constexpr Gp fromVirtual(int32_t sizeIndex) const noexcept
+        {
+            return Gp{ static_cast<Id>(::zasm::detail::getVirtualRegId(getVirtualIndex(), sizeIndex)) };
+        }
+
+        constexpr Gp fromIndex(ZydisRegister first) const noexcept
+        {
+            const auto regIndex = getPhysicalIndex();
+            if (regIndex == -1)
+                return Gp{};
+            return Gp{ static_cast<ZydisRegister>(first + regIndex) };
         }
     };
 
@@ -0,0 +1,191 @@
+#pragma once
+
+#include <Zydis/Zydis.h>
+#include <array>
+#include <cstdint>
+
+namespace zasm::detail
+{
+    // Per register information, built at compile time to avoid calling into Zydis for queries
+    // done per operand. Matches the results of ZydisRegisterGetClass, ZydisRegisterGetId,
+    // ZydisRegisterGetWidth and ZydisRegisterGetLargestEnclosing.
+    struct RegInfo
+    {
+        ZydisRegisterClass regClass{ ZYDIS_REGCLASS_INVALID };
+        // Index within the class, Gp8 has 20 registers.
+        int8_t index{ -1 };
+        // Index used for the encoding, hi byte registers share the index of their root.
+        int8_t physIndex{ -1 };
+        bool isGp8Hi{};
+        // Width in bits outside of and in 64 bit mode.
+        uint16_t width{};
+        uint16_t width64{};
+        // Largest enclosing register in 16, 32 and 64 bit modes.
+        std::array<ZydisRegister, 3> root{};
+    };
+
+    struct RegClassRange
+    {
+        ZydisRegisterClass regClass;
+        ZydisRegister lo;
+        ZydisRegister hi;
+        uint16_t width;
+        uint16_t width64;
+    };
+
+    inline constexpr RegClassRange kRegClassRanges[] = {
+        { ZYDIS_REGCLASS_GPR8, ZYDIS_REGISTER_AL, ZYDIS_REGISTER_R15B, 8, 8 },
+        { ZYDIS_REGCLASS_GPR16, ZYDIS_REGISTER_AX, ZYDIS_REGISTER_R15W, 16, 16 },
+        { ZYDIS_REGCLASS_GPR32, ZYDIS_REGISTER_EAX, ZYDIS_REGISTER_R15D, 32, 32 },
+        { ZYDIS_REGCLASS_GPR64, ZYDIS_REGISTER_RAX, ZYDIS_REGISTER_R15, 0, 64 },
+        { ZYDIS_REGCLASS_X87, ZYDIS_REGISTER_ST0, ZYDIS_REGISTER_ST7, 80, 80 },
+        { ZYDIS_REGCLASS_MMX, ZYDIS_REGISTER_MM0, ZYDIS_REGISTER_MM7, 64, 64 },
+        { ZYDIS_REGCLASS_XMM, ZYDIS_REGISTER_XMM0, ZYDIS_REGISTER_XMM31, 128, 128 },
+        { ZYDIS_REGCLASS_YMM, ZYDIS_REGISTER_YMM0, ZYDIS_REGISTER_YMM31, 256, 256 },
+        { ZYDIS_REGCLASS_ZMM, ZYDIS_REGISTER_ZMM0, ZYDIS_REGISTER_ZMM31, 512, 512 },
+        { ZYDIS_REGCLASS_TMM, ZYDIS_REGISTER_TMM0, ZYDIS_REGISTER_TMM7, 8192, 8192 },
+        { ZYDIS_REGCLASS_FLAGS, ZYDIS_REGISTER_FLAGS, ZYDIS_REGISTER_RFLAGS, 0, 0 },
+        { ZYDIS_REGCLASS_IP, ZYDIS_REGISTER_IP, ZYDIS_REGISTER_RIP, 0, 0 },
+        { ZYDIS_REGCLASS_SEGMENT, ZYDIS_REGISTER_ES, ZYDIS_REGISTER_GS, 16, 16 },
+        { ZYDIS_REGCLASS_TABLE, ZYDIS_REGISTER_GDTR, ZYDIS_REGISTER_TR, 0, 0 },
+        { ZYDIS_REGCLASS_TEST, ZYDIS_REGISTER_TR0, ZYDIS_REGISTER_TR7, 32, 32 },
+        { ZYDIS_REGCLASS_CONTROL, ZYDIS_REGISTER_CR0, ZYDIS_REGISTER_CR15, 32, 64 },
+        { ZYDIS_REGCLASS_DEBUG, ZYDIS_REGISTER_DR0, ZYDIS_REGISTER_DR15, 32, 64 },
+        { ZYDIS_REGCLASS_MASK, ZYDIS_REGISTER_K0, ZYDIS_REGISTER_K7, 64, 64 },
+        { ZYDIS_REGCLASS_BOUND, ZYDIS_REGISTER_BND0, ZYDIS_REGISTER_BND3, 128, 128 },
+    };
+
+    // Index into RegInfo::root, -1 for invalid modes.
+    constexpr int8_t getRegModeIndex(ZydisMachineMode mode) noexcept
+    {
+        switch (mode)
+        {
+            case ZYDIS_MACHINE_MODE_LONG_COMPAT_16:
+            case ZYDIS_MACHINE_MODE_LEGACY_16:
+            case ZYDIS_MACHINE_MODE_REAL_16:
+                return 0;
+            case ZYDIS_MACHINE_MODE_LONG_COMPAT_32:
+            case ZYDIS_MACHINE_MODE_LEGACY_32:
+                return 1;
+            case ZYDIS_MACHINE_MODE_LONG_64:
+                return 2;
+            default:
+                return -1;
+        }
+    }
+
+    constexpr void setRegWidth(RegInfo& info, uint16_t width, uint16_t width64) noexcept
+    {
+        info.width = width;
+        info.width64 = width64;
+    }
+
+    constexpr auto buildRegInfoTable() noexcept
+    {
+        std::array<RegInfo, ZYDIS_REGISTER_MAX_VALUE + 1> table{};
+
+        for (const auto& range : kRegClassRanges)
+        {
+            for (int32_t reg = range.lo; reg <= range.hi; ++reg)
+            {
+                auto& info = table[reg];
+                info.regClass = range.regClass;
+                info.index = static_cast<int8_t>(reg - range.lo);
+                info.physIndex = info.index;
+                info.width = range.width;
+                info.width64 = range.width64;
+                info.root = { static_cast<ZydisRegister>(reg), static_cast<ZydisRegister>(reg),
+                              static_cast<ZydisRegister>(reg) };
+            }
+        }
+
+        // Gp8 orders al, cl, dl, bl, ah, ch, dh, bh, spl, bpl, ..., the hi byte registers share the
+        // index of the lo byte registers and all following are shifted by them.
+        for (int32_t reg = ZYDIS_REGISTER_AH; reg <= ZYDIS_REGISTER_R15B; ++reg)
+        {
+            table[reg].physIndex -= 4;
+        }
+        for (int32_t reg = ZYDIS_REGISTER_AH; reg <= ZYDIS_REGISTER_BH; ++reg)
+        {
+            table[reg].isGp8Hi = true;
+        }
+
+        // Gp registers are enclosed by the register of the mode's stack width, r8 to r15 and
+        // 64 bit registers have no root outside of 64 bit mode.
+        for (int32_t reg = ZYDIS_REGISTER_AL; reg <= ZYDIS_REGISTER_R15; ++reg)
+        {
+            auto& info = table[reg];
+            const bool isExtended = info.physIndex >= 8 || info.regClass == ZYDIS_REGCLASS_GPR64;
+            info.root[0] = isExtended ? ZYDIS_REGISTER_NONE : static_cast<ZydisRegister>(ZYDIS_REGISTER_AX + info.physIndex);
+            info.root[1] = isExtended ? ZYDIS_REGISTER_NONE : static_cast<ZydisRegister>(ZYDIS_REGISTER_EAX + info.physIndex);
+            info.root[2] = static_cast<ZydisRegister>(ZYDIS_REGISTER_RAX + info.physIndex);
+        }
+
+        // Vector registers are enclosed by the zmm register in all modes.
+        for (int32_t reg = ZYDIS_REGISTER_XMM0; reg <= ZYDIS_REGISTER_ZMM31; ++reg)
+        {
+            const auto root = static_cast<ZydisRegister>(ZYDIS_REGISTER_ZMM0 + table[reg].index);
+            table[reg].root = { root, root, root };
+        }
+
+        // Registers with a fixed width regardless of their class.
+        setRegWidth(table[ZYDIS_REGISTER_X87CONTROL], 16, 16);
+        setRegWidth(table[ZYDIS_REGISTER_X87STATUS], 16, 16);
+        setRegWidth(table[ZYDIS_REGISTER_X87TAG], 16, 16);
+        setRegWidth(table[ZYDIS_REGISTER_FLAGS], 16, 16);
+        setRegWidth(table[ZYDIS_REGISTER_IP], 16, 16);
+        setRegWidth(table[ZYDIS_REGISTER_EFLAGS], 32, 32);
+        setRegWidth(table[ZYDIS_REGISTER_EIP], 32, 32);
+        setRegWidth(table[ZYDIS_REGISTER_RFLAGS], 0, 64);
+        setRegWidth(table[ZYDIS_REGISTER_RIP], 0, 64);
+        setRegWidth(table[ZYDIS_REGISTER_BNDCFG], 64, 64);
+        setRegWidth(table[ZYDIS_REGISTER_BNDSTATUS], 64, 64);
+        setRegWidth(table[ZYDIS_REGISTER_XCR0], 64, 64);
+        setRegWidth(table[ZYDIS_REGISTER_PKRU], 32, 32);
+        setRegWidth(table[ZYDIS_REGISTER_MXCSR], 32, 32);
+        setRegWidth(table[ZYDIS_REGISTER_UIF], 1, 1);
+
+        return table;
+    }
+
+    inline constexpr auto kRegInfoTable = buildRegInfoTable();
+
+    inline constexpr RegInfo kInvalidRegInfo{};
+
+    // Virtual registers use the ids past the physical registers, the lowest two bits select the
+    // size of the general purpose register and the remaining bits the virtual register index.
+    constexpr int32_t kVirtualRegBase = 0x400;
+    constexpr int32_t kVirtualRegEnd = 0x8000;
+    constexpr uint32_t kMaxVirtualRegs = (kVirtualRegEnd - kVirtualRegBase) / 4;
+
+    // Indexed by the size bits, virtual registers have no physical index and no fixed root.
+    inline constexpr RegInfo kVirtualRegInfo[4] = {
+        { ZYDIS_REGCLASS_GPR8, -1, -1, false, 8, 8, {} },
+        { ZYDIS_REGCLASS_GPR16, -1, -1, false, 16, 16, {} },
+        { ZYDIS_REGCLASS_GPR32, -1, -1, false, 32, 32, {} },
+        { ZYDIS_REGCLASS_GPR64, -1, -1, false, 0, 64, {} },
+    };
+
+    constexpr bool isVirtualRegId(int32_t reg) noexcept
+    {
+        return reg >= kVirtualRegBase && reg < kVirtualRegEnd;
+    }
+
+    // Size index 0 to 3 for 8, 16, 32 and 64 bit.
+    constexpr int32_t getVirtualRegId(uint32_t index, int32_t sizeIndex) noexcept
+    {
+        return kVirtualRegBase + static_cast<int32_t>(index << 2) + sizeIndex;
+    }
+
+    constexpr const RegInfo& getRegInfo(int32_t reg) noexcept
+    {
+        if (reg < 0 || reg > ZYDIS_REGISTER_MAX_VALUE)
+        {
+            if (isVirtualRegId(reg))
+                return kVirtualRegInfo[(reg - kVirtualRegBase) & 3];
+            return kInvalidRegInfo;
+        }
+        return kRegInfoTable[reg];
+    }
+
+} // namespace zasm::detail
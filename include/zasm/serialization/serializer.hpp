@@ -33,6 +33,21 @@ namespace zasm
         RelocationKind kind{};
     };
 
+    struct NodeInfo
+    {
+        int32_t offset{};
+        int64_t address{};
+        int32_t length{};
+    };
+
+    struct JccErratumStats
+    {
+        // Branches and fused pairs moved to the next 32 byte boundary.
+        size_t numPadded{};
+        // Size of the inserted nops in bytes.
+        size_t bytesPadded{};
+    };
+
     class Serializer
     {
         detail::SerializerState* _state;
@@ -49,6 +64,20 @@ namespace zasm
         /// <returns>If successful returns Error::None otherwise check Error value.</returns>
         Error serialize(const Program& program, int64_t newBase);
 
+        /// <summary>
+        /// Mitigates the jcc erratum of Skylake derived cores, decoded branches that cross or end on a
+        /// 32 byte boundary are not cached. Jumps, calls, returns and macro-fusible pairs of cmp, test,
+        /// add, sub, and, inc or dec followed by a jcc are moved to the next boundary with nops when they
+        /// would touch one. Disabled by default.
+        /// </summary>
+        void setJccErratumMitigation(bool enable) noexcept;
+        bool hasJccErratumMitigation() const noexcept;
+
+        /// <summary>
+        /// Returns the padding inserted for the jcc erratum by the last serialization.
+        /// </summary>
+        const JccErratumStats& getJccErratumStats() const noexcept;
+
         /// <summary>
         /// Attempts to relocate the current serialized code to the new specified base address.
         /// </summary>
@@ -117,6 +146,33 @@ namespace zasm
         /// <returns>Pointer to relocation info or null in case the index does not exist</returns>
         const RelocationInfo* getRelocation(const size_t index) const noexcept;
 
+        /// <summary>
+        /// Returns the amount of serialized nodes, this matches the node count of the program
+        /// at the time of serialization.
+        /// </summary>
+        size_t getNodeCount() const noexcept;
+
+        /// <summary>
+        /// Returns the final layout of the node at the specified index, nodes are indexed in
+        /// the order of the program.
+        /// </summary>
+        /// <param name="index">Index of the node</param>
+        /// <returns>Pointer to node info or null in case the index does not exist</returns>
+        const NodeInfo* getNodeInfo(size_t index) const noexcept;
+
+        /// <summary>
+        /// Returns true if the last serialize call was for this program and the program was not
+        /// modified since, only then the node layout matches the nodes of the program.
+        /// </summary>
+        bool isUpToDate(const Program& program) const noexcept;
+
+        /// <summary>
+        /// Returns the node that caused the last serialize call to fail, this is typically an
+        /// instruction that was recorded without validation and can not be encoded.
+        /// </summary>
+        /// <returns>The failing node or null if the last serialize call did not fail on a node</returns>
+        const Node* getErrorNode() const noexcept;
+
         /// <summary>
         /// Clears the current serialized state.
         /// </summary>
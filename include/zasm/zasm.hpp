@@ -1,8 +1,18 @@
 #pragma once
 
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/analysis/liveness.hpp>
 #include <zasm/assembler/assembler.hpp>
+#include <zasm/assembler/codestream.hpp>
+#include <zasm/assembler/staticassembler.hpp>
 #include <zasm/core/errors.hpp>
 #include <zasm/decoder/decoder.hpp>
 #include <zasm/encoder/encoder.hpp>
+#include <zasm/parser/parser.hpp>
+#include <zasm/passes/blocklayout.hpp>
+#include <zasm/passes/deadcodeelimination.hpp>
+#include <zasm/passes/jumpthreading.hpp>
+#include <zasm/passes/peephole.hpp>
+#include <zasm/passes/registerallocator.hpp>
 #include <zasm/program/program.hpp>
 #include <zasm/serialization/serializer.hpp>
\ No newline at end of file
@@ -0,0 +1,69 @@
+#include <benchmark/benchmark.h>
+#include <vector>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    // Blocks of five instructions ending with a conditional branch to another block, forward and backward.
+    static void buildBranchyProgram(Program& program, int64_t numBlocks)
+    {
+        using namespace zasm::operands;
+
+        Assembler assembler(program);
+
+        std::vector<Label> labels;
+        labels.reserve(static_cast<size_t>(numBlocks));
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            labels.push_back(assembler.createLabel());
+        }
+
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            assembler.bind(labels[i]);
+            assembler.mov(rax, qword_ptr(rcx, 8));
+            assembler.add(rax, rdx);
+            assembler.lea(rdx, qword_ptr(rax, rbx, 2, 0x10));
+            assembler.cmp(rax, Imm(static_cast<int32_t>(i)));
+            assembler.jz(labels[(i * 7 + 3) % numBlocks]);
+        }
+        assembler.ret();
+    }
+
+    static void BM_Liveness(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        buildBranchyProgram(program, state.range(0));
+
+        analysis::Liveness liveness;
+        for (auto _ : state)
+        {
+            liveness.analyze(program);
+            benchmark::DoNotOptimize(liveness.getBlockCount());
+        }
+
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0) * 5), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Liveness)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(4096, 1 << 20);
+
+    static void BM_ControlFlowGraph(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        buildBranchyProgram(program, state.range(0));
+
+        analysis::ControlFlowGraph cfg;
+        for (auto _ : state)
+        {
+            cfg.build(program);
+            benchmark::DoNotOptimize(cfg.getLoopCount());
+        }
+
+        state.counters["Blocks"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_ControlFlowGraph)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(4096, 1 << 20);
+
+} // namespace zasm::benchmarks
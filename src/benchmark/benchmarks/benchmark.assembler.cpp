@@ -1,6 +1,7 @@
 #include <benchmark/benchmark.h>
 #include <functional>
 #include <testdata/instructions.hpp>
+#include <vector>
 #include <zasm/zasm.hpp>
 
 namespace zasm::benchmarks
@@ -81,6 +82,56 @@ namespace zasm::benchmarks
     }
     BENCHMARK(BM_Assembler_EmitSingle_3_Operands)->Unit(benchmark::kMicrosecond);
 
+    // The typed emitters are out-of-line wrappers around the emit template, these two measure what
+    // calling the template directly from the call site saves.
+    static void BM_Assembler_EmitTyped(benchmark::State& state)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            assembler.setCursor(nullptr);
+            state.ResumeTiming();
+
+            for (int32_t i = 0; i < 1000; i++)
+            {
+                assembler.add(rax, rcx);
+            }
+        }
+
+        state.counters["Instructions"] = benchmark::Counter(1000, benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Assembler_EmitTyped)->Unit(benchmark::kMicrosecond);
+
+    static void BM_Assembler_EmitTemplate(benchmark::State& state)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            assembler.setCursor(nullptr);
+            state.ResumeTiming();
+
+            for (int32_t i = 0; i < 1000; i++)
+            {
+                assembler.emit(ZYDIS_MNEMONIC_ADD, rax, rcx);
+            }
+        }
+
+        state.counters["Instructions"] = benchmark::Counter(1000, benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Assembler_EmitTemplate)->Unit(benchmark::kMicrosecond);
+
     static void BM_Assembler_EmitAll(benchmark::State& state)
     {
         Program program(ZYDIS_MACHINE_MODE_LONG_64);
@@ -104,4 +155,267 @@ namespace zasm::benchmarks
     }
     BENCHMARK(BM_Assembler_EmitAll)->Unit(benchmark::kMicrosecond);
 
+    static void BM_Assembler_EmitAll_RecordOnly(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        assembler.setRecordOnly(true);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            assembler.setCursor(nullptr);
+            state.ResumeTiming();
+
+            for (const auto& instr : zasm::tests::data::Instructions)
+            {
+                instr.emitter(assembler);
+            }
+
+            state.counters["Instructions"] = benchmark::Counter(std::size(zasm::tests::data::Instructions), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+        }
+    }
+    BENCHMARK(BM_Assembler_EmitAll_RecordOnly)->Unit(benchmark::kMicrosecond);
+
+    static void BM_Assembler_EmitAll_Stream(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        CodeStream stream(ZYDIS_MACHINE_MODE_LONG_64, 0x00400000);
+        assembler.setStream(&stream);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            stream.clear();
+            state.ResumeTiming();
+
+            for (const auto& instr : zasm::tests::data::Instructions)
+            {
+                instr.emitter(assembler);
+            }
+
+            state.counters["Instructions"] = benchmark::Counter(std::size(zasm::tests::data::Instructions), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+        }
+    }
+    BENCHMARK(BM_Assembler_EmitAll_Stream)->Unit(benchmark::kMicrosecond);
+
+    static void BM_Assembler_Stream_Branches(benchmark::State& state)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        CodeStream stream(ZYDIS_MACHINE_MODE_LONG_64, 0x00400000);
+        assembler.setStream(&stream);
+
+        std::vector<Label> labels;
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            labels.push_back(assembler.createLabel());
+        }
+
+        for (auto _ : state)
+        {
+            stream.clear();
+
+            // Straight-line code with a forward branch to the next block and a backward branch.
+            for (int64_t i = 0; i < state.range(0); ++i)
+            {
+                assembler.bind(labels[i]);
+                assembler.add(eax, ecx);
+                assembler.cmp(eax, Imm(100));
+                if (i + 1 < state.range(0))
+                    assembler.jz(labels[i + 1]);
+                assembler.jnz(labels[i]);
+            }
+
+            benchmark::DoNotOptimize(stream.getCode());
+            state.counters["Instructions"] = benchmark::Counter(state.range(0) * 4, benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+        }
+    }
+    BENCHMARK(BM_Assembler_Stream_Branches)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+    static void BM_Assembler_BuildPrograms(benchmark::State& state)
+    {
+        const auto instrCount = state.range(0);
+
+        for (auto _ : state)
+        {
+            // Each iteration builds a fresh program, node memory comes from the thread's block cache.
+            Program program(ZYDIS_MACHINE_MODE_LONG_64);
+            Assembler assembler(program);
+
+            for (int64_t i = 0; i < instrCount; i++)
+            {
+                assembler.mov(operands::rax, operands::rcx);
+            }
+
+            benchmark::DoNotOptimize(program.size());
+        }
+
+        state.counters["Instructions"] = benchmark::Counter(static_cast<double>(instrCount), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Assembler_BuildPrograms)->Arg(4096)->ThreadRange(1, 8)->UseRealTime()->Unit(benchmark::kMicrosecond);
+
+    static void BM_Assembler_EmitRepeatedForms(benchmark::State& state)
+    {
+        using namespace zasm::operands;
+
+        // Same few forms with varying registers and values, served from the generator cache.
+        const Gp64 regs[] = { rcx, rdx, rbx, rsi, rdi };
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            assembler.setCursor(nullptr);
+            state.ResumeTiming();
+
+            for (int32_t i = 0; i < 1000; i++)
+            {
+                const auto& dst = regs[i % std::size(regs)];
+                const auto& src = regs[(i + 1) % std::size(regs)];
+                assembler.mov(dst, qword_ptr(src, (i % 16) * 8));
+                assembler.add(dst, Imm(i % 100));
+            }
+        }
+
+        const auto stats = assembler.getGeneratorStats();
+        state.counters["CacheHitRate"] = static_cast<double>(stats.cacheHits) / static_cast<double>(stats.cacheHits + stats.cacheMisses);
+        state.counters["Instructions"] = benchmark::Counter(2000, benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Assembler_EmitRepeatedForms)->Unit(benchmark::kMicrosecond);
+
+    // Node construction after the generator, without the encoder. The copy variant is the path before
+    // instructions were constructed in place: the generator returned a new instruction in an Expected
+    // that was then copied into the node. The emplace variant writes the operands into a buffer and
+    // constructs the node from the shared form.
+    static Instruction makeForm()
+    {
+        using namespace zasm::operands;
+
+        Instruction::Operands ops{ rcx, qword_ptr(rdx, 8) };
+        Instruction::Access access{ ZYDIS_OPERAND_ACTION_WRITE, ZYDIS_OPERAND_ACTION_READ };
+        Instruction::OperandsVisibility visibility{ Operand::Visibility::Explicit, Operand::Visibility::Explicit };
+
+        return Instruction(
+            Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, ops, access, visibility, {}, {}, Instruction::Encoding::Legacy,
+            Instruction::Category::DataXfer, 4);
+    }
+
+    static void BM_Program_CreateNode_Copy(benchmark::State& state)
+    {
+        using namespace zasm::operands;
+
+        const auto form = makeForm();
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            state.ResumeTiming();
+
+            for (int32_t i = 0; i < 1000; i++)
+            {
+                Instruction::Operands ops{ rcx, qword_ptr(rdx, i * 8) };
+                Expected<Instruction, Error> res = Instruction(form, ops);
+                program.append(program.createNode(*res));
+            }
+        }
+
+        // Temporary, the Expected and the node.
+        state.counters["BytesMoved"] = static_cast<double>(sizeof(Instruction) * 3);
+        state.counters["Instructions"] = benchmark::Counter(1000, benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Program_CreateNode_Copy)->Unit(benchmark::kMicrosecond);
+
+    static void BM_Program_CreateNode_Emplace(benchmark::State& state)
+    {
+        using namespace zasm::operands;
+
+        const auto form = makeForm();
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            state.ResumeTiming();
+
+            for (int32_t i = 0; i < 1000; i++)
+            {
+                Instruction::Operands ops{ rcx, qword_ptr(rdx, i * 8) };
+                program.append(program.createNode(form, ops));
+            }
+        }
+
+        // Operand buffer and the node.
+        state.counters["BytesMoved"] = static_cast<double>(sizeof(Instruction::Operands) + sizeof(Instruction));
+        state.counters["Instructions"] = benchmark::Counter(1000, benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Program_CreateNode_Emplace)->Unit(benchmark::kMicrosecond);
+
+    // Absolute jump through a patchable pointer, the typical detour stub.
+    static void BM_Assembler_Thunk_Runtime(benchmark::State& state)
+    {
+        using namespace zasm::operands;
+
+        for (auto _ : state)
+        {
+            Program program(ZYDIS_MACHINE_MODE_LONG_64);
+            Assembler assembler(program);
+
+            auto labelTarget = assembler.createLabel();
+            assembler.push(rcx);
+            assembler.mov(rcx, rsp);
+            assembler.sub(rsp, Imm(0x28));
+            assembler.call(qword_ptr(rip, labelTarget));
+            assembler.add(rsp, Imm(0x28));
+            assembler.pop(rcx);
+            assembler.ret();
+            assembler.bind(labelTarget);
+            assembler.dq(0x00007FF612345678);
+
+            Serializer serializer;
+            serializer.serialize(program, 0x00400000);
+
+            benchmark::DoNotOptimize(serializer.getCode());
+        }
+    }
+    BENCHMARK(BM_Assembler_Thunk_Runtime)->Unit(benchmark::kMicrosecond);
+
+    static void BM_Assembler_Thunk_Static(benchmark::State& state)
+    {
+        using namespace zasm::operands;
+
+        static constexpr auto kThunk = assembleStatic([](auto& a) {
+            auto labelTarget = a.createLabel();
+            a.push(rcx);
+            a.mov(rcx, rsp);
+            a.sub(rsp, Imm(0x28));
+            a.call(qword_ptr(rip, labelTarget));
+            a.add(rsp, Imm(0x28));
+            a.pop(rcx);
+            a.ret();
+            a.bind(labelTarget);
+            a.dq(0);
+            a.markPatch();
+        });
+
+        for (auto _ : state)
+        {
+            auto code = kThunk.code;
+            kThunk.patch(code.data(), 0, 0x00007FF612345678);
+
+            benchmark::DoNotOptimize(code.data());
+        }
+    }
+    BENCHMARK(BM_Assembler_Thunk_Static)->Unit(benchmark::kMicrosecond);
+
 } // namespace zasm::benchmarks
\ No newline at end of file
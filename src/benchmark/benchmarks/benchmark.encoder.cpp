@@ -0,0 +1,103 @@
+#include <array>
+#include <benchmark/benchmark.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    using namespace zasm::operands;
+
+    struct EncoderForm
+    {
+        ZydisMnemonic mnemonic;
+        size_t numOps;
+        EncoderOperands operands;
+    };
+
+    static const EncoderForm kFormMovRegReg{ ZYDIS_MNEMONIC_MOV, 2, { rax, r9 } };
+    static const EncoderForm kFormMovRegMem{ ZYDIS_MNEMONIC_MOV, 2, { rcx, qword_ptr(rdx, rbx, 8, 0x20) } };
+    static const EncoderForm kFormAddRegImm{ ZYDIS_MNEMONIC_ADD, 2, { esi, Imm(0x1000) } };
+    static const EncoderForm kFormCmpMemImm{ ZYDIS_MNEMONIC_CMP, 2, { dword_ptr(rsp, 8), Imm(1) } };
+    static const EncoderForm kFormLea{ ZYDIS_MNEMONIC_LEA, 2, { rax, qword_ptr(rbp, rcx, 4, -16) } };
+    static const EncoderForm kFormPush{ ZYDIS_MNEMONIC_PUSH, 1, { r12 } };
+    static const EncoderForm kFormJzRel8{ ZYDIS_MNEMONIC_JZ, 1, { Imm(0x40) } };
+    static const EncoderForm kFormJmpRel32{ ZYDIS_MNEMONIC_JMP, 1, { Imm(0x10000) } };
+    static const EncoderForm kFormRet{ ZYDIS_MNEMONIC_RET, 0, {} };
+
+    static void BM_Encoder_Direct(benchmark::State& state, const EncoderForm& form)
+    {
+        EncoderResult res{};
+        for (auto _ : state)
+        {
+            auto err = encodeEstimated(
+                res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, form.mnemonic, form.numOps, form.operands);
+            benchmark::DoNotOptimize(err);
+            benchmark::DoNotOptimize(res);
+        }
+    }
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, mov_r64_r64, kFormMovRegReg);
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, mov_r64_m64, kFormMovRegMem);
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, add_r32_imm32, kFormAddRegImm);
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, cmp_m32_imm8, kFormCmpMemImm);
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, lea_r64_m, kFormLea);
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, push_r64, kFormPush);
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, jz_rel8, kFormJzRel8);
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, jmp_rel32, kFormJmpRel32);
+    BENCHMARK_CAPTURE(BM_Encoder_Direct, ret, kFormRet);
+
+    static void BM_Encoder_Generic(benchmark::State& state, const EncoderForm& form)
+    {
+        EncoderResult res{};
+        for (auto _ : state)
+        {
+            auto err = encodeEstimatedGeneric(
+                res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, form.mnemonic, form.numOps, form.operands);
+            benchmark::DoNotOptimize(err);
+            benchmark::DoNotOptimize(res);
+        }
+    }
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, mov_r64_r64, kFormMovRegReg);
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, mov_r64_m64, kFormMovRegMem);
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, add_r32_imm32, kFormAddRegImm);
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, cmp_m32_imm8, kFormCmpMemImm);
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, lea_r64_m, kFormLea);
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, push_r64, kFormPush);
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, jz_rel8, kFormJzRel8);
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, jmp_rel32, kFormJmpRel32);
+    BENCHMARK_CAPTURE(BM_Encoder_Generic, ret, kFormRet);
+
+    static void BM_Operand_CopyVisit(benchmark::State& state)
+    {
+        const std::array<Operand, 6> ops{
+            rax, qword_ptr(rdx, rbx, 8, 0x20), Imm(0x1000), Label{}, Operand{}, dword_ptr(rsp, 8),
+        };
+
+        // Copying and dispatching on operands is done by every pass over the program.
+        const auto getValue = [](auto&& op) -> int64_t {
+            using T = std::decay_t<decltype(op)>;
+            if constexpr (std::is_same_v<T, Reg>)
+                return op.getId();
+            else if constexpr (std::is_same_v<T, Mem>)
+                return op.getDisplacement();
+            else if constexpr (std::is_same_v<T, Imm>)
+                return op.template value<int64_t>();
+            else if constexpr (std::is_same_v<T, Label>)
+                return static_cast<int64_t>(op.getId());
+            else
+                return 0;
+        };
+
+        for (auto _ : state)
+        {
+            int64_t sum = 0;
+            for (const auto& op : ops)
+            {
+                Operand copy = op;
+                benchmark::DoNotOptimize(copy);
+                sum += copy.visit(getValue);
+            }
+            benchmark::DoNotOptimize(sum);
+        }
+    }
+    BENCHMARK(BM_Operand_CopyVisit);
+
+} // namespace zasm::benchmarks
@@ -0,0 +1,120 @@
+#include <benchmark/benchmark.h>
+#include <testdata/instructions.hpp>
+#include <zasm/program/formatter.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    static void emitTestData(Program& program)
+    {
+        Assembler assembler(program);
+        for (const auto& instr : zasm::tests::data::Instructions)
+        {
+            instr.emitter(assembler);
+        }
+    }
+
+    static void BM_Formatter_ToString(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        emitTestData(program);
+
+        size_t bytes = 0;
+        for (auto _ : state)
+        {
+            auto text = formatter::toString(program);
+            bytes = text.size();
+
+            benchmark::DoNotOptimize(text);
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    }
+    BENCHMARK(BM_Formatter_ToString)->Unit(benchmark::kMillisecond);
+
+    static void BM_Formatter_ToBuffer(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        emitTestData(program);
+
+        formatter::Buffer buffer;
+
+        size_t bytes = 0;
+        for (auto _ : state)
+        {
+            buffer.clear();
+            bytes = formatter::toBuffer(program, buffer);
+
+            benchmark::DoNotOptimize(buffer);
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    }
+    BENCHMARK(BM_Formatter_ToBuffer)->Unit(benchmark::kMillisecond);
+
+    static void BM_Formatter_ToCallback(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        emitTestData(program);
+
+        // Measures the formatting alone, the text is discarded.
+        const auto discard = [](void*, const char* data, size_t) { benchmark::DoNotOptimize(data); };
+
+        size_t bytes = 0;
+        for (auto _ : state)
+        {
+            bytes = formatter::format(program, discard, nullptr);
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    }
+    BENCHMARK(BM_Formatter_ToCallback)->Unit(benchmark::kMillisecond);
+
+    static void BM_Formatter_ToStringParallel(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        emitTestData(program);
+
+        const auto threadCount = static_cast<size_t>(state.range(0));
+
+        size_t bytes = 0;
+        for (auto _ : state)
+        {
+            auto text = formatter::toStringParallel(program, {}, threadCount);
+            bytes = text.size();
+
+            benchmark::DoNotOptimize(text);
+        }
+
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * bytes));
+    }
+    BENCHMARK(BM_Formatter_ToStringParallel)->RangeMultiplier(2)->Range(1, 8)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+    // Formats a single instruction, isolates the per operand dispatch from the program traversal.
+    template<typename TEmit> static void BM_Formatter_Operand(benchmark::State& state, TEmit&& emit)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        emit(assembler);
+
+        const auto* instr = program.getTail()->getIf<Instruction>();
+
+        for (auto _ : state)
+        {
+            auto text = formatter::toString(program, instr);
+
+            benchmark::DoNotOptimize(text);
+        }
+    }
+    BENCHMARK_CAPTURE(BM_Formatter_Operand, reg, [](Assembler& a) { a.mov(operands::rax, operands::r9); });
+    BENCHMARK_CAPTURE(BM_Formatter_Operand, mem, [](Assembler& a) {
+        a.mov(operands::rcx, operands::qword_ptr(operands::rdx, operands::rbx, 8, 0x20));
+    });
+    BENCHMARK_CAPTURE(BM_Formatter_Operand, imm, [](Assembler& a) { a.add(operands::esi, operands::Imm(0x1000)); });
+    BENCHMARK_CAPTURE(BM_Formatter_Operand, label, [](Assembler& a) {
+        auto label = a.createLabel();
+        a.bind(label);
+        a.jmp(label);
+    });
+
+} // namespace zasm::benchmarks
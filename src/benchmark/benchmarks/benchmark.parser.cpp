@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <benchmark/benchmark.h>
+#include <testdata/instructions.hpp>
+#include <zasm/program/formatter.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    static std::string formatTestData()
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        for (const auto& instr : zasm::tests::data::Instructions)
+        {
+            instr.emitter(assembler);
+        }
+        return formatter::toString(program);
+    }
+
+    static void BM_Parser_TestData(benchmark::State& state)
+    {
+        const auto text = formatTestData();
+        const auto numLines = std::count(text.begin(), text.end(), '\n') + 1;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            assembler.setCursor(nullptr);
+            state.ResumeTiming();
+
+            Parser parser(assembler);
+            if (parser.parse(text) != Error::None)
+            {
+                state.SkipWithError("Failed to parse");
+                break;
+            }
+        }
+
+        state.counters["Lines"] = benchmark::Counter(
+            static_cast<double>(numLines), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+        state.SetBytesProcessed(static_cast<int64_t>(state.iterations() * text.size()));
+    }
+    BENCHMARK(BM_Parser_TestData)->Unit(benchmark::kMillisecond);
+
+} // namespace zasm::benchmarks
@@ -0,0 +1,328 @@
+#include <benchmark/benchmark.h>
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+#include <zasm/zasm.hpp>
+
+namespace zasm::benchmarks
+{
+    // Same shape as the program of the analysis benchmarks using numRegs virtual registers in rotation,
+    // more registers than available force spills.
+    static void buildVirtualProgram(Program& program, int64_t numBlocks, int64_t numRegs)
+    {
+        using namespace zasm::operands;
+
+        Assembler assembler(program);
+
+        std::vector<Gp64> regs;
+        for (int64_t i = 0; i < numRegs; ++i)
+        {
+            regs.push_back(assembler.createVirtualGp64());
+        }
+
+        std::vector<Label> labels;
+        labels.reserve(static_cast<size_t>(numBlocks));
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            labels.push_back(assembler.createLabel());
+        }
+
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            const auto& a = regs[i % numRegs];
+            const auto& b = regs[(i + 1) % numRegs];
+            const auto& c = regs[(i + 3) % numRegs];
+
+            assembler.bind(labels[i]);
+            assembler.mov(a, qword_ptr(rcx, 8));
+            assembler.add(b, a);
+            assembler.lea(a, qword_ptr(a, c, 2, 0x10));
+            assembler.cmp(b, Imm(static_cast<int32_t>(i)));
+            assembler.jz(labels[(i * 7 + 3) % numBlocks]);
+        }
+        assembler.ret();
+    }
+
+    static void BM_RegisterAllocator(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        passes::RegisterAllocator allocator;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            buildVirtualProgram(program, state.range(0), state.range(1));
+            state.ResumeTiming();
+
+            allocator.run(program);
+        }
+
+        // Code quality, spilled registers and the loads and stores required for them.
+        const auto& stats = allocator.getStats();
+        state.counters["Spilled"] = static_cast<double>(stats.numSpilled);
+        state.counters["SpillInstructions"] = static_cast<double>(stats.numSpillInstructions);
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0) * 5), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_RegisterAllocator)
+        ->Unit(benchmark::kMillisecond)
+        ->RangeMultiplier(4)
+        ->Ranges({ { 1024, 1 << 16 }, { 8, 32 } });
+
+    // Code as a naive generator emits it, every block holds one candidate of each peephole rule and a
+    // write to r8 that is dead as every block overwrites it.
+    static void buildRedundantProgram(Program& program, int64_t numBlocks)
+    {
+        using namespace zasm::operands;
+
+        Assembler assembler(program);
+
+        std::vector<Label> labels;
+        labels.reserve(static_cast<size_t>(numBlocks) + 1);
+        for (int64_t i = 0; i <= numBlocks; ++i)
+        {
+            labels.push_back(assembler.createLabel());
+        }
+
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            assembler.bind(labels[i]);
+            assembler.mov(r8, rdx);
+            assembler.mov(rax, rax);
+            assembler.mov(rcx, Imm(0));
+            assembler.mov(rdx, Imm(static_cast<int32_t>(i)));
+            assembler.add(rdx, Imm(1));
+            assembler.add(rdx, Imm(1));
+            assembler.cmp(rdx, rcx);
+            assembler.jz(labels[(i * 7 + 3) % numBlocks]);
+            assembler.jmp(labels[i + 1]);
+        }
+        assembler.bind(labels[numBlocks]);
+        assembler.ret();
+    }
+
+    static void BM_Peephole(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        passes::Peephole peephole;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            buildRedundantProgram(program, state.range(0));
+            state.ResumeTiming();
+
+            peephole.run(program);
+        }
+
+        const auto& stats = peephole.getStats();
+        state.counters["Removed"] = static_cast<double>(stats.numRemoved);
+        state.counters["Replaced"] = static_cast<double>(stats.numReplaced);
+        state.counters["BytesSaved"] = static_cast<double>(stats.bytesSaved);
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0) * 9), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Peephole)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1024, 1 << 16);
+
+    static void BM_DeadCodeElimination(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        passes::DeadCodeElimination dce;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            buildRedundantProgram(program, state.range(0));
+            state.ResumeTiming();
+
+            dce.run(program);
+        }
+
+        const auto& stats = dce.getStats();
+        state.counters["Removed"] = static_cast<double>(stats.numRemovedInstructions);
+        state.counters["BytesSaved"] = static_cast<double>(stats.bytesSaved);
+        state.counters["Instructions"] = benchmark::Counter(
+            static_cast<double>(state.range(0) * 9), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_DeadCodeElimination)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1024, 1 << 16);
+
+    // Every block branches over a jump to the next block into a chain of trampolines that ends at the
+    // return, resolving each chain on its own would be quadratic.
+    static void buildBranchChainProgram(Program& program, int64_t numBlocks)
+    {
+        using namespace zasm::operands;
+
+        Assembler assembler(program);
+
+        std::vector<Label> blocks;
+        std::vector<Label> trampolines;
+        blocks.reserve(static_cast<size_t>(numBlocks) + 1);
+        trampolines.reserve(static_cast<size_t>(numBlocks) + 1);
+        for (int64_t i = 0; i <= numBlocks; ++i)
+        {
+            blocks.push_back(assembler.createLabel());
+            trampolines.push_back(assembler.createLabel());
+        }
+
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            assembler.bind(blocks[i]);
+            assembler.add(rax, Imm(1));
+            assembler.cmp(rax, rcx);
+            assembler.jz(trampolines[i]);
+            assembler.jmp(blocks[i + 1]);
+            assembler.bind(trampolines[i]);
+            assembler.jmp(trampolines[i + 1]);
+        }
+        assembler.bind(blocks[numBlocks]);
+        assembler.bind(trampolines[numBlocks]);
+        assembler.ret();
+    }
+
+    static void BM_JumpThreading(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        passes::JumpThreading jumpThreading;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            buildBranchChainProgram(program, state.range(0));
+            state.ResumeTiming();
+
+            jumpThreading.run(program);
+        }
+
+        const auto& stats = jumpThreading.getStats();
+        state.counters["Threaded"] = static_cast<double>(stats.numThreaded);
+        state.counters["Inverted"] = static_cast<double>(stats.numInverted);
+        state.counters["Removed"] = static_cast<double>(stats.numRemoved);
+        state.counters["Branches"] = benchmark::Counter(
+            static_cast<double>(state.range(0) * 3), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_JumpThreading)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1024, 1 << 16);
+
+    // Loop bodies with a rarely taken error path placed between their hot blocks, the profile marks
+    // the hot blocks and the error paths.
+    static void buildColdPathProgram(
+        Program& program, int64_t numBlocks, passes::BlockLayout& blockLayout, std::vector<uint8_t>& hotLabels)
+    {
+        using namespace zasm::operands;
+
+        Assembler assembler(program);
+
+        for (int64_t i = 0; i < numBlocks; ++i)
+        {
+            auto labelHot = assembler.createLabel();
+            auto labelCold = assembler.createLabel();
+            auto labelJoin = assembler.createLabel();
+
+            assembler.bind(labelHot);
+            assembler.add(rax, Imm(1));
+            assembler.cmp(rax, rcx);
+            assembler.jnz(labelJoin);
+            assembler.bind(labelCold);
+            assembler.mov(rdx, Imm(0x12345678));
+            assembler.mov(qword_ptr(rsp, 0x20), rdx);
+            assembler.mov(r8, Imm(0x87654321));
+            assembler.mov(qword_ptr(rsp, 0x28), r8);
+            assembler.xor_(eax, eax);
+            assembler.bind(labelJoin);
+            assembler.sub(rdx, rax);
+            assembler.imul(rdx, rcx);
+
+            blockLayout.setWeight(labelHot, 1000);
+            blockLayout.setWeight(labelCold, 0);
+            blockLayout.setWeight(labelJoin, 1000);
+
+            hotLabels.resize(static_cast<size_t>(labelJoin.getId()) + 1);
+            hotLabels[static_cast<size_t>(labelHot.getId())] = 1;
+            hotLabels[static_cast<size_t>(labelJoin.getId())] = 1;
+        }
+        assembler.ret();
+    }
+
+    // Counts the 64 byte cache lines touched by the blocks of hot labels until the first section change.
+    static size_t countHotCacheLines(const Program& program, const std::vector<uint8_t>& hotLabels)
+    {
+        constexpr int64_t kCacheLineSize = 64;
+
+        size_t numLines = 0;
+        int64_t offset = 0;
+        int64_t lastLine = -1;
+        bool isHot = false;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (const auto* label = node->getIf<Label>(); label != nullptr)
+            {
+                const auto labelIdx = static_cast<size_t>(label->getId());
+                isHot = labelIdx < hotLabels.size() && hotLabels[labelIdx] != 0;
+                continue;
+            }
+            if (node->holds<Section>())
+                break;
+
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr)
+                continue;
+
+            const auto length = static_cast<int64_t>(instr->getLength());
+            if (isHot)
+            {
+                const auto firstLine = std::max(offset / kCacheLineSize, lastLine + 1);
+                const auto endLine = (offset + length - 1) / kCacheLineSize;
+                if (endLine >= firstLine)
+                {
+                    numLines += static_cast<size_t>(endLine - firstLine + 1);
+                    lastLine = endLine;
+                }
+            }
+            offset += length;
+        }
+        return numLines;
+    }
+
+    static void BM_BlockLayout(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        passes::BlockLayout blockLayout;
+        std::vector<uint8_t> hotLabels;
+
+        for (auto _ : state)
+        {
+            state.PauseTiming();
+            program.clear();
+            blockLayout.clearWeights();
+            hotLabels.clear();
+            buildColdPathProgram(program, state.range(0), blockLayout, hotLabels);
+            state.ResumeTiming();
+
+            blockLayout.run(program);
+        }
+
+        // Lines touched by the hot path before and after the layout with the inverted branches.
+        Program reference(ZYDIS_MACHINE_MODE_LONG_64);
+        passes::BlockLayout referenceLayout;
+        buildColdPathProgram(reference, state.range(0), referenceLayout, hotLabels);
+
+        passes::JumpThreading jumpThreading;
+        jumpThreading.run(program);
+
+        const auto& stats = blockLayout.getStats();
+        state.counters["HotCacheLinesBefore"] = static_cast<double>(countHotCacheLines(reference, hotLabels));
+        state.counters["HotCacheLinesAfter"] = static_cast<double>(countHotCacheLines(program, hotLabels));
+        state.counters["HotSize"] = static_cast<double>(stats.hotSize);
+        state.counters["ColdSize"] = static_cast<double>(stats.coldSize);
+        state.counters["JumpsInserted"] = static_cast<double>(stats.numJumpsInserted);
+    }
+    BENCHMARK(BM_BlockLayout)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(1024, 1 << 16);
+
+} // namespace zasm::benchmarks
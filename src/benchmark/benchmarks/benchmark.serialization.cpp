@@ -1,6 +1,7 @@
 #include <benchmark/benchmark.h>
 #include <functional>
 #include <testdata/instructions.hpp>
+#include <vector>
 #include <zasm/zasm.hpp>
 
 namespace zasm::benchmarks
@@ -48,4 +49,78 @@ namespace zasm::benchmarks
     }
     BENCHMARK(BM_Serialization)->Unit(benchmark::kMillisecond)->RangeMultiplier(2)->Range(4096, 8 << 18);
 
+    static void BM_Serialization_RipRelative(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        // Position independent code, every instruction references a label relative to rip.
+        std::vector<zasm::Label> labels;
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            if (i % 16 == 0)
+            {
+                labels.push_back(assembler.createLabel());
+                assembler.bind(labels.back());
+            }
+
+            const auto& label = labels[(i * 31) % labels.size()];
+            if (i % 2 == 0)
+                assembler.lea(operands::rax, operands::qword_ptr(operands::rip, label));
+            else
+                assembler.mov(operands::ecx, operands::dword_ptr(operands::rip, label));
+        }
+
+        for (auto _ : state)
+        {
+            serializer.serialize(program, 0x00400000);
+
+            state.counters["Instructions"] = benchmark::Counter(state.range(0), benchmark::Counter::kIsIterationInvariantRate, benchmark::Counter::OneK::kIs1000);
+        }
+    }
+    BENCHMARK(BM_Serialization_RipRelative)->Unit(benchmark::kMillisecond)->RangeMultiplier(4)->Range(4096, 1 << 18);
+
+    // Loops of a compare and a conditional branch back to the head, the padding reported relative to the
+    // code size is the cost of the jcc erratum mitigation.
+    static void BM_Serialization_JccErratum(benchmark::State& state)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+        serializer.setJccErratumMitigation(state.range(1) != 0);
+
+        for (int64_t i = 0; i < state.range(0); ++i)
+        {
+            auto label = assembler.createLabel();
+            assembler.bind(label);
+            assembler.add(operands::rax, operands::qword_ptr(operands::rcx, static_cast<int32_t>(i % 64) * 8));
+            for (int64_t n = 0; n < i % 5; ++n)
+            {
+                assembler.lea(operands::rdx, operands::qword_ptr(operands::rdx, operands::rax, 2, 0x10));
+            }
+            assembler.sub(operands::r8, operands::Imm(1));
+            assembler.jnz(label);
+        }
+        assembler.ret();
+
+        for (auto _ : state)
+        {
+            serializer.serialize(program, 0x00400000);
+        }
+
+        const auto& stats = serializer.getJccErratumStats();
+        state.counters["Padded"] = static_cast<double>(stats.numPadded);
+        state.counters["PaddingBytes"] = static_cast<double>(stats.bytesPadded);
+        state.counters["SizeOverhead%"] = 100.0 * static_cast<double>(stats.bytesPadded)
+            / static_cast<double>(serializer.getCodeSize() - stats.bytesPadded);
+        state.counters["Loops"] = benchmark::Counter(
+            static_cast<double>(state.range(0)), benchmark::Counter::kIsIterationInvariantRate,
+            benchmark::Counter::OneK::kIs1000);
+    }
+    BENCHMARK(BM_Serialization_JccErratum)
+        ->Unit(benchmark::kMillisecond)
+        ->RangeMultiplier(8)
+        ->Ranges({ { 1024, 1 << 16 }, { 0, 1 } });
+
 } // namespace zasm::benchmarks
\ No newline at end of file
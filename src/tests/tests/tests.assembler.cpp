@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <zasm/program/formatter.hpp>
 #include <zasm/zasm.hpp>
 
 namespace zasm::tests
@@ -40,4 +41,84 @@ namespace zasm::tests
         ASSERT_EQ(assembler.bind(label01), Error::InvalidLabel);
     }
 
-} // namespace zasm::tests
\ No newline at end of file
+    TEST(AssemblerTests, GeneratorCacheHit)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        ASSERT_EQ(assembler.mov(rcx, qword_ptr(rdx, 8)), Error::None);
+        ASSERT_EQ(assembler.mov(rbx, qword_ptr(rcx, 16)), Error::None);
+
+        const auto stats = assembler.getGeneratorStats();
+        ASSERT_EQ(stats.cacheMisses, 1);
+        ASSERT_EQ(stats.cacheHits, 1);
+
+        const auto* instr = program.getTail()->getIf<Instruction>();
+        ASSERT_NE(instr, nullptr);
+        ASSERT_EQ(instr->getLength(), 4);
+        ASSERT_EQ(formatter::toString(program, instr), std::string("mov rbx, qword ptr ds:[rcx+16]"));
+    }
+
+    TEST(AssemblerTests, GeneratorCacheMatchesDecoder)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        const Gp64 regs[] = { rax, rcx, rdx, rbx, rsp, rbp, rsi, rdi, r8, r9, r10, r11, r12, r13, r14, r15 };
+        const int64_t values[] = { 0, 1, -1, 2, -100, 127, 128, 255, 256, -129, 0x7FFF, 0x10000, -0x10000, 0x7FFFFFFF, -0x80000000LL };
+
+        for (const auto& reg : regs)
+        {
+            for (const auto& base : regs)
+            {
+                for (auto val : values)
+                {
+                    ASSERT_EQ(assembler.add(reg, qword_ptr(base, val)), Error::None);
+                    if (reg != rsp)
+                    {
+                        ASSERT_EQ(assembler.mov(qword_ptr(base, reg, 2, val), reg), Error::None);
+                    }
+                    ASSERT_EQ(assembler.add(reg.r32(), Imm(val)), Error::None);
+                    ASSERT_EQ(assembler.mov(reg, Imm(val)), Error::None);
+                }
+            }
+        }
+
+        const auto stats = assembler.getGeneratorStats();
+        ASSERT_GT(stats.cacheHits, stats.cacheMisses);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(serializer.getNodeCount(), program.size());
+
+        Decoder decoder(ZYDIS_MACHINE_MODE_LONG_64);
+
+        size_t index = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext(), ++index)
+        {
+            const auto* instr = node->getIf<Instruction>();
+            ASSERT_NE(instr, nullptr);
+
+            const auto* info = serializer.getNodeInfo(index);
+            ASSERT_NE(info, nullptr);
+
+            auto decodeResult = decoder.decode(serializer.getCode() + info->offset, info->length, info->address);
+            ASSERT_EQ(decodeResult.hasValue(), true);
+
+            const auto& decoded = *decodeResult;
+
+            const auto text = formatter::toString(program, instr);
+            ASSERT_EQ(text, formatter::toString(program, &decoded));
+            ASSERT_EQ(instr->getLength(), decoded.getLength()) << text;
+            ASSERT_EQ(instr->getOperandCount(), decoded.getOperandCount()) << text;
+            ASSERT_EQ(instr->getCategory(), decoded.getCategory()) << text;
+            ASSERT_EQ(instr->getOperandsVisibility(), decoded.getOperandsVisibility()) << text;
+            ASSERT_EQ(instr->getFlags().write, decoded.getFlags().write) << text;
+        }
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,143 @@
+#include "../testutils.hpp"
+
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using namespace zasm::operands;
+    using passes::BlockLayout;
+    using passes::JumpThreading;
+
+    TEST(BlockLayoutTests, ColdSplit)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelError = assembler.createLabel();
+        auto labelBody = assembler.createLabel();
+
+        ASSERT_EQ(assembler.test(rcx, rcx), Error::None);
+        ASSERT_EQ(assembler.jnz(labelBody), Error::None);
+        ASSERT_EQ(assembler.bind(labelError), Error::None);
+        ASSERT_EQ(assembler.xor_(eax, eax), Error::None);
+        ASSERT_EQ(assembler.dec(rax), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.bind(labelBody), Error::None);
+        ASSERT_EQ(assembler.add(rax, rdx), Error::None);
+        ASSERT_EQ(assembler.dec(rcx), Error::None);
+        ASSERT_EQ(assembler.jnz(labelBody), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        BlockLayout blockLayout;
+        blockLayout.setWeight(labelBody, 1000);
+        blockLayout.setWeight(labelError, 0);
+        ASSERT_EQ(blockLayout.run(program), Error::None);
+
+        // The exit inherits the weight of the loop falling into it.
+        const auto& stats = blockLayout.getStats();
+        ASSERT_EQ(stats.numHotBlocks, 3);
+        ASSERT_EQ(stats.numColdBlocks, 1);
+        ASSERT_EQ(stats.numChains, 1);
+        ASSERT_EQ(stats.numJumpsInserted, 1);
+
+        ASSERT_EQ(getInstruction(program, 1).getId(), ZYDIS_MNEMONIC_JNZ);
+        const auto& jmp = getInstruction(program, 2);
+        ASSERT_EQ(jmp.getId(), ZYDIS_MNEMONIC_JMP);
+        ASSERT_EQ(jmp.getOperands()[0].get<Label>().getId(), labelError.getId());
+        ASSERT_EQ(getInstruction(program, 3).getId(), ZYDIS_MNEMONIC_ADD);
+        ASSERT_EQ(getInstruction(program, 6).getId(), ZYDIS_MNEMONIC_RET);
+        ASSERT_EQ(getInstruction(program, 7).getId(), ZYDIS_MNEMONIC_XOR);
+
+        // The branch over the inserted jump becomes a branch into the cold section.
+        JumpThreading jumpThreading;
+        ASSERT_EQ(jumpThreading.run(program), Error::None);
+        ASSERT_EQ(jumpThreading.getStats().numInverted, 1);
+
+        const auto& jz = getInstruction(program, 1);
+        ASSERT_EQ(jz.getId(), ZYDIS_MNEMONIC_JZ);
+        ASSERT_EQ(jz.getOperands()[0].get<Label>().getId(), labelError.getId());
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        ASSERT_EQ(serializer.getSectionCount(), 2);
+
+        const auto* coldInfo = serializer.getSectionInfo(1);
+        ASSERT_NE(coldInfo, nullptr);
+        ASSERT_EQ(std::string(coldInfo->name), ".text.cold");
+        ASSERT_EQ(coldInfo->attribs, Section::Attribs::Code);
+        ASSERT_EQ(coldInfo->address, 0x401000);
+        ASSERT_EQ(serializer.getLabelAddress(labelError.getId()), 0x401000);
+    }
+
+    TEST(BlockLayoutTests, ChainOrder)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelRare = assembler.createLabel();
+        auto labelLikely = assembler.createLabel();
+        auto labelJoin = assembler.createLabel();
+
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.jl(labelLikely), Error::None);
+        ASSERT_EQ(assembler.bind(labelRare), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.jmp(labelJoin), Error::None);
+        ASSERT_EQ(assembler.bind(labelLikely), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.bind(labelJoin), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        BlockLayout blockLayout;
+        blockLayout.setWeight(program.getHead(), 1010);
+        blockLayout.setWeight(labelRare, 10);
+        blockLayout.setWeight(labelLikely, 1000);
+        blockLayout.setWeight(labelJoin, 1010);
+        ASSERT_EQ(blockLayout.run(program), Error::None);
+
+        // The likely path becomes the fallthrough, the rare path is placed after the return.
+        const auto& stats = blockLayout.getStats();
+        ASSERT_EQ(stats.numHotBlocks, 4);
+        ASSERT_EQ(stats.numColdBlocks, 0);
+        ASSERT_EQ(stats.numChains, 2);
+        ASSERT_EQ(stats.numJumpsInserted, 1);
+
+        ASSERT_EQ(getInstruction(program, 2).getId(), ZYDIS_MNEMONIC_JMP);
+        ASSERT_EQ(getInstruction(program, 2).getOperands()[0].get<Label>().getId(), labelRare.getId());
+        ASSERT_EQ(getInstruction(program, 3).getOperands()[1].get<Imm>().value<int64_t>(), 2);
+        ASSERT_EQ(getInstruction(program, 4).getId(), ZYDIS_MNEMONIC_RET);
+        ASSERT_EQ(getInstruction(program, 5).getOperands()[1].get<Imm>().value<int64_t>(), 1);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        ASSERT_EQ(serializer.getSectionCount(), 1);
+    }
+
+    TEST(BlockLayoutTests, NoWeights)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelSkip = assembler.createLabel();
+
+        ASSERT_EQ(assembler.test(rcx, rcx), Error::None);
+        ASSERT_EQ(assembler.jz(labelSkip), Error::None);
+        ASSERT_EQ(assembler.inc(rax), Error::None);
+        ASSERT_EQ(assembler.bind(labelSkip), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        const auto oldSize = program.size();
+
+        BlockLayout blockLayout;
+        ASSERT_EQ(blockLayout.run(program), Error::None);
+
+        const auto& stats = blockLayout.getStats();
+        ASSERT_EQ(stats.numHotBlocks, 0);
+        ASSERT_EQ(stats.numColdBlocks, 0);
+        ASSERT_EQ(stats.numJumpsInserted, 0);
+        ASSERT_EQ(program.size(), oldSize);
+        ASSERT_EQ(getInstruction(program, 2).getId(), ZYDIS_MNEMONIC_INC);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,186 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <testdata/instructions.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    TEST(CodeStreamTests, MatchesSerializer)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        for (const auto& instr : data::Instructions)
+        {
+            ASSERT_EQ(instr.emitter(assembler), Error::None) << instr.operation;
+        }
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        Program streamProgram(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler streamAssembler(streamProgram);
+        CodeStream stream(ZYDIS_MACHINE_MODE_LONG_64, 0x0000000000401000);
+        ASSERT_EQ(streamAssembler.setStream(&stream), Error::None);
+
+        for (const auto& instr : data::Instructions)
+        {
+            ASSERT_EQ(instr.emitter(streamAssembler), Error::None) << instr.operation;
+        }
+
+        ASSERT_EQ(streamProgram.size(), 0);
+        ASSERT_EQ(stream.getCodeSize(), serializer.getCodeSize());
+        ASSERT_EQ(std::memcmp(stream.getCode(), serializer.getCode(), serializer.getCodeSize()), 0);
+    }
+
+    TEST(CodeStreamTests, LabelFixups)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        // Far from the temporary values used for unbound labels.
+        constexpr int64_t kBase = 0x00007FF612340000;
+        CodeStream stream(ZYDIS_MACHINE_MODE_LONG_64, kBase);
+        ASSERT_EQ(assembler.setStream(&stream), Error::None);
+
+        auto labelLoop = assembler.createLabel();
+        auto labelExit = assembler.createLabel();
+        auto labelData = assembler.createLabel();
+
+        ASSERT_EQ(assembler.bind(labelLoop), Error::None);
+        ASSERT_EQ(assembler.jz(labelExit), Error::None);
+        ASSERT_EQ(assembler.lea(rax, qword_ptr(rip, labelData, 8)), Error::None);
+        ASSERT_EQ(assembler.dec(ecx), Error::None);
+        ASSERT_EQ(assembler.jmp(labelLoop), Error::None);
+        ASSERT_EQ(assembler.embedLabelRel(labelExit, labelLoop, BitSize::_32), Error::None);
+        ASSERT_EQ(assembler.embedLabel(labelData), Error::None);
+        ASSERT_EQ(stream.getUnresolvedCount(), 4);
+
+        ASSERT_EQ(assembler.bind(labelExit), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(stream.getUnresolvedCount(), 2);
+
+        ASSERT_EQ(assembler.bind(labelData), Error::None);
+        ASSERT_EQ(assembler.dq(0), Error::None);
+        ASSERT_EQ(stream.getUnresolvedCount(), 0);
+
+        ASSERT_EQ(assembler.bind(labelData), Error::LabelAlreadyBound);
+        ASSERT_EQ(assembler.section(".data"), Error::InvalidOperation);
+
+        const auto exitVA = stream.getLabelAddress(labelExit.getId());
+        const auto dataVA = stream.getLabelAddress(labelData.getId());
+        ASSERT_NE(exitVA, -1);
+        ASSERT_NE(dataVA, -1);
+
+        const uint8_t* code = stream.getCode();
+        Decoder decoder(ZYDIS_MACHINE_MODE_LONG_64);
+
+        // Forward branches are always rel32.
+        auto jzResult = decoder.decode(code, stream.getCodeSize(), kBase);
+        ASSERT_EQ(jzResult.hasValue(), true);
+        const auto& jz = *jzResult;
+        ASSERT_EQ(jz.getLength(), 6);
+        ASSERT_EQ(jz.getOperand<Imm>(0).value<int64_t>(), exitVA);
+
+        auto leaResult = decoder.decode(code + 6, stream.getCodeSize() - 6, kBase + 6);
+        ASSERT_EQ(leaResult.hasValue(), true);
+        const auto& lea = *leaResult;
+        const auto& leaMem = lea.getOperand<Mem>(1);
+        ASSERT_EQ(kBase + 6 + lea.getLength() + leaMem.getDisplacement(), dataVA + 8);
+
+        // Backward branches use the shortest form.
+        const auto jmpOffset = 6 + lea.getLength() + 2;
+        auto jmpResult = decoder.decode(code + jmpOffset, stream.getCodeSize() - jmpOffset, kBase + jmpOffset);
+        ASSERT_EQ(jmpResult.hasValue(), true);
+        const auto& jmp = *jmpResult;
+        ASSERT_EQ(jmp.getLength(), 2);
+        ASSERT_EQ(jmp.getOperand<Imm>(0).value<int64_t>(), kBase);
+
+        const auto dataOffset = jmpOffset + 2;
+        int32_t relValue{};
+        std::memcpy(&relValue, code + dataOffset, sizeof(relValue));
+        ASSERT_EQ(relValue, exitVA - kBase);
+
+        int64_t absValue{};
+        std::memcpy(&absValue, code + dataOffset + 4, sizeof(absValue));
+        ASSERT_EQ(absValue, dataVA);
+    }
+
+    TEST(CodeStreamTests, AbsLabelAbove4GiB)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        constexpr int64_t kBase = 0x00007FF612340000;
+        CodeStream stream(ZYDIS_MACHINE_MODE_LONG_64, kBase);
+        ASSERT_EQ(assembler.setStream(&stream), Error::None);
+
+        auto label = assembler.createLabel();
+        ASSERT_EQ(assembler.mov(rax, label), Error::None);
+        ASSERT_EQ(stream.getUnresolvedCount(), 1);
+        ASSERT_EQ(assembler.nop(), Error::None);
+        ASSERT_EQ(assembler.bind(label), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(stream.getUnresolvedCount(), 0);
+
+        const auto labelVA = stream.getLabelAddress(label.getId());
+        ASSERT_EQ(labelVA, kBase + 11);
+
+        // mov rax, imm64
+        const uint8_t* code = stream.getCode();
+        ASSERT_EQ(stream.getCodeSize(), 12);
+        ASSERT_EQ(code[0], 0x48);
+        ASSERT_EQ(code[1], 0xB8);
+
+        int64_t absValue{};
+        std::memcpy(&absValue, code + 2, sizeof(absValue));
+        ASSERT_EQ(absValue, labelVA);
+    }
+
+    TEST(CodeStreamTests, ModeMismatch)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        CodeStream stream(ZYDIS_MACHINE_MODE_LEGACY_32, 0x1000);
+
+        ASSERT_EQ(assembler.setStream(&stream), Error::InvalidMode);
+        ASSERT_EQ(assembler.getStream(), nullptr);
+    }
+
+    TEST(CodeStreamTests, Align)
+    {
+        const auto emitCode = [](Assembler& assembler) {
+            ASSERT_EQ(assembler.nop(), Error::None);
+            ASSERT_EQ(assembler.align(32), Error::None);
+            ASSERT_EQ(assembler.ret(), Error::None);
+            ASSERT_EQ(assembler.align(8, Align::Type::Data), Error::None);
+            ASSERT_EQ(assembler.dd(0x11223344), Error::None);
+        };
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        emitCode(assembler);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        Program streamProgram(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler streamAssembler(streamProgram);
+        CodeStream stream(ZYDIS_MACHINE_MODE_LONG_64, 0x0000000000401000);
+        ASSERT_EQ(streamAssembler.setStream(&stream), Error::None);
+        emitCode(streamAssembler);
+
+        ASSERT_EQ(stream.getCodeSize(), 44);
+        ASSERT_EQ(stream.getCodeSize(), serializer.getCodeSize());
+        ASSERT_EQ(std::memcmp(stream.getCode(), serializer.getCode(), serializer.getCodeSize()), 0);
+
+        ASSERT_EQ(stream.align(0, Align::Type::Code), Error::InvalidParameter);
+        ASSERT_EQ(stream.align(24, Align::Type::Code), Error::InvalidParameter);
+        ASSERT_EQ(stream.getCodeSize(), 44);
+    }
+
+} // namespace zasm::tests
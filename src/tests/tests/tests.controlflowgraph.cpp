@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using namespace zasm::operands;
+    using analysis::ControlFlowGraph;
+
+    TEST(ControlFlowGraphTests, Diamond)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelElse = assembler.createLabel();
+        auto labelExit = assembler.createLabel();
+
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.jz(labelElse), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(1)), Error::None);
+        const auto* nodeThen = program.getTail();
+        ASSERT_EQ(assembler.jmp(labelExit), Error::None);
+        ASSERT_EQ(assembler.bind(labelElse), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.bind(labelExit), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        const auto* nodeRet = program.getTail();
+
+        ControlFlowGraph cfg;
+        ASSERT_EQ(cfg.build(program), Error::None);
+        ASSERT_EQ(cfg.getBlockCount(), 4);
+        ASSERT_EQ(cfg.getBlockOf(nodeThen), 1);
+        ASSERT_EQ(cfg.getBlockOf(nodeRet), 3);
+
+        ASSERT_EQ(cfg.getBlock(0).succs[0], 1);
+        ASSERT_EQ(cfg.getBlock(0).succs[1], 2);
+        ASSERT_EQ(cfg.getBlock(1).succs[0], analysis::kInvalidBlock);
+        ASSERT_EQ(cfg.getBlock(1).succs[1], 3);
+        ASSERT_EQ(cfg.getBlock(3).hasUnknownSucc, true);
+        ASSERT_EQ(cfg.getPredecessorCount(3), 2);
+
+        ASSERT_EQ(cfg.getImmediateDominator(0), analysis::kInvalidBlock);
+        ASSERT_EQ(cfg.getImmediateDominator(1), 0);
+        ASSERT_EQ(cfg.getImmediateDominator(2), 0);
+        ASSERT_EQ(cfg.getImmediateDominator(3), 0);
+        ASSERT_EQ(cfg.dominates(0, 3), true);
+        ASSERT_EQ(cfg.dominates(1, 3), false);
+        ASSERT_EQ(cfg.dominates(3, 3), true);
+        ASSERT_EQ(cfg.getLoopCount(), 0);
+    }
+
+    TEST(ControlFlowGraphTests, NestedLoops)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelOuter = assembler.createLabel();
+        auto labelInner = assembler.createLabel();
+
+        ASSERT_EQ(assembler.mov(ecx, Imm(10)), Error::None);
+        ASSERT_EQ(assembler.bind(labelOuter), Error::None);
+        ASSERT_EQ(assembler.mov(edx, Imm(5)), Error::None);
+        ASSERT_EQ(assembler.bind(labelInner), Error::None);
+        ASSERT_EQ(assembler.dec(edx), Error::None);
+        ASSERT_EQ(assembler.jnz(labelInner), Error::None);
+        ASSERT_EQ(assembler.dec(ecx), Error::None);
+        ASSERT_EQ(assembler.jnz(labelOuter), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        ControlFlowGraph cfg;
+        ASSERT_EQ(cfg.build(program), Error::None);
+        ASSERT_EQ(cfg.getBlockCount(), 5);
+        ASSERT_EQ(cfg.getLoopCount(), 2);
+
+        // Inner loops come first.
+        const auto& inner = cfg.getLoop(0);
+        const auto& outer = cfg.getLoop(1);
+        ASSERT_EQ(inner.header, 2);
+        ASSERT_EQ(inner.parent, 1);
+        ASSERT_EQ(inner.depth, 2);
+        ASSERT_EQ(outer.header, 1);
+        ASSERT_EQ(outer.parent, analysis::kInvalidLoop);
+        ASSERT_EQ(outer.depth, 1);
+
+        ASSERT_EQ(cfg.getLoopDepth(0), 0);
+        ASSERT_EQ(cfg.getLoopDepth(1), 1);
+        ASSERT_EQ(cfg.getLoopDepth(2), 2);
+        ASSERT_EQ(cfg.getLoopDepth(3), 1);
+        ASSERT_EQ(cfg.getLoopDepth(4), 0);
+        ASSERT_EQ(cfg.getLoopOf(3), 1);
+
+        ASSERT_EQ(cfg.getImmediateDominator(2), 1);
+        ASSERT_EQ(cfg.getImmediateDominator(3), 2);
+        ASSERT_EQ(cfg.getImmediateDominator(4), 3);
+    }
+
+    TEST(ControlFlowGraphTests, EntriesAndUnreachable)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelExit = assembler.createLabel();
+        auto labelFunc = assembler.createLabel();
+
+        ASSERT_EQ(assembler.lea(rax, qword_ptr(labelFunc)), Error::None);
+        ASSERT_EQ(assembler.jmp(labelExit), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.bind(labelExit), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.bind(labelFunc), Error::None);
+        ASSERT_EQ(assembler.mov(eax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        ControlFlowGraph cfg;
+        ASSERT_EQ(cfg.build(program), Error::None);
+        ASSERT_EQ(cfg.getBlockCount(), 4);
+
+        // The address of labelFunc is taken, it is an entry of its own.
+        ASSERT_EQ(cfg.getEntryCount(), 2);
+        ASSERT_EQ(cfg.getEntry(0), 0);
+        ASSERT_EQ(cfg.getEntry(1), 3);
+
+        ASSERT_EQ(cfg.isReachable(1), false);
+        ASSERT_EQ(cfg.getImmediateDominator(1), analysis::kInvalidBlock);
+        ASSERT_EQ(cfg.dominates(0, 1), false);
+        ASSERT_EQ(cfg.isReachable(3), true);
+        ASSERT_EQ(cfg.getImmediateDominator(3), analysis::kInvalidBlock);
+        ASSERT_EQ(cfg.dominates(0, 3), false);
+        ASSERT_EQ(cfg.getImmediateDominator(2), 0);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,146 @@
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using namespace zasm::operands;
+    using passes::DeadCodeElimination;
+
+    static bool containsNode(const Program& program, const Node* target)
+    {
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (node == target)
+                return true;
+        }
+        return false;
+    }
+
+    TEST(DeadCodeEliminationTests, DeadInstructions)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        ASSERT_EQ(assembler.mov(rax, Imm(1)), Error::None);
+        const auto* nodeMovRax = program.getTail();
+        ASSERT_EQ(assembler.add(rcx, Imm(1)), Error::None);
+        const auto* nodeAdd = program.getTail();
+        ASSERT_EQ(assembler.mov(rdx, qword_ptr(rax)), Error::None);
+        const auto* nodeLoad = program.getTail();
+        ASSERT_EQ(assembler.mov(ecx, Imm(0)), Error::None);
+        ASSERT_EQ(assembler.cmp(rax, rdx), Error::None);
+        const auto* nodeCmp = program.getTail();
+        ASSERT_EQ(assembler.mov(rdx, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        const auto addLength = nodeAdd->get<Instruction>().getLength();
+        const auto cmpLength = nodeCmp->get<Instruction>().getLength();
+
+        DeadCodeElimination dce;
+        ASSERT_EQ(dce.run(program), Error::None);
+
+        // The load may fault and is kept even though rdx is overwritten.
+        ASSERT_EQ(containsNode(program, nodeMovRax), true);
+        ASSERT_EQ(containsNode(program, nodeLoad), true);
+        ASSERT_EQ(containsNode(program, nodeAdd), false);
+        ASSERT_EQ(containsNode(program, nodeCmp), false);
+
+        const auto& stats = dce.getStats();
+        ASSERT_EQ(stats.numRemovedInstructions, 2);
+        ASSERT_EQ(stats.numUnreachableBlocks, 0);
+        ASSERT_EQ(stats.bytesSaved, static_cast<size_t>(addLength + cmpLength));
+    }
+
+    TEST(DeadCodeEliminationTests, UnreachableBlocks)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelExit = assembler.createLabel();
+        auto labelDead = assembler.createLabel();
+        auto labelEntry = assembler.createLabel();
+        auto labelCalled = assembler.createLabel();
+
+        ASSERT_EQ(assembler.call(labelCalled), Error::None);
+        ASSERT_EQ(assembler.jmp(labelExit), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.bind(labelDead), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.jmp(labelDead), Error::None);
+        ASSERT_EQ(assembler.bind(labelEntry), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(3)), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.bind(labelCalled), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(4)), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.bind(labelExit), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        const auto oldSize = serializer.getCodeSize();
+
+        DeadCodeElimination dce;
+        dce.addEntry(labelEntry);
+        ASSERT_EQ(dce.run(program), Error::None);
+
+        const auto& stats = dce.getStats();
+        ASSERT_EQ(stats.numUnreachableBlocks, 2);
+        ASSERT_EQ(stats.numRemovedInstructions, 3);
+        ASSERT_EQ(stats.numRemovedLabels, 1);
+
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        ASSERT_EQ(oldSize - serializer.getCodeSize(), stats.bytesSaved);
+    }
+
+    TEST(DeadCodeEliminationTests, VirtualRegisters)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        const auto v0 = assembler.createVirtualGp64();
+        const auto v1 = assembler.createVirtualGp64();
+
+        // Runs before register allocation, the virtual registers are not tracked by liveness.
+        ASSERT_EQ(assembler.mov(v0, Imm(1)), Error::None);
+        const auto* nodeMovV0 = program.getTail();
+        ASSERT_EQ(assembler.lea(v1, qword_ptr(v0, 8)), Error::None);
+        const auto* nodeLea = program.getTail();
+        ASSERT_EQ(assembler.mov(rdx, Imm(2)), Error::None);
+        const auto* nodeMovRdx = program.getTail();
+        ASSERT_EQ(assembler.mov(qword_ptr(rcx), v1), Error::None);
+        ASSERT_EQ(assembler.mov(rdx, Imm(3)), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        DeadCodeElimination dce;
+        ASSERT_EQ(dce.run(program), Error::None);
+
+        ASSERT_EQ(containsNode(program, nodeMovV0), true);
+        ASSERT_EQ(containsNode(program, nodeLea), true);
+        ASSERT_EQ(containsNode(program, nodeMovRdx), false);
+        ASSERT_EQ(dce.getStats().numRemovedInstructions, 1);
+    }
+
+    TEST(DeadCodeEliminationTests, NamedLabels)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelNamed = assembler.createLabel("named");
+        auto labelUnnamed = assembler.createLabel();
+
+        ASSERT_EQ(assembler.bind(labelNamed), Error::None);
+        ASSERT_EQ(assembler.bind(labelUnnamed), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        DeadCodeElimination dce;
+        ASSERT_EQ(dce.run(program), Error::None);
+        ASSERT_EQ(dce.getStats().numRemovedLabels, 1);
+        ASSERT_EQ(program.size(), 2);
+
+        // Removed labels are unbound and can be bound again.
+        ASSERT_EQ(assembler.bind(labelUnnamed), Error::None);
+    }
+
+} // namespace zasm::tests
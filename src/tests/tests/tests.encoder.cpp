@@ -0,0 +1,218 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <testdata/instructions.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static void expectDirectMatchesGeneric(
+        Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps, const EncoderOperands& ops, size_t& numDirect)
+    {
+        EncoderResult directRes{};
+        if (!encodeEstimatedDirect(directRes, ZYDIS_MACHINE_MODE_LONG_64, attribs, id, numOps, ops))
+            return;
+
+        numDirect++;
+
+        EncoderResult genericRes{};
+        ASSERT_EQ(encodeEstimatedGeneric(genericRes, ZYDIS_MACHINE_MODE_LONG_64, attribs, id, numOps, ops), Error::None);
+        ASSERT_EQ(directRes.length, genericRes.length);
+        ASSERT_EQ(std::memcmp(directRes.data.data(), genericRes.data.data(), genericRes.length), 0);
+        ASSERT_EQ(directRes.relocKind, genericRes.relocKind);
+    }
+
+    TEST(EncoderTests, DirectMatchesTestData)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        for (const auto& instr : data::Instructions)
+        {
+            ASSERT_EQ(instr.emitter(assembler), Error::None) << instr.operation;
+        }
+
+        size_t numDirect = 0;
+        for (auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto& instr = node->get<Instruction>();
+
+            EncoderOperands ops{};
+            size_t numOps = 0;
+            for (size_t i = 0; i < std::min<size_t>(instr.getOperandCount(), ops.size()); i++)
+            {
+                if (!instr.isOperandExplicit(i))
+                    break;
+                ops[numOps++] = instr.getOperand(i);
+            }
+
+            expectDirectMatchesGeneric(instr.getAttribs(), instr.getId(), numOps, ops, numDirect);
+        }
+
+        ASSERT_GT(numDirect, 100);
+    }
+
+    TEST(EncoderTests, DirectMemoryForms)
+    {
+        using namespace zasm::operands;
+
+        const Gp64 regs[] = { rax, rcx, rsp, rbp, rsi, r8, r12, r13, r15 };
+        const int64_t displacements[] = { 0, 1, -1, 127, -128, 128, -129, 0x7FFFFFFF, -0x7FFFFFFF - 1 };
+
+        size_t numDirect = 0;
+        for (const auto& base : regs)
+        {
+            for (const auto& index : regs)
+            {
+                for (const auto disp : displacements)
+                {
+                    const auto hasIndex = index != rsp;
+                    const auto mem = hasIndex ? qword_ptr(base, index, 4, disp) : qword_ptr(base, disp);
+
+                    expectDirectMatchesGeneric(
+                        Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { Operand(rdx), Operand(mem) }, numDirect);
+                    expectDirectMatchesGeneric(
+                        Instruction::Attribs::None, ZYDIS_MNEMONIC_ADD, 2, { Operand(mem), Operand(r9) }, numDirect);
+                    expectDirectMatchesGeneric(
+                        Instruction::Attribs::None, ZYDIS_MNEMONIC_CMP, 2, { Operand(mem), Operand(Imm(disp)) }, numDirect);
+                    expectDirectMatchesGeneric(
+                        Instruction::Attribs::None, ZYDIS_MNEMONIC_LEA, 2, { Operand(r14), Operand(mem) }, numDirect);
+                }
+            }
+        }
+
+        ASSERT_EQ(numDirect, std::size(regs) * std::size(regs) * std::size(displacements) * 4);
+    }
+
+    TEST(EncoderTests, DirectImmediates)
+    {
+        using namespace zasm::operands;
+
+        const int64_t values[] = {
+            0, 1, -1, 127, -128, 128, -129, 0x7FFFFFFF, -0x7FFFFFFFLL - 1, 0x80000000, 0x0011223344556677,
+        };
+        const ZydisMnemonic mnemonics[] = { ZYDIS_MNEMONIC_MOV, ZYDIS_MNEMONIC_ADD, ZYDIS_MNEMONIC_SUB,
+                                            ZYDIS_MNEMONIC_AND, ZYDIS_MNEMONIC_XOR, ZYDIS_MNEMONIC_TEST };
+
+        size_t numDirect = 0;
+        for (const auto mnemonic : mnemonics)
+        {
+            for (const auto value : values)
+            {
+                expectDirectMatchesGeneric(
+                    Instruction::Attribs::None, mnemonic, 2, { Operand(eax), Operand(Imm(value)) }, numDirect);
+                expectDirectMatchesGeneric(
+                    Instruction::Attribs::None, mnemonic, 2, { Operand(r10d), Operand(Imm(value)) }, numDirect);
+                expectDirectMatchesGeneric(
+                    Instruction::Attribs::None, mnemonic, 2, { Operand(rax), Operand(Imm(value)) }, numDirect);
+                expectDirectMatchesGeneric(
+                    Instruction::Attribs::None, mnemonic, 2, { Operand(r11), Operand(Imm(value)) }, numDirect);
+            }
+        }
+
+        ASSERT_GT(numDirect, 0);
+    }
+
+    TEST(EncoderTests, DirectBranches)
+    {
+        using namespace zasm::operands;
+
+        const int64_t targets[] = { 0, 2, 129, 130, -126, -127, 0x1000, -0x1000 };
+        const ZydisMnemonic mnemonics[] = { ZYDIS_MNEMONIC_JMP, ZYDIS_MNEMONIC_CALL, ZYDIS_MNEMONIC_JZ,
+                                            ZYDIS_MNEMONIC_JNLE, ZYDIS_MNEMONIC_JO };
+
+        size_t numDirect = 0;
+        for (const auto mnemonic : mnemonics)
+        {
+            for (const auto target : targets)
+            {
+                expectDirectMatchesGeneric(Instruction::Attribs::None, mnemonic, 1, { Operand(Imm(target)) }, numDirect);
+            }
+            expectDirectMatchesGeneric(
+                Instruction::Attribs::None, mnemonic, 1, { Operand(Label(Label::Id{ 0 })) }, numDirect);
+        }
+
+        ASSERT_EQ(numDirect, std::size(mnemonics) * (std::size(targets) + 1));
+    }
+
+    TEST(EncoderTests, DirectRejectsMismatchedSizes)
+    {
+        using namespace zasm::operands;
+
+        EncoderResult res{};
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, ecx }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { eax, qword_ptr(rcx) }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::Lock, ZYDIS_MNEMONIC_ADD, 2, { qword_ptr(rcx), rax }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_COMPAT_32, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { eax, ecx }));
+        ASSERT_EQ(res.length, 0);
+
+        ASSERT_EQ(
+            encodeEstimated(res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, ecx }),
+            Error::ImpossibleInstruction);
+    }
+
+    TEST(EncoderTests, DirectSegmentOverrides)
+    {
+        using namespace zasm::operands;
+
+        // The default segment of the base needs no prefix, every other one is left to Zydis.
+        EncoderResult res{};
+        ASSERT_TRUE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, qword_ptr(ds, rcx) }));
+        ASSERT_TRUE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, qword_ptr(ss, rsp) }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, qword_ptr(es, rcx) }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, qword_ptr(ss, rcx) }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, qword_ptr(cs, rcx) }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, qword_ptr(ds, rbp) }));
+
+        const std::array<uint8_t, 4> expected = { 0x26, 0x48, 0x8B, 0x01 };
+        ASSERT_EQ(
+            encodeEstimated(
+                res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, qword_ptr(es, rcx) }),
+            Error::None);
+        ASSERT_EQ(res.length, expected.size());
+        ASSERT_EQ(std::memcmp(res.data.data(), expected.data(), expected.size()), 0);
+    }
+
+    TEST(EncoderTests, RejectsVirtualRegisters)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        const auto v0 = assembler.createVirtualGp64();
+        ASSERT_TRUE(v0.isVirtual());
+        ASSERT_EQ(v0.getId(), ZYDIS_REGISTER_NONE);
+
+        // Memory operands keep the virtual register, it must not turn into an absolute address.
+        const auto mem = qword_ptr(v0, 8);
+        ASSERT_TRUE(mem.getBase().isVirtual());
+        ASSERT_EQ(mem.getBase(), v0);
+
+        EncoderResult res{};
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { v0, rcx }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, mem }));
+        ASSERT_FALSE(encodeEstimatedDirect(
+            res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2,
+            { rax, qword_ptr(rcx, v0, 1, 0) }));
+
+        ASSERT_EQ(
+            encodeEstimated(res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { v0, rcx }),
+            Error::ImpossibleInstruction);
+        ASSERT_EQ(
+            encodeEstimated(res, ZYDIS_MACHINE_MODE_LONG_64, Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, { rax, mem }),
+            Error::ImpossibleInstruction);
+    }
+
+} // namespace zasm::tests
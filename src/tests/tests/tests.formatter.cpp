@@ -1,4 +1,6 @@
+#include <cstdio>
 #include <gtest/gtest.h>
+#include <iterator>
 #include <zasm/program/formatter.hpp>
 #include <zasm/zasm.hpp>
 
@@ -66,4 +68,219 @@ namespace zasm::tests
         ASSERT_EQ(nodeStr, std::string("jmp L1\nlock inc dword ptr ds:[L0]\nL0:\ndd 0x00000000\nL1:\nnop"));
     }
 
+    static void createTestProgram(Assembler& assembler)
+    {
+        using namespace zasm::operands;
+
+        auto label01 = assembler.createLabel();
+        auto label02 = assembler.createLabel();
+
+        for (int i = 0; i < 1000; i++)
+        {
+            ASSERT_EQ(assembler.jmp(label02), zasm::Error::None);
+            ASSERT_EQ(assembler.lock().inc(dword_ptr(label01)), zasm::Error::None);
+            ASSERT_EQ(assembler.mov(rax, qword_ptr(rcx, rdx, 4, -0x10)), zasm::Error::None);
+            ASSERT_EQ(assembler.add(rax, Imm(i)), zasm::Error::None);
+        }
+        ASSERT_EQ(assembler.bind(label01), zasm::Error::None);
+        ASSERT_EQ(assembler.dd(0), zasm::Error::None);
+        ASSERT_EQ(assembler.bind(label02), zasm::Error::None);
+        ASSERT_EQ(assembler.nop(), zasm::Error::None);
+    }
+
+    TEST(FormatterTests, StreamOutputIterator)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        createTestProgram(assembler);
+
+        const auto expected = formatter::toString(program);
+
+        std::string res;
+        formatter::toOutput(program, std::back_inserter(res));
+        ASSERT_EQ(res, expected);
+    }
+
+    TEST(FormatterTests, StreamBufferReuse)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        createTestProgram(assembler);
+
+        const auto expected = formatter::toString(program);
+
+        formatter::Buffer buffer;
+        for (int i = 0; i < 2; i++)
+        {
+            buffer.clear();
+
+            const auto written = formatter::toBuffer(program, buffer);
+            ASSERT_EQ(written, expected.size());
+            ASSERT_EQ(buffer.size(), expected.size());
+            ASSERT_GT(buffer.getChunkCount(), 1);
+            ASSERT_EQ(buffer.str(), expected);
+        }
+    }
+
+    TEST(FormatterTests, StreamFile)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        createTestProgram(assembler);
+
+        const auto expected = formatter::toString(program);
+
+        std::FILE* file = std::tmpfile();
+        ASSERT_NE(file, nullptr);
+
+        const auto written = formatter::toFile(program, file);
+        ASSERT_EQ(written, expected.size());
+
+        std::string res(written, '\0');
+        std::rewind(file);
+        ASSERT_EQ(std::fread(res.data(), 1, res.size(), file), written);
+        std::fclose(file);
+
+        ASSERT_EQ(res, expected);
+    }
+
+    TEST(FormatterTests, LargeData)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        uint8_t data[100]{};
+        data[0] = 0xAB;
+        data[99] = 0xCD;
+        ASSERT_EQ(assembler.embed(data, sizeof(data)), zasm::Error::None);
+
+        auto nodeStr = formatter::toString(program);
+        ASSERT_EQ(nodeStr.rfind("db 0xab, 0x00", 0), 0);
+        ASSERT_EQ(nodeStr.substr(nodeStr.size() - 4), std::string("0xcd"));
+        ASSERT_EQ(std::count(nodeStr.begin(), nodeStr.end(), '\n'), 6);
+    }
+
+    TEST(FormatterTests, HexImmediates)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        ASSERT_EQ(assembler.mov(eax, Imm(0x1F2E)), zasm::Error::None);
+        ASSERT_EQ(assembler.mov(rax, qword_ptr(rcx, -0x20)), zasm::Error::None);
+
+        auto nodeStr = formatter::toString(program, formatter::Options::HexImmediates | formatter::Options::HexOffsets);
+        ASSERT_EQ(nodeStr, std::string("mov eax, 0x1F2E\nmov rax, qword ptr ds:[rcx-0x20]"));
+    }
+
+    TEST(FormatterTests, ParallelMatchesSerial)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        for (int i = 0; i < 10; i++)
+        {
+            createTestProgram(assembler);
+        }
+
+        const auto expected = formatter::toString(program);
+
+        for (size_t threadCount : { 1, 2, 3, 8 })
+        {
+            const auto res = formatter::toStringParallel(program, {}, threadCount);
+            ASSERT_EQ(res, expected);
+        }
+    }
+
+    TEST(FormatterTests, LabelNames)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto label = assembler.createLabel("loop_start");
+        ASSERT_EQ(assembler.bind(label), zasm::Error::None);
+        ASSERT_EQ(assembler.jmp(label), zasm::Error::None);
+
+        // Names are opt-in for the plain output.
+        auto nodeStr = formatter::toString(program);
+        ASSERT_EQ(nodeStr, std::string("L0:\njmp L0"));
+
+        nodeStr = formatter::toString(program, formatter::Options::LabelNames);
+        ASSERT_EQ(nodeStr, std::string("loop_start:\njmp loop_start"));
+    }
+
+    TEST(FormatterTests, AnnotatedWithSerializer)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto label = assembler.createLabel("loop_start");
+        ASSERT_EQ(assembler.bind(label), zasm::Error::None);
+        ASSERT_EQ(assembler.nop(), zasm::Error::None);
+        ASSERT_EQ(assembler.jmp(label), zasm::Error::None);
+        ASSERT_EQ(assembler.jmp(Imm(0x1000)), zasm::Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), zasm::Error::None);
+        ASSERT_EQ(serializer.getNodeCount(), program.size());
+
+        const auto pad = [](size_t numBytes) { return std::string((15 - numBytes) * 3 + 2, ' '); };
+
+        const std::string expected = "0000000000001000   0  " + pad(0) + "loop_start:\n"
+                                   + "0000000000001000   1  90 " + pad(1) + "nop\n"
+                                   + "0000000000001001   2  EB FD " + pad(2) + "jmp loop_start\n"
+                                   + "0000000000001003   2  EB FB " + pad(2) + "jmp 4096 <loop_start>";
+
+        auto nodeStr = formatter::toString(program, serializer);
+        ASSERT_EQ(nodeStr, expected);
+
+        // Program changed after serialization, no annotations.
+        ASSERT_EQ(assembler.nop(), zasm::Error::None);
+        nodeStr = formatter::toString(program, serializer);
+        ASSERT_EQ(nodeStr, formatter::toString(program));
+
+        // Replacing a node keeps the node count but the layout is still outdated.
+        ASSERT_EQ(serializer.serialize(program, 0x1000), zasm::Error::None);
+        const auto* lastNode = program.getTail();
+        assembler.setCursor(lastNode->getPrev());
+        ASSERT_EQ(assembler.int3(), zasm::Error::None);
+        program.destroy(lastNode);
+        ASSERT_EQ(serializer.getNodeCount(), program.size());
+        nodeStr = formatter::toString(program, serializer);
+        ASSERT_EQ(nodeStr, formatter::toString(program));
+    }
+
+    TEST(FormatterTests, AnnotatedTruncatedBytes)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        const uint8_t data[20]{};
+        ASSERT_EQ(assembler.nop(), zasm::Error::None);
+        ASSERT_EQ(assembler.embed(data, sizeof(data)), zasm::Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), zasm::Error::None);
+
+        // The text of every node starts in the same column, also after truncated bytes.
+        const auto nodeStr = formatter::toString(program, serializer);
+        const auto lineBreak = nodeStr.find('\n');
+        ASSERT_NE(lineBreak, std::string::npos);
+
+        const auto firstLine = nodeStr.substr(0, lineBreak);
+        const auto secondLine = nodeStr.substr(lineBreak + 1);
+        ASSERT_EQ(firstLine.find("nop"), 69);
+        ASSERT_EQ(secondLine.find(".."), 67);
+        ASSERT_EQ(secondLine[68], '.');
+        ASSERT_NE(secondLine[69], ' ');
+    }
+
 } // namespace zasm::tests
\ No newline at end of file
@@ -0,0 +1,139 @@
+#include "../testutils.hpp"
+
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using namespace zasm::operands;
+    using passes::JumpThreading;
+
+    TEST(JumpThreadingTests, Chain)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelA = assembler.createLabel();
+        auto labelB = assembler.createLabel();
+        auto labelC = assembler.createLabel();
+
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.jz(labelA), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.bind(labelA), Error::None);
+        ASSERT_EQ(assembler.jmp(labelB), Error::None);
+        ASSERT_EQ(assembler.int3(), Error::None);
+        ASSERT_EQ(assembler.bind(labelB), Error::None);
+        ASSERT_EQ(assembler.jmp(labelC), Error::None);
+        ASSERT_EQ(assembler.int3(), Error::None);
+        ASSERT_EQ(assembler.bind(labelC), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        JumpThreading jumpThreading;
+        ASSERT_EQ(jumpThreading.run(program), Error::None);
+
+        const auto& stats = jumpThreading.getStats();
+        ASSERT_EQ(stats.numThreaded, 2);
+        ASSERT_EQ(stats.numInverted, 0);
+        ASSERT_EQ(stats.numRemoved, 0);
+
+        const auto& jz = getInstruction(program, 1);
+        ASSERT_EQ(jz.getId(), ZYDIS_MNEMONIC_JZ);
+        ASSERT_EQ(jz.getOperands()[0].get<Label>().getId(), labelC.getId());
+
+        const auto& jmp = getInstruction(program, 3);
+        ASSERT_EQ(jmp.getId(), ZYDIS_MNEMONIC_JMP);
+        ASSERT_EQ(jmp.getOperands()[0].get<Label>().getId(), labelC.getId());
+    }
+
+    TEST(JumpThreadingTests, InvertBranch)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelSkip = assembler.createLabel();
+        auto labelExit = assembler.createLabel();
+
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.jl(labelSkip), Error::None);
+        ASSERT_EQ(assembler.jmp(labelExit), Error::None);
+        ASSERT_EQ(assembler.bind(labelSkip), Error::None);
+        ASSERT_EQ(assembler.mov(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.bind(labelExit), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        const auto oldSize = serializer.getCodeSize();
+
+        JumpThreading jumpThreading;
+        ASSERT_EQ(jumpThreading.run(program), Error::None);
+        ASSERT_EQ(jumpThreading.getStats().numInverted, 1);
+
+        const auto& jnl = getInstruction(program, 1);
+        ASSERT_EQ(jnl.getId(), ZYDIS_MNEMONIC_JNL);
+        ASSERT_EQ(jnl.getOperands()[0].get<Label>().getId(), labelExit.getId());
+        ASSERT_EQ(getInstruction(program, 2).getId(), ZYDIS_MNEMONIC_MOV);
+
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        ASSERT_LT(serializer.getCodeSize(), oldSize);
+    }
+
+    TEST(JumpThreadingTests, JumpToNext)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelNext = assembler.createLabel();
+        auto labelTrampoline = assembler.createLabel();
+        auto labelLoop = assembler.createLabel();
+
+        ASSERT_EQ(assembler.jmp(labelNext), Error::None);
+        ASSERT_EQ(assembler.bind(labelNext), Error::None);
+        ASSERT_EQ(assembler.jnz(labelTrampoline), Error::None);
+        ASSERT_EQ(assembler.bind(labelLoop), Error::None);
+        ASSERT_EQ(assembler.dec(rcx), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.bind(labelTrampoline), Error::None);
+        ASSERT_EQ(assembler.jmp(labelLoop), Error::None);
+
+        JumpThreading jumpThreading;
+        ASSERT_EQ(jumpThreading.run(program), Error::None);
+
+        // The jnz resolves to the next instruction and is removed like the jmp, the trampoline stays.
+        const auto& stats = jumpThreading.getStats();
+        ASSERT_EQ(stats.numRemoved, 2);
+        ASSERT_EQ(stats.numThreaded, 0);
+        ASSERT_EQ(getInstruction(program, 0).getId(), ZYDIS_MNEMONIC_DEC);
+        ASSERT_EQ(getInstruction(program, 2).getId(), ZYDIS_MNEMONIC_JMP);
+    }
+
+    TEST(JumpThreadingTests, LabelBeforeData)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelData = assembler.createLabel();
+        auto labelEnd = assembler.createLabel();
+
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.jz(labelData), Error::None);
+        ASSERT_EQ(assembler.jnz(labelEnd), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.bind(labelData), Error::None);
+        ASSERT_EQ(assembler.dq(0x1122334455667788), Error::None);
+        ASSERT_EQ(assembler.bind(labelEnd), Error::None);
+
+        JumpThreading jumpThreading;
+        ASSERT_EQ(jumpThreading.run(program), Error::None);
+
+        // Neither data nor the end of the program continue a chain.
+        const auto& stats = jumpThreading.getStats();
+        ASSERT_EQ(stats.numThreaded, 0);
+        ASSERT_EQ(stats.numInverted, 0);
+        ASSERT_EQ(stats.numRemoved, 0);
+        ASSERT_EQ(getInstruction(program, 1).getOperands()[0].get<Label>().getId(), labelData.getId());
+        ASSERT_EQ(getInstruction(program, 2).getOperands()[0].get<Label>().getId(), labelEnd.getId());
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,162 @@
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using namespace zasm::operands;
+    using analysis::Liveness;
+
+    TEST(LivenessTests, StraightLine)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        ASSERT_EQ(assembler.mov(rax, Imm(1)), Error::None);
+        const auto* nodeMovRax = program.getTail();
+        ASSERT_EQ(assembler.mov(rcx, rax), Error::None);
+        const auto* nodeMovRcx = program.getTail();
+        ASSERT_EQ(assembler.mov(al, Imm(2)), Error::None);
+        const auto* nodeMovAl = program.getTail();
+        ASSERT_EQ(assembler.mov(edx, Imm(3)), Error::None);
+        const auto* nodeMovEdx = program.getTail();
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Liveness liveness;
+        ASSERT_EQ(liveness.analyze(program), Error::None);
+        ASSERT_EQ(liveness.getBlockCount(), 1);
+
+        const auto inMovRax = liveness.getLiveIn(nodeMovRax);
+        ASSERT_EQ(inMovRax.regs.contains(rax), false);
+        ASSERT_EQ(inMovRax.regs.contains(rcx), false);
+        ASSERT_EQ(inMovRax.regs.contains(rdx), false);
+        ASSERT_EQ(inMovRax.regs.contains(rbx), true);
+
+        const auto inMovRcx = liveness.getLiveIn(nodeMovRcx);
+        ASSERT_EQ(inMovRcx.regs.contains(rax), true);
+        ASSERT_EQ(inMovRcx.regs.contains(rcx), false);
+
+        // Writing al keeps the rest of rax, writing edx clears the upper half of rdx.
+        ASSERT_EQ(liveness.getLiveIn(nodeMovAl).regs.contains(rax), true);
+        ASSERT_EQ(liveness.getLiveIn(nodeMovEdx).regs.contains(rdx), false);
+        ASSERT_EQ(liveness.getLiveOut(nodeMovEdx).regs.contains(rdx), true);
+    }
+
+    TEST(LivenessTests, Flags)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelExit = assembler.createLabel();
+
+        ASSERT_EQ(assembler.add(rax, Imm(1)), Error::None);
+        const auto* nodeAdd = program.getTail();
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        const auto* nodeCmp = program.getTail();
+        ASSERT_EQ(assembler.jz(labelExit), Error::None);
+        ASSERT_EQ(assembler.mov(rax, rdx), Error::None);
+        ASSERT_EQ(assembler.bind(labelExit), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Liveness liveness;
+        ASSERT_EQ(liveness.analyze(program), Error::None);
+        ASSERT_EQ(liveness.getBlockCount(), 3);
+
+        // cmp overwrites the flags of add before jz reads them.
+        ASSERT_EQ(liveness.getLiveOut(nodeAdd).flags & ZYDIS_CPUFLAG_ZF, 0);
+        ASSERT_NE(liveness.getLiveOut(nodeCmp).flags & ZYDIS_CPUFLAG_ZF, 0);
+        ASSERT_EQ(liveness.getLiveIn(nodeCmp).regs.contains(rcx), true);
+    }
+
+    TEST(LivenessTests, Loop)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelLoop = assembler.createLabel();
+
+        ASSERT_EQ(assembler.xor_(eax, eax), Error::None);
+        const auto* nodeXor = program.getTail();
+        ASSERT_EQ(assembler.mov(ecx, Imm(10)), Error::None);
+        ASSERT_EQ(assembler.bind(labelLoop), Error::None);
+        ASSERT_EQ(assembler.add(rax, rbx), Error::None);
+        const auto* nodeAdd = program.getTail();
+        ASSERT_EQ(assembler.dec(ecx), Error::None);
+        ASSERT_EQ(assembler.jnz(labelLoop), Error::None);
+        const auto* nodeJnz = program.getTail();
+        ASSERT_EQ(assembler.mov(rbx, Imm(0)), Error::None);
+        const auto* nodeMovRbx = program.getTail();
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Liveness liveness;
+        ASSERT_EQ(liveness.analyze(program), Error::None);
+
+        // rcx is live around the back edge.
+        ASSERT_EQ(liveness.getLiveOut(nodeJnz).regs.contains(rcx), true);
+        ASSERT_EQ(liveness.getLiveIn(nodeAdd).regs.contains(rcx), true);
+
+        // rbx is overwritten after the loop but read inside of it.
+        ASSERT_EQ(liveness.getLiveIn(nodeMovRbx).regs.contains(rbx), false);
+        ASSERT_EQ(liveness.getLiveOut(nodeJnz).regs.contains(rbx), true);
+
+        // The zero idiom does not read rax.
+        ASSERT_EQ(liveness.getLiveIn(nodeXor).regs.contains(rax), false);
+        ASSERT_EQ(liveness.getLiveIn(nodeXor).regs.contains(rbx), true);
+    }
+
+    TEST(LivenessTests, ZeroIdiomPartialWrite)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        const auto getAccess = [&]() {
+            return analysis::getRegAccess(program.getTail()->get<Instruction>(), program.getMode());
+        };
+
+        ASSERT_EQ(assembler.xor_(rax, rax), Error::None);
+        ASSERT_EQ(getAccess().use.contains(rax), false);
+        ASSERT_EQ(assembler.xor_(eax, eax), Error::None);
+        ASSERT_EQ(getAccess().use.contains(rax), false);
+        ASSERT_EQ(assembler.vpxor(xmm1, xmm0, xmm0), Error::None);
+        ASSERT_EQ(getAccess().use.contains(zmm0), false);
+
+        // The rest of the register keeps its old value.
+        ASSERT_EQ(assembler.xor_(al, al), Error::None);
+        ASSERT_EQ(getAccess().use.contains(rax), true);
+        ASSERT_EQ(assembler.sub(ax, ax), Error::None);
+        ASSERT_EQ(getAccess().use.contains(rax), true);
+        ASSERT_EQ(assembler.pxor(xmm0, xmm0), Error::None);
+        ASSERT_EQ(getAccess().use.contains(zmm0), true);
+        ASSERT_EQ(assembler.xorps(xmm0, xmm0), Error::None);
+        ASSERT_EQ(getAccess().use.contains(zmm0), true);
+    }
+
+    TEST(LivenessTests, RegSet)
+    {
+        analysis::RegSet set;
+        ASSERT_EQ(set.empty(), true);
+
+        set.add(rax);
+        set.add(zmm31);
+        set.add(Reg{});
+        ASSERT_EQ(set.count(), 2);
+        ASSERT_EQ(set.contains(rax), true);
+        ASSERT_EQ(set.contains(rcx), false);
+
+        analysis::RegSet other;
+        other.add(rcx);
+        other.add(zmm31);
+        ASSERT_EQ((set & other).count(), 1);
+        ASSERT_EQ((set | other).count(), 3);
+        ASSERT_EQ((set - other).contains(zmm31), false);
+        ASSERT_EQ(set.intersects(other), true);
+
+        size_t count = 0;
+        analysis::RegSet::all().forEach([&](const Reg& reg) {
+            ASSERT_EQ(reg.isValid(), true);
+            count++;
+        });
+        ASSERT_EQ(count, analysis::RegSet::all().count());
+        ASSERT_EQ(count, static_cast<size_t>(ZYDIS_REGISTER_MAX_VALUE));
+    }
+
+} // namespace zasm::tests
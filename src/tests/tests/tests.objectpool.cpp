@@ -0,0 +1,136 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+#include <zasm/core/objectpool.hpp>
+
+namespace zasm::tests
+{
+    struct PoolItem
+    {
+        uint64_t a;
+        uint64_t b;
+    };
+
+    // Large enough for a block size class no other pool uses.
+    struct LargePoolItem
+    {
+        uint64_t data[1000];
+    };
+
+    TEST(ObjectPoolTests, TestReuse)
+    {
+        ObjectPool<PoolItem, 16> pool;
+
+        auto* item0 = pool.allocate(1);
+        ASSERT_NE(item0, nullptr);
+
+        pool.deallocate(item0, 1);
+
+        auto* item1 = pool.allocate(1);
+        ASSERT_EQ(item1, item0);
+
+        pool.deallocate(item1, 1);
+    }
+
+    TEST(ObjectPoolTests, TestMultipleBlocks)
+    {
+        ObjectPool<PoolItem, 16> pool;
+
+        std::vector<PoolItem*> items;
+        for (uint64_t i = 0; i < 100; i++)
+        {
+            auto* item = pool.allocate(1);
+            ASSERT_NE(item, nullptr);
+
+            pool.construct(item, PoolItem{ i, i * 2 });
+            items.push_back(item);
+        }
+
+        for (uint64_t i = 0; i < 100; i++)
+        {
+            ASSERT_EQ(items[i]->a, i);
+            ASSERT_EQ(items[i]->b, i * 2);
+        }
+
+        for (auto* item : items)
+        {
+            pool.deallocate(item, 1);
+        }
+    }
+
+    TEST(ObjectPoolTests, TestCopyConstruction)
+    {
+        using Traits = std::allocator_traits<ObjectPool<PoolItem, 16>>;
+
+        ObjectPool<PoolItem, 16> pool;
+        auto* item0 = pool.allocate(1);
+        pool.construct(item0, PoolItem{ 1, 2 });
+
+        // The copy does not share any blocks with the original.
+        auto copy = Traits::select_on_container_copy_construction(pool);
+        auto* item1 = copy.allocate(1);
+        ASSERT_NE(item1, nullptr);
+        ASSERT_NE(item1, item0);
+        copy.construct(item1, PoolItem{ 3, 4 });
+
+        ASSERT_EQ(item0->a, 1);
+        ASSERT_EQ(item1->a, 3);
+
+        copy.deallocate(item1, 1);
+        pool.deallocate(item0, 1);
+    }
+
+    TEST(ObjectPoolTests, TestMove)
+    {
+        ObjectPool<PoolItem, 16> pool;
+        auto* item0 = pool.allocate(1);
+        pool.construct(item0, PoolItem{ 1, 2 });
+        pool.deallocate(item0, 1);
+
+        // The free list moves along with the blocks.
+        ObjectPool<PoolItem, 16> pool2(std::move(pool));
+        auto* item1 = pool2.allocate(1);
+        ASSERT_EQ(item1, item0);
+
+        // The moved-from pool remains usable.
+        auto* item2 = pool.allocate(1);
+        ASSERT_NE(item2, nullptr);
+        ASSERT_NE(item2, item1);
+
+        ObjectPool<PoolItem, 16> pool3;
+        pool3 = std::move(pool2);
+        pool3.deallocate(item1, 1);
+        ASSERT_EQ(pool3.allocate(1), item1);
+
+        pool3.deallocate(item1, 1);
+        pool.deallocate(item2, 1);
+    }
+
+    TEST(ObjectPoolTests, TestCrossThreadRelease)
+    {
+        std::set<LargePoolItem*> released;
+
+        // Whole blocks only, the reused blocks are handed out in a different order.
+        auto* pool = new ObjectPool<LargePoolItem, 16>();
+        for (uint64_t i = 0; i < 96; i++)
+        {
+            released.insert(pool->allocate(1));
+        }
+
+        // Blocks acquired on this thread are released into the cache of another one.
+        std::thread worker([pool]() { delete pool; });
+        worker.join();
+
+        // Thread has exited, its cache was handed to the shared depot and the blocks are reused.
+        ObjectPool<LargePoolItem, 16> pool2;
+        for (uint64_t i = 0; i < 96; i++)
+        {
+            auto* item = pool2.allocate(1);
+            ASSERT_NE(item, nullptr);
+            ASSERT_EQ(released.count(item), 1);
+        }
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,153 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <testdata/instructions.hpp>
+#include <zasm/program/formatter.hpp>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    static std::string_view getTextLine(std::string_view text, size_t line)
+    {
+        size_t pos = 0;
+        for (size_t i = 1; i < line; i++)
+        {
+            pos = text.find('\n', pos);
+            if (pos == text.npos)
+                return {};
+            pos++;
+        }
+        return text.substr(pos, text.find('\n', pos) - pos);
+    }
+
+    TEST(ParserTests, Instructions)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Parser parser(assembler);
+
+        const std::string text = "mov eax, edx\nlock inc dword ptr ds:[eax]\nmov rax, qword ptr ds:[rcx+rdx*4-16]";
+        ASSERT_EQ(parser.parse(text), Error::None);
+        ASSERT_EQ(program.size(), 3);
+
+        ASSERT_EQ(formatter::toString(program), text);
+    }
+
+    TEST(ParserTests, CaseAndComments)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Parser parser(assembler);
+
+        ASSERT_EQ(parser.parse("  ; comment only\r\n\tMOV EAX, 0x1F ; trailing\r\n\n   ADD eax, -1"), Error::None);
+
+        ASSERT_EQ(formatter::toString(program), std::string("mov eax, 31\nadd eax, -1"));
+    }
+
+    TEST(ParserTests, LabelsAndData)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Parser parser(assembler);
+
+        const std::string text = "jmp L1\nlock inc dword ptr ds:[L0]\nL0:\ndd 0x00000000\nL1:\nnop\ndq L0\ndd L1 - L0";
+        ASSERT_EQ(parser.parse(text), Error::None);
+
+        ASSERT_EQ(formatter::toString(program, formatter::Options::LabelNames), text);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+    }
+
+    TEST(ParserTests, Align)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Parser parser(assembler);
+
+        const std::string text = "nop\n.align 16\nL0:\nret\n.align 8, data\ndq L0";
+        ASSERT_EQ(parser.parse(text), Error::None);
+
+        ASSERT_EQ(formatter::toString(program), text);
+
+        ASSERT_EQ(parser.parse(".align 3"), Error::InvalidParameter);
+        ASSERT_EQ(parser.parse(".align 16, code"), Error::InvalidSyntax);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(serializer.getCodeSize(), 32);
+    }
+
+    TEST(ParserTests, LabelsAcrossCalls)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Parser parser(assembler);
+
+        ASSERT_EQ(parser.parse("jmp loop_start"), Error::None);
+        ASSERT_EQ(parser.parse("loop_start: nop"), Error::None);
+        ASSERT_EQ(parser.parse("loop_start:"), Error::LabelAlreadyBound);
+
+        const auto text = formatter::toString(program, formatter::Options::LabelNames);
+        ASSERT_EQ(text, std::string("jmp loop_start\nloop_start:\nnop"));
+    }
+
+    TEST(ParserTests, Section)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Parser parser(assembler);
+
+        const std::string text = ".section .text\nnop\n.section .data\ndb 0x01";
+        ASSERT_EQ(parser.parse(text), Error::None);
+
+        ASSERT_EQ(formatter::toString(program), text);
+    }
+
+    TEST(ParserTests, InvalidSyntax)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Parser parser(assembler);
+
+        ASSERT_EQ(parser.parse("nop\nnotamnemonic eax"), Error::InvalidSyntax);
+        ASSERT_EQ(parser.getLine(), 2);
+
+        ASSERT_EQ(parser.parse("mov eax, [rax+"), Error::InvalidSyntax);
+        ASSERT_EQ(parser.parse("mov eax, [rax*3]"), Error::InvalidSyntax);
+        ASSERT_EQ(parser.parse("mov eax, edx edx"), Error::InvalidSyntax);
+        ASSERT_EQ(parser.parse("db 0x100"), Error::InvalidSyntax);
+        ASSERT_EQ(parser.parse("mov eax, 12abc"), Error::InvalidSyntax);
+    }
+
+    TEST(ParserTests, RoundTripTestData)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        for (const auto& instr : data::Instructions)
+        {
+            ASSERT_EQ(instr.emitter(assembler), Error::None) << instr.operation;
+        }
+
+        const auto text = formatter::toString(program);
+
+        Program parsedProgram(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler parsedAssembler(parsedProgram);
+        Parser parser(parsedAssembler);
+
+        const auto err = parser.parse(text);
+        ASSERT_EQ(err, Error::None) << "Line " << parser.getLine() << ": " << getTextLine(text, parser.getLine());
+        ASSERT_EQ(parsedProgram.size(), program.size());
+        ASSERT_EQ(formatter::toString(parsedProgram), text);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        Serializer parsedSerializer;
+        ASSERT_EQ(parsedSerializer.serialize(parsedProgram, 0x0000000000401000), Error::None);
+
+        ASSERT_EQ(parsedSerializer.getCodeSize(), serializer.getCodeSize());
+        ASSERT_EQ(std::memcmp(parsedSerializer.getCode(), serializer.getCode(), serializer.getCodeSize()), 0);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,163 @@
+#include "../testutils.hpp"
+
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using namespace zasm::operands;
+    using passes::Peephole;
+
+    static size_t getInstructionCount(const Program& program)
+    {
+        size_t count = 0;
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            if (node->holds<Instruction>())
+                count++;
+        }
+        return count;
+    }
+
+    TEST(PeepholeTests, SelfMove)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        ASSERT_EQ(assembler.mov(rax, rax), Error::None);
+        ASSERT_EQ(assembler.mov(eax, eax), Error::None);
+        ASSERT_EQ(assembler.mov(cx, cx), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Peephole peephole;
+        ASSERT_EQ(peephole.run(program), Error::None);
+        ASSERT_EQ(peephole.getStats().numRemoved, 2);
+
+        // mov eax, eax clears the upper half of rax.
+        ASSERT_EQ(getInstructionCount(program), 2);
+        ASSERT_EQ(getInstruction(program, 0).getId(), ZYDIS_MNEMONIC_MOV);
+        ASSERT_EQ(getInstruction(program, 0).getOperands()[0].get<Reg>(), eax);
+    }
+
+    TEST(PeepholeTests, ZeroIdiom)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto label = assembler.createLabel();
+
+        ASSERT_EQ(assembler.mov(rax, Imm(0)), Error::None);
+        ASSERT_EQ(assembler.cmp(rcx, rdx), Error::None);
+        ASSERT_EQ(assembler.mov(edx, Imm(0)), Error::None);
+        ASSERT_EQ(assembler.jz(label), Error::None);
+        ASSERT_EQ(assembler.nop(), Error::None);
+        ASSERT_EQ(assembler.bind(label), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Peephole peephole;
+        ASSERT_EQ(peephole.run(program), Error::None);
+        ASSERT_EQ(peephole.getStats().numReplaced, 1);
+
+        const auto& instrXor = getInstruction(program, 0);
+        ASSERT_EQ(instrXor.getId(), ZYDIS_MNEMONIC_XOR);
+        ASSERT_EQ(instrXor.getOperands()[0].get<Reg>(), eax);
+        ASSERT_EQ(instrXor.getOperands()[1].get<Reg>(), eax);
+
+        // The flags are read by jz.
+        ASSERT_EQ(getInstruction(program, 2).getId(), ZYDIS_MNEMONIC_MOV);
+    }
+
+    TEST(PeepholeTests, JumpToNext)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelA = assembler.createLabel();
+        auto labelB = assembler.createLabel();
+        auto labelC = assembler.createLabel();
+
+        ASSERT_EQ(assembler.jmp(labelB), Error::None);
+        ASSERT_EQ(assembler.bind(labelA), Error::None);
+        ASSERT_EQ(assembler.bind(labelB), Error::None);
+        ASSERT_EQ(assembler.jmp(labelC), Error::None);
+        ASSERT_EQ(assembler.nop(), Error::None);
+        ASSERT_EQ(assembler.bind(labelC), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Peephole peephole;
+        ASSERT_EQ(peephole.run(program), Error::None);
+        ASSERT_EQ(peephole.getStats().numRemoved, 1);
+        ASSERT_EQ(getInstructionCount(program), 3);
+        ASSERT_EQ(getInstruction(program, 0).getId(), ZYDIS_MNEMONIC_JMP);
+    }
+
+    TEST(PeepholeTests, FoldAddSub)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        ASSERT_EQ(assembler.add(rax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.add(rax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.sub(rax, Imm(5)), Error::None);
+        ASSERT_EQ(assembler.add(ecx, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.add(rdx, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.sub(rdx, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        const auto oldSize = serializer.getCodeSize();
+
+        Peephole peephole;
+        ASSERT_EQ(peephole.run(program), Error::None);
+        ASSERT_EQ(getInstructionCount(program), 4);
+
+        const auto& instrAdd = getInstruction(program, 0);
+        ASSERT_EQ(instrAdd.getId(), ZYDIS_MNEMONIC_ADD);
+        ASSERT_EQ(instrAdd.getOperands()[0].get<Reg>(), rax);
+        ASSERT_EQ(instrAdd.getOperands()[1].get<Imm>().value<int64_t>(), -3);
+
+        const auto& instrInc = getInstruction(program, 1);
+        ASSERT_EQ(instrInc.getId(), ZYDIS_MNEMONIC_INC);
+        ASSERT_EQ(instrInc.getOperands()[0].get<Reg>(), ecx);
+
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        ASSERT_EQ(oldSize - serializer.getCodeSize(), peephole.getStats().bytesSaved);
+    }
+
+    TEST(PeepholeTests, FoldAddSub32)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        ASSERT_EQ(assembler.add(eax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.sub(eax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.add(ecx, Imm(0)), Error::None);
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        const auto oldSize = serializer.getCodeSize();
+
+        Peephole peephole;
+        ASSERT_EQ(peephole.run(program), Error::None);
+        ASSERT_EQ(peephole.getStats().numRemoved, 0);
+        ASSERT_EQ(getInstructionCount(program), 4);
+
+        // The sums are zero but the writes clear the upper halves of rax and rcx.
+        const auto& instrEax = getInstruction(program, 0);
+        ASSERT_EQ(instrEax.getId(), ZYDIS_MNEMONIC_MOV);
+        ASSERT_EQ(instrEax.getOperands()[0].get<Reg>(), eax);
+        ASSERT_EQ(instrEax.getOperands()[1].get<Reg>(), eax);
+
+        const auto& instrEcx = getInstruction(program, 1);
+        ASSERT_EQ(instrEcx.getId(), ZYDIS_MNEMONIC_MOV);
+        ASSERT_EQ(instrEcx.getOperands()[0].get<Reg>(), ecx);
+
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        ASSERT_EQ(oldSize - serializer.getCodeSize(), peephole.getStats().bytesSaved);
+    }
+
+} // namespace zasm::tests
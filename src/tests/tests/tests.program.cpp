@@ -1,4 +1,8 @@
 #include <gtest/gtest.h>
+#include <memory>
+#include <thread>
+#include <variant>
+#include <vector>
 #include <zasm/zasm.hpp>
 
 namespace zasm::tests
@@ -335,4 +339,138 @@ namespace zasm::tests
         }
     }
 
-} // namespace zasm::tests
\ No newline at end of file
+    TEST(ProgramTests, ParallelConstruction)
+    {
+        using namespace zasm::operands;
+
+        constexpr size_t kThreadCount = 4;
+        constexpr size_t kProgramCount = 8;
+        constexpr int kInstrCount = 2000;
+
+        std::vector<std::unique_ptr<Program>> programs(kThreadCount * kProgramCount);
+        std::vector<std::thread> threads;
+
+        for (size_t t = 0; t < kThreadCount; t++)
+        {
+            threads.emplace_back([&programs, t]() {
+                for (size_t i = 0; i < kProgramCount; i++)
+                {
+                    auto program = std::make_unique<Program>(ZYDIS_MACHINE_MODE_LONG_64);
+
+                    Assembler assembler(*program);
+                    for (int n = 0; n < kInstrCount; n++)
+                    {
+                        assembler.mov(eax, Imm(n));
+                    }
+
+                    programs[t * kProgramCount + i] = std::move(program);
+                }
+            });
+        }
+
+        for (auto& thread : threads)
+        {
+            thread.join();
+        }
+
+        // Nodes were allocated on the worker threads, verify and release them on this one.
+        for (auto& program : programs)
+        {
+            ASSERT_EQ(program->size(), kInstrCount);
+
+            int n = 0;
+            for (const auto* node = program->getHead(); node != nullptr; node = node->getNext())
+            {
+                const auto& instr = node->get<Instruction>();
+                ASSERT_EQ(instr.getId(), ZYDIS_MNEMONIC_MOV);
+                ASSERT_EQ(instr.getOperand<Imm>(1).value<int>(), n);
+                n++;
+            }
+
+            program.reset();
+        }
+    }
+
+    TEST(ProgramTests, CreateNodeInPlace)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        ASSERT_EQ(assembler.add(rax, qword_ptr(rcx, 0x10)), Error::None);
+        const auto& form = program.getHead()->get<Instruction>();
+        ASSERT_EQ(form.hasMetaData(), true);
+
+        auto ops = form.getOperands();
+        ops[0] = rdx;
+        ops[1] = qword_ptr(rbx, 0x20);
+
+        const auto* node = program.createNode(form, ops);
+        ASSERT_NE(node, nullptr);
+
+        const auto& instr = node->get<Instruction>();
+        ASSERT_EQ(instr.getId(), ZYDIS_MNEMONIC_ADD);
+        ASSERT_EQ(instr.getOperandCount(), form.getOperandCount());
+        ASSERT_EQ(instr.getOperand<Reg>(0), rdx);
+        ASSERT_EQ(instr.getOperand<Mem>(1).getBase(), rbx);
+        ASSERT_EQ(instr.getOperand<Mem>(1).getDisplacement(), 0x20);
+        ASSERT_EQ(instr.getLength(), form.getLength());
+        ASSERT_EQ(instr.getFlags().write, form.getFlags().write);
+        ASSERT_EQ(instr.getAccess(), form.getAccess());
+
+        const auto* recordNode = program.createNode(Instruction::Attribs::None, ZYDIS_MNEMONIC_MOV, 2, ops);
+        ASSERT_NE(recordNode, nullptr);
+        ASSERT_EQ(recordNode->get<Instruction>().getId(), ZYDIS_MNEMONIC_MOV);
+        ASSERT_EQ(recordNode->get<Instruction>().hasMetaData(), false);
+
+        program.append(node);
+        program.append(recordNode);
+        ASSERT_EQ(program.size(), 3);
+    }
+
+    TEST(ProgramTests, SharedInstructionMeta)
+    {
+        Decoder decoder(ZYDIS_MACHINE_MODE_LONG_64);
+
+        // add rax, rcx; add rdx, rbx; mov rax, rcx
+        const uint8_t code[] = { 0x48, 0x01, 0xC8, 0x48, 0x01, 0xDA, 0x48, 0x89, 0xC8 };
+
+        auto res0 = decoder.decode(code, 3, 0);
+        ASSERT_EQ(res0.hasValue(), true);
+        auto res1 = decoder.decode(code + 3, 3, 3);
+        ASSERT_EQ(res1.hasValue(), true);
+        auto res2 = decoder.decode(code + 6, 3, 6);
+        ASSERT_EQ(res2.hasValue(), true);
+
+        const auto& add0 = *res0;
+        const auto& add1 = *res1;
+        const auto& mov = *res2;
+
+        // Same form, the meta data is shared.
+        ASSERT_EQ(&add0.getAccess(), &add1.getAccess());
+        ASSERT_EQ(&add0.getFlags(), &add1.getFlags());
+        ASSERT_NE(&add0.getAccess(), &mov.getAccess());
+        ASSERT_EQ(add0.getAccess()[0], ZYDIS_OPERAND_ACTION_READWRITE);
+        ASSERT_EQ(mov.getAccess()[0], ZYDIS_OPERAND_ACTION_WRITE);
+
+        // Instructions without meta data all refer to the same empty entry.
+        const Instruction empty0(Instruction::Attribs::None, ZYDIS_MNEMONIC_NOP, 0, {});
+        const Instruction empty1{};
+        ASSERT_EQ(&empty0.getAccess(), &empty1.getAccess());
+    }
+
+    TEST(ProgramTests, OperandAccess)
+    {
+        using namespace zasm::operands;
+
+        const Operand op = rax;
+        ASSERT_EQ(op.get<Reg>(), rax);
+        ASSERT_EQ(op.getIf<Imm>(), nullptr);
+
+        // Accessing a different type stays checked in release builds.
+        ASSERT_THROW(op.get<Imm>(), std::bad_variant_access);
+        ASSERT_THROW(Operand{}.get<Label>(), std::bad_variant_access);
+    }
+
+} // namespace zasm::tests
@@ -0,0 +1,282 @@
+#include "../testutils.hpp"
+
+#include <array>
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using namespace zasm::operands;
+    using passes::RegisterAllocator;
+
+    static bool hasVirtualRegs(const Program& program)
+    {
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr)
+                continue;
+
+            for (size_t i = 0; i < instr->getOperandCount(); ++i)
+            {
+                const auto& op = instr->getOperand(i);
+                if (const auto* reg = op.getIf<Reg>(); reg != nullptr && reg->isVirtual())
+                    return true;
+                const auto* mem = op.getIf<Mem>();
+                if (mem != nullptr && (mem->getBase().isVirtual() || mem->getIndex().isVirtual()))
+                    return true;
+            }
+        }
+        return false;
+    }
+
+    TEST(RegisterAllocatorTests, Basic)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto v0 = assembler.createVirtualGp64();
+        auto v1 = assembler.createVirtualGp64();
+
+        ASSERT_EQ(assembler.mov(rcx, Imm(5)), Error::None);
+        ASSERT_EQ(assembler.mov(v0, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.mov(v1, qword_ptr(v0, 8)), Error::None);
+        ASSERT_EQ(assembler.add(v0, v1), Error::None);
+        ASSERT_EQ(assembler.add(rcx, v0), Error::None);
+        ASSERT_EQ(assembler.mov(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        RegisterAllocator allocator;
+        ASSERT_EQ(allocator.run(program), Error::None);
+        ASSERT_EQ(hasVirtualRegs(program), false);
+        ASSERT_EQ(allocator.getStats().numVirtualRegs, 2);
+        ASSERT_EQ(allocator.getStats().numSpilled, 0);
+        ASSERT_EQ(allocator.getStats().numSpillInstructions, 0);
+
+        // rcx is live across v0 and can not hold it.
+        const auto& instrAdd = getInstruction(program, 4);
+        const auto& ops = instrAdd.getOperands();
+        ASSERT_EQ(ops[0].get<Reg>(), rcx);
+        ASSERT_NE(ops[1].get<Reg>(), rcx);
+        ASSERT_EQ(ops[1].get<Reg>().isGp64(), true);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+    }
+
+    TEST(RegisterAllocatorTests, Spill)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        std::array<Gp64, 6> regs;
+        for (auto& reg : regs)
+        {
+            reg = assembler.createVirtualGp64();
+        }
+
+        for (size_t i = 0; i < regs.size(); ++i)
+        {
+            ASSERT_EQ(assembler.mov(regs[i], Imm(static_cast<int32_t>(i))), Error::None);
+        }
+        for (size_t i = 1; i < regs.size(); ++i)
+        {
+            ASSERT_EQ(assembler.add(regs[0], regs[i]), Error::None);
+        }
+        ASSERT_EQ(assembler.mov(rax, regs[0]), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        analysis::RegSet allocatable;
+        allocatable.add(rax);
+        allocatable.add(rcx);
+        allocatable.add(rdx);
+        allocatable.add(rbx);
+
+        RegisterAllocator allocator;
+        allocator.setAllocatable(allocatable);
+        allocator.setSpillArea(rbp, -0x40);
+        ASSERT_EQ(allocator.run(program), Error::None);
+        ASSERT_EQ(hasVirtualRegs(program), false);
+
+        const auto& stats = allocator.getStats();
+        ASSERT_EQ(stats.numVirtualRegs, 6);
+        ASSERT_GT(stats.numSpilled, 0);
+        ASSERT_GT(stats.numSpillInstructions, 0);
+        ASSERT_EQ(stats.spillAreaSize, static_cast<int32_t>(stats.numSpilled * 8));
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+    }
+
+    TEST(RegisterAllocatorTests, SpillBaseMoved)
+    {
+        const auto emitCode = [](Program& program) {
+            Assembler assembler(program);
+
+            std::array<Gp64, 6> regs;
+            for (auto& reg : regs)
+            {
+                reg = assembler.createVirtualGp64();
+            }
+
+            ASSERT_EQ(assembler.push(rbx), Error::None);
+            for (size_t i = 0; i < regs.size(); ++i)
+            {
+                ASSERT_EQ(assembler.mov(regs[i], Imm(static_cast<int32_t>(i))), Error::None);
+            }
+            for (size_t i = 1; i < regs.size(); ++i)
+            {
+                ASSERT_EQ(assembler.add(regs[0], regs[i]), Error::None);
+            }
+            ASSERT_EQ(assembler.mov(qword_ptr(rdi), regs[0]), Error::None);
+            ASSERT_EQ(assembler.pop(rbx), Error::None);
+            ASSERT_EQ(assembler.ret(), Error::None);
+        };
+
+        analysis::RegSet allocatable;
+        allocatable.add(rax);
+        allocatable.add(rcx);
+        allocatable.add(rdx);
+
+        // push and pop move the stack pointer, slots relative to it would refer to other memory.
+        {
+            Program program(ZYDIS_MACHINE_MODE_LONG_64);
+            emitCode(program);
+
+            RegisterAllocator allocator;
+            allocator.setAllocatable(allocatable);
+            ASSERT_EQ(allocator.run(program), Error::InvalidOperation);
+        }
+
+        {
+            Program program(ZYDIS_MACHINE_MODE_LONG_64);
+            emitCode(program);
+
+            RegisterAllocator allocator;
+            allocator.setAllocatable(allocatable);
+            allocator.setSpillArea(rbp, -0x40);
+            ASSERT_EQ(allocator.run(program), Error::None);
+            ASSERT_EQ(hasVirtualRegs(program), false);
+            ASSERT_GT(allocator.getStats().numSpilled, 0);
+        }
+    }
+
+    TEST(RegisterAllocatorTests, HiddenOperands)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto v0 = assembler.createVirtualGp64();
+        auto v1 = assembler.createVirtualGp64();
+
+        ASSERT_EQ(assembler.mov(v0, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.mov(v1, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.mov(rax, Imm(3)), Error::None);
+        ASSERT_EQ(assembler.mul(v1), Error::None);
+        ASSERT_EQ(assembler.add(rax, v0), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        RegisterAllocator allocator;
+        ASSERT_EQ(allocator.run(program), Error::None);
+        ASSERT_EQ(hasVirtualRegs(program), false);
+
+        // mul reads rax and writes rdx:rax, v0 is live across it.
+        const auto& instrAdd = getInstruction(program, 4);
+        const auto reg = instrAdd.getOperands()[1].get<Reg>();
+        ASSERT_NE(reg, rax);
+        ASSERT_NE(reg, rdx);
+
+        const auto& instrMul = getInstruction(program, 3);
+        ASSERT_EQ(instrMul.getId(), ZYDIS_MNEMONIC_MUL);
+        ASSERT_NE(instrMul.getOperands()[0].get<Reg>(), rax);
+    }
+
+    TEST(RegisterAllocatorTests, LiveAtExit)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto v0 = assembler.createVirtualGp32();
+
+        // eax holds the result once the program returns.
+        ASSERT_EQ(assembler.mov(eax, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.mov(v0, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.add(dword_ptr(rcx), v0), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        RegisterAllocator allocator;
+        ASSERT_EQ(allocator.run(program), Error::None);
+        ASSERT_EQ(hasVirtualRegs(program), false);
+
+        const auto reg = getInstruction(program, 1).getOperands()[0].get<Reg>();
+        ASSERT_NE(reg, eax);
+        ASSERT_NE(reg, ecx);
+        ASSERT_EQ(getInstruction(program, 0).getOperands()[0].get<Reg>(), eax);
+    }
+
+    TEST(RegisterAllocatorTests, LiveAtCall)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelFunc = assembler.createLabel();
+        auto v0 = assembler.createVirtualGp64();
+
+        // rcx is an argument of the call.
+        ASSERT_EQ(assembler.mov(rcx, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.mov(v0, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.mov(qword_ptr(rbx), v0), Error::None);
+        ASSERT_EQ(assembler.call(labelFunc), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.bind(labelFunc), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        analysis::RegSet allocatable;
+        allocatable.add(rcx);
+        allocatable.add(rdx);
+
+        RegisterAllocator allocator;
+        allocator.setAllocatable(allocatable);
+        ASSERT_EQ(allocator.run(program), Error::None);
+        ASSERT_EQ(hasVirtualRegs(program), false);
+        ASSERT_EQ(allocator.getStats().numSpilled, 0);
+        ASSERT_EQ(getInstruction(program, 1).getOperands()[0].get<Reg>(), rdx);
+    }
+
+    TEST(RegisterAllocatorTests, HighByteRegisters)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto v0 = assembler.createVirtualGp8();
+        auto v1 = assembler.createVirtualGp32();
+
+        ASSERT_EQ(assembler.mov(v0, Imm(1)), Error::None);
+        ASSERT_EQ(assembler.add(ah, v0), Error::None);
+        ASSERT_EQ(assembler.mov(v1, Imm(2)), Error::None);
+        ASSERT_EQ(assembler.add(eax, v1), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        RegisterAllocator allocator;
+        ASSERT_EQ(allocator.run(program), Error::None);
+        ASSERT_EQ(hasVirtualRegs(program), false);
+
+        // Next to ah only al, cl, dl and bl can be encoded.
+        const auto reg = getInstruction(program, 1).getOperands()[1].get<Reg>();
+        ASSERT_EQ(reg.isGp8Lo(), true);
+        ASSERT_LT(reg.getPhysicalIndex(), 4);
+
+        // The lengths are the ones of the physical registers and not of the placeholders.
+        size_t totalLength = 0;
+        for (size_t i = 0; i < 5; ++i)
+        {
+            totalLength += getInstruction(program, i).getLength();
+        }
+        ASSERT_EQ(getInstruction(program, 2).getLength(), 5);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x400000), Error::None);
+        ASSERT_EQ(serializer.getCodeSize(), totalLength);
+    }
+
+} // namespace zasm::tests
@@ -435,4 +435,47 @@ namespace zasm::tests
         ASSERT_EQ(r15.r64(), r15);
     }
 
+    TEST(RegisterTests, TestConstexprQueries)
+    {
+        using namespace zasm::operands;
+
+        static_assert(ah.isGp8Hi() && !ah.isGp8Lo() && ah.getOffset() == 1);
+        static_assert(spl.isGp8Lo() && spl.getPhysicalIndex() == 4);
+        static_assert(r12d.getClass() == ZYDIS_REGCLASS_GPR32 && r12d.getIndex() == 12);
+        static_assert(bh.getRoot(ZYDIS_MACHINE_MODE_LONG_64) == rbx);
+        static_assert(bh.getRoot(ZYDIS_MACHINE_MODE_LEGACY_32) == ebx);
+        static_assert(r9w.getRoot(ZYDIS_MACHINE_MODE_LEGACY_32) == Reg{});
+        static_assert(xmm17.getRoot(ZYDIS_MACHINE_MODE_LONG_64) == zmm17);
+        static_assert(rax.getSize(ZYDIS_MACHINE_MODE_LONG_64) == BitSize::_64);
+        static_assert(ymm3.getSize(ZYDIS_MACHINE_MODE_LEGACY_32) == BitSize::_256);
+        static_assert(dil.r64() == rdi && ax.r8hi() == ah);
+
+        SUCCEED();
+    }
+
+    TEST(RegisterTests, TestTablesMatchZydis)
+    {
+        using namespace zasm::operands;
+
+        constexpr ZydisMachineMode kModes[] = {
+            ZYDIS_MACHINE_MODE_LONG_64,        ZYDIS_MACHINE_MODE_LONG_COMPAT_32, ZYDIS_MACHINE_MODE_LONG_COMPAT_16,
+            ZYDIS_MACHINE_MODE_LEGACY_32,      ZYDIS_MACHINE_MODE_LEGACY_16,      ZYDIS_MACHINE_MODE_REAL_16,
+        };
+
+        for (int32_t id = ZYDIS_REGISTER_NONE + 1; id <= ZYDIS_REGISTER_MAX_VALUE; ++id)
+        {
+            const auto regId = static_cast<ZydisRegister>(id);
+            const auto reg = Reg(regId);
+
+            ASSERT_EQ(reg.getClass(), ZydisRegisterGetClass(regId)) << id;
+            ASSERT_EQ(reg.getIndex(), ZydisRegisterGetId(regId)) << id;
+
+            for (const auto mode : kModes)
+            {
+                ASSERT_EQ(reg.getSize(mode), toBitSize(ZydisRegisterGetWidth(mode, regId))) << id << " " << mode;
+                ASSERT_EQ(reg.getRoot(mode).getId(), ZydisRegisterGetLargestEnclosing(mode, regId)) << id << " " << mode;
+            }
+        }
+    }
+
 } // namespace zasm::tests
\ No newline at end of file
@@ -99,4 +99,30 @@ namespace zasm::tests
         }
     }
 
+    TEST(AssemblerTests, TestSegmentES64)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        ASSERT_EQ(assembler.mov(rax, qword_ptr(es, rcx)), Error::None);
+        ASSERT_EQ(assembler.mov(rax, qword_ptr(ds, rcx)), Error::None);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        // The default segment is not encoded.
+        const std::array<uint8_t, 7> expected = {
+            0x26, 0x48, 0x8B, 0x01, 0x48, 0x8B, 0x01,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+    }
+
 } // namespace zasm::tests
\ No newline at end of file
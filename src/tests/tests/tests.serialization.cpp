@@ -1,4 +1,8 @@
+#include <algorithm>
+#include <cstring>
 #include <gtest/gtest.h>
+#include <testdata/instructions.hpp>
+#include <vector>
 #include <zasm/zasm.hpp>
 
 namespace zasm::tests
@@ -606,4 +610,379 @@ namespace zasm::tests
         }
     }
 
-} // namespace zasm::tests
\ No newline at end of file
+    TEST(SerializationTests, RipRelativeLabelsX64)
+    {
+        using namespace zasm::operands;
+
+        // Instructions of different length referencing labels before and after them, without
+        // meta data there is no length to predict the size from.
+        for (const bool recordOnly : { false, true })
+        {
+            Program program(ZYDIS_MACHINE_MODE_LONG_64);
+            Assembler assembler(program);
+            Serializer serializer;
+
+            assembler.setRecordOnly(recordOnly);
+
+            constexpr size_t kNumLabels = 64;
+
+            std::vector<Label> labels;
+            for (size_t i = 0; i < kNumLabels; i++)
+            {
+                labels.push_back(assembler.createLabel());
+            }
+
+            std::vector<std::pair<const Node*, Label>> references;
+            for (size_t i = 0; i < kNumLabels; i++)
+            {
+                ASSERT_EQ(assembler.bind(labels[i]), Error::None);
+
+                const auto& target = labels[(i * 7) % kNumLabels];
+                ASSERT_EQ(assembler.lea(rax, qword_ptr(rip, target)), Error::None);
+                references.emplace_back(assembler.getCursor(), target);
+                ASSERT_EQ(assembler.mov(r9d, dword_ptr(rip, target)), Error::None);
+                references.emplace_back(assembler.getCursor(), target);
+                ASSERT_EQ(assembler.add(qword_ptr(rip, target), Imm(static_cast<int32_t>(i * 0x1000))), Error::None);
+                references.emplace_back(assembler.getCursor(), target);
+                ASSERT_EQ(assembler.cmp(byte_ptr(rip, target), Imm(1)), Error::None);
+                references.emplace_back(assembler.getCursor(), target);
+            }
+
+            ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+            Decoder decoder(ZYDIS_MACHINE_MODE_LONG_64);
+
+            size_t index = 0;
+            size_t numChecked = 0;
+            for (const auto* node = program.getHead(); node != nullptr; node = node->getNext(), ++index)
+            {
+                if (node->getIf<Instruction>() == nullptr)
+                    continue;
+
+                const auto* info = serializer.getNodeInfo(index);
+                ASSERT_NE(info, nullptr);
+
+                auto decodeResult = decoder.decode(serializer.getCode() + info->offset, info->length, info->address);
+                ASSERT_EQ(decodeResult.hasValue(), true);
+
+                const auto& decoded = *decodeResult;
+                ASSERT_EQ(decoded.getLength(), info->length);
+
+                const auto it = std::find_if(
+                    references.begin(), references.end(), [&](const auto& ref) { return ref.first == node; });
+                ASSERT_NE(it, references.end());
+
+                const auto* mem = decoded.getOperandIf<Mem>(0);
+                if (mem == nullptr)
+                    mem = decoded.getOperandIf<Mem>(1);
+                ASSERT_NE(mem, nullptr);
+                ASSERT_EQ(mem->getBase(), rip);
+
+                const auto targetAddress = info->address + info->length + mem->getDisplacement();
+                ASSERT_EQ(targetAddress, serializer.getLabelAddress(it->second.getId()));
+                numChecked++;
+            }
+
+            ASSERT_EQ(numChecked, references.size());
+        }
+    }
+
+    TEST(SerializationTests, RecordOnlyMatchesGenerated)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        Program recordedProgram(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler recordingAssembler(recordedProgram);
+        recordingAssembler.setRecordOnly(true);
+
+        for (const auto& instr : data::Instructions)
+        {
+            ASSERT_EQ(instr.emitter(assembler), Error::None) << instr.operation;
+            ASSERT_EQ(instr.emitter(recordingAssembler), Error::None) << instr.operation;
+        }
+
+        ASSERT_EQ(recordedProgram.size(), program.size());
+        ASSERT_EQ(program.getHead()->get<Instruction>().hasMetaData(), true);
+        ASSERT_EQ(recordedProgram.getHead()->get<Instruction>().hasMetaData(), false);
+
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        Serializer recordedSerializer;
+        ASSERT_EQ(recordedSerializer.serialize(recordedProgram, 0x0000000000401000), Error::None);
+        ASSERT_EQ(recordedSerializer.getErrorNode(), nullptr);
+
+        ASSERT_EQ(recordedSerializer.getCodeSize(), serializer.getCodeSize());
+        ASSERT_EQ(std::memcmp(recordedSerializer.getCode(), serializer.getCode(), serializer.getCodeSize()), 0);
+    }
+
+    TEST(SerializationTests, RecordOnlyReportsErrorNode)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        assembler.setRecordOnly(true);
+
+        ASSERT_EQ(assembler.nop(), Error::None);
+        ASSERT_EQ(assembler.emit(ZYDIS_MNEMONIC_MOV, rax, ecx), Error::None);
+        const auto* invalidNode = assembler.getCursor();
+        ASSERT_EQ(assembler.nop(), Error::None);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::ImpossibleInstruction);
+        ASSERT_EQ(serializer.getErrorNode(), invalidNode);
+
+        // Without record-only the error is reported when emitting.
+        assembler.setRecordOnly(false);
+        ASSERT_EQ(assembler.emit(ZYDIS_MNEMONIC_MOV, rax, ecx), Error::ImpossibleInstruction);
+    }
+
+    TEST(SerializationTests, AlignCodeX64)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        auto label = assembler.createLabel();
+
+        ASSERT_EQ(assembler.nop(), Error::None);
+        ASSERT_EQ(assembler.align(16), Error::None);
+        ASSERT_EQ(assembler.bind(label), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        ASSERT_EQ(assembler.align(3), Error::InvalidParameter);
+        ASSERT_EQ(assembler.align(0), Error::InvalidParameter);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_EQ(serializer.getLabelAddress(label.getId()), 0x0000000000401010);
+
+        // 15 bytes of padding as one 11 and one 4 byte nop.
+        const std::array<uint8_t, 17> expected = {
+            0x90, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x1F, 0x40, 0x00, 0xC3,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+    }
+
+    TEST(SerializationTests, AlignRelaxationX64)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        auto label = assembler.createLabel();
+
+        // The jump is encoded with rel32 until the label is bound, the padding grows once it is relaxed to rel8.
+        ASSERT_EQ(assembler.jmp(label), Error::None);
+        ASSERT_EQ(assembler.align(16), Error::None);
+        ASSERT_EQ(assembler.bind(label), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_EQ(serializer.getLabelAddress(label.getId()), 0x0000000000401010);
+
+        const std::array<uint8_t, 17> expected = {
+            0xEB, 0x0E, 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00, 0x0F, 0x1F, 0x00, 0xC3,
+        };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+    }
+
+    TEST(SerializationTests, AlignDataX64)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        ASSERT_EQ(assembler.ret(), Error::None);
+        ASSERT_EQ(assembler.align(8, Align::Type::Data), Error::None);
+        ASSERT_EQ(assembler.dd(0x11223344), Error::None);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        const std::array<uint8_t, 12> expected = { 0xC3, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x44, 0x33, 0x22, 0x11 };
+        ASSERT_EQ(serializer.getCodeSize(), expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[i], expected[i]);
+        }
+
+        const auto* nodeInfo = serializer.getNodeInfo(1);
+        ASSERT_NE(nodeInfo, nullptr);
+        ASSERT_EQ(nodeInfo->length, 7);
+    }
+
+    TEST(SerializationTests, JccErratumBranchX64)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+
+        auto label = assembler.createLabel();
+
+        // The short jmp ends on the 32 byte boundary.
+        for (int i = 0; i < 30; i++)
+        {
+            ASSERT_EQ(assembler.nop(), Error::None);
+        }
+        ASSERT_EQ(assembler.jmp(label), Error::None);
+        ASSERT_EQ(assembler.bind(label), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        ASSERT_EQ(serializer.hasJccErratumMitigation(), false);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+        ASSERT_EQ(serializer.getCodeSize(), 33);
+        ASSERT_EQ(serializer.getJccErratumStats().numPadded, 0);
+
+        serializer.setJccErratumMitigation(true);
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        const std::array<uint8_t, 5> expected = { 0x66, 0x90, 0xEB, 0x00, 0xC3 };
+        ASSERT_EQ(serializer.getCodeSize(), 30 + expected.size());
+
+        const auto* data = serializer.getCode();
+        ASSERT_NE(data, nullptr);
+        for (size_t i = 0; i < expected.size(); i++)
+        {
+            ASSERT_EQ(data[30 + i], expected[i]);
+        }
+
+        ASSERT_EQ(serializer.getNodeInfo(30)->offset, 32);
+        ASSERT_EQ(serializer.getJccErratumStats().numPadded, 1);
+        ASSERT_EQ(serializer.getJccErratumStats().bytesPadded, 2);
+    }
+
+    TEST(SerializationTests, JccErratumFusedPairX64)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+        serializer.setJccErratumMitigation(true);
+
+        auto label = assembler.createLabel();
+
+        // The cmp ends before the boundary, the fused jcc crosses it.
+        for (int i = 0; i < 28; i++)
+        {
+            ASSERT_EQ(assembler.nop(), Error::None);
+        }
+        ASSERT_EQ(assembler.cmp(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.jz(label), Error::None);
+        ASSERT_EQ(assembler.bind(label), Error::None);
+        ASSERT_EQ(assembler.mov(rax, rcx), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        ASSERT_EQ(serializer.serialize(program, 0x0000000000401000), Error::None);
+
+        // The pair is moved as a whole, the jcc itself no longer touches a boundary.
+        ASSERT_EQ(serializer.getNodeInfo(28)->offset, 32);
+        ASSERT_EQ(serializer.getNodeInfo(29)->offset, 35);
+        ASSERT_EQ(serializer.getJccErratumStats().numPadded, 1);
+        ASSERT_EQ(serializer.getJccErratumStats().bytesPadded, 4);
+        ASSERT_EQ(serializer.getLabelOffset(label.getId()), 37);
+    }
+
+    TEST(SerializationTests, JccErratumAlignSettlesX64)
+    {
+        using namespace zasm::operands;
+
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        Serializer serializer;
+        serializer.setJccErratumMitigation(true);
+
+        auto label = assembler.createLabel();
+
+        // Relaxing the second jmp moves it off the boundary which drops its padding, the alignment then pushes the
+        // label out of rel8 range again, without sizes that only grow this flips between two layouts forever.
+        ASSERT_EQ(assembler.jmp(label), Error::None);
+        for (int i = 0; i < 22; i++)
+        {
+            ASSERT_EQ(assembler.nop(), Error::None);
+        }
+        ASSERT_EQ(assembler.jmp(label), Error::None);
+        for (int i = 0; i < 97; i++)
+        {
+            ASSERT_EQ(assembler.nop(), Error::None);
+        }
+        ASSERT_EQ(assembler.align(32), Error::None);
+        ASSERT_EQ(assembler.bind(label), Error::None);
+        ASSERT_EQ(assembler.ret(), Error::None);
+
+        constexpr int64_t kBase = 0x0000000000401000;
+        ASSERT_EQ(serializer.serialize(program, kBase), Error::None);
+
+        const auto labelVA = serializer.getLabelAddress(label.getId());
+        ASSERT_EQ(labelVA % 32, 0);
+
+        Decoder decoder(ZYDIS_MACHINE_MODE_LONG_64);
+        for (const size_t nodeIndex : { size_t{ 0 }, size_t{ 23 } })
+        {
+            const auto* nodeInfo = serializer.getNodeInfo(nodeIndex);
+            ASSERT_NE(nodeInfo, nullptr);
+
+            const auto* code = serializer.getCode() + nodeInfo->offset;
+            auto decoded = decoder.decode(code, nodeInfo->length, nodeInfo->address);
+            ASSERT_EQ(decoded.hasValue(), true);
+
+            const auto& jmp = *decoded;
+            ASSERT_EQ(jmp.getId(), ZYDIS_MNEMONIC_JMP);
+            ASSERT_EQ(jmp.getOperand<Imm>(0).value<int64_t>(), labelVA);
+
+            // Neither crossing nor ending on a boundary.
+            const auto end = nodeInfo->address + jmp.getLength();
+            ASSERT_EQ(nodeInfo->address / 32, (end - 1) / 32);
+            ASSERT_NE(end % 32, 0);
+        }
+    }
+
+    TEST(SerializationTests, UpToDateProgram)
+    {
+        Serializer serializer;
+        {
+            Program program(ZYDIS_MACHINE_MODE_LONG_64);
+            Assembler assembler(program);
+            ASSERT_EQ(assembler.nop(), Error::None);
+            ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+            ASSERT_EQ(serializer.isUpToDate(program), true);
+        }
+
+        // A new program with the same modifications, possibly at the address of the old one.
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+        ASSERT_EQ(assembler.nop(), Error::None);
+        ASSERT_EQ(serializer.isUpToDate(program), false);
+
+        ASSERT_EQ(serializer.serialize(program, 0x1000), Error::None);
+        ASSERT_EQ(serializer.isUpToDate(program), true);
+    }
+
+} // namespace zasm::tests
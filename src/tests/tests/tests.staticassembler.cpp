@@ -0,0 +1,127 @@
+#include <cstring>
+#include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
+
+namespace zasm::tests
+{
+    using namespace zasm::operands;
+
+    // Hook style thunk, preserves the frame, calls a patchable target and jumps to a patchable continuation.
+    // Branches only go backwards so the serializer picks the same encodings, forward references are
+    // the rip-relative operands.
+    static constexpr auto kThunk = assembleStatic([](auto& a) {
+        auto labelLoop = a.createLabel();
+        auto labelCall = a.createLabel();
+        auto labelTarget = a.createLabel();
+
+        a.push(rbp);
+        a.mov(rbp, rsp);
+        a.sub(rsp, Imm(0x20));
+        a.mov(rax, qword_ptr(rip, labelTarget));
+        a.bind(labelLoop);
+        a.add(qword_ptr(rcx, rdx, 8, 0x40), Imm(1));
+        a.mov(dword_ptr(rip, labelTarget, 4), Imm(0x1000));
+        a.test(eax, eax);
+        a.jnz(labelLoop);
+        a.bind(labelCall);
+        a.movabs(r11, Imm(0x1122334455667788));
+        a.markPatch();
+        a.call(r11);
+        a.add(rsp, Imm(0x20));
+        a.pop(rbp);
+        a.jmp(qword_ptr(rip, labelTarget));
+        a.bind(labelTarget);
+        a.dq(0);
+        a.markPatch();
+    });
+
+    static_assert(kThunk.code.size() == 67);
+    static_assert(kThunk.code[0] == 0x55);
+    static_assert(kThunk.patches.size() == 2);
+    static_assert(kThunk.patches[0].size == 8 && kThunk.patches[1].size == 8);
+    static_assert(kThunk.patches[1].offset + 8 == kThunk.code.size());
+
+    TEST(StaticAssemblerTests, MatchesSerializer)
+    {
+        Program program(ZYDIS_MACHINE_MODE_LONG_64);
+        Assembler assembler(program);
+
+        auto labelLoop = assembler.createLabel();
+        auto labelCall = assembler.createLabel();
+        auto labelTarget = assembler.createLabel();
+
+        ASSERT_EQ(assembler.push(rbp), Error::None);
+        ASSERT_EQ(assembler.mov(rbp, rsp), Error::None);
+        ASSERT_EQ(assembler.sub(rsp, Imm(0x20)), Error::None);
+        ASSERT_EQ(assembler.mov(rax, qword_ptr(rip, labelTarget)), Error::None);
+        ASSERT_EQ(assembler.bind(labelLoop), Error::None);
+        ASSERT_EQ(assembler.add(qword_ptr(rcx, rdx, 8, 0x40), Imm(1)), Error::None);
+        ASSERT_EQ(assembler.mov(dword_ptr(rip, labelTarget, 4), Imm(0x1000)), Error::None);
+        ASSERT_EQ(assembler.test(eax, eax), Error::None);
+        ASSERT_EQ(assembler.jnz(labelLoop), Error::None);
+        ASSERT_EQ(assembler.bind(labelCall), Error::None);
+        ASSERT_EQ(assembler.mov(r11, Imm(0x1122334455667788)), Error::None);
+        ASSERT_EQ(assembler.call(r11), Error::None);
+        ASSERT_EQ(assembler.add(rsp, Imm(0x20)), Error::None);
+        ASSERT_EQ(assembler.pop(rbp), Error::None);
+        ASSERT_EQ(assembler.jmp(qword_ptr(rip, labelTarget)), Error::None);
+        ASSERT_EQ(assembler.bind(labelTarget), Error::None);
+        ASSERT_EQ(assembler.dq(0), Error::None);
+
+        // The reference is independent of the streaming mode that shares the direct encoders.
+        Serializer serializer;
+        ASSERT_EQ(serializer.serialize(program, 0), Error::None);
+
+        ASSERT_EQ(serializer.getCodeSize(), kThunk.code.size());
+        ASSERT_EQ(std::memcmp(serializer.getCode(), kThunk.code.data(), kThunk.code.size()), 0);
+
+        // The movabs immediate follows the rex prefix and opcode.
+        ASSERT_EQ(kThunk.patches[0].offset, static_cast<size_t>(serializer.getLabelOffset(labelCall.getId()) + 2));
+        ASSERT_EQ(kThunk.patches[1].offset, static_cast<size_t>(serializer.getLabelOffset(labelTarget.getId())));
+    }
+
+    TEST(StaticAssemblerTests, Patch)
+    {
+        auto code = kThunk.code;
+        kThunk.patch(code.data(), 1, 0x00007FF612345678);
+
+        uint64_t value{};
+        std::memcpy(&value, code.data() + kThunk.patches[1].offset, sizeof(value));
+        ASSERT_EQ(value, 0x00007FF612345678);
+        ASSERT_EQ(std::memcmp(code.data(), kThunk.code.data(), kThunk.patches[1].offset), 0);
+    }
+
+    TEST(StaticAssemblerTests, Errors)
+    {
+        {
+            StaticAssembler<16> a;
+            ASSERT_EQ(a.mov(eax, rcx), Error::ImpossibleInstruction);
+            ASSERT_EQ(a.getCodeSize(), 0);
+            // The first error is kept.
+            ASSERT_EQ(a.nop(), Error::ImpossibleInstruction);
+        }
+        {
+            StaticAssembler<16> a;
+            ASSERT_EQ(a.markPatch(), Error::InvalidOperation);
+        }
+        {
+            StaticAssembler<16> a;
+            ASSERT_EQ(a.jmp(Label{}), Error::InvalidLabel);
+            ASSERT_EQ(a.getCodeSize(), 0);
+        }
+        {
+            StaticAssembler<16> a;
+            auto label = a.createLabel();
+            ASSERT_EQ(a.jnz(label), Error::None);
+            ASSERT_EQ(a.getUnresolvedCount(), 1);
+            ASSERT_EQ(a.bind(label), Error::None);
+            ASSERT_EQ(a.getUnresolvedCount(), 0);
+            ASSERT_EQ(a.bind(label), Error::LabelAlreadyBound);
+        }
+        {
+            StaticAssembler<4> a;
+            ASSERT_EQ(a.mov(rax, Imm(1)), Error::OutOfBounds);
+        }
+    }
+
+} // namespace zasm::tests
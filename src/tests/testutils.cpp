@@ -37,4 +37,15 @@ namespace zasm::tests
         return res;
     }
 
+    const Instruction& getInstruction(const Program& program, size_t index)
+    {
+        const auto* node = program.getHead();
+        for (;;)
+        {
+            if (node->holds<Instruction>() && index-- == 0)
+                return node->get<Instruction>();
+            node = node->getNext();
+        }
+    }
+
 }
\ No newline at end of file
@@ -3,6 +3,7 @@
 #include <vector>
 #include <string>
 #include <gtest/gtest.h>
+#include <zasm/zasm.hpp>
 
 namespace zasm::tests
 {
@@ -10,4 +11,8 @@ namespace zasm::tests
 
     std::string hexEncode(const uint8_t* data, size_t N);
 
+    // Returns the instruction at the given index, labels and other nodes are not counted.
+    // Passes replace the nodes of rewritten instructions, tests look them up by position.
+    const Instruction& getInstruction(const Program& program, size_t index);
+
 }
\ No newline at end of file
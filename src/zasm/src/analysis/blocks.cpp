@@ -0,0 +1,254 @@
+#include "blocks.hpp"
+
+#include "../program/program.state.hpp"
+
+namespace zasm::detail
+{
+    BranchKind getBranchKind(const Instruction& instr) noexcept
+    {
+        switch (instr.getId())
+        {
+            case ZYDIS_MNEMONIC_JMP:
+                return BranchKind::Jmp;
+            case ZYDIS_MNEMONIC_JB:
+            case ZYDIS_MNEMONIC_JBE:
+            case ZYDIS_MNEMONIC_JCXZ:
+            case ZYDIS_MNEMONIC_JECXZ:
+            case ZYDIS_MNEMONIC_JKNZD:
+            case ZYDIS_MNEMONIC_JKZD:
+            case ZYDIS_MNEMONIC_JL:
+            case ZYDIS_MNEMONIC_JLE:
+            case ZYDIS_MNEMONIC_JNB:
+            case ZYDIS_MNEMONIC_JNBE:
+            case ZYDIS_MNEMONIC_JNL:
+            case ZYDIS_MNEMONIC_JNLE:
+            case ZYDIS_MNEMONIC_JNO:
+            case ZYDIS_MNEMONIC_JNP:
+            case ZYDIS_MNEMONIC_JNS:
+            case ZYDIS_MNEMONIC_JNZ:
+            case ZYDIS_MNEMONIC_JO:
+            case ZYDIS_MNEMONIC_JP:
+            case ZYDIS_MNEMONIC_JRCXZ:
+            case ZYDIS_MNEMONIC_JS:
+            case ZYDIS_MNEMONIC_JZ:
+            case ZYDIS_MNEMONIC_LOOP:
+            case ZYDIS_MNEMONIC_LOOPE:
+            case ZYDIS_MNEMONIC_LOOPNE:
+                return BranchKind::Jcc;
+            case ZYDIS_MNEMONIC_CALL:
+                return BranchKind::Call;
+            case ZYDIS_MNEMONIC_RET:
+            case ZYDIS_MNEMONIC_IRET:
+            case ZYDIS_MNEMONIC_IRETD:
+            case ZYDIS_MNEMONIC_IRETQ:
+            case ZYDIS_MNEMONIC_SYSRET:
+            case ZYDIS_MNEMONIC_SYSEXIT:
+            case ZYDIS_MNEMONIC_UD0:
+            case ZYDIS_MNEMONIC_UD1:
+            case ZYDIS_MNEMONIC_UD2:
+            case ZYDIS_MNEMONIC_HLT:
+                return BranchKind::Exit;
+            default:
+                return BranchKind::None;
+        }
+    }
+
+    static uint32_t getLabelBlock(const ProgramState& state, const BlockList& res, const Label& label)
+    {
+        const auto labelIdx = static_cast<size_t>(label.getId());
+        if (!label.isValid() || labelIdx >= state.labels.size() || state.labels[labelIdx].node == nullptr)
+            return kInvalidBlock;
+
+        return res.getBlock(state.labels[labelIdx].node);
+    }
+
+    static uint32_t getTargetBlock(const ProgramState& state, const BlockList& res, const Instruction& instr)
+    {
+        const auto* label = instr.getOperandIf<operands::Label>(0);
+        if (label == nullptr)
+            return kInvalidBlock;
+
+        return getLabelBlock(state, res, *label);
+    }
+
+    // Labels referenced by anything else than the target of a jump.
+    static void collectReferencedLabels(const Node* node, std::vector<Label>& res)
+    {
+        if (const auto* embedded = node->getIf<EmbeddedLabel>(); embedded != nullptr)
+        {
+            res.push_back(embedded->getLabel());
+            return;
+        }
+
+        const auto* instr = node->getIf<Instruction>();
+        if (instr == nullptr)
+            return;
+
+        const auto kind = getBranchKind(*instr);
+        const auto& ops = instr->getOperands();
+        for (size_t i = 0; i < instr->getOperandCount(); ++i)
+        {
+            if (const auto* label = ops[i].getIf<operands::Label>(); label != nullptr)
+            {
+                if (i != 0 || (kind != BranchKind::Jmp && kind != BranchKind::Jcc))
+                    res.push_back(*label);
+            }
+            else if (const auto* mem = ops[i].getIf<operands::Mem>(); mem != nullptr && mem->hasLabel())
+            {
+                res.push_back(mem->getLabel());
+            }
+        }
+    }
+
+    static void buildEntries(const ProgramState& state, BlockList& res, const std::vector<Label>& referencedLabels)
+    {
+        const auto numBlocks = static_cast<uint32_t>(res.blocks.size());
+
+        std::vector<uint8_t> isEntry(numBlocks, 0);
+        for (uint32_t i = 0; i < numBlocks; ++i)
+        {
+            if (i == 0 || res.blocks[i].head->holds<Section>())
+                isEntry[i] = 1;
+        }
+        for (const auto& label : referencedLabels)
+        {
+            if (const auto blockIdx = getLabelBlock(state, res, label); blockIdx != kInvalidBlock)
+                isEntry[blockIdx] = 1;
+        }
+
+        res.entries.clear();
+        for (uint32_t i = 0; i < numBlocks; ++i)
+        {
+            if (isEntry[i] != 0)
+                res.entries.push_back(i);
+        }
+    }
+
+    static void buildEdges(const ProgramState& state, BlockList& res)
+    {
+        auto& blocks = res.blocks;
+        const auto numBlocks = static_cast<uint32_t>(blocks.size());
+
+        for (uint32_t i = 0; i < numBlocks; ++i)
+        {
+            auto& block = blocks[i];
+            if (block.isData)
+                continue;
+
+            auto kind = BranchKind::None;
+            const auto* instr = block.tail->getIf<Instruction>();
+            if (instr != nullptr)
+                kind = getBranchKind(*instr);
+
+            if (kind == BranchKind::None || kind == BranchKind::Call || kind == BranchKind::Jcc)
+            {
+                // Sections may be placed anywhere, falling into one has no known successor.
+                const auto next = i + 1;
+                if (next < numBlocks && !blocks[next].isData && !blocks[next].head->holds<Section>())
+                    block.succs[0] = next;
+                else
+                    block.hasUnknownSucc = true;
+            }
+
+            if (kind == BranchKind::Jmp || kind == BranchKind::Jcc)
+            {
+                const auto target = getTargetBlock(state, res, *instr);
+                if (target != kInvalidBlock)
+                    block.succs[1] = target;
+                else
+                    block.hasUnknownSucc = true;
+            }
+            else if (kind == BranchKind::Exit)
+            {
+                block.hasUnknownSucc = true;
+            }
+        }
+
+        // Predecessors in compressed form.
+        res.predOffsets.assign(numBlocks + 1, 0);
+        for (const auto& block : blocks)
+        {
+            for (const auto succ : block.succs)
+            {
+                if (succ != kInvalidBlock)
+                    res.predOffsets[succ + 1]++;
+            }
+        }
+        for (uint32_t i = 0; i < numBlocks; ++i)
+        {
+            res.predOffsets[i + 1] += res.predOffsets[i];
+        }
+
+        res.preds.resize(res.predOffsets[numBlocks]);
+        std::vector<uint32_t> fill(res.predOffsets.begin(), res.predOffsets.end() - 1);
+        for (uint32_t i = 0; i < numBlocks; ++i)
+        {
+            for (const auto succ : blocks[i].succs)
+            {
+                if (succ != kInvalidBlock)
+                    res.preds[fill[succ]++] = i;
+            }
+        }
+    }
+
+    void buildBlocks(const Program& program, BlockList& res)
+    {
+        const auto& state = program.getState();
+
+        res.blocks.clear();
+        res.nodeBlock.assign(state.nextNodeId, kInvalidBlock);
+
+        std::vector<Label> referencedLabels;
+
+        BasicBlock* cur = nullptr;
+        bool hasCode = false;
+        bool isTerminated = false;
+
+        for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+        {
+            const auto* instr = node->getIf<Instruction>();
+            const bool isData = node->holds<Data>() || node->holds<EmbeddedLabel>();
+            const bool isBoundary = node->holds<Label>() || node->holds<Section>();
+
+            bool startNew = cur == nullptr || isTerminated;
+            if (!startNew)
+            {
+                if (isBoundary)
+                    startNew = hasCode || cur->isData;
+                else if (isData)
+                    startNew = hasCode;
+                else if (instr != nullptr)
+                    startNew = cur->isData;
+            }
+
+            if (startNew)
+            {
+                cur = &res.blocks.emplace_back();
+                cur->head = node;
+                hasCode = false;
+                isTerminated = false;
+            }
+
+            cur->tail = node;
+            res.nodeBlock[static_cast<size_t>(node->getId())] = static_cast<uint32_t>(res.blocks.size() - 1);
+
+            collectReferencedLabels(node, referencedLabels);
+
+            if (isData)
+            {
+                cur->isData = true;
+            }
+            else if (instr != nullptr)
+            {
+                hasCode = true;
+
+                const auto kind = getBranchKind(*instr);
+                isTerminated = kind == BranchKind::Jmp || kind == BranchKind::Jcc || kind == BranchKind::Exit;
+            }
+        }
+
+        buildEdges(state, res);
+        buildEntries(state, res, referencedLabels);
+    }
+
+} // namespace zasm::detail
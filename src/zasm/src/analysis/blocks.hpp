@@ -0,0 +1,50 @@
+#pragma once
+
+#include "zasm/analysis/basicblock.hpp"
+#include "zasm/program/program.hpp"
+
+#include <cstdint>
+#include <vector>
+
+namespace zasm::detail
+{
+    using analysis::BasicBlock;
+    using analysis::kInvalidBlock;
+
+    enum class BranchKind : uint8_t
+    {
+        None,
+        Jmp,
+        Jcc,
+        Call,
+        // Ends the flow without a known successor, ret, iret, sysret, ud2 and such.
+        Exit,
+    };
+
+    BranchKind getBranchKind(const Instruction& instr) noexcept;
+
+    // Partition of the program into basic blocks in list order.
+    struct BlockList
+    {
+        std::vector<BasicBlock> blocks;
+        // Block index per node id.
+        std::vector<uint32_t> nodeBlock;
+        // Predecessors of block i are preds[predOffsets[i]] to preds[predOffsets[i + 1]].
+        std::vector<uint32_t> predOffsets;
+        std::vector<uint32_t> preds;
+        // Blocks entered from outside of the known edges: the first block, sections and blocks whose
+        // label is used by anything else than a jump, such as calls, lea or embedded labels.
+        std::vector<uint32_t> entries;
+
+        uint32_t getBlock(const zasm::Node* node) const noexcept
+        {
+            const auto idx = static_cast<size_t>(node->getId());
+            if (idx >= nodeBlock.size())
+                return kInvalidBlock;
+            return nodeBlock[idx];
+        }
+    };
+
+    void buildBlocks(const Program& program, BlockList& res);
+
+} // namespace zasm::detail
@@ -0,0 +1,400 @@
+#include "zasm/analysis/controlflowgraph.hpp"
+
+#include "blocks.hpp"
+
+#include <algorithm>
+#include <cassert>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct ControlFlowGraphState
+        {
+            BlockList blockList;
+            // Immediate dominator per block, kInvalidBlock for entries and unreachable blocks.
+            std::vector<uint32_t> idom;
+            // Pre and post order numbers in the dominator tree, kInvalidBlock if unreachable.
+            std::vector<uint32_t> domPre;
+            std::vector<uint32_t> domPost;
+            std::vector<analysis::Loop> loops;
+            // Innermost loop per block.
+            std::vector<uint32_t> blockLoop;
+        };
+
+        // The entries are the successors of a virtual root with the index numBlocks.
+        static uint32_t getSucc(const BlockList& blockList, uint32_t blockIdx, size_t index) noexcept
+        {
+            if (blockIdx == blockList.blocks.size())
+                return blockList.entries[index];
+            return blockList.blocks[blockIdx].succs[index];
+        }
+
+        static size_t getSuccCount(const BlockList& blockList, uint32_t blockIdx) noexcept
+        {
+            if (blockIdx == blockList.blocks.size())
+                return blockList.entries.size();
+            return std::size(blockList.blocks[blockIdx].succs);
+        }
+
+        // Reverse post order of all blocks reachable from the virtual root, starting with the root.
+        static std::vector<uint32_t> computeReversePostOrder(const BlockList& blockList)
+        {
+            const auto root = static_cast<uint32_t>(blockList.blocks.size());
+
+            std::vector<uint32_t> order;
+            std::vector<uint8_t> isVisited(root + 1, 0);
+            std::vector<std::pair<uint32_t, size_t>> stack;
+
+            stack.emplace_back(root, 0);
+            isVisited[root] = 1;
+
+            while (!stack.empty())
+            {
+                auto& [blockIdx, succIdx] = stack.back();
+                if (succIdx == getSuccCount(blockList, blockIdx))
+                {
+                    order.push_back(blockIdx);
+                    stack.pop_back();
+                    continue;
+                }
+
+                const auto succ = getSucc(blockList, blockIdx, succIdx++);
+                if (succ != kInvalidBlock && isVisited[succ] == 0)
+                {
+                    isVisited[succ] = 1;
+                    stack.emplace_back(succ, 0);
+                }
+            }
+
+            std::reverse(order.begin(), order.end());
+            return order;
+        }
+
+        // Cooper, Harvey and Kennedy, "A Simple, Fast Dominance Algorithm".
+        static void computeDominators(ControlFlowGraphState& state)
+        {
+            const auto& blockList = state.blockList;
+            const auto root = static_cast<uint32_t>(blockList.blocks.size());
+
+            const auto order = computeReversePostOrder(blockList);
+
+            std::vector<uint32_t> orderIdx(root + 1, kInvalidBlock);
+            for (uint32_t i = 0; i < order.size(); ++i)
+            {
+                orderIdx[order[i]] = i;
+            }
+
+            std::vector<uint8_t> isEntry(root, 0);
+            for (const auto entry : blockList.entries)
+            {
+                isEntry[entry] = 1;
+            }
+
+            auto& idom = state.idom;
+            idom.assign(root + 1, kInvalidBlock);
+            idom[root] = root;
+
+            const auto intersect = [&](uint32_t a, uint32_t b) {
+                while (a != b)
+                {
+                    while (orderIdx[a] > orderIdx[b])
+                        a = idom[a];
+                    while (orderIdx[b] > orderIdx[a])
+                        b = idom[b];
+                }
+                return a;
+            };
+
+            bool changed = true;
+            while (changed)
+            {
+                changed = false;
+
+                for (size_t i = 1; i < order.size(); ++i)
+                {
+                    const auto blockIdx = order[i];
+
+                    auto newIdom = isEntry[blockIdx] != 0 ? root : kInvalidBlock;
+                    for (auto j = blockList.predOffsets[blockIdx]; j < blockList.predOffsets[blockIdx + 1]; ++j)
+                    {
+                        const auto pred = blockList.preds[j];
+                        if (idom[pred] == kInvalidBlock)
+                            continue;
+
+                        newIdom = newIdom == kInvalidBlock ? pred : intersect(pred, newIdom);
+                    }
+
+                    if (idom[blockIdx] != newIdom)
+                    {
+                        idom[blockIdx] = newIdom;
+                        changed = true;
+                    }
+                }
+            }
+
+            // Number the dominator tree so dominance queries are constant time.
+            std::vector<uint32_t> childOffsets(root + 2, 0);
+            for (uint32_t i = 0; i < root; ++i)
+            {
+                if (idom[i] != kInvalidBlock)
+                    childOffsets[idom[i] + 1]++;
+            }
+            for (uint32_t i = 0; i <= root; ++i)
+            {
+                childOffsets[i + 1] += childOffsets[i];
+            }
+
+            std::vector<uint32_t> children(childOffsets[root + 1]);
+            std::vector<uint32_t> fill(childOffsets.begin(), childOffsets.end() - 1);
+            for (uint32_t i = 0; i < root; ++i)
+            {
+                if (idom[i] != kInvalidBlock)
+                    children[fill[idom[i]]++] = i;
+            }
+
+            state.domPre.assign(root + 1, kInvalidBlock);
+            state.domPost.assign(root + 1, kInvalidBlock);
+
+            uint32_t preCounter = 0;
+            uint32_t postCounter = 0;
+            std::vector<std::pair<uint32_t, uint32_t>> stack;
+            stack.emplace_back(root, childOffsets[root]);
+            state.domPre[root] = preCounter++;
+
+            while (!stack.empty())
+            {
+                auto& [blockIdx, childIdx] = stack.back();
+                if (childIdx == childOffsets[blockIdx + 1])
+                {
+                    state.domPost[blockIdx] = postCounter++;
+                    stack.pop_back();
+                    continue;
+                }
+
+                const auto child = children[childIdx++];
+                state.domPre[child] = preCounter++;
+                stack.emplace_back(child, childOffsets[child]);
+            }
+
+            // The virtual root is not exposed.
+            for (auto& blockIdom : idom)
+            {
+                if (blockIdom == root)
+                    blockIdom = kInvalidBlock;
+            }
+        }
+
+        static bool dominates(const ControlFlowGraphState& state, uint32_t blockA, uint32_t blockB) noexcept
+        {
+            if (state.domPre[blockA] == kInvalidBlock || state.domPre[blockB] == kInvalidBlock)
+                return false;
+
+            return state.domPre[blockA] <= state.domPre[blockB] && state.domPost[blockB] <= state.domPost[blockA];
+        }
+
+        // Natural loops, headers are visited in reverse dominator tree pre order so inner loops are
+        // found before the loops containing them.
+        static void computeLoops(ControlFlowGraphState& state)
+        {
+            const auto& blockList = state.blockList;
+            const auto numBlocks = static_cast<uint32_t>(blockList.blocks.size());
+
+            std::vector<uint32_t> domOrder(numBlocks + 1, kInvalidBlock);
+            for (uint32_t i = 0; i < numBlocks; ++i)
+            {
+                if (state.domPre[i] != kInvalidBlock)
+                    domOrder[state.domPre[i]] = i;
+            }
+
+            state.loops.clear();
+            state.blockLoop.assign(numBlocks, analysis::kInvalidLoop);
+
+            std::vector<uint32_t> worklist;
+            for (auto it = domOrder.rbegin(); it != domOrder.rend(); ++it)
+            {
+                const auto header = *it;
+                if (header == kInvalidBlock)
+                    continue;
+
+                worklist.clear();
+                for (auto i = blockList.predOffsets[header]; i < blockList.predOffsets[header + 1]; ++i)
+                {
+                    const auto pred = blockList.preds[i];
+                    if (dominates(state, header, pred))
+                        worklist.push_back(pred);
+                }
+
+                if (worklist.empty())
+                    continue;
+
+                const auto loopIdx = static_cast<uint32_t>(state.loops.size());
+                state.loops.push_back(analysis::Loop{ header });
+                state.blockLoop[header] = loopIdx;
+
+                while (!worklist.empty())
+                {
+                    auto blockIdx = worklist.back();
+                    worklist.pop_back();
+
+                    if (blockIdx == header)
+                        continue;
+
+                    if (state.blockLoop[blockIdx] == analysis::kInvalidLoop)
+                    {
+                        state.blockLoop[blockIdx] = loopIdx;
+                    }
+                    else
+                    {
+                        // Part of an inner loop, continue with the predecessors of its outermost header.
+                        auto innerIdx = state.blockLoop[blockIdx];
+                        while (state.loops[innerIdx].parent != analysis::kInvalidLoop)
+                            innerIdx = state.loops[innerIdx].parent;
+
+                        if (innerIdx == loopIdx)
+                            continue;
+
+                        state.loops[innerIdx].parent = loopIdx;
+                        blockIdx = state.loops[innerIdx].header;
+                    }
+
+                    for (auto i = blockList.predOffsets[blockIdx]; i < blockList.predOffsets[blockIdx + 1]; ++i)
+                    {
+                        const auto pred = blockList.preds[i];
+                        if (state.domPre[pred] != kInvalidBlock)
+                            worklist.push_back(pred);
+                    }
+                }
+            }
+
+            // Parents are always found after their children.
+            for (auto it = state.loops.rbegin(); it != state.loops.rend(); ++it)
+            {
+                it->depth = it->parent == analysis::kInvalidLoop ? 1 : state.loops[it->parent].depth + 1;
+            }
+        }
+
+    } // namespace detail
+
+    namespace analysis
+    {
+        ControlFlowGraph::ControlFlowGraph()
+            : _state(new detail::ControlFlowGraphState())
+        {
+        }
+
+        ControlFlowGraph::~ControlFlowGraph()
+        {
+            delete _state;
+        }
+
+        Error ControlFlowGraph::build(const Program& program)
+        {
+            auto& state = *_state;
+
+            detail::buildBlocks(program, state.blockList);
+            detail::computeDominators(state);
+            detail::computeLoops(state);
+
+            return Error::None;
+        }
+
+        size_t ControlFlowGraph::getBlockCount() const noexcept
+        {
+            return _state->blockList.blocks.size();
+        }
+
+        const BasicBlock& ControlFlowGraph::getBlock(uint32_t blockIdx) const noexcept
+        {
+            assert(blockIdx < _state->blockList.blocks.size());
+            return _state->blockList.blocks[blockIdx];
+        }
+
+        uint32_t ControlFlowGraph::getBlockOf(const Node* node) const noexcept
+        {
+            if (node == nullptr)
+                return kInvalidBlock;
+            return _state->blockList.getBlock(node);
+        }
+
+        size_t ControlFlowGraph::getPredecessorCount(uint32_t blockIdx) const noexcept
+        {
+            const auto& blockList = _state->blockList;
+            if (blockIdx >= blockList.blocks.size())
+                return 0;
+            return blockList.predOffsets[blockIdx + 1] - blockList.predOffsets[blockIdx];
+        }
+
+        uint32_t ControlFlowGraph::getPredecessor(uint32_t blockIdx, size_t index) const noexcept
+        {
+            if (index >= getPredecessorCount(blockIdx))
+                return kInvalidBlock;
+            return _state->blockList.preds[_state->blockList.predOffsets[blockIdx] + index];
+        }
+
+        size_t ControlFlowGraph::getEntryCount() const noexcept
+        {
+            return _state->blockList.entries.size();
+        }
+
+        uint32_t ControlFlowGraph::getEntry(size_t index) const noexcept
+        {
+            if (index >= _state->blockList.entries.size())
+                return kInvalidBlock;
+            return _state->blockList.entries[index];
+        }
+
+        uint32_t ControlFlowGraph::getImmediateDominator(uint32_t blockIdx) const noexcept
+        {
+            if (blockIdx >= _state->blockList.blocks.size())
+                return kInvalidBlock;
+            return _state->idom[blockIdx];
+        }
+
+        bool ControlFlowGraph::dominates(uint32_t blockA, uint32_t blockB) const noexcept
+        {
+            const auto numBlocks = _state->blockList.blocks.size();
+            if (blockA >= numBlocks || blockB >= numBlocks)
+                return false;
+            return detail::dominates(*_state, blockA, blockB);
+        }
+
+        bool ControlFlowGraph::isReachable(uint32_t blockIdx) const noexcept
+        {
+            if (blockIdx >= _state->blockList.blocks.size())
+                return false;
+            return _state->domPre[blockIdx] != kInvalidBlock;
+        }
+
+        size_t ControlFlowGraph::getLoopCount() const noexcept
+        {
+            return _state->loops.size();
+        }
+
+        const Loop& ControlFlowGraph::getLoop(uint32_t loopIdx) const noexcept
+        {
+            assert(loopIdx < _state->loops.size());
+            return _state->loops[loopIdx];
+        }
+
+        uint32_t ControlFlowGraph::getLoopOf(uint32_t blockIdx) const noexcept
+        {
+            if (blockIdx >= _state->blockList.blocks.size())
+                return kInvalidLoop;
+            return _state->blockLoop[blockIdx];
+        }
+
+        uint32_t ControlFlowGraph::getLoopDepth(uint32_t blockIdx) const noexcept
+        {
+            const auto loopIdx = getLoopOf(blockIdx);
+            if (loopIdx == kInvalidLoop)
+                return 0;
+            return _state->loops[loopIdx].depth;
+        }
+
+    } // namespace analysis
+
+} // namespace zasm
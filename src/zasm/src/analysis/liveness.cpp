@@ -0,0 +1,338 @@
+#include "zasm/analysis/liveness.hpp"
+
+#include "blocks.hpp"
+
+#include <vector>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct LivenessState
+        {
+            ZydisMachineMode mode{};
+            BlockList blockList;
+            // Upward exposed uses and definitions per block.
+            std::vector<analysis::LiveSet> gen;
+            std::vector<analysis::LiveSet> kill;
+            std::vector<analysis::LiveSet> liveIn;
+        };
+
+    } // namespace detail
+
+    namespace analysis
+    {
+        static bool isTracked(const operands::Reg& reg) noexcept
+        {
+            if (!reg.isValid())
+                return false;
+
+            // Flags are tracked by the flag masks, the instruction pointer is never considered live.
+            const auto regClass = reg.getClass();
+            return regClass != ZYDIS_REGCLASS_FLAGS && regClass != ZYDIS_REGCLASS_IP;
+        }
+
+        static operands::Reg getKey(const operands::Reg& reg, ZydisMachineMode mode) noexcept
+        {
+            const auto root = reg.getRoot(mode);
+            return root.isValid() ? root : reg;
+        }
+
+        static bool isFullWrite(
+            const operands::Reg& reg, const operands::Reg& key, const Instruction& instr, ZydisMachineMode mode) noexcept
+        {
+            if (reg == key)
+                return true;
+
+            // 32 bit writes zero the upper half in 64 bit mode.
+            if (mode == ZYDIS_MACHINE_MODE_LONG_64 && reg.isGp32())
+                return true;
+
+            // VEX and EVEX encoded writes zero the upper part of the vector register.
+            const auto encoding = instr.getEncoding();
+            if ((reg.isXmm() || reg.isYmm())
+                && (encoding == Instruction::Encoding::VEX || encoding == Instruction::Encoding::EVEX))
+                return true;
+
+            return false;
+        }
+
+        static void addMemUse(RegAccess& res, const operands::Mem& mem, ZydisMachineMode mode) noexcept
+        {
+            for (const auto& reg : { operands::Reg(mem.getSegment()), mem.getBase(), mem.getIndex() })
+            {
+                if (isTracked(reg))
+                    res.use.add(getKey(reg, mode));
+            }
+        }
+
+        // xor reg, reg and similar produce zero regardless of the previous value, returns the register that is
+        // only read in appearance. Partial writes like xor al, al or legacy encoded pxor keep the rest of the old value.
+        static operands::Reg getZeroIdiomReg(const Instruction& instr, ZydisMachineMode mode) noexcept
+        {
+            size_t srcIndex = 0;
+            switch (instr.getId())
+            {
+                case ZYDIS_MNEMONIC_XOR:
+                case ZYDIS_MNEMONIC_SUB:
+                case ZYDIS_MNEMONIC_PXOR:
+                case ZYDIS_MNEMONIC_XORPS:
+                case ZYDIS_MNEMONIC_XORPD:
+                    break;
+                // The destination is separate, both sources have to be the same.
+                case ZYDIS_MNEMONIC_VPXOR:
+                case ZYDIS_MNEMONIC_VXORPS:
+                case ZYDIS_MNEMONIC_VXORPD:
+                    srcIndex = 1;
+                    break;
+                default:
+                    return {};
+            }
+
+            const auto* dst = instr.getOperandIf<operands::Reg>(0);
+            const auto* src0 = instr.getOperandIf<operands::Reg>(srcIndex);
+            const auto* src1 = instr.getOperandIf<operands::Reg>(srcIndex + 1);
+            if (dst == nullptr || src0 == nullptr || src1 == nullptr || *src0 != *src1)
+                return {};
+
+            if (!isFullWrite(*dst, getKey(*dst, mode), instr, mode))
+                return {};
+
+            return *src0;
+        }
+
+        RegAccess getRegAccess(const Instruction& instr, ZydisMachineMode mode) noexcept
+        {
+            RegAccess res;
+
+            const auto& ops = instr.getOperands();
+            const auto opCount = instr.getOperandCount();
+
+            if (!instr.hasMetaData())
+            {
+                for (size_t i = 0; i < opCount; ++i)
+                {
+                    if (const auto* reg = ops[i].getIf<operands::Reg>(); reg != nullptr && isTracked(*reg))
+                    {
+                        const auto key = getKey(*reg, mode);
+                        res.use.add(key);
+                        res.write.add(key);
+                    }
+                    else if (const auto* mem = ops[i].getIf<operands::Mem>(); mem != nullptr)
+                    {
+                        addMemUse(res, *mem, mode);
+                    }
+                }
+                res.flagsUse = kAllFlags;
+                return res;
+            }
+
+            const auto& access = instr.getAccess();
+            for (size_t i = 0; i < opCount; ++i)
+            {
+                if (const auto* reg = ops[i].getIf<operands::Reg>(); reg != nullptr)
+                {
+                    if (!isTracked(*reg))
+                        continue;
+
+                    const auto key = getKey(*reg, mode);
+                    if ((access[i] & (ZYDIS_OPERAND_ACTION_READ | ZYDIS_OPERAND_ACTION_CONDREAD)) != 0)
+                        res.use.add(key);
+
+                    if ((access[i] & (ZYDIS_OPERAND_ACTION_WRITE | ZYDIS_OPERAND_ACTION_CONDWRITE)) != 0)
+                        res.write.add(key);
+
+                    if ((access[i] & ZYDIS_OPERAND_ACTION_WRITE) != 0 && isFullWrite(*reg, key, instr, mode))
+                        res.def.add(key);
+                }
+                else if (const auto* mem = ops[i].getIf<operands::Mem>(); mem != nullptr)
+                {
+                    addMemUse(res, *mem, mode);
+                }
+            }
+
+            if (const auto zeroReg = getZeroIdiomReg(instr, mode); zeroReg.isValid())
+            {
+                res.use.remove(getKey(zeroReg, mode));
+            }
+
+            const auto& flags = instr.getFlags();
+            res.flagsUse = flags.read;
+            res.flagsDef = flags.write | flags.undefined;
+
+            // The callee is unknown, it may read anything.
+            if (detail::getBranchKind(instr) == detail::BranchKind::Call)
+            {
+                res.use = RegSet::all();
+                res.flagsUse = kAllFlags;
+            }
+
+            return res;
+        }
+
+        static LiveSet getAllLive() noexcept
+        {
+            return LiveSet{ RegSet::all(), kAllFlags };
+        }
+
+        static void transfer(LiveSet& live, const RegAccess& access) noexcept
+        {
+            live.regs -= access.def;
+            live.regs |= access.use;
+            live.flags &= ~access.flagsDef;
+            live.flags |= access.flagsUse;
+        }
+
+        static LiveSet getBlockLiveOut(const detail::LivenessState& state, uint32_t blockIdx) noexcept
+        {
+            const auto& block = state.blockList.blocks[blockIdx];
+            if (block.isData || block.hasUnknownSucc)
+                return getAllLive();
+
+            LiveSet res;
+            for (const auto succ : block.succs)
+            {
+                if (succ == detail::kInvalidBlock)
+                    continue;
+                res.regs |= state.liveIn[succ].regs;
+                res.flags |= state.liveIn[succ].flags;
+            }
+            return res;
+        }
+
+        Liveness::Liveness()
+            : _state(new detail::LivenessState())
+        {
+        }
+
+        Liveness::~Liveness()
+        {
+            delete _state;
+        }
+
+        Error Liveness::analyze(const Program& program)
+        {
+            auto& state = *_state;
+            state.mode = program.getMode();
+
+            auto& blockList = state.blockList;
+            detail::buildBlocks(program, blockList);
+
+            const auto numBlocks = static_cast<uint32_t>(blockList.blocks.size());
+            state.gen.assign(numBlocks, LiveSet{});
+            state.kill.assign(numBlocks, LiveSet{});
+            state.liveIn.assign(numBlocks, LiveSet{});
+
+            // Local uses and definitions, computed backwards through each block.
+            for (uint32_t i = 0; i < numBlocks; ++i)
+            {
+                const auto& block = blockList.blocks[i];
+                if (block.isData)
+                {
+                    state.liveIn[i] = getAllLive();
+                    continue;
+                }
+
+                auto& gen = state.gen[i];
+                auto& kill = state.kill[i];
+                for (const auto* node = block.tail;; node = node->getPrev())
+                {
+                    if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+                    {
+                        const auto access = getRegAccess(*instr, state.mode);
+                        transfer(gen, access);
+                        kill.regs |= access.def;
+                        kill.flags |= access.flagsDef;
+                    }
+                    if (node == block.head)
+                        break;
+                }
+            }
+
+            // Backward worklist, blocks are popped in reverse order first.
+            std::vector<uint32_t> worklist;
+            std::vector<uint8_t> isQueued(numBlocks, 1);
+            worklist.reserve(numBlocks);
+            for (uint32_t i = 0; i < numBlocks; ++i)
+            {
+                worklist.push_back(i);
+            }
+
+            while (!worklist.empty())
+            {
+                const auto blockIdx = worklist.back();
+                worklist.pop_back();
+                isQueued[blockIdx] = 0;
+
+                if (blockList.blocks[blockIdx].isData)
+                    continue;
+
+                auto live = getBlockLiveOut(state, blockIdx);
+                live.regs -= state.kill[blockIdx].regs;
+                live.regs |= state.gen[blockIdx].regs;
+                live.flags &= ~state.kill[blockIdx].flags;
+                live.flags |= state.gen[blockIdx].flags;
+
+                if (live == state.liveIn[blockIdx])
+                    continue;
+
+                state.liveIn[blockIdx] = live;
+
+                for (auto i = blockList.predOffsets[blockIdx]; i < blockList.predOffsets[blockIdx + 1]; ++i)
+                {
+                    const auto pred = blockList.preds[i];
+                    if (isQueued[pred] == 0)
+                    {
+                        isQueued[pred] = 1;
+                        worklist.push_back(pred);
+                    }
+                }
+            }
+
+            return Error::None;
+        }
+
+        LiveSet Liveness::getLiveOut(const Node* node) const noexcept
+        {
+            const auto& state = *_state;
+            if (node == nullptr)
+                return getAllLive();
+
+            const auto blockIdx = state.blockList.getBlock(node);
+            if (blockIdx == detail::kInvalidBlock)
+                return getAllLive();
+
+            auto live = getBlockLiveOut(state, blockIdx);
+            for (const auto* cur = state.blockList.blocks[blockIdx].tail; cur != node; cur = cur->getPrev())
+            {
+                if (const auto* instr = cur->getIf<Instruction>(); instr != nullptr)
+                {
+                    transfer(live, getRegAccess(*instr, state.mode));
+                }
+            }
+
+            return live;
+        }
+
+        LiveSet Liveness::getLiveIn(const Node* node) const noexcept
+        {
+            auto live = getLiveOut(node);
+            if (node == nullptr)
+                return live;
+
+            if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+            {
+                transfer(live, getRegAccess(*instr, _state->mode));
+            }
+
+            return live;
+        }
+
+        size_t Liveness::getBlockCount() const noexcept
+        {
+            return _state->blockList.blocks.size();
+        }
+
+    } // namespace analysis
+
+} // namespace zasm
@@ -1,10 +1,177 @@
 #include "zasm/assembler/assembler.hpp"
 
 #include "../encoder/generator.hpp"
+#include "zasm/assembler/codestream.hpp"
 #include "zasm/program/program.hpp"
 
+#include <algorithm>
+#include <array>
+#include <iterator>
+
 namespace zasm
 {
+    // Physical registers standing in for virtual registers while generating, they encode like any
+    // other register of their group and are never implicit operands in 64 bit mode.
+    static constexpr int8_t kPlaceholders64[] = { 8, 9, 10, 11, 14, 15 };
+    // Encodable without REX, used outside of 64 bit mode and next to ah, ch, dh and bh. Only the
+    // first three have an 8 bit register in that case.
+    static constexpr int8_t kPlaceholders32[] = { 1, 2, 3, 6, 7 };
+    static constexpr int8_t kNumPlaceholders8NoRex = 3;
+
+    struct VirtualRegSubst
+    {
+        std::array<uint32_t, std::size(kPlaceholders64)> virtIndex{};
+        std::array<int8_t, std::size(kPlaceholders64)> physIndex{};
+        size_t count{};
+        uint32_t usedMask{};
+        // A high byte register is used, placeholders must not require REX.
+        bool noRex{};
+    };
+
+    static operands::Reg toPhysical(const operands::Reg& reg, int8_t physIndex) noexcept
+    {
+        const operands::Gp root(static_cast<ZydisRegister>(ZYDIS_REGISTER_RAX + physIndex));
+        switch (reg.getClass())
+        {
+            case ZYDIS_REGCLASS_GPR8:
+                return root.r8();
+            case ZYDIS_REGCLASS_GPR16:
+                return root.r16();
+            case ZYDIS_REGCLASS_GPR32:
+                return root.r32();
+            default:
+                return root.r64();
+        }
+    }
+
+    static operands::Mem replaceMemRegs(const operands::Mem& mem, const operands::Reg& base, const operands::Reg& index) noexcept
+    {
+        if (mem.hasLabel())
+        {
+            return operands::Mem(
+                mem.getBitSize(), mem.getSegment(), mem.getLabel(), base, index, mem.getScale(), mem.getDisplacement());
+        }
+        return operands::Mem(mem.getBitSize(), mem.getSegment(), base, index, mem.getScale(), mem.getDisplacement());
+    }
+
+    static void markUsed(VirtualRegSubst& subst, const operands::Reg& reg) noexcept
+    {
+        if (reg.isGp() && !reg.isVirtual())
+            subst.usedMask |= 1u << reg.getPhysicalIndex();
+        if (reg.isGp8Hi())
+            subst.noRex = true;
+    }
+
+    static operands::Reg substitute(VirtualRegSubst& subst, ZydisMachineMode mode, const operands::Reg& reg) noexcept
+    {
+        if (!reg.isVirtual())
+            return reg;
+
+        const auto virtIndex = reg.getVirtualIndex();
+        for (size_t i = 0; i < subst.count; i++)
+        {
+            if (subst.virtIndex[i] == virtIndex)
+                return toPhysical(reg, subst.physIndex[i]);
+        }
+
+        const auto* first = std::begin(kPlaceholders64);
+        const auto* last = std::end(kPlaceholders64);
+        if (mode != ZYDIS_MACHINE_MODE_LONG_64 || subst.noRex)
+        {
+            first = std::begin(kPlaceholders32);
+            last = reg.getClass() == ZYDIS_REGCLASS_GPR8 ? first + kNumPlaceholders8NoRex : std::end(kPlaceholders32);
+        }
+        for (const auto* it = first; it != last; ++it)
+        {
+            if ((subst.usedMask & (1u << *it)) != 0)
+                continue;
+
+            subst.usedMask |= 1u << *it;
+            subst.virtIndex[subst.count] = virtIndex;
+            subst.physIndex[subst.count] = *it;
+            subst.count++;
+            return toPhysical(reg, *it);
+        }
+
+        // Out of placeholders.
+        return operands::Reg{};
+    }
+
+    // Replaces virtual registers in the explicit operands, returns false if there are more distinct
+    // virtual registers than placeholders.
+    static bool substituteVirtualRegs(
+        ZydisMachineMode mode, size_t numOps, std::array<Operand, ZYDIS_ENCODER_MAX_OPERANDS>& ops) noexcept
+    {
+        VirtualRegSubst subst;
+        for (size_t i = 0; i < numOps; i++)
+        {
+            if (const auto* reg = ops[i].getIf<operands::Reg>(); reg != nullptr)
+            {
+                markUsed(subst, *reg);
+            }
+            else if (const auto* mem = ops[i].getIf<operands::Mem>(); mem != nullptr)
+            {
+                markUsed(subst, mem->getBase());
+                markUsed(subst, mem->getIndex());
+            }
+        }
+
+        for (size_t i = 0; i < numOps; i++)
+        {
+            if (const auto* reg = ops[i].getIf<operands::Reg>(); reg != nullptr && reg->isVirtual())
+            {
+                const auto newReg = substitute(subst, mode, *reg);
+                if (!newReg.isValid())
+                    return false;
+                ops[i] = newReg;
+            }
+            else if (const auto* mem = ops[i].getIf<operands::Mem>();
+                     mem != nullptr && (mem->getBase().isVirtual() || mem->getIndex().isVirtual()))
+            {
+                const auto newBase = substitute(subst, mode, mem->getBase());
+                const auto newIndex = substitute(subst, mode, mem->getIndex());
+                if (newBase.isValid() != mem->getBase().isValid() || newIndex.isValid() != mem->getIndex().isValid())
+                    return false;
+                ops[i] = replaceMemRegs(*mem, newBase, newIndex);
+            }
+        }
+
+        return true;
+    }
+
+    static bool hasVirtualRegs(size_t numOps, const std::array<Operand, ZYDIS_ENCODER_MAX_OPERANDS>& ops) noexcept
+    {
+        for (size_t i = 0; i < numOps; i++)
+        {
+            if (const auto* reg = ops[i].getIf<operands::Reg>(); reg != nullptr && reg->isVirtual())
+                return true;
+            if (const auto* mem = ops[i].getIf<operands::Mem>();
+                mem != nullptr && (mem->getBase().isVirtual() || mem->getIndex().isVirtual()))
+                return true;
+        }
+        return false;
+    }
+
+    // Puts the virtual registers back into the generated operands.
+    static void restoreVirtualRegs(
+        size_t numOps, const std::array<Operand, ZYDIS_ENCODER_MAX_OPERANDS>& virtOps, Instruction::Operands& instrOps) noexcept
+    {
+        for (size_t i = 0; i < numOps; i++)
+        {
+            if (const auto* reg = virtOps[i].getIf<operands::Reg>(); reg != nullptr && reg->isVirtual())
+            {
+                instrOps[i] = *reg;
+            }
+            else if (const auto* mem = virtOps[i].getIf<operands::Mem>(); mem != nullptr)
+            {
+                if (const auto* instrMem = instrOps[i].getIf<operands::Mem>(); instrMem != nullptr)
+                {
+                    instrOps[i] = replaceMemRegs(*instrMem, mem->getBase(), mem->getIndex());
+                }
+            }
+        }
+    }
+
     Assembler::Assembler(Program& program)
         : _program(program)
         , _generator(new InstrGenerator(program.getMode()))
@@ -26,13 +193,74 @@ namespace zasm
         return _cursor;
     }
 
+    Assembler::GeneratorStats Assembler::getGeneratorStats() const noexcept
+    {
+        return { _generator->getCacheHits(), _generator->getCacheMisses() };
+    }
+
+    void Assembler::setRecordOnly(bool enable) noexcept
+    {
+        _recordOnly = enable;
+    }
+
+    bool Assembler::isRecordOnly() const noexcept
+    {
+        return _recordOnly;
+    }
+
+    Error Assembler::setStream(CodeStream* stream) noexcept
+    {
+        if (stream != nullptr && stream->getMode() != _program.getMode())
+        {
+            return Error::InvalidMode;
+        }
+
+        _stream = stream;
+
+        return Error::None;
+    }
+
+    CodeStream* Assembler::getStream() const noexcept
+    {
+        return _stream;
+    }
+
     Label Assembler::createLabel(const char* name /*= nullptr*/)
     {
         return _program.createLabel(name);
     }
 
+    operands::Gp8 Assembler::createVirtualGp8()
+    {
+        auto reg = _program.createVirtualGp(BitSize::_8);
+        return reg.as<operands::Gp8>();
+    }
+
+    operands::Gp16 Assembler::createVirtualGp16()
+    {
+        auto reg = _program.createVirtualGp(BitSize::_16);
+        return reg.as<operands::Gp16>();
+    }
+
+    operands::Gp32 Assembler::createVirtualGp32()
+    {
+        auto reg = _program.createVirtualGp(BitSize::_32);
+        return reg.as<operands::Gp32>();
+    }
+
+    operands::Gp64 Assembler::createVirtualGp64()
+    {
+        auto reg = _program.createVirtualGp(BitSize::_64);
+        return reg.as<operands::Gp64>();
+    }
+
     Error Assembler::bind(const Label& label)
     {
+        if (_stream != nullptr)
+        {
+            return _stream->bind(label);
+        }
+
         auto labelNode = _program.bindLabel(label);
         if (!labelNode)
         {
@@ -47,6 +275,11 @@ namespace zasm
     Error Assembler::section(
         const char* name, Section::Attribs attribs /*= Section::Attribs::Code*/, int32_t align /*= 0x1000*/)
     {
+        if (_stream != nullptr)
+        {
+            return Error::InvalidOperation;
+        }
+
         auto newSect = _program.createSection(name, attribs, align);
 
         auto sectNode = _program.bindSection(newSect);
@@ -60,6 +293,24 @@ namespace zasm
         return Error::None;
     }
 
+    Error Assembler::align(int32_t align, Align::Type type /*= Align::Type::Code*/)
+    {
+        if (align <= 0 || (align & (align - 1)) != 0)
+        {
+            return Error::InvalidParameter;
+        }
+
+        if (_stream != nullptr)
+        {
+            return _stream->align(align, type);
+        }
+
+        auto* node = _program.createNode(Align(type, align));
+        _cursor = _program.insertAfter(_cursor, node);
+
+        return Error::None;
+    }
+
     Error Assembler::db(uint8_t val)
     {
         return embed(&val, sizeof(val));
@@ -82,6 +333,11 @@ namespace zasm
 
     Error Assembler::embed(const void* ptr, size_t len)
     {
+        if (_stream != nullptr)
+        {
+            return _stream->embed(ptr, len);
+        }
+
         auto data = _program.createData(ptr, len);
 
         auto* dataNode = _program.createNode(std::move(data));
@@ -93,20 +349,94 @@ namespace zasm
     Error Assembler::emit_(
         Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps, std::array<Operand, ZYDIS_ENCODER_MAX_OPERANDS>&& ops)
     {
-        auto genResult = _generator->generate(attribs, id, numOps, std::move(ops));
+        // Streaming encodes directly into the CodeStream, no nodes are created.
+        if (_stream != nullptr)
+        {
+            return _stream->emit(attribs, id, numOps, ops);
+        }
+
+        if (_recordOnly)
+        {
+            Instruction::Operands instrOps{};
+            for (size_t i = 0; i < numOps && i < ops.size(); i++)
+            {
+                instrOps[i] = std::move(ops[i]);
+            }
+
+            auto* instrNode = _program.createNode(attribs, id, numOps, instrOps);
+            _cursor = _program.insertAfter(_cursor, instrNode);
+
+            return Error::None;
+        }
+
+        // The generator writes the operands here, the node is constructed in place from the generated
+        // form and the operands.
+        Instruction::Operands instrOps;
+
+        // Virtual registers can not be encoded, the instruction is generated with physical placeholders
+        // and the virtual registers are put back afterwards.
+        const bool hasVirtual = hasVirtualRegs(numOps, ops);
+        std::array<Operand, ZYDIS_ENCODER_MAX_OPERANDS> virtOps;
+        if (hasVirtual)
+        {
+            virtOps = ops;
+            if (!substituteVirtualRegs(_program.getMode(), numOps, ops))
+            {
+                return Error::InvalidOperation;
+            }
+        }
+
+        auto genResult = _generator->generate(attribs, id, numOps, std::move(ops), instrOps);
         if (!genResult)
         {
             return genResult.error();
         }
 
-        auto* instrNode = _program.createNode(std::move(*genResult));
+        if (hasVirtual)
+        {
+            restoreVirtualRegs(numOps, virtOps, instrOps);
+        }
+
+        auto* instrNode = _program.createNode(**genResult, instrOps);
         _cursor = _program.insertAfter(_cursor, instrNode);
 
         return Error::None;
     }
 
+    Error Assembler::emit(Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps, const Operand* ops)
+    {
+        if (numOps > ZYDIS_ENCODER_MAX_OPERANDS)
+        {
+            return Error::InvalidParameter;
+        }
+
+        std::array<Operand, ZYDIS_ENCODER_MAX_OPERANDS> operands{};
+        for (size_t i = 0; i < numOps; i++)
+        {
+            operands[i] = ops[i];
+        }
+
+        attribs = attribs | _attribState;
+        _attribState = Instruction::Attribs::None;
+
+        return emit_(attribs, id, numOps, std::move(operands));
+    }
+
     Error Assembler::fromInstruction(const Instruction& instr)
     {
+        if (_stream != nullptr)
+        {
+            EncoderOperands ops{};
+            size_t numOps = 0;
+            for (size_t i = 0; i < std::min<size_t>(instr.getOperandCount(), ops.size()); i++)
+            {
+                if (instr.isOperandHidden(i) || instr.getOperand(i).holds<operands::None>())
+                    break;
+                ops[numOps++] = instr.getOperand(i);
+            }
+            return _stream->emit(instr.getAttribs(), instr.getId(), numOps, ops);
+        }
+
         auto* instrNode = _program.createNode(instr);
         _cursor = _program.insertAfter(_cursor, instrNode);
 
@@ -131,6 +461,11 @@ namespace zasm
             return Error::InvalidMode;
         }
 
+        if (_stream != nullptr)
+        {
+            return _stream->embedLabel(label, size);
+        }
+
         auto* node = _program.createNode(EmbeddedLabel(label, size));
         _cursor = _program.insertAfter(_cursor, node);
 
@@ -139,6 +474,11 @@ namespace zasm
 
     Error Assembler::embedLabelRel(Label label, Label relativeTo, BitSize size)
     {
+        if (_stream != nullptr)
+        {
+            return _stream->embedLabelRel(label, relativeTo, size);
+        }
+
         auto* node = _program.createNode(EmbeddedLabel(label, relativeTo, size));
         _cursor = _program.insertAfter(_cursor, node);
 
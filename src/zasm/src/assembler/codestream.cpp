@@ -0,0 +1,431 @@
+#include "zasm/assembler/codestream.hpp"
+
+#include "../encoder/encoder.context.hpp"
+#include "zasm/core/math.hpp"
+
+#include <Zydis/Decoder.h>
+#include <cstring>
+#include <limits>
+#include <vector>
+
+namespace zasm
+{
+    namespace detail
+    {
+        // A location in the code that refers to a label which was not bound when it was emitted.
+        struct CodeStreamFixup
+        {
+            size_t offset{};
+            uint8_t size{};
+            // Relative fields are signed, absolute fields and data may also be unsigned.
+            bool isRelative{};
+            Label::Id label{ Label::Id::Invalid };
+            Label::Id relativeTo{ Label::Id::Invalid };
+            int64_t addend{};
+            // Next fixup waiting for the same label, -1 ends the list.
+            int32_t next{ -1 };
+        };
+
+        struct CodeStreamState
+        {
+            ZydisMachineMode mode{};
+            int64_t base{};
+            std::vector<uint8_t> code;
+            EncoderContext ctx;
+            ZydisDecoder decoder{};
+            std::vector<CodeStreamFixup> fixups;
+            // Head of the fixup list per label, indexed by the label id.
+            std::vector<int32_t> fixupHeads;
+            size_t unresolvedCount{};
+        };
+
+    } // namespace detail
+
+    CodeStream::CodeStream(ZydisMachineMode mode, int64_t base)
+        : _state(new detail::CodeStreamState())
+    {
+        _state->mode = mode;
+        _state->base = base;
+        _state->ctx.baseVA = base;
+
+        switch (mode)
+        {
+            case ZYDIS_MACHINE_MODE_LONG_64:
+                ZydisDecoderInit(&_state->decoder, mode, ZydisStackWidth::ZYDIS_STACK_WIDTH_64);
+                break;
+            case ZYDIS_MACHINE_MODE_LONG_COMPAT_32:
+            case ZYDIS_MACHINE_MODE_LEGACY_32:
+                ZydisDecoderInit(&_state->decoder, mode, ZydisStackWidth::ZYDIS_STACK_WIDTH_32);
+                break;
+            case ZYDIS_MACHINE_MODE_LONG_COMPAT_16:
+            case ZYDIS_MACHINE_MODE_LEGACY_16:
+            case ZYDIS_MACHINE_MODE_REAL_16:
+                ZydisDecoderInit(&_state->decoder, mode, ZydisStackWidth::ZYDIS_STACK_WIDTH_16);
+                break;
+            default:
+                break;
+        }
+    }
+
+    CodeStream::~CodeStream()
+    {
+        delete _state;
+    }
+
+    ZydisMachineMode CodeStream::getMode() const noexcept
+    {
+        return _state->mode;
+    }
+
+    int64_t CodeStream::getBase() const noexcept
+    {
+        return _state->base;
+    }
+
+    int64_t CodeStream::getAddress() const noexcept
+    {
+        return _state->base + static_cast<int64_t>(_state->code.size());
+    }
+
+    const uint8_t* CodeStream::getCode() const noexcept
+    {
+        return _state->code.data();
+    }
+
+    size_t CodeStream::getCodeSize() const noexcept
+    {
+        return _state->code.size();
+    }
+
+    int64_t CodeStream::getLabelAddress(Label::Id labelId) const noexcept
+    {
+        const auto labelIdx = static_cast<size_t>(labelId);
+        if (labelId == Label::Id::Invalid || labelIdx >= _state->ctx.labelLinks.size())
+        {
+            return -1;
+        }
+        return _state->ctx.labelLinks[labelIdx].boundVA;
+    }
+
+    size_t CodeStream::getUnresolvedCount() const noexcept
+    {
+        return _state->unresolvedCount;
+    }
+
+    void CodeStream::clear() noexcept
+    {
+        _state->code.clear();
+        _state->ctx.labelLinks.clear();
+        _state->fixups.clear();
+        _state->fixupHeads.clear();
+        _state->unresolvedCount = 0;
+    }
+
+    static void addFixup(detail::CodeStreamState& state, Label::Id waitingFor, detail::CodeStreamFixup&& fixup)
+    {
+        const auto labelIdx = static_cast<size_t>(waitingFor);
+        if (labelIdx >= state.fixupHeads.size())
+        {
+            state.fixupHeads.resize(labelIdx + 1, -1);
+        }
+
+        fixup.next = state.fixupHeads[labelIdx];
+        state.fixupHeads[labelIdx] = static_cast<int32_t>(state.fixups.size());
+        state.fixups.push_back(fixup);
+    }
+
+    static bool isInRange(int64_t value, uint8_t size, bool isRelative) noexcept
+    {
+        if (size >= 8)
+            return true;
+
+        const auto numBits = size * 8;
+        if (isRelative)
+        {
+            const auto limit = int64_t{ 1 } << (numBits - 1);
+            return value >= -limit && value < limit;
+        }
+
+        // Same as the Serializer for embedded labels.
+        const auto absValue = value < 0 ? -value : value;
+        return absValue < static_cast<int64_t>((uint64_t{ 1 } << numBits) - 1);
+    }
+
+    static Error writeValue(detail::CodeStreamState& state, size_t offset, uint8_t size, bool isRelative, int64_t value)
+    {
+        if (!isInRange(value, size, isRelative))
+        {
+            return Error::InvalidLabel;
+        }
+
+        // Little endian, truncated to the size of the field.
+        for (uint8_t i = 0; i < size; ++i)
+        {
+            state.code[offset + i] = static_cast<uint8_t>(static_cast<uint64_t>(value) >> (i * 8));
+        }
+
+        return Error::None;
+    }
+
+    // Patches the fixup if all labels are bound, otherwise it waits for the missing label.
+    static Error resolveFixup(CodeStream& stream, detail::CodeStreamState& state, detail::CodeStreamFixup&& fixup)
+    {
+        const auto labelVA = stream.getLabelAddress(fixup.label);
+        if (labelVA == -1)
+        {
+            addFixup(state, fixup.label, std::move(fixup));
+            return Error::None;
+        }
+
+        int64_t value = labelVA + fixup.addend;
+        if (fixup.relativeTo != Label::Id::Invalid)
+        {
+            const auto relativeVA = stream.getLabelAddress(fixup.relativeTo);
+            if (relativeVA == -1)
+            {
+                addFixup(state, fixup.relativeTo, std::move(fixup));
+                return Error::None;
+            }
+            value -= relativeVA;
+        }
+
+        state.unresolvedCount--;
+        return writeValue(state, fixup.offset, fixup.size, fixup.isRelative, value);
+    }
+
+    // Placeholder that only fits the 64 bit immediate form.
+    static constexpr int64_t kUnboundAbsLabel64Value = int64_t{ 0x123456 } << 32;
+
+    // mov r64, label is the only instruction that can take the absolute address of a label as an immediate
+    // and has a form that is wider than 32 bits.
+    static bool isUnboundAbsLabel64(
+        const CodeStream& stream, ZydisMachineMode mode, ZydisMnemonic id, size_t numOps,
+        const EncoderOperands& operands) noexcept
+    {
+        if (mode != ZYDIS_MACHINE_MODE_LONG_64 || id != ZYDIS_MNEMONIC_MOV || numOps != 2)
+            return false;
+
+        const auto* dst = operands[0].getIf<operands::Reg>();
+        const auto* label = operands[1].getIf<operands::Label>();
+        if (dst == nullptr || label == nullptr || !dst->isGp64())
+            return false;
+
+        return stream.getLabelAddress(label->getId()) == -1;
+    }
+
+    Error CodeStream::emit(
+        Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps, const EncoderOperands& operands) noexcept
+    {
+        auto& state = *_state;
+        auto& ctx = state.ctx;
+
+        const auto offset = state.code.size();
+        const auto address = getAddress();
+
+        ctx.va = address;
+        ctx.offset = static_cast<int32_t>(offset);
+        ctx.needsExtraPass = false;
+
+        EncoderResult res{};
+        if (isUnboundAbsLabel64(*this, state.mode, id, numOps, operands))
+        {
+            // There is no later pass that could widen the field once the label is bound, reserve
+            // the imm64 form up front so the label can be bound anywhere in the address space.
+            auto wideOps = operands;
+            wideOps[1] = operands::Imm(kUnboundAbsLabel64Value);
+
+            if (auto err = encodeFull(res, ctx, state.mode, attribs, id, numOps, wideOps); err != Error::None)
+            {
+                return err;
+            }
+            ctx.needsExtraPass = true;
+        }
+        else if (auto err = encodeFull(res, ctx, state.mode, attribs, id, numOps, operands); err != Error::None)
+        {
+            return err;
+        }
+
+        state.code.insert(state.code.end(), res.data.begin(), res.data.begin() + res.length);
+
+        // The encoder flags the use of labels that are not bound yet, only those instructions
+        // are decoded to locate the field that has to be patched.
+        if (!ctx.needsExtraPass)
+        {
+            return Error::None;
+        }
+
+        ZydisDecodedOperand instrOps[ZYDIS_MAX_OPERAND_COUNT];
+        ZydisDecodedInstruction instr;
+
+        const auto decodeStatus = ZydisDecoderDecodeFull(
+            &state.decoder, state.code.data() + offset, res.length, &instr, instrOps,
+            static_cast<ZyanU8>(std::size(instrOps)), 0);
+        if (ZYAN_FAILED(decodeStatus))
+        {
+            return Error::InvalidInstruction;
+        }
+
+        const auto endAddress = address + res.length;
+        for (size_t i = 0; i < numOps && i < operands.size(); ++i)
+        {
+            const auto& op = operands[i];
+
+            detail::CodeStreamFixup fixup{};
+            if (const auto* label = op.getIf<operands::Label>(); label != nullptr)
+            {
+                if (getLabelAddress(label->getId()) != -1)
+                    continue;
+
+                fixup.label = label->getId();
+                fixup.offset = offset + instr.raw.imm[0].offset;
+                fixup.size = static_cast<uint8_t>(instr.raw.imm[0].size / 8);
+                fixup.isRelative = instr.raw.imm[0].is_relative;
+                fixup.addend = fixup.isRelative ? -endAddress : 0;
+            }
+            else if (const auto* mem = op.getIf<operands::Mem>(); mem != nullptr && mem->hasLabel())
+            {
+                if (getLabelAddress(mem->getLabelId()) != -1)
+                    continue;
+
+                const bool isRipRel = state.mode == ZYDIS_MACHINE_MODE_LONG_64
+                    && (mem->getBase().getId() == ZYDIS_REGISTER_RIP
+                        || (!mem->getBase().isValid() && !mem->getIndex().isValid()));
+
+                fixup.label = mem->getLabelId();
+                fixup.offset = offset + instr.raw.disp.offset;
+                fixup.size = static_cast<uint8_t>(instr.raw.disp.size / 8);
+                fixup.isRelative = isRipRel;
+                fixup.addend = isRipRel ? mem->getDisplacement() - endAddress : mem->getDisplacement();
+            }
+            else
+            {
+                continue;
+            }
+
+            if (fixup.size == 0)
+            {
+                return Error::ImpossibleInstruction;
+            }
+
+            state.unresolvedCount++;
+            addFixup(state, fixup.label, std::move(fixup));
+        }
+
+        return Error::None;
+    }
+
+    Error CodeStream::embed(const void* data, size_t len)
+    {
+        const auto* ptr = static_cast<const uint8_t*>(data);
+        _state->code.insert(_state->code.end(), ptr, ptr + len);
+
+        return Error::None;
+    }
+
+    Error CodeStream::align(int32_t align, Align::Type type)
+    {
+        if (align <= 0 || (align & (align - 1)) != 0)
+        {
+            return Error::InvalidParameter;
+        }
+
+        const auto address = getAddress();
+        const auto padding = static_cast<size_t>(math::alignTo<int64_t>(address, align) - address);
+
+        auto& code = _state->code;
+        const auto oldSize = code.size();
+        code.resize(oldSize + padding);
+        encodePadding(code.data() + oldSize, padding, _state->mode, type);
+
+        return Error::None;
+    }
+
+    Error CodeStream::embedLabel(Label label, BitSize size)
+    {
+        return embedLabelRel(label, Label{}, size);
+    }
+
+    Error CodeStream::embedLabelRel(Label label, Label relativeTo, BitSize size)
+    {
+        if (!label.isValid())
+        {
+            return Error::InvalidLabel;
+        }
+
+        uint8_t byteSize = 0;
+        switch (size)
+        {
+            case BitSize::_8:
+                byteSize = 1;
+                break;
+            case BitSize::_16:
+                byteSize = 2;
+                break;
+            case BitSize::_32:
+                byteSize = 4;
+                break;
+            case BitSize::_64:
+                byteSize = 8;
+                break;
+            default:
+                return Error::InvalidOperation;
+        }
+
+        auto& state = *_state;
+
+        detail::CodeStreamFixup fixup{};
+        fixup.offset = state.code.size();
+        fixup.size = byteSize;
+        fixup.label = label.getId();
+        fixup.relativeTo = relativeTo.getId();
+
+        state.code.resize(state.code.size() + byteSize);
+
+        state.unresolvedCount++;
+        return resolveFixup(*this, state, std::move(fixup));
+    }
+
+    Error CodeStream::bind(Label label)
+    {
+        if (!label.isValid())
+        {
+            return Error::InvalidLabel;
+        }
+
+        auto& state = *_state;
+
+        auto& labelLink = state.ctx.getOrCreateLabelLink(label.getId());
+        if (labelLink.boundVA != -1)
+        {
+            return Error::LabelAlreadyBound;
+        }
+
+        labelLink.boundOffset = static_cast<int32_t>(state.code.size());
+        labelLink.boundVA = getAddress();
+
+        const auto labelIdx = static_cast<size_t>(label.getId());
+        if (labelIdx >= state.fixupHeads.size())
+        {
+            return Error::None;
+        }
+
+        // Detach the list first, fixups that still wait for another label are moved to its list.
+        auto fixupIdx = state.fixupHeads[labelIdx];
+        state.fixupHeads[labelIdx] = -1;
+
+        Error result = Error::None;
+        while (fixupIdx != -1)
+        {
+            auto fixup = state.fixups[fixupIdx];
+            fixupIdx = fixup.next;
+
+            if (auto err = resolveFixup(*this, state, std::move(fixup)); err != Error::None && result == Error::None)
+            {
+                result = err;
+            }
+        }
+
+        return result;
+    }
+
+} // namespace zasm
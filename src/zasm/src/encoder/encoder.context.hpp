@@ -34,6 +34,8 @@ namespace zasm
         int64_t va{};
         int32_t offset{};
         int32_t instrSize{};
+        // Set by the encoder if the encoding depends on instrSize, ex. rip-relative operands.
+        bool needsInstrSize{};
         int32_t drift{};
 
         struct LabelLink
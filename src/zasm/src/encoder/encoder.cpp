@@ -1,9 +1,11 @@
 #include "zasm/encoder/encoder.hpp"
+#include "zasm/encoder/direct.hpp"
 
 #include "encoder.context.hpp"
 
 #include <Zydis/Decoder.h>
 #include <Zydis/Encoder.h>
+#include <cstring>
 #include <limits>
 #include <optional>
 
@@ -22,7 +24,6 @@ namespace zasm
 
     // NOTE: This value has to be at least larger than 0xFFFF to be used with imm32/rel32 displacement.
     static constexpr int32_t kTemporaryRel32Value = 0x123456;
-    static constexpr int32_t kHintRequiresSize = -1;
 
     struct EncodeVariantsInfo
     {
@@ -151,6 +152,10 @@ namespace zasm
 
     static Error buildOperand_(ZydisEncoderOperand& dst, EncoderState&, const operands::Reg& op) noexcept
     {
+        // Virtual registers have to be allocated before encoding.
+        if (op.isVirtual())
+            return Error::ImpossibleInstruction;
+
         dst.type = ZydisOperandType::ZYDIS_OPERAND_TYPE_REGISTER;
         dst.reg.value = op.getId();
 
@@ -236,10 +241,35 @@ namespace zasm
         return Error::None;
     }
 
+    // Decoded memory operands carry the segment even without a prefix, only a segment other than the
+    // default of the base register requires an override.
+    static bool hasDefaultSegment(const operands::Mem& op) noexcept
+    {
+        const auto segmentId = op.getSegment().getId();
+        if (segmentId == ZYDIS_REGISTER_NONE)
+            return true;
+
+        switch (op.getBase().getId())
+        {
+            case ZYDIS_REGISTER_RSP:
+            case ZYDIS_REGISTER_RBP:
+            case ZYDIS_REGISTER_ESP:
+            case ZYDIS_REGISTER_EBP:
+            case ZYDIS_REGISTER_SP:
+            case ZYDIS_REGISTER_BP:
+                return segmentId == ZYDIS_REGISTER_SS;
+            default:
+                return segmentId == ZYDIS_REGISTER_DS;
+        }
+    }
+
     static Error buildOperand_(ZydisEncoderOperand& dst, EncoderState& state, const operands::Mem& op) noexcept
     {
         auto* ctx = state.ctx;
 
+        if (op.getBase().isVirtual() || op.getIndex().isVirtual())
+            return Error::ImpossibleInstruction;
+
         dst.type = ZydisOperandType::ZYDIS_OPERAND_TYPE_MEMORY;
         dst.mem.base = op.getBase().getId();
         dst.mem.index = op.getIndex().getId();
@@ -262,7 +292,13 @@ namespace zasm
                 }
                 else
                 {
-                    displacement += kTemporaryRel32Value;
+                    // Rip-relative placeholders are relative to the instruction so they stay
+                    // within disp32 regardless of the address.
+                    const bool isRipRel = state.req.machine_mode == ZYDIS_MACHINE_MODE_LONG_64
+                        && (dst.mem.base == ZYDIS_REGISTER_RIP
+                            || (dst.mem.base == ZYDIS_REGISTER_NONE && dst.mem.index == ZYDIS_REGISTER_NONE));
+
+                    displacement += isRipRel ? va + kTemporaryRel32Value : kTemporaryRel32Value;
                     ctx->needsExtraPass = true;
                 }
             }
@@ -291,12 +327,12 @@ namespace zasm
 
         if (dst.mem.base == ZydisRegister::ZYDIS_REGISTER_RIP)
         {
-            // We require the exact instruction size to encode this correctly.
+            // We require the exact instruction size to encode this correctly, the caller
+            // re-encodes if the size provided does not match the result.
             const auto instrSize = ctx ? ctx->instrSize : 0;
-            if (ctx && instrSize == 0)
+            if (ctx != nullptr)
             {
-                // Causes to re-encode again with instruction size available.
-                ctx->instrSize = kHintRequiresSize;
+                ctx->needsInstrSize = true;
             }
 
             displacement = displacement - (va + instrSize);
@@ -305,11 +341,32 @@ namespace zasm
         dst.mem.displacement = displacement;
 
         // Handling segment
-        const auto segmentId = op.getSegment().getId();
-        if (segmentId == ZYDIS_REGISTER_GS)
-            state.req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_GS;
-        else if (segmentId == ZYDIS_REGISTER_FS)
-            state.req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_FS;
+        if (!hasDefaultSegment(op))
+        {
+            switch (op.getSegment().getId())
+            {
+                case ZYDIS_REGISTER_GS:
+                    state.req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_GS;
+                    break;
+                case ZYDIS_REGISTER_FS:
+                    state.req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_FS;
+                    break;
+                case ZYDIS_REGISTER_CS:
+                    state.req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_CS;
+                    break;
+                case ZYDIS_REGISTER_SS:
+                    state.req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_SS;
+                    break;
+                case ZYDIS_REGISTER_DS:
+                    state.req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_DS;
+                    break;
+                case ZYDIS_REGISTER_ES:
+                    state.req.prefixes |= ZYDIS_ATTRIB_HAS_SEGMENT_ES;
+                    break;
+                default:
+                    return Error::InvalidParameter;
+            }
+        }
 
         return Error::None;
     }
@@ -392,7 +449,253 @@ namespace zasm
         }
     }
 
-    static Error encode_(
+    // Specialized encoders for the most common forms in long mode. The generic path builds a full
+    // encoder request for every instruction, for simple forms like gp register arithmetic that
+    // dominates the cost. Forms not handled here are left to Zydis, the output of the forms
+    // handled is identical to what Zydis produces.
+    namespace direct
+    {
+        using detail::direct::emitRegMem;
+        using detail::direct::emitRex;
+        using detail::direct::encodeBinary;
+        using detail::direct::getConditionCode;
+        using detail::direct::Gp;
+        using detail::direct::isInt32;
+        using detail::direct::Mem;
+
+        using DirectOperand = detail::direct::Operand;
+
+        struct Writer
+        {
+            EncoderResult& res;
+
+            void emit8(uint8_t val) noexcept
+            {
+                res.data[res.length++] = val;
+            }
+
+            void emit16(uint16_t val) noexcept
+            {
+                emit8(static_cast<uint8_t>(val));
+                emit8(static_cast<uint8_t>(val >> 8));
+            }
+
+            void emit32(uint32_t val) noexcept
+            {
+                emit16(static_cast<uint16_t>(val));
+                emit16(static_cast<uint16_t>(val >> 16));
+            }
+
+            void emit64(uint64_t val) noexcept
+            {
+                emit32(static_cast<uint32_t>(val));
+                emit32(static_cast<uint32_t>(val >> 32));
+            }
+
+            void emitImm(uint64_t val, uint8_t size) noexcept
+            {
+                for (uint8_t i = 0; i < size; ++i)
+                {
+                    emit8(static_cast<uint8_t>(val >> (i * 8)));
+                }
+            }
+        };
+
+        static bool getGp(const Operand& op, Gp& gp) noexcept
+        {
+            const auto* reg = op.getIf<operands::Reg>();
+            if (reg == nullptr)
+                return false;
+
+            return detail::direct::getGp(reg->getId(), gp);
+        }
+
+        // Only base + index * scale + disp32 with a 64 bit base, everything that involves labels,
+        // rip, absolute addresses or segment prefixes is left to Zydis.
+        static bool getMem(const Operand& op, Mem& mem) noexcept
+        {
+            const auto* src = op.getIf<operands::Mem>();
+            if (src == nullptr || src->hasLabel() || !hasDefaultSegment(*src))
+                return false;
+
+            if (src->getBase().isVirtual() || src->getIndex().isVirtual())
+                return false;
+
+            const auto baseId = src->getBase().getId();
+            if (baseId < ZYDIS_REGISTER_RAX || baseId > ZYDIS_REGISTER_R15)
+                return false;
+
+            const auto disp = src->getDisplacement();
+            if (!isInt32(disp))
+                return false;
+
+            mem.base = static_cast<uint8_t>(baseId - ZYDIS_REGISTER_RAX);
+            mem.disp = static_cast<int32_t>(disp);
+            mem.size = src->getByteSize();
+
+            const auto indexId = src->getIndex().getId();
+            if (indexId == ZYDIS_REGISTER_NONE)
+            {
+                mem.index = -1;
+                return true;
+            }
+            if (indexId < ZYDIS_REGISTER_RAX || indexId > ZYDIS_REGISTER_R15 || indexId == ZYDIS_REGISTER_RSP)
+                return false;
+
+            mem.index = static_cast<int8_t>(indexId - ZYDIS_REGISTER_RAX);
+            return detail::direct::getScaleBits(src->getScale(), mem.scaleBits);
+        }
+
+        static bool getImm(const Operand& op, int64_t& val) noexcept
+        {
+            const auto* imm = op.getIf<operands::Imm>();
+            if (imm == nullptr)
+                return false;
+
+            val = imm->value<int64_t>();
+            return true;
+        }
+
+        static DirectOperand getOperand(const Operand& op) noexcept
+        {
+            DirectOperand res{};
+            if (getGp(op, res.gp))
+                res.kind = DirectOperand::Kind::Gp;
+            else if (getMem(op, res.mem))
+                res.kind = DirectOperand::Kind::Mem;
+            else if (getImm(op, res.imm))
+                res.kind = DirectOperand::Kind::Imm;
+            return res;
+        }
+
+        // jmp, call and jcc with a label or immediate as target, same rel8/rel32 selection as the generic path.
+        static bool encodeBranch(Writer& w, EncoderContext* ctx, ZydisMnemonic id, const Operand& op) noexcept
+        {
+            const auto cc = getConditionCode(id);
+            if (cc == -1 && id != ZYDIS_MNEMONIC_JMP && id != ZYDIS_MNEMONIC_CALL)
+                return false;
+
+            int64_t targetAddress{};
+            if (const auto* label = op.getIf<operands::Label>(); label != nullptr)
+            {
+                auto labelVA = ctx != nullptr ? ctx->getLabelAddress(label->getId()) : std::nullopt;
+                if (!labelVA.has_value() && ctx != nullptr)
+                {
+                    ctx->needsExtraPass = true;
+                }
+
+                if (labelVA.has_value())
+                    targetAddress = *labelVA;
+                else
+                    targetAddress = ctx != nullptr ? ctx->va + kTemporaryRel32Value : kTemporaryRel32Value;
+
+                w.res.relocKind = RelocationKind::Immediate;
+            }
+            else if (!getImm(op, targetAddress))
+            {
+                return false;
+            }
+
+            const auto [rel, branchType] = processRelAddress(getEncodeVariantInfo(id), ctx ? ctx->va : 0, targetAddress);
+            if (branchType == ZydisBranchType::ZYDIS_BRANCH_TYPE_SHORT)
+            {
+                w.emit8(id == ZYDIS_MNEMONIC_JMP ? 0xEB : static_cast<uint8_t>(0x70 | cc));
+                w.emit8(static_cast<uint8_t>(rel));
+            }
+            else if (branchType == ZydisBranchType::ZYDIS_BRANCH_TYPE_NEAR)
+            {
+                if (id == ZYDIS_MNEMONIC_JMP)
+                {
+                    w.emit8(0xE9);
+                }
+                else if (id == ZYDIS_MNEMONIC_CALL)
+                {
+                    w.emit8(0xE8);
+                }
+                else
+                {
+                    w.emit8(0x0F);
+                    w.emit8(static_cast<uint8_t>(0x80 | cc));
+                }
+                w.emit32(static_cast<uint32_t>(rel));
+            }
+            else
+            {
+                w.res.relocKind = RelocationKind::None;
+                return false;
+            }
+            return true;
+        }
+
+        static bool encode(
+            EncoderResult& res, EncoderContext* ctx, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id,
+            size_t numOps, const Operand* operands) noexcept
+        {
+            if (mode != ZYDIS_MACHINE_MODE_LONG_64 || attribs != Instruction::Attribs::None)
+                return false;
+
+            Writer w{ res };
+            Gp gp{};
+            Mem mem{};
+            int64_t imm{};
+
+            bool encoded = false;
+            switch (numOps)
+            {
+                case 0:
+                    if (id == ZYDIS_MNEMONIC_RET)
+                    {
+                        w.emit8(0xC3);
+                        encoded = true;
+                    }
+                    break;
+                case 1:
+                    if ((id == ZYDIS_MNEMONIC_PUSH || id == ZYDIS_MNEMONIC_POP) && getGp(operands[0], gp) && gp.is64)
+                    {
+                        emitRex(w, false, 0, 0, gp.index);
+                        w.emit8((id == ZYDIS_MNEMONIC_PUSH ? 0x50 : 0x58) + (gp.index & 7));
+                        encoded = true;
+                    }
+                    else if (id == ZYDIS_MNEMONIC_RET && getImm(operands[0], imm) && imm >= 0 && imm <= 0xFFFF)
+                    {
+                        w.emit8(0xC2);
+                        w.emit16(static_cast<uint16_t>(imm));
+                        encoded = true;
+                    }
+                    else
+                    {
+                        encoded = encodeBranch(w, ctx, id, operands[0]);
+                    }
+                    break;
+                case 2:
+                    if (id == ZYDIS_MNEMONIC_LEA)
+                    {
+                        if (getGp(operands[0], gp) && getMem(operands[1], mem) && mem.size == (gp.is64 ? 8 : 4))
+                        {
+                            emitRegMem(w, gp.is64, 0x8D, gp.index, mem);
+                            encoded = true;
+                        }
+                    }
+                    else
+                    {
+                        encoded = encodeBinary(w, id, getOperand(operands[0]), getOperand(operands[1]));
+                    }
+                    break;
+                default:
+                    break;
+            }
+
+            if (!encoded)
+            {
+                // Partially written, leave it to Zydis.
+                res.length = 0;
+            }
+            return encoded;
+        }
+
+    } // namespace direct
+
+    static Error encodeGeneric_(
         EncoderResult& res, EncoderContext* ctx, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id,
         size_t numOps, const Operand* operands) noexcept
     {
@@ -453,6 +756,21 @@ namespace zasm
         return Error::None;
     }
 
+    static Error encode_(
+        EncoderResult& res, EncoderContext* ctx, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id,
+        size_t numOps, const Operand* operands) noexcept
+    {
+        res.length = 0;
+        res.relocKind = RelocationKind::None;
+
+        if (direct::encode(res, ctx, mode, attribs, id, numOps, operands))
+        {
+            return Error::None;
+        }
+
+        return encodeGeneric_(res, ctx, mode, attribs, id, numOps, operands);
+    }
+
     Error encodeEstimated(
         EncoderResult& res, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps,
         const EncoderOperands& operands) noexcept
@@ -460,34 +778,48 @@ namespace zasm
         return encode_(res, nullptr, mode, attribs, id, numOps, operands.data());
     }
 
+    Error encodeEstimatedGeneric(
+        EncoderResult& res, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps,
+        const EncoderOperands& operands) noexcept
+    {
+        return encodeGeneric_(res, nullptr, mode, attribs, id, numOps, operands.data());
+    }
+
+    bool encodeEstimatedDirect(
+        EncoderResult& res, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id, size_t numOps,
+        const EncoderOperands& operands) noexcept
+    {
+        res.length = 0;
+        res.relocKind = RelocationKind::None;
+
+        return direct::encode(res, nullptr, mode, attribs, id, numOps, operands.data());
+    }
+
     static Error encodeFull_(
         EncoderResult& res, EncoderContext& ctx, ZydisMachineMode mode, Instruction::Attribs prefixes, ZydisMnemonic id,
-        size_t numOps, const Operand* operands) noexcept
+        size_t numOps, const Operand* operands, int32_t predictedSize) noexcept
     {
-        // encode_ will set this to kHintRequiresSize in case a length is required for correct encoding.
-        ctx.instrSize = 0;
+        // The displacement of rip-relative operands depends on the final instruction size, encode
+        // with the predicted size first. The size of a rip-relative instruction does not depend on
+        // the displacement so the prediction is usually exact and a single encode is enough.
+        ctx.instrSize = predictedSize;
+        ctx.needsInstrSize = false;
 
         if (auto encodeError = encode_(res, &ctx, mode, prefixes, id, numOps, operands); encodeError != Error::None)
         {
             return encodeError;
         }
 
-        while (ctx.instrSize == kHintRequiresSize)
+        // If the instruction size does not match what we previously specified we need to re-encode
+        // it with the now known size, this happens without a prediction or when other operands
+        // change the size, ex. near the limits of rel8/32.
+        while (ctx.needsInstrSize && res.length != ctx.instrSize)
         {
-            // Encode with now known size, instruction size can change again in this call.
             ctx.instrSize = res.length;
             if (auto encodeError = encode_(res, &ctx, mode, prefixes, id, numOps, operands); encodeError != Error::None)
             {
                 return encodeError;
             }
-
-            // If the instruction size does not match what we previously specified
-            // we need to re-encode it with the now known size, this can happen near
-            // the limits of rel8/32 but is unlikely.
-            if (res.length != ctx.instrSize)
-            {
-                ctx.instrSize = kHintRequiresSize;
-            }
         }
 
         return Error::None;
@@ -512,7 +844,62 @@ namespace zasm
             explicitOps++;
         }
 
-        return encodeFull_(buf, ctx, mode, instr.getAttribs(), instr.getId(), explicitOps, operands.data());
+        // Prefer the length from the previous pass, on the first pass the length of the generated
+        // instruction is used, instructions without meta data have no length.
+        int32_t predictedSize = instr.getLength();
+        if (ctx.nodeIndex < ctx.nodes.size() && ctx.nodes[ctx.nodeIndex].length != 0)
+        {
+            predictedSize = ctx.nodes[ctx.nodeIndex].length;
+        }
+
+        return encodeFull_(buf, ctx, mode, instr.getAttribs(), instr.getId(), explicitOps, operands.data(), predictedSize);
+    }
+
+    Error encodeFull(
+        EncoderResult& buf, EncoderContext& ctx, ZydisMachineMode mode, Instruction::Attribs attribs, ZydisMnemonic id,
+        size_t numOps, const EncoderOperands& operands) noexcept
+    {
+        return encodeFull_(buf, ctx, mode, attribs, id, numOps, operands.data(), 0);
+    }
+
+    // Recommended multi-byte nops, the longer forms add prefixes to the 9 byte form.
+    static constexpr uint8_t kNops[][11] = {
+        { 0x90 },
+        { 0x66, 0x90 },
+        { 0x0F, 0x1F, 0x00 },
+        { 0x0F, 0x1F, 0x40, 0x00 },
+        { 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+        { 0x66, 0x0F, 0x1F, 0x44, 0x00, 0x00 },
+        { 0x0F, 0x1F, 0x80, 0x00, 0x00, 0x00, 0x00 },
+        { 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+        { 0x66, 0x66, 0x2E, 0x0F, 0x1F, 0x84, 0x00, 0x00, 0x00, 0x00, 0x00 },
+    };
+
+    void encodePadding(uint8_t* buf, size_t len, ZydisMachineMode mode, Align::Type type) noexcept
+    {
+        if (type == Align::Type::Data)
+        {
+            std::memset(buf, 0, len);
+            return;
+        }
+
+        const bool is16Bit = mode == ZYDIS_MACHINE_MODE_LONG_COMPAT_16 || mode == ZYDIS_MACHINE_MODE_LEGACY_16
+            || mode == ZYDIS_MACHINE_MODE_REAL_16;
+        if (is16Bit)
+        {
+            std::memset(buf, 0x90, len);
+            return;
+        }
+
+        while (len > 0)
+        {
+            const auto nopLen = std::min<size_t>(len, std::size(kNops));
+            std::memcpy(buf, kNops[nopLen - 1], nopLen);
+            buf += nopLen;
+            len -= nopLen;
+        }
     }
 
-} // namespace zasm
\ No newline at end of file
+} // namespace zasm
@@ -1,6 +1,7 @@
 #include "generator.hpp"
 
 #include <Zydis/Zydis.h>
+#include <limits>
 
 namespace zasm
 {
@@ -40,6 +41,242 @@ namespace zasm
         return false;
     }
 
+    // Registers with the same class and index group encode the same way. The accumulator has
+    // short forms, 4 and 5 need a SIB byte or displacement as base, 8 and above need REX or
+    // a three byte VEX and 16 and above need EVEX.
+    static uint64_t getRegIndexClass(int8_t index) noexcept
+    {
+        if (index < 0)
+            return 15;
+        if (index == 0)
+            return 0;
+        if (index <= 3)
+            return 1;
+        if (index == 4)
+            return 2;
+        if (index == 5)
+            return 3;
+        if (index <= 7)
+            return 4;
+        if (index <= 11)
+            return 5;
+        if (index == 12)
+            return 6;
+        if (index == 13)
+            return 7;
+        if (index <= 15)
+            return 8;
+        return 9;
+    }
+
+    static uint64_t getRegShape(const operands::Reg& reg) noexcept
+    {
+        if (!reg.isValid())
+            return 0;
+
+        const auto regClass = static_cast<uint64_t>(reg.getClass());
+        return (1ULL << 12) | (regClass << 4) | getRegIndexClass(reg.getIndex());
+    }
+
+    // The encoder picks the immediate size by the range of the value, some forms also
+    // encode the values -1 to 1 implicitly.
+    static uint64_t getImmClass(int64_t val) noexcept
+    {
+        if (val >= -1 && val <= 1)
+            return static_cast<uint64_t>(val + 1);
+        if (val < 0)
+        {
+            if (val >= std::numeric_limits<int8_t>::min())
+                return 3;
+            if (val >= std::numeric_limits<int16_t>::min())
+                return 4;
+            if (val >= std::numeric_limits<int32_t>::min())
+                return 5;
+            return 6;
+        }
+        if (val <= std::numeric_limits<int8_t>::max())
+            return 7;
+        if (val <= std::numeric_limits<uint8_t>::max())
+            return 8;
+        if (val <= std::numeric_limits<int16_t>::max())
+            return 9;
+        if (val <= std::numeric_limits<uint16_t>::max())
+            return 10;
+        if (val <= std::numeric_limits<int32_t>::max())
+            return 11;
+        if (val <= std::numeric_limits<uint32_t>::max())
+            return 12;
+        return 13;
+    }
+
+    static uint64_t getDispClass(int64_t disp) noexcept
+    {
+        if (disp == 0)
+            return 0;
+        if (disp >= std::numeric_limits<int8_t>::min() && disp <= std::numeric_limits<int8_t>::max())
+            return 1;
+        if (disp >= std::numeric_limits<int32_t>::min() && disp <= std::numeric_limits<int32_t>::max())
+            return 2;
+        return 3;
+    }
+
+    enum class OperandShape : uint64_t
+    {
+        None = 0,
+        Reg,
+        Mem,
+        Imm,
+        Label,
+    };
+
+    static uint64_t getOperandShape(const Operand& op) noexcept
+    {
+        if (const auto* opReg = op.getIf<operands::Reg>(); opReg != nullptr)
+        {
+            return static_cast<uint64_t>(OperandShape::Reg) | (getRegShape(*opReg) << 3);
+        }
+        if (const auto* opMem = op.getIf<operands::Mem>(); opMem != nullptr)
+        {
+            const auto segId = static_cast<uint64_t>(opMem->getSegment().getId()) & 0x3FF;
+            return static_cast<uint64_t>(OperandShape::Mem) | (static_cast<uint64_t>(opMem->getBitSize()) << 3)
+                | (segId << 11) | (getRegShape(opMem->getBase()) << 21) | (getRegShape(opMem->getIndex()) << 34)
+                | (static_cast<uint64_t>(opMem->getScale() & 0xF) << 47) | (getDispClass(opMem->getDisplacement()) << 51)
+                | (static_cast<uint64_t>(opMem->hasLabel()) << 53);
+        }
+        if (const auto* opImm = op.getIf<operands::Imm>(); opImm != nullptr)
+        {
+            return static_cast<uint64_t>(OperandShape::Imm) | (getImmClass(opImm->value<int64_t>()) << 3);
+        }
+        if (op.holds<operands::Label>())
+        {
+            return static_cast<uint64_t>(OperandShape::Label);
+        }
+        return static_cast<uint64_t>(OperandShape::None);
+    }
+
+    static bool buildCacheKey(
+        detail::GeneratorCacheKey& key, Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t numOps,
+        const EncoderOperands& operands) noexcept
+    {
+        if (numOps > operands.size())
+            return false;
+
+        // The size of relative branches depends on the exact target.
+        if (numOps > 0 && operands[0].holds<operands::Imm>() && isImmediateControlFlow(mnemonic))
+            return false;
+
+        key.mnemonic = mnemonic;
+        key.attribs = attribs;
+        key.numOps = numOps;
+        for (size_t i = 0; i < numOps; i++)
+        {
+            key.ops[i] = getOperandShape(operands[i]);
+        }
+
+        return true;
+    }
+
+    // Checks that each provided operand ended up at the same position and that the values
+    // can be exchanged, also records how the encoding transformed immediate values.
+    static detail::GeneratorCacheEntry createCacheEntry(
+        const Instruction& instr, size_t numOps, const EncoderOperands& operands) noexcept
+    {
+        detail::GeneratorCacheEntry entry{ instr };
+
+        if (instr.getOperandCount() < numOps)
+            return entry;
+
+        for (size_t i = 0; i < numOps; i++)
+        {
+            if (instr.isOperandHidden(i))
+                return entry;
+
+            const auto& opSrc = operands[i];
+            const auto& opDst = instr.getOperand(i);
+
+            if (const auto* regSrc = opSrc.getIf<operands::Reg>(); regSrc != nullptr)
+            {
+                const auto* regDst = opDst.getIf<operands::Reg>();
+                if (regDst == nullptr || regDst->getId() != regSrc->getId())
+                    return entry;
+            }
+            else if (const auto* memSrc = opSrc.getIf<operands::Mem>(); memSrc != nullptr)
+            {
+                const auto* memDst = opDst.getIf<operands::Mem>();
+                if (memDst == nullptr)
+                    return entry;
+
+                if (!memSrc->hasLabel()
+                    && (memDst->getBase() != memSrc->getBase() || memDst->getIndex() != memSrc->getIndex()
+                        || memDst->getDisplacement() != memSrc->getDisplacement()))
+                    return entry;
+            }
+            else if (const auto* immSrc = opSrc.getIf<operands::Imm>(); immSrc != nullptr)
+            {
+                const auto* immDst = opDst.getIf<operands::Imm>();
+                if (immDst == nullptr)
+                    return entry;
+
+                const auto srcVal = immSrc->value<int64_t>();
+                const auto delta = immDst->value<uint64_t>() - immSrc->value<uint64_t>();
+
+                // Values outside of the 32 bit range are only exchangeable if kept as is.
+                if (delta != 0
+                    && (srcVal < std::numeric_limits<int32_t>::min() || srcVal > std::numeric_limits<uint32_t>::max()))
+                    return entry;
+
+                entry.immDelta[i] = delta;
+            }
+            else if (!opSrc.holds<operands::Label>())
+            {
+                return entry;
+            }
+        }
+
+        entry.valid = true;
+        return entry;
+    }
+
+    // Writes the operands for the cached form, the meta data is taken from the entry as is.
+    static void instantiateCacheEntry(
+        const detail::GeneratorCacheEntry& entry, size_t numOps, const EncoderOperands& operands,
+        Instruction::Operands& newOps) noexcept
+    {
+        const auto& instr = entry.instr;
+
+        newOps = instr.getOperands();
+        for (size_t i = 0; i < numOps; i++)
+        {
+            const auto& opSrc = operands[i];
+            if (const auto* opImm = opSrc.getIf<operands::Imm>(); opImm != nullptr)
+            {
+                newOps[i] = operands::Imm(static_cast<int64_t>(opImm->value<uint64_t>() + entry.immDelta[i]));
+            }
+            else if (const auto* opMem = opSrc.getIf<operands::Mem>(); opMem != nullptr)
+            {
+                const auto& cachedMem = instr.getOperand<operands::Mem>(i);
+                const auto seg = cachedMem.getSegment();
+
+                if (opMem->hasLabel())
+                {
+                    newOps[i] = operands::Mem(
+                        opMem->getBitSize(), seg, opMem->getLabel(), opMem->getBase(), opMem->getIndex(), opMem->getScale(),
+                        opMem->getDisplacement());
+                }
+                else
+                {
+                    newOps[i] = operands::Mem(
+                        cachedMem.getBitSize(), seg, opMem->getBase(), opMem->getIndex(), cachedMem.getScale(),
+                        opMem->getDisplacement());
+                }
+            }
+            else
+            {
+                newOps[i] = opSrc;
+            }
+        }
+    }
+
     InstrGenerator::InstrGenerator(ZydisMachineMode mode) noexcept
         : _decoder(mode)
         , _mode(mode)
@@ -47,7 +284,46 @@ namespace zasm
     }
 
     InstrGenerator::Result InstrGenerator::generate(
-        Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t numOps, EncoderOperands&& operands) noexcept
+        Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t numOps, EncoderOperands&& operands,
+        Instruction::Operands& newOps) noexcept
+    {
+        detail::GeneratorCacheKey key{};
+        const bool cacheable = buildCacheKey(key, attribs, mnemonic, numOps, operands);
+        if (cacheable)
+        {
+            if (auto it = _cache.find(key); it != _cache.end() && it->second.valid)
+            {
+                _cacheHits++;
+                instantiateCacheEntry(it->second, numOps, operands, newOps);
+                return &it->second.instr;
+            }
+        }
+
+        _cacheMisses++;
+
+        auto res = generateUncached(attribs, mnemonic, numOps, operands);
+        if (!res)
+        {
+            return zasm::makeUnexpected(res.error());
+        }
+
+        newOps = res->getOperands();
+
+        if (cacheable && _cache.size() < kMaxCacheEntries)
+        {
+            auto [it, inserted] = _cache.try_emplace(key, createCacheEntry(*res, numOps, operands));
+            if (inserted)
+            {
+                return &it->second.instr;
+            }
+        }
+
+        _lastUncached.emplace(*res);
+        return &*_lastUncached;
+    }
+
+    InstrGenerator::UncachedResult InstrGenerator::generateUncached(
+        Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t numOps, const EncoderOperands& operands) noexcept
     {
         EncoderResult buf{};
 
@@ -90,6 +366,14 @@ namespace zasm
                         opMem->getBitSize(), decodedMemOp.getSegment(), opMem->getLabel(), opMem->getBase(), opMem->getIndex(),
                         opMem->getScale(), opMem->getDisplacement());
                 }
+                else if (const auto seg = opMem->getSegment(); seg.isValid() && seg != decodedMemOp.getSegment())
+                {
+                    // The decoder reports the default segment for overrides ignored in 64 bit mode, the
+                    // explicit segment is kept so it is encoded again.
+                    newOps[i] = operands::Mem(
+                        decodedMemOp.getBitSize(), seg, decodedMemOp.getBase(), decodedMemOp.getIndex(),
+                        decodedMemOp.getScale(), decodedMemOp.getDisplacement());
+                }
             }
             if (opSrc.holds<operands::Imm>())
             {
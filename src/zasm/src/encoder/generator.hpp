@@ -4,23 +4,107 @@
 #include "zasm/decoder/decoder.hpp"
 #include "zasm/encoder/encoder.hpp"
 
+#include <array>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+
 namespace zasm
 {
+    namespace detail
+    {
+        // Identifies the form of an instruction, register classes, immediate and displacement
+        // ranges are part of the key but not the values. Instructions with the same key encode
+        // the same way and share all meta data.
+        struct GeneratorCacheKey
+        {
+            ZydisMnemonic mnemonic{};
+            Instruction::Attribs attribs{};
+            size_t numOps{};
+            std::array<uint64_t, ZYDIS_ENCODER_MAX_OPERANDS> ops{};
+
+            bool operator==(const GeneratorCacheKey& other) const noexcept
+            {
+                return mnemonic == other.mnemonic && attribs == other.attribs && numOps == other.numOps && ops == other.ops;
+            }
+        };
+
+        struct GeneratorCacheKeyHash
+        {
+            size_t operator()(const GeneratorCacheKey& key) const noexcept
+            {
+                uint64_t h = static_cast<uint64_t>(key.mnemonic) | (static_cast<uint64_t>(key.attribs) << 16)
+                    | (static_cast<uint64_t>(key.numOps) << 32);
+                for (const auto op : key.ops)
+                {
+                    h = (h ^ op) * 0x9E3779B97F4A7C15ULL;
+                    h ^= h >> 29;
+                }
+                return static_cast<size_t>(h);
+            }
+        };
+
+        struct GeneratorCacheEntry
+        {
+            // Generated instruction of the first occurrence, operand values are substituted on use.
+            Instruction instr;
+
+            // Difference between the decoded and the provided immediate values.
+            std::array<uint64_t, ZYDIS_ENCODER_MAX_OPERANDS> immDelta{};
+
+            // False if the operands can not be substituted, such forms are always generated.
+            bool valid{};
+        };
+
+    } // namespace detail
+
     class InstrGenerator
     {
+        // Upper bound of distinct instruction forms remembered per generator.
+        static constexpr size_t kMaxCacheEntries = 8192;
+
         Decoder _decoder;
         ZydisMachineMode _mode;
 
+        std::unordered_map<detail::GeneratorCacheKey, detail::GeneratorCacheEntry, detail::GeneratorCacheKeyHash> _cache;
+        size_t _cacheHits{};
+        size_t _cacheMisses{};
+
+        // Holds the last generated form that could not be cached.
+        std::optional<Instruction> _lastUncached;
+
     public:
-        using Result = zasm::Expected<Instruction, Error>;
+        // The generated form, owned by the generator and valid until the next call.
+        using Result = zasm::Expected<const Instruction*, Error>;
 
         InstrGenerator(ZydisMachineMode mode) noexcept;
 
         // Generates an instruction without context.
         // This is primarily used by the assembler to obtain all relevant meta data.
         // Some operands will encode temporary values and switched back after decoding.
+        // Results are cached by the form of the instruction, a cache hit only substitutes
+        // the operand values and skips the encode and decode.
+        // The final operands are written to newOps, the operands of the returned form are not
+        // meaningful. The caller constructs the instruction from both where it is stored.
         Result generate(
-            Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t numOps, EncoderOperands&& operands) noexcept;
+            Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t numOps, EncoderOperands&& operands,
+            Instruction::Operands& newOps) noexcept;
+
+        size_t getCacheHits() const noexcept
+        {
+            return _cacheHits;
+        }
+
+        size_t getCacheMisses() const noexcept
+        {
+            return _cacheMisses;
+        }
+
+    private:
+        using UncachedResult = zasm::Expected<Instruction, Error>;
+
+        UncachedResult generateUncached(
+            Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t numOps, const EncoderOperands& operands) noexcept;
     };
 
-} // namespace zasm
\ No newline at end of file
+} // namespace zasm
@@ -0,0 +1,586 @@
+#include "zasm/parser/parser.hpp"
+
+#include "parser.hash.hpp"
+
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <zasm/assembler/assembler.hpp>
+#include <zasm/core/expected.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct ParserState
+        {
+            Assembler& assembler;
+
+            // The map refers to the names owned by the deque which never relocates them.
+            std::deque<std::string> labelNames;
+            std::unordered_map<std::string_view, Label> labels;
+
+            // Reused for data directives.
+            std::vector<uint8_t> data;
+
+            size_t line{};
+
+            ParserState(Assembler& a)
+                : assembler(a)
+            {
+            }
+        };
+
+        using MnemonicTable = PerfectHashTable<ZydisMnemonic>;
+        using RegisterTable = PerfectHashTable<ZydisRegister>;
+
+        static const MnemonicTable& getMnemonicTable()
+        {
+            static const MnemonicTable table = [] {
+                std::vector<MnemonicTable::Item> items;
+                for (int i = ZYDIS_MNEMONIC_INVALID + 1; i <= ZYDIS_MNEMONIC_MAX_VALUE; ++i)
+                {
+                    const auto id = static_cast<ZydisMnemonic>(i);
+                    if (const char* str = ZydisMnemonicGetString(id); str != nullptr)
+                        items.push_back({ str, id });
+                }
+                return MnemonicTable(items);
+            }();
+            return table;
+        }
+
+        static const RegisterTable& getRegisterTable()
+        {
+            static const RegisterTable table = [] {
+                std::vector<RegisterTable::Item> items;
+                for (int i = ZYDIS_REGISTER_NONE + 1; i <= ZYDIS_REGISTER_MAX_VALUE; ++i)
+                {
+                    const auto id = static_cast<ZydisRegister>(i);
+                    if (const char* str = ZydisRegisterGetString(id); str != nullptr)
+                        items.push_back({ str, id });
+                }
+                return RegisterTable(items);
+            }();
+            return table;
+        }
+
+        struct SizeKeyword
+        {
+            std::string_view name;
+            BitSize size;
+        };
+
+        static constexpr SizeKeyword kSizeKeywords[] = {
+            { "byte", BitSize::_8 },     { "word", BitSize::_16 },     { "dword", BitSize::_32 },
+            { "fword", BitSize::_48 },   { "qword", BitSize::_64 },    { "tword", BitSize::_80 },
+            { "tbyte", BitSize::_80 },   { "oword", BitSize::_128 },   { "xmmword", BitSize::_128 },
+            { "ymmword", BitSize::_256 }, { "zmmword", BitSize::_512 },
+        };
+
+        struct PrefixKeyword
+        {
+            std::string_view name;
+            Instruction::Attribs attrib;
+        };
+
+        static constexpr PrefixKeyword kPrefixKeywords[] = {
+            { "lock", Instruction::Attribs::Lock },         { "rep", Instruction::Attribs::Rep },
+            { "repe", Instruction::Attribs::Repe },         { "repz", Instruction::Attribs::Repe },
+            { "repne", Instruction::Attribs::Repne },       { "repnz", Instruction::Attribs::Repne },
+            { "bnd", Instruction::Attribs::Bnd },           { "xacquire", Instruction::Attribs::Xacquire },
+            { "xrelease", Instruction::Attribs::Xrelease },
+        };
+
+        static constexpr bool isDigit(char c) noexcept
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        static constexpr bool isIdentStart(char c) noexcept
+        {
+            return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || c == '_' || c == '.' || c == '$' || c == '@'
+                || c == '?';
+        }
+
+        static constexpr bool isIdentChar(char c) noexcept
+        {
+            return isIdentStart(c) || isDigit(c);
+        }
+
+        // Tokenizes a single line, tokens are views into the source text.
+        struct Lexer
+        {
+            const char* cur;
+            const char* end;
+
+            void skipSpace() noexcept
+            {
+                while (cur != end && (*cur == ' ' || *cur == '\t' || *cur == '\r'))
+                    ++cur;
+            }
+
+            bool atEnd() noexcept
+            {
+                skipSpace();
+                return cur == end;
+            }
+
+            char peek() noexcept
+            {
+                skipSpace();
+                return cur != end ? *cur : '\0';
+            }
+
+            bool consume(char c) noexcept
+            {
+                if (peek() != c)
+                    return false;
+                ++cur;
+                return true;
+            }
+
+            std::string_view ident() noexcept
+            {
+                skipSpace();
+                if (cur == end || !isIdentStart(*cur))
+                    return {};
+
+                const char* start = cur;
+                while (cur != end && isIdentChar(*cur))
+                    ++cur;
+
+                return { start, static_cast<size_t>(cur - start) };
+            }
+
+            std::string_view rest() noexcept
+            {
+                skipSpace();
+                const char* last = end;
+                while (last != cur && (last[-1] == ' ' || last[-1] == '\t' || last[-1] == '\r'))
+                    --last;
+
+                std::string_view res{ cur, static_cast<size_t>(last - cur) };
+                cur = end;
+                return res;
+            }
+        };
+
+        // Keywords are matched in lower case, the identifier is only copied if it has upper case characters.
+        struct LowerCase
+        {
+            char buf[32];
+
+            std::string_view operator()(std::string_view str) noexcept
+            {
+                const auto isUpper = [](char c) { return c >= 'A' && c <= 'Z'; };
+                if (std::none_of(str.begin(), str.end(), isUpper))
+                    return str;
+
+                if (str.size() > std::size(buf))
+                    return {};
+
+                std::transform(str.begin(), str.end(), buf, [&](char c) { return isUpper(c) ? c + ('a' - 'A') : c; });
+                return { buf, str.size() };
+            }
+        };
+
+        static ZydisRegister findRegister(std::string_view ident) noexcept
+        {
+            LowerCase lower;
+            const auto* reg = getRegisterTable().find(lower(ident));
+            return reg != nullptr ? *reg : ZYDIS_REGISTER_NONE;
+        }
+
+        static Label getLabel(ParserState& state, std::string_view name)
+        {
+            if (auto it = state.labels.find(name); it != state.labels.end())
+                return it->second;
+
+            const auto& storedName = state.labelNames.emplace_back(name);
+            const auto label = state.assembler.createLabel(storedName.c_str());
+            state.labels.emplace(storedName, label);
+
+            return label;
+        }
+
+        // Parses a decimal or 0x prefixed hexadecimal number with an optional sign.
+        static bool parseNumber(Lexer& lex, int64_t& out) noexcept
+        {
+            const bool negative = lex.consume('-');
+
+            lex.skipSpace();
+
+            int base = 10;
+            if (lex.end - lex.cur > 2 && lex.cur[0] == '0' && (lex.cur[1] == 'x' || lex.cur[1] == 'X'))
+            {
+                base = 16;
+                lex.cur += 2;
+            }
+
+            uint64_t val{};
+            const auto res = std::from_chars(lex.cur, lex.end, val, base);
+            if (res.ec != std::errc{} || (res.ptr != lex.end && isIdentChar(*res.ptr)))
+                return false;
+
+            lex.cur = res.ptr;
+            out = static_cast<int64_t>(negative ? 0ULL - val : val);
+
+            return true;
+        }
+
+        static bool fitsInBits(int64_t val, int32_t numBits) noexcept
+        {
+            if (numBits >= 64)
+                return true;
+
+            // Accept both the signed and the unsigned range.
+            const auto limit = int64_t{ 1 } << numBits;
+            return val >= -(limit / 2) && val < limit;
+        }
+
+        static bool parseSizePrefix(Lexer& lex, BitSize& size) noexcept
+        {
+            auto saved = lex;
+
+            LowerCase lower;
+            const auto name = lower(lex.ident());
+            const auto it = std::find_if(
+                std::begin(kSizeKeywords), std::end(kSizeKeywords), [&](const auto& kw) { return kw.name == name; });
+            if (it != std::end(kSizeKeywords) && lower(lex.ident()) == "ptr")
+            {
+                size = it->size;
+                return true;
+            }
+
+            lex = saved;
+            return false;
+        }
+
+        // Parses the memory operand after the opening bracket: [base+index*scale+label+disp]
+        static Expected<Operand, Error> parseMemory(ParserState& state, Lexer& lex, BitSize size, const operands::Seg& seg)
+        {
+            operands::Reg base;
+            operands::Reg index;
+            int32_t scale = 0;
+            int64_t disp = 0;
+            Label label;
+
+            bool negate = lex.consume('-');
+            for (;;)
+            {
+                if (isDigit(lex.peek()))
+                {
+                    int64_t val{};
+                    if (!parseNumber(lex, val))
+                        return makeUnexpected(Error::InvalidSyntax);
+
+                    const auto uval = static_cast<uint64_t>(val);
+                    disp = static_cast<int64_t>(static_cast<uint64_t>(disp) + (negate ? 0ULL - uval : uval));
+                }
+                else
+                {
+                    const auto ident = lex.ident();
+                    if (ident.empty() || negate)
+                        return makeUnexpected(Error::InvalidSyntax);
+
+                    if (const auto reg = findRegister(ident); reg != ZYDIS_REGISTER_NONE)
+                    {
+                        if (lex.consume('*'))
+                        {
+                            int64_t val{};
+                            if (index.isValid() || !parseNumber(lex, val) || (val != 1 && val != 2 && val != 4 && val != 8))
+                                return makeUnexpected(Error::InvalidSyntax);
+
+                            index = operands::Reg(reg);
+                            scale = static_cast<int32_t>(val);
+                        }
+                        else if (!base.isValid())
+                        {
+                            base = operands::Reg(reg);
+                        }
+                        else if (!index.isValid())
+                        {
+                            index = operands::Reg(reg);
+                            scale = 1;
+                        }
+                        else
+                        {
+                            return makeUnexpected(Error::InvalidSyntax);
+                        }
+                    }
+                    else
+                    {
+                        if (label.isValid())
+                            return makeUnexpected(Error::InvalidSyntax);
+
+                        label = getLabel(state, ident);
+                    }
+                }
+
+                if (lex.consume(']'))
+                    break;
+
+                if (lex.consume('+'))
+                    negate = false;
+                else if (lex.consume('-'))
+                    negate = true;
+                else
+                    return makeUnexpected(Error::InvalidSyntax);
+            }
+
+            return Operand(operands::Mem(size, seg, label, base, index, scale, disp));
+        }
+
+        static Expected<Operand, Error> parseOperand(ParserState& state, Lexer& lex)
+        {
+            const char c = lex.peek();
+            if (c == '-' || isDigit(c))
+            {
+                int64_t val{};
+                if (!parseNumber(lex, val))
+                    return makeUnexpected(Error::InvalidSyntax);
+
+                return Operand(operands::Imm(val));
+            }
+
+            BitSize size = BitSize::_0;
+            const bool hasSize = parseSizePrefix(lex, size);
+
+            if (lex.consume('['))
+                return parseMemory(state, lex, size, operands::Seg{});
+
+            const auto ident = lex.ident();
+            if (ident.empty())
+                return makeUnexpected(Error::InvalidSyntax);
+
+            if (const auto reg = findRegister(ident); reg != ZYDIS_REGISTER_NONE)
+            {
+                // Segment override, seg:[...]
+                if (lex.consume(':'))
+                {
+                    if (ZydisRegisterGetClass(reg) != ZYDIS_REGCLASS_SEGMENT || !lex.consume('['))
+                        return makeUnexpected(Error::InvalidSyntax);
+
+                    return parseMemory(state, lex, size, operands::Seg(reg));
+                }
+
+                if (hasSize)
+                    return makeUnexpected(Error::InvalidSyntax);
+
+                return Operand(operands::Reg(reg));
+            }
+
+            if (hasSize)
+                return makeUnexpected(Error::InvalidSyntax);
+
+            return Operand(getLabel(state, ident));
+        }
+
+        static Error parseInstruction(ParserState& state, Lexer& lex, std::string_view ident)
+        {
+            LowerCase lower;
+
+            auto attribs = Instruction::Attribs::None;
+            for (;;)
+            {
+                const auto name = lower(ident);
+                const auto it = std::find_if(
+                    std::begin(kPrefixKeywords), std::end(kPrefixKeywords), [&](const auto& kw) { return kw.name == name; });
+                if (it == std::end(kPrefixKeywords))
+                    break;
+
+                attribs = attribs | it->attrib;
+                ident = lex.ident();
+            }
+
+            const auto* mnemonic = getMnemonicTable().find(lower(ident));
+            if (mnemonic == nullptr)
+                return Error::InvalidSyntax;
+
+            std::array<Operand, ZYDIS_ENCODER_MAX_OPERANDS> ops{};
+            size_t numOps = 0;
+
+            if (!lex.atEnd())
+            {
+                do
+                {
+                    if (numOps >= ops.size())
+                        return Error::InvalidSyntax;
+
+                    auto op = parseOperand(state, lex);
+                    if (!op)
+                        return op.error();
+
+                    ops[numOps++] = std::move(*op);
+                } while (lex.consume(','));
+            }
+
+            if (!lex.atEnd())
+                return Error::InvalidSyntax;
+
+            return state.assembler.emit(attribs, *mnemonic, numOps, ops.data());
+        }
+
+        static Error parseData(ParserState& state, Lexer& lex, BitSize size)
+        {
+            // Embedded label, either absolute or relative to another label.
+            if (isIdentStart(lex.peek()))
+            {
+                const auto label = getLabel(state, lex.ident());
+                if (lex.consume('-'))
+                {
+                    const auto ident = lex.ident();
+                    if (ident.empty() || !lex.atEnd())
+                        return Error::InvalidSyntax;
+
+                    return state.assembler.embedLabelRel(label, getLabel(state, ident), size);
+                }
+
+                if (!lex.atEnd())
+                    return Error::InvalidSyntax;
+
+                return state.assembler.embedLabel(label);
+            }
+
+            const auto numBits = getBitSize(size);
+
+            state.data.clear();
+            do
+            {
+                int64_t val{};
+                if (!parseNumber(lex, val) || !fitsInBits(val, numBits))
+                    return Error::InvalidSyntax;
+
+                for (int32_t i = 0; i < numBits; i += 8)
+                {
+                    state.data.push_back(static_cast<uint8_t>(static_cast<uint64_t>(val) >> i));
+                }
+            } while (lex.consume(','));
+
+            if (!lex.atEnd())
+                return Error::InvalidSyntax;
+
+            return state.assembler.embed(state.data.data(), state.data.size());
+        }
+
+        // .align 16 pads with nops, .align 16, data pads with zeros.
+        static Error parseAlign(ParserState& state, Lexer& lex)
+        {
+            int64_t val{};
+            if (!parseNumber(lex, val) || !fitsInBits(val, 32))
+                return Error::InvalidSyntax;
+
+            auto type = Align::Type::Code;
+            if (lex.consume(','))
+            {
+                LowerCase lower;
+                if (lower(lex.ident()) != "data")
+                    return Error::InvalidSyntax;
+                type = Align::Type::Data;
+            }
+
+            if (!lex.atEnd())
+                return Error::InvalidSyntax;
+
+            return state.assembler.align(static_cast<int32_t>(val), type);
+        }
+
+        static Error parseLine(ParserState& state, std::string_view line)
+        {
+            if (const auto pos = line.find(';'); pos != line.npos)
+                line = line.substr(0, pos);
+
+            Lexer lex{ line.data(), line.data() + line.size() };
+            if (lex.atEnd())
+                return Error::None;
+
+            auto ident = lex.ident();
+            if (ident.empty())
+                return Error::InvalidSyntax;
+
+            // Label, may be followed by more on the same line.
+            if (lex.consume(':'))
+            {
+                if (auto err = state.assembler.bind(getLabel(state, ident)); err != Error::None)
+                    return err;
+
+                if (lex.atEnd())
+                    return Error::None;
+
+                ident = lex.ident();
+                if (ident.empty())
+                    return Error::InvalidSyntax;
+            }
+
+            LowerCase lower;
+            const auto name = lower(ident);
+
+            if (name == ".section")
+            {
+                const std::string sectName(lex.rest());
+                return state.assembler.section(sectName.empty() ? nullptr : sectName.c_str());
+            }
+
+            if (name == ".align")
+                return parseAlign(state, lex);
+
+            if (name == "db")
+                return parseData(state, lex, BitSize::_8);
+            if (name == "dw")
+                return parseData(state, lex, BitSize::_16);
+            if (name == "dd")
+                return parseData(state, lex, BitSize::_32);
+            if (name == "dq")
+                return parseData(state, lex, BitSize::_64);
+
+            return parseInstruction(state, lex, ident);
+        }
+
+    } // namespace detail
+
+    Parser::Parser(Assembler& assembler)
+        : _state{ new detail::ParserState(assembler) }
+    {
+        // Build the lookup tables up front rather than on the first line.
+        detail::getMnemonicTable();
+        detail::getRegisterTable();
+    }
+
+    Parser::~Parser()
+    {
+        delete _state;
+    }
+
+    Error Parser::parse(std::string_view text)
+    {
+        _state->line = 0;
+
+        size_t pos = 0;
+        while (pos < text.size())
+        {
+            auto lineEnd = text.find('\n', pos);
+            if (lineEnd == text.npos)
+                lineEnd = text.size();
+
+            _state->line++;
+
+            const auto err = detail::parseLine(*_state, text.substr(pos, lineEnd - pos));
+            if (err != Error::None)
+                return err;
+
+            pos = lineEnd + 1;
+        }
+
+        return Error::None;
+    }
+
+    size_t Parser::getLine() const noexcept
+    {
+        return _state->line;
+    }
+
+} // namespace zasm
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <string_view>
+#include <vector>
+
+namespace zasm::detail
+{
+    // Static string lookup table using hash and displace. Keys are grouped into buckets by
+    // their first hash, each bucket stores the seed that places all of its keys into free slots.
+    // Looking up a key takes two hashes and a single comparison, there is no probing.
+    template<typename TValue> class PerfectHashTable
+    {
+    public:
+        struct Item
+        {
+            std::string_view key;
+            TValue value;
+        };
+
+    private:
+        std::vector<uint32_t> _seeds;
+        std::vector<Item> _slots;
+        size_t _bucketMask{};
+        size_t _slotMask{};
+
+        static constexpr uint64_t hash(std::string_view key, uint64_t seed) noexcept
+        {
+            uint64_t h = 0xCBF29CE484222325ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+            for (const char c : key)
+            {
+                h ^= static_cast<uint8_t>(c);
+                h *= 0x100000001B3ULL;
+            }
+            h ^= h >> 29;
+            h *= 0xBF58476D1CE4E5B9ULL;
+            h ^= h >> 32;
+            return h;
+        }
+
+        static size_t roundUpPow2(size_t val) noexcept
+        {
+            size_t res = 1;
+            while (res < val)
+                res <<= 1;
+            return res;
+        }
+
+    public:
+        PerfectHashTable() = default;
+
+        // Keys must be unique and not empty.
+        explicit PerfectHashTable(const std::vector<Item>& items)
+        {
+            const size_t slotCount = roundUpPow2(items.size() + items.size() / 4 + 1);
+            const size_t bucketCount = std::max<size_t>(slotCount / 4, 1);
+
+            _slotMask = slotCount - 1;
+            _bucketMask = bucketCount - 1;
+            _seeds.assign(bucketCount, 0);
+            _slots.assign(slotCount, Item{});
+
+            std::vector<std::vector<size_t>> buckets(bucketCount);
+            for (size_t i = 0; i < items.size(); ++i)
+            {
+                buckets[hash(items[i].key, 0) & _bucketMask].push_back(i);
+            }
+
+            // Place the largest buckets first while most slots are still free.
+            std::vector<size_t> order(bucketCount);
+            std::iota(order.begin(), order.end(), size_t{ 0 });
+            std::stable_sort(
+                order.begin(), order.end(), [&](size_t a, size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+            std::vector<bool> used(slotCount);
+            std::vector<size_t> placed;
+            for (const auto bucketIdx : order)
+            {
+                const auto& bucket = buckets[bucketIdx];
+                if (bucket.empty())
+                    break;
+
+                for (uint32_t seed = 1;; ++seed)
+                {
+                    placed.clear();
+                    for (const auto itemIdx : bucket)
+                    {
+                        const size_t slot = hash(items[itemIdx].key, seed) & _slotMask;
+                        if (used[slot] || std::find(placed.begin(), placed.end(), slot) != placed.end())
+                            break;
+                        placed.push_back(slot);
+                    }
+
+                    if (placed.size() != bucket.size())
+                        continue;
+
+                    for (size_t i = 0; i < placed.size(); ++i)
+                    {
+                        used[placed[i]] = true;
+                        _slots[placed[i]] = items[bucket[i]];
+                    }
+                    _seeds[bucketIdx] = seed;
+                    break;
+                }
+            }
+        }
+
+        const TValue* find(std::string_view key) const noexcept
+        {
+            if (key.empty() || _slots.empty())
+                return nullptr;
+
+            const auto seed = _seeds[hash(key, 0) & _bucketMask];
+            const auto& slot = _slots[hash(key, seed) & _slotMask];
+            if (slot.key != key)
+                return nullptr;
+
+            return &slot.value;
+        }
+    };
+
+} // namespace zasm::detail
@@ -0,0 +1,458 @@
+#include "zasm/passes/blocklayout.hpp"
+
+#include "../analysis/blocks.hpp"
+#include "../program/program.state.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <string>
+#include <vector>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/assembler/assembler.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct BlockWeight
+        {
+            const Node* node{};
+            Label label{};
+            uint64_t weight{};
+        };
+
+        struct LayoutEdge
+        {
+            uint32_t from{};
+            uint32_t to{};
+            uint64_t weight{};
+        };
+
+        struct BlockLayoutState
+        {
+            std::vector<BlockWeight> weights;
+            uint64_t coldThreshold{};
+            std::string coldSectionName{ ".text.cold" };
+            passes::BlockLayoutStats stats;
+
+            analysis::ControlFlowGraph cfg;
+            std::vector<uint64_t> blockWeights;
+            std::vector<uint8_t> hasWeight;
+            std::vector<uint8_t> isCold;
+            // Boundaries of the block, changed by inserted labels and jumps.
+            std::vector<const Node*> heads;
+            std::vector<const Node*> tails;
+
+            // Chains as linked lists of blocks, the root of a chain is found through the parents.
+            std::vector<uint32_t> chainParent;
+            std::vector<uint32_t> chainHead;
+            std::vector<uint32_t> chainTail;
+            std::vector<uint32_t> chainNext;
+
+            std::vector<LayoutEdge> edges;
+            // Weight and root of the chains of a region.
+            std::vector<std::pair<uint64_t, uint32_t>> chains;
+            // Blocks in their new order and the block following each of them.
+            std::vector<uint32_t> hotOrder;
+            std::vector<uint32_t> coldOrder;
+            std::vector<uint32_t> layoutNext;
+        };
+
+        static uint32_t findChain(BlockLayoutState& state, uint32_t blockIdx) noexcept
+        {
+            auto root = blockIdx;
+            while (state.chainParent[root] != root)
+            {
+                root = state.chainParent[root];
+            }
+
+            while (state.chainParent[blockIdx] != root)
+            {
+                const auto parent = state.chainParent[blockIdx];
+                state.chainParent[blockIdx] = root;
+                blockIdx = parent;
+            }
+
+            return root;
+        }
+
+        // Falls into the next block without a branch.
+        static bool hasFallthrough(const analysis::BasicBlock& block) noexcept
+        {
+            if (block.isData)
+                return false;
+
+            const auto* instr = block.tail->getIf<Instruction>();
+            if (instr == nullptr)
+                return true;
+
+            const auto kind = getBranchKind(*instr);
+            return kind != BranchKind::Jmp && kind != BranchKind::Exit;
+        }
+
+        static void assignWeights(BlockLayoutState& state, const Program& program)
+        {
+            const auto& cfg = state.cfg;
+            const auto numBlocks = static_cast<uint32_t>(cfg.getBlockCount());
+
+            state.blockWeights.assign(numBlocks, 0);
+            state.hasWeight.assign(numBlocks, 0);
+
+            const auto& labels = program.getState().labels;
+            for (const auto& entry : state.weights)
+            {
+                const auto* node = entry.node;
+                if (node == nullptr)
+                {
+                    const auto labelIdx = static_cast<size_t>(entry.label.getId());
+                    if (!entry.label.isValid() || labelIdx >= labels.size())
+                        continue;
+                    node = labels[labelIdx].node;
+                }
+
+                const auto blockIdx = cfg.getBlockOf(node);
+                if (blockIdx == analysis::kInvalidBlock)
+                    continue;
+
+                state.blockWeights[blockIdx] = std::max(state.blockWeights[blockIdx], entry.weight);
+                state.hasWeight[blockIdx] = 1;
+            }
+
+            for (uint32_t i = 1; i < numBlocks; ++i)
+            {
+                if (state.hasWeight[i] == 0 && cfg.getBlock(i - 1).succs[0] == i)
+                    state.blockWeights[i] = state.blockWeights[i - 1];
+            }
+        }
+
+        // Merges the chains along the heaviest edges, a chain only grows at its ends.
+        static void buildChains(BlockLayoutState& state, uint32_t regionBegin, uint32_t regionEnd)
+        {
+            const auto& cfg = state.cfg;
+
+            state.edges.clear();
+            for (auto blockIdx = regionBegin; blockIdx < regionEnd; ++blockIdx)
+            {
+                if (state.isCold[blockIdx] != 0)
+                    continue;
+
+                for (const auto succ : cfg.getBlock(blockIdx).succs)
+                {
+                    // The first block of the region stays in front.
+                    if (succ <= regionBegin || succ >= regionEnd || succ == blockIdx || state.isCold[succ] != 0)
+                        continue;
+
+                    const auto weight = std::min(state.blockWeights[blockIdx], state.blockWeights[succ]);
+                    state.edges.push_back({ blockIdx, succ, weight });
+                }
+            }
+
+            // Equal weights keep the list order, the original layout is kept where possible.
+            std::stable_sort(state.edges.begin(), state.edges.end(), [](const LayoutEdge& a, const LayoutEdge& b) {
+                return a.weight > b.weight;
+            });
+
+            for (const auto& edge : state.edges)
+            {
+                const auto chainFrom = findChain(state, edge.from);
+                const auto chainTo = findChain(state, edge.to);
+                if (chainFrom == chainTo || state.chainTail[chainFrom] != edge.from || state.chainHead[chainTo] != edge.to)
+                    continue;
+
+                state.chainNext[edge.from] = edge.to;
+                state.chainParent[chainTo] = chainFrom;
+                state.chainTail[chainFrom] = state.chainTail[chainTo];
+            }
+        }
+
+        // Places the chain of the first block first and the others by their heaviest block.
+        static void orderChains(BlockLayoutState& state, uint32_t regionBegin, uint32_t regionEnd)
+        {
+            const auto getChainWeight = [&](uint32_t chain) {
+                uint64_t weight = 0;
+                for (auto blockIdx = state.chainHead[chain]; blockIdx != analysis::kInvalidBlock;
+                     blockIdx = state.chainNext[blockIdx])
+                {
+                    weight = std::max(weight, state.blockWeights[blockIdx]);
+                }
+                return weight;
+            };
+
+            auto& chains = state.chains;
+            chains.clear();
+            for (auto blockIdx = regionBegin; blockIdx < regionEnd; ++blockIdx)
+            {
+                if (state.isCold[blockIdx] != 0 || findChain(state, blockIdx) != blockIdx)
+                    continue;
+
+                const auto weight = blockIdx == regionBegin ? std::numeric_limits<uint64_t>::max()
+                                                            : getChainWeight(blockIdx);
+                chains.emplace_back(weight, blockIdx);
+            }
+            std::stable_sort(chains.begin(), chains.end(), [](const auto& a, const auto& b) { return a.first > b.first; });
+
+            state.stats.numChains += chains.size();
+
+            uint32_t prevBlock = analysis::kInvalidBlock;
+            for (const auto& [weight, chain] : chains)
+            {
+                for (auto blockIdx = state.chainHead[chain]; blockIdx != analysis::kInvalidBlock;
+                     blockIdx = state.chainNext[blockIdx])
+                {
+                    if (prevBlock != analysis::kInvalidBlock)
+                        state.layoutNext[prevBlock] = blockIdx;
+                    prevBlock = blockIdx;
+                    state.hotOrder.push_back(blockIdx);
+                    state.stats.numHotBlocks++;
+                }
+            }
+
+            // The code after the region did not follow any of its blocks.
+            state.hotOrder.push_back(analysis::kInvalidBlock);
+        }
+
+        static Label getBlockLabel(BlockLayoutState& state, Program& program, uint32_t blockIdx)
+        {
+            for (const auto* node = state.heads[blockIdx]; node != nullptr && !node->holds<Instruction>();
+                 node = node->getNext())
+            {
+                if (const auto* label = node->getIf<Label>(); label != nullptr)
+                    return *label;
+                if (node == state.tails[blockIdx])
+                    break;
+            }
+
+            const auto label = program.createLabel();
+            const auto labelNode = program.bindLabel(label);
+            if (!labelNode.hasValue())
+                return {};
+
+            state.heads[blockIdx] = program.insertBefore(state.heads[blockIdx], labelNode.value());
+            return label;
+        }
+
+        static void moveBlock(Program& program, const Node*& pos, const Node* head, const Node* tail)
+        {
+            for (const auto* node = head;;)
+            {
+                const auto* next = node->getNext();
+                program.moveAfter(pos, node);
+                pos = node;
+                if (node == tail)
+                    break;
+                node = next;
+            }
+        }
+
+        static size_t getBlockSize(const BlockLayoutState& state, uint32_t blockIdx) noexcept
+        {
+            size_t size = 0;
+            for (const auto* node = state.heads[blockIdx];; node = node->getNext())
+            {
+                if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+                    size += instr->getLength();
+                if (node == state.tails[blockIdx])
+                    break;
+            }
+            return size;
+        }
+
+    } // namespace detail
+
+    namespace passes
+    {
+        BlockLayout::BlockLayout()
+            : _state(new detail::BlockLayoutState())
+        {
+        }
+
+        BlockLayout::~BlockLayout()
+        {
+            delete _state;
+        }
+
+        void BlockLayout::setWeight(const Label& label, uint64_t weight)
+        {
+            _state->weights.push_back({ nullptr, label, weight });
+        }
+
+        void BlockLayout::setWeight(const Node* node, uint64_t weight)
+        {
+            _state->weights.push_back({ node, Label{}, weight });
+        }
+
+        void BlockLayout::clearWeights() noexcept
+        {
+            _state->weights.clear();
+        }
+
+        void BlockLayout::setColdThreshold(uint64_t threshold) noexcept
+        {
+            _state->coldThreshold = threshold;
+        }
+
+        void BlockLayout::setColdSectionName(const char* name)
+        {
+            _state->coldSectionName = name != nullptr ? name : "";
+        }
+
+        Error BlockLayout::run(Program& program)
+        {
+            auto& state = *_state;
+            state.stats = {};
+
+            if (state.weights.empty())
+                return Error::None;
+
+            if (auto err = state.cfg.build(program); err != Error::None)
+                return err;
+
+            const auto& cfg = state.cfg;
+            const auto numBlocks = static_cast<uint32_t>(cfg.getBlockCount());
+
+            detail::assignWeights(state, program);
+
+            state.heads.resize(numBlocks);
+            state.tails.resize(numBlocks);
+            state.isCold.assign(numBlocks, 0);
+            state.chainParent.resize(numBlocks);
+            state.chainHead.resize(numBlocks);
+            state.chainTail.resize(numBlocks);
+            state.chainNext.assign(numBlocks, analysis::kInvalidBlock);
+            state.layoutNext.assign(numBlocks, analysis::kInvalidBlock);
+            state.hotOrder.clear();
+            state.coldOrder.clear();
+            for (uint32_t i = 0; i < numBlocks; ++i)
+            {
+                state.heads[i] = cfg.getBlock(i).head;
+                state.tails[i] = cfg.getBlock(i).tail;
+                state.chainParent[i] = i;
+                state.chainHead[i] = i;
+                state.chainTail[i] = i;
+            }
+
+            // Regions are runs of code blocks starting at the program, a section or after data.
+            for (uint32_t regionBegin = 0; regionBegin < numBlocks;)
+            {
+                if (cfg.getBlock(regionBegin).isData)
+                {
+                    regionBegin++;
+                    continue;
+                }
+
+                auto regionEnd = regionBegin + 1;
+                while (regionEnd < numBlocks && !cfg.getBlock(regionEnd).isData
+                       && !cfg.getBlock(regionEnd).head->holds<Section>())
+                {
+                    regionEnd++;
+                }
+
+                // Code falling into data or the next section has to stay in place.
+                if (detail::hasFallthrough(cfg.getBlock(regionEnd - 1)))
+                {
+                    regionBegin = regionEnd;
+                    continue;
+                }
+
+                for (auto blockIdx = regionBegin + 1; blockIdx < regionEnd; ++blockIdx)
+                {
+                    if (state.blockWeights[blockIdx] <= state.coldThreshold)
+                    {
+                        state.isCold[blockIdx] = 1;
+                        state.coldOrder.push_back(blockIdx);
+                    }
+                }
+
+                detail::buildChains(state, regionBegin, regionEnd);
+                detail::orderChains(state, regionBegin, regionEnd);
+
+                regionBegin = regionEnd;
+            }
+
+            for (size_t i = 1; i < state.coldOrder.size(); ++i)
+            {
+                state.layoutNext[state.coldOrder[i - 1]] = state.coldOrder[i];
+            }
+
+            state.stats.numColdBlocks = state.coldOrder.size();
+
+            // Jumps to the fallthrough of blocks that are no longer followed by it.
+            Assembler assembler(program);
+            const auto fixFallthrough = [&](uint32_t blockIdx) -> Error {
+                const auto succ = cfg.getBlock(blockIdx).succs[0];
+                if (succ == analysis::kInvalidBlock || state.layoutNext[blockIdx] == succ)
+                    return Error::None;
+
+                const auto label = detail::getBlockLabel(state, program, succ);
+                if (!label.isValid())
+                    return Error::InvalidLabel;
+
+                assembler.setCursor(state.tails[blockIdx]);
+                if (auto err = assembler.jmp(label); err != Error::None)
+                    return err;
+
+                state.tails[blockIdx] = assembler.getCursor();
+                state.stats.numJumpsInserted++;
+                return Error::None;
+            };
+
+            for (const auto blockIdx : state.hotOrder)
+            {
+                if (blockIdx == analysis::kInvalidBlock)
+                    continue;
+                if (auto err = fixFallthrough(blockIdx); err != Error::None)
+                    return err;
+            }
+            for (const auto blockIdx : state.coldOrder)
+            {
+                if (auto err = fixFallthrough(blockIdx); err != Error::None)
+                    return err;
+            }
+
+            // Cold blocks go into their own section at the end.
+            if (!state.coldOrder.empty())
+            {
+                const auto section = program.createSection(
+                    state.coldSectionName.c_str(), Section::Attribs::Code, 0x1000);
+
+                const auto sectionNode = program.bindSection(section);
+                if (!sectionNode.hasValue())
+                    return sectionNode.error();
+
+                const auto* pos = program.append(sectionNode.value());
+                for (const auto blockIdx : state.coldOrder)
+                {
+                    detail::moveBlock(program, pos, state.heads[blockIdx], state.tails[blockIdx]);
+                    state.stats.coldSize += detail::getBlockSize(state, blockIdx);
+                }
+            }
+
+            // Hot blocks of each region follow the first block in chain order.
+            const Node* pos = nullptr;
+            for (const auto blockIdx : state.hotOrder)
+            {
+                if (blockIdx == analysis::kInvalidBlock)
+                {
+                    pos = nullptr;
+                    continue;
+                }
+
+                if (pos != nullptr)
+                    detail::moveBlock(program, pos, state.heads[blockIdx], state.tails[blockIdx]);
+                else
+                    pos = state.tails[blockIdx];
+
+                state.stats.hotSize += detail::getBlockSize(state, blockIdx);
+            }
+
+            return Error::None;
+        }
+
+        const BlockLayoutStats& BlockLayout::getStats() const noexcept
+        {
+            return _state->stats;
+        }
+
+    } // namespace passes
+
+} // namespace zasm
@@ -0,0 +1,290 @@
+#include "zasm/passes/deadcodeelimination.hpp"
+
+#include "../program/program.state.hpp"
+
+#include <vector>
+#include <zasm/analysis/controlflowgraph.hpp>
+#include <zasm/analysis/liveness.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        struct DeadCodeEliminationState
+        {
+            std::vector<Label> entries;
+            passes::DeadCodeEliminationStats stats;
+
+            analysis::ControlFlowGraph cfg;
+            analysis::Liveness liveness;
+            std::vector<uint8_t> reachable;
+            std::vector<uint32_t> worklist;
+            std::vector<const Node*> removed;
+            // References per label id.
+            std::vector<uint32_t> labelRefs;
+        };
+
+        static bool isGpOrFlags(const operands::Reg& reg) noexcept
+        {
+            return reg.isGp() || reg.getClass() == ZYDIS_REGCLASS_FLAGS;
+        }
+
+        // Instructions that only compute registers and flags, removing them has no other effect than
+        // not producing their results.
+        static bool isRemovable(const Instruction& instr) noexcept
+        {
+            if (!instr.hasMetaData())
+                return false;
+
+            constexpr auto kPrefixes = Instruction::Attribs::Lock | Instruction::Attribs::Rep | Instruction::Attribs::Repe
+                | Instruction::Attribs::Repne;
+            if ((instr.getAttribs() & kPrefixes) != Instruction::Attribs::None)
+                return false;
+
+            switch (instr.getCategory())
+            {
+                case Instruction::Category::Binary:
+                case Instruction::Category::BitByte:
+                case Instruction::Category::Cmov:
+                case Instruction::Category::Convert:
+                case Instruction::Category::DataXfer:
+                case Instruction::Category::Logical:
+                case Instruction::Category::Rotate:
+                case Instruction::Category::SetCC:
+                case Instruction::Category::Shift:
+                    break;
+                default:
+                    return false;
+            }
+
+            // Division faults on zero and overflow.
+            if (instr.getId() == ZYDIS_MNEMONIC_DIV || instr.getId() == ZYDIS_MNEMONIC_IDIV)
+                return false;
+
+            const auto& ops = instr.getOperands();
+            for (size_t i = 0; i < instr.getOperandCount(); ++i)
+            {
+                // Memory may fault or be shared, lea only computes the address.
+                if (const auto* mem = ops[i].getIf<operands::Mem>(); mem != nullptr)
+                {
+                    if (instr.getId() != ZYDIS_MNEMONIC_LEA)
+                        return false;
+
+                    if (mem->getBase().isVirtual() || mem->getIndex().isVirtual())
+                        return false;
+                }
+
+                // Control, debug and segment registers may fault or have side effects.
+                if (const auto* reg = ops[i].getIf<operands::Reg>(); reg != nullptr && !isGpOrFlags(*reg))
+                    return false;
+
+                // Liveness does not track virtual registers, their results would always look dead.
+                if (const auto* reg = ops[i].getIf<operands::Reg>(); reg != nullptr && reg->isVirtual())
+                    return false;
+            }
+
+            return true;
+        }
+
+        static void transfer(analysis::LiveSet& live, const analysis::RegAccess& access) noexcept
+        {
+            live.regs -= access.def;
+            live.regs |= access.use;
+            live.flags &= ~access.flagsDef;
+            live.flags |= access.flagsUse;
+        }
+
+        static void markReachable(DeadCodeEliminationState& state, const Program& program)
+        {
+            const auto& cfg = state.cfg;
+            const auto numBlocks = static_cast<uint32_t>(cfg.getBlockCount());
+
+            state.reachable.assign(numBlocks, 0);
+            for (uint32_t i = 0; i < numBlocks; ++i)
+            {
+                state.reachable[i] = cfg.isReachable(i) ? 1 : 0;
+            }
+
+            // Entries given by the user and everything they reach.
+            const auto& labels = program.getState().labels;
+            state.worklist.clear();
+            for (const auto& label : state.entries)
+            {
+                const auto labelIdx = static_cast<size_t>(label.getId());
+                if (!label.isValid() || labelIdx >= labels.size())
+                    continue;
+
+                const auto blockIdx = cfg.getBlockOf(labels[labelIdx].node);
+                if (blockIdx != analysis::kInvalidBlock && state.reachable[blockIdx] == 0)
+                {
+                    state.reachable[blockIdx] = 1;
+                    state.worklist.push_back(blockIdx);
+                }
+            }
+
+            while (!state.worklist.empty())
+            {
+                const auto blockIdx = state.worklist.back();
+                state.worklist.pop_back();
+
+                for (const auto succ : cfg.getBlock(blockIdx).succs)
+                {
+                    if (succ != analysis::kInvalidBlock && state.reachable[succ] == 0)
+                    {
+                        state.reachable[succ] = 1;
+                        state.worklist.push_back(succ);
+                    }
+                }
+            }
+        }
+
+        static void removeNode(DeadCodeEliminationState& state, const Node* node)
+        {
+            state.removed.push_back(node);
+            state.stats.numRemovedInstructions++;
+            state.stats.bytesSaved += node->get<Instruction>().getLength();
+        }
+
+        static void collectDeadInstructions(DeadCodeEliminationState& state, ZydisMachineMode mode)
+        {
+            const auto& cfg = state.cfg;
+            for (uint32_t blockIdx = 0; blockIdx < cfg.getBlockCount(); ++blockIdx)
+            {
+                const auto& block = cfg.getBlock(blockIdx);
+                if (block.isData)
+                    continue;
+
+                if (state.reachable[blockIdx] == 0)
+                {
+                    state.stats.numUnreachableBlocks++;
+                    for (const auto* node = block.head;; node = node->getNext())
+                    {
+                        if (node->holds<Instruction>())
+                            removeNode(state, node);
+                        if (node == block.tail)
+                            break;
+                    }
+                    continue;
+                }
+
+                // Walk backwards, results only read by removed instructions are dead as well.
+                auto live = state.liveness.getLiveOut(block.tail);
+                for (const auto* node = block.tail;; node = node->getPrev())
+                {
+                    if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+                    {
+                        const auto access = analysis::getRegAccess(*instr, mode);
+                        const bool isDead = !access.write.intersects(live.regs) && (access.flagsDef & live.flags) == 0;
+                        if (isDead && isRemovable(*instr))
+                            removeNode(state, node);
+                        else
+                            transfer(live, access);
+                    }
+                    if (node == block.head)
+                        break;
+                }
+            }
+        }
+
+        static void addLabelRef(DeadCodeEliminationState& state, const Label& label)
+        {
+            const auto labelIdx = static_cast<size_t>(label.getId());
+            if (label.isValid() && labelIdx < state.labelRefs.size())
+                state.labelRefs[labelIdx]++;
+        }
+
+        static void removeUnreferencedLabels(DeadCodeEliminationState& state, Program& program)
+        {
+            state.labelRefs.assign(program.getState().labels.size(), 0);
+            for (const auto& label : state.entries)
+            {
+                addLabelRef(state, label);
+            }
+
+            for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+            {
+                if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+                {
+                    const auto& ops = instr->getOperands();
+                    for (size_t i = 0; i < instr->getOperandCount(); ++i)
+                    {
+                        if (const auto* label = ops[i].getIf<Label>(); label != nullptr)
+                            addLabelRef(state, *label);
+                        else if (const auto* mem = ops[i].getIf<operands::Mem>(); mem != nullptr && mem->hasLabel())
+                            addLabelRef(state, mem->getLabel());
+                    }
+                }
+                else if (const auto* embedded = node->getIf<EmbeddedLabel>(); embedded != nullptr)
+                {
+                    addLabelRef(state, embedded->getLabel());
+                    addLabelRef(state, embedded->getRelativeLabel());
+                }
+            }
+
+            for (const auto* node = program.getHead(); node != nullptr;)
+            {
+                const auto* next = node->getNext();
+
+                const auto* label = node->getIf<Label>();
+                if (label != nullptr && state.labelRefs[static_cast<size_t>(label->getId())] == 0
+                    && program.getLabelName(*label) == nullptr)
+                {
+                    program.destroy(node);
+                    state.stats.numRemovedLabels++;
+                }
+
+                node = next;
+            }
+        }
+
+    } // namespace detail
+
+    namespace passes
+    {
+        DeadCodeElimination::DeadCodeElimination()
+            : _state(new detail::DeadCodeEliminationState())
+        {
+        }
+
+        DeadCodeElimination::~DeadCodeElimination()
+        {
+            delete _state;
+        }
+
+        void DeadCodeElimination::addEntry(const Label& label)
+        {
+            _state->entries.push_back(label);
+        }
+
+        Error DeadCodeElimination::run(Program& program)
+        {
+            auto& state = *_state;
+            state.stats = {};
+
+            if (auto err = state.cfg.build(program); err != Error::None)
+                return err;
+            if (auto err = state.liveness.analyze(program); err != Error::None)
+                return err;
+
+            detail::markReachable(state, program);
+
+            state.removed.clear();
+            detail::collectDeadInstructions(state, program.getMode());
+            for (const auto* node : state.removed)
+            {
+                program.destroy(node);
+            }
+
+            detail::removeUnreferencedLabels(state, program);
+
+            return Error::None;
+        }
+
+        const DeadCodeEliminationStats& DeadCodeElimination::getStats() const noexcept
+        {
+            return _state->stats;
+        }
+
+    } // namespace passes
+
+} // namespace zasm
@@ -0,0 +1,267 @@
+#include "zasm/passes/jumpthreading.hpp"
+
+#include "../program/program.state.hpp"
+
+#include <vector>
+#include <zasm/assembler/assembler.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        enum class ResolveState : uint8_t
+        {
+            Unvisited,
+            InProgress,
+            Done,
+        };
+
+        struct JumpThreadingState
+        {
+            passes::JumpThreadingStats stats;
+            // Final destination per label id, valid once the state is Done.
+            std::vector<Label> targets;
+            std::vector<ResolveState> resolveStates;
+            std::vector<Label> chain;
+        };
+
+        static ZydisMnemonic getInvertedBranch(ZydisMnemonic mnemonic) noexcept
+        {
+            switch (mnemonic)
+            {
+                case ZYDIS_MNEMONIC_JB:
+                    return ZYDIS_MNEMONIC_JNB;
+                case ZYDIS_MNEMONIC_JNB:
+                    return ZYDIS_MNEMONIC_JB;
+                case ZYDIS_MNEMONIC_JBE:
+                    return ZYDIS_MNEMONIC_JNBE;
+                case ZYDIS_MNEMONIC_JNBE:
+                    return ZYDIS_MNEMONIC_JBE;
+                case ZYDIS_MNEMONIC_JL:
+                    return ZYDIS_MNEMONIC_JNL;
+                case ZYDIS_MNEMONIC_JNL:
+                    return ZYDIS_MNEMONIC_JL;
+                case ZYDIS_MNEMONIC_JLE:
+                    return ZYDIS_MNEMONIC_JNLE;
+                case ZYDIS_MNEMONIC_JNLE:
+                    return ZYDIS_MNEMONIC_JLE;
+                case ZYDIS_MNEMONIC_JO:
+                    return ZYDIS_MNEMONIC_JNO;
+                case ZYDIS_MNEMONIC_JNO:
+                    return ZYDIS_MNEMONIC_JO;
+                case ZYDIS_MNEMONIC_JP:
+                    return ZYDIS_MNEMONIC_JNP;
+                case ZYDIS_MNEMONIC_JNP:
+                    return ZYDIS_MNEMONIC_JP;
+                case ZYDIS_MNEMONIC_JS:
+                    return ZYDIS_MNEMONIC_JNS;
+                case ZYDIS_MNEMONIC_JNS:
+                    return ZYDIS_MNEMONIC_JS;
+                case ZYDIS_MNEMONIC_JZ:
+                    return ZYDIS_MNEMONIC_JNZ;
+                case ZYDIS_MNEMONIC_JNZ:
+                    return ZYDIS_MNEMONIC_JZ;
+                default:
+                    return ZYDIS_MNEMONIC_INVALID;
+            }
+        }
+
+        // Returns the label operand of jmp and the conditional branches on flags.
+        static const Label* getBranchTarget(const Node* node) noexcept
+        {
+            if (node == nullptr)
+                return nullptr;
+
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr || instr->getOperandCount() == 0)
+                return nullptr;
+
+            const auto mnemonic = instr->getId();
+            if (mnemonic != ZYDIS_MNEMONIC_JMP && getInvertedBranch(mnemonic) == ZYDIS_MNEMONIC_INVALID)
+                return nullptr;
+
+            return instr->getOperands()[0].getIf<Label>();
+        }
+
+        static const Node* getLabelNode(const Program& program, const Label& label) noexcept
+        {
+            const auto& labels = program.getState().labels;
+            const auto labelIdx = static_cast<size_t>(label.getId());
+            if (!label.isValid() || labelIdx >= labels.size())
+                return nullptr;
+            return labels[labelIdx].node;
+        }
+
+        // Returns true if only labels are between node and the binding of label.
+        static bool isBoundAfter(const Program& program, const Node* node, const Label& label) noexcept
+        {
+            const auto* labelNode = getLabelNode(program, label);
+            if (labelNode == nullptr)
+                return false;
+
+            for (const auto* cur = node->getNext(); cur != nullptr; cur = cur->getNext())
+            {
+                if (cur == labelNode)
+                    return true;
+                if (!cur->holds<Label>())
+                    return false;
+            }
+            return false;
+        }
+
+        // Returns the label of the jmp that is the first instruction at the label.
+        static const Label* getChainNext(const Program& program, const Label& label) noexcept
+        {
+            const auto* node = getLabelNode(program, label);
+            while (node != nullptr && node->holds<Label>())
+            {
+                node = node->getNext();
+            }
+
+            const auto* target = getBranchTarget(node);
+            if (target == nullptr || node->get<Instruction>().getId() != ZYDIS_MNEMONIC_JMP)
+                return nullptr;
+
+            return target;
+        }
+
+        // Follows the unconditional jumps starting at the label, every label of a chain is resolved once.
+        static Label resolveTarget(JumpThreadingState& state, const Program& program, const Label& label)
+        {
+            auto target = label;
+
+            auto& chain = state.chain;
+            chain.clear();
+
+            for (;;)
+            {
+                const auto labelIdx = static_cast<size_t>(target.getId());
+                if (!target.isValid() || labelIdx >= state.targets.size())
+                    break;
+
+                if (state.resolveStates[labelIdx] == ResolveState::Done)
+                {
+                    target = state.targets[labelIdx];
+                    break;
+                }
+                if (state.resolveStates[labelIdx] == ResolveState::InProgress)
+                {
+                    // Jumps in a cycle, stop at the label.
+                    break;
+                }
+
+                state.resolveStates[labelIdx] = ResolveState::InProgress;
+                chain.push_back(target);
+
+                const auto* next = getChainNext(program, target);
+                if (next == nullptr)
+                    break;
+
+                target = *next;
+            }
+
+            for (const auto& entry : chain)
+            {
+                const auto labelIdx = static_cast<size_t>(entry.getId());
+                state.targets[labelIdx] = target;
+                state.resolveStates[labelIdx] = ResolveState::Done;
+            }
+
+            return target;
+        }
+
+    } // namespace detail
+
+    namespace passes
+    {
+        JumpThreading::JumpThreading()
+            : _state(new detail::JumpThreadingState())
+        {
+        }
+
+        JumpThreading::~JumpThreading()
+        {
+            delete _state;
+        }
+
+        Error JumpThreading::run(Program& program)
+        {
+            auto& state = *_state;
+            state.stats = {};
+
+            const auto numLabels = program.getState().labels.size();
+            state.targets.assign(numLabels, Label{});
+            state.resolveStates.assign(numLabels, detail::ResolveState::Unvisited);
+
+            Assembler assembler(program);
+
+            for (const auto* node = program.getHead(); node != nullptr;)
+            {
+                const auto* next = node->getNext();
+
+                const auto* label = detail::getBranchTarget(node);
+                if (label == nullptr)
+                {
+                    node = next;
+                    continue;
+                }
+
+                const auto& instr = node->get<Instruction>();
+                const auto target = detail::resolveTarget(state, program, *label);
+
+                // Branches to the next node do nothing.
+                if (detail::isBoundAfter(program, node, *label) || detail::isBoundAfter(program, node, target))
+                {
+                    program.destroy(node);
+                    state.stats.numRemoved++;
+                    node = next;
+                    continue;
+                }
+
+                // jcc L1; jmp L2; L1: -> jncc L2; L1:
+                const auto* jmpTarget = detail::getBranchTarget(next);
+                if (instr.getId() != ZYDIS_MNEMONIC_JMP && jmpTarget != nullptr
+                    && next->get<Instruction>().getId() == ZYDIS_MNEMONIC_JMP && detail::isBoundAfter(program, next, *label))
+                {
+                    const Operand newTarget = detail::resolveTarget(state, program, *jmpTarget);
+
+                    assembler.setCursor(next);
+                    if (auto err = assembler.emit(
+                            instr.getAttribs(), detail::getInvertedBranch(instr.getId()), 1, &newTarget);
+                        err != Error::None)
+                    {
+                        return err;
+                    }
+
+                    const auto* emitted = assembler.getCursor();
+                    program.destroy(node);
+                    program.destroy(next);
+                    state.stats.numInverted++;
+                    node = emitted->getNext();
+                    continue;
+                }
+
+                if (target.getId() != label->getId())
+                {
+                    auto ops = instr.getOperands();
+                    ops[0] = target;
+
+                    program.insertAfter(node, program.createNode(instr, ops));
+                    program.destroy(node);
+                    state.stats.numThreaded++;
+                }
+
+                node = next;
+            }
+
+            return Error::None;
+        }
+
+        const JumpThreadingStats& JumpThreading::getStats() const noexcept
+        {
+            return _state->stats;
+        }
+
+    } // namespace passes
+
+} // namespace zasm
@@ -0,0 +1,384 @@
+#include "zasm/passes/peephole.hpp"
+
+#include "../analysis/blocks.hpp"
+
+#include <array>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <vector>
+#include <zasm/analysis/liveness.hpp>
+#include <zasm/assembler/assembler.hpp>
+#include <zasm/core/math.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        constexpr uint32_t kStatusFlags = ZYDIS_CPUFLAG_CF | ZYDIS_CPUFLAG_PF | ZYDIS_CPUFLAG_AF | ZYDIS_CPUFLAG_ZF
+            | ZYDIS_CPUFLAG_SF | ZYDIS_CPUFLAG_OF;
+
+        struct PeepholeState
+        {
+            passes::PeepholeStats stats;
+            ZydisMachineMode mode{};
+            analysis::Liveness liveness;
+            BlockList blockList;
+            // Flags live after each instruction by node id, nodes created by the pass have none and are
+            // treated as if all flags were live.
+            std::vector<uint32_t> flagsLiveOut;
+        };
+
+        // Shared by all rules during a run, the assembler keeps its generator cache across rewrites.
+        struct PeepholeContext
+        {
+            PeepholeState& state;
+            Program& program;
+            Assembler assembler;
+
+            PeepholeContext(PeepholeState& state_, Program& program_)
+                : state(state_)
+                , program(program_)
+                , assembler(program_)
+            {
+            }
+        };
+
+        // Returns true if the rule rewrote the node, next is set to the node following the rewritten
+        // sequence. The instruction reference is invalid once its node is destroyed.
+        using PeepholeRuleFn = bool (*)(PeepholeContext&, const Node*, const Instruction&, const Node*&);
+
+        struct PeepholeRule
+        {
+            ZydisMnemonic mnemonic;
+            PeepholeRuleFn apply;
+        };
+
+        static bool areFlagsDead(const PeepholeState& state, const Node* node) noexcept
+        {
+            const auto idx = static_cast<size_t>(node->getId());
+            if (idx >= state.flagsLiveOut.size())
+                return false;
+            return (state.flagsLiveOut[idx] & kStatusFlags) == 0;
+        }
+
+        static const Instruction* getInstruction(const Node* node) noexcept
+        {
+            if (node == nullptr)
+                return nullptr;
+            const auto* instr = node->getIf<Instruction>();
+            if (instr == nullptr || !instr->hasMetaData())
+                return nullptr;
+            return instr;
+        }
+
+        // Replaces the nodes from first to last with the single instruction emit generates.
+        template<typename TEmit>
+        static bool replace(PeepholeContext& ctx, const Node* first, const Node* last, const Node*& next, TEmit&& emit)
+        {
+            auto& assembler = ctx.assembler;
+            assembler.setCursor(last);
+            if (emit(assembler) != Error::None)
+                return false;
+
+            next = assembler.getCursor()->getNext();
+
+            size_t oldLength = 0;
+            for (const auto* node = first;;)
+            {
+                const auto* nodeNext = node->getNext();
+                oldLength += node->get<Instruction>().getLength();
+                ctx.program.destroy(node);
+                if (node == last)
+                    break;
+                node = nodeNext;
+            }
+
+            const auto newLength = assembler.getCursor()->get<Instruction>().getLength();
+
+            ctx.state.stats.numReplaced++;
+            if (oldLength > newLength)
+                ctx.state.stats.bytesSaved += oldLength - newLength;
+            return true;
+        }
+
+        static void remove(PeepholeContext& ctx, const Node* node, const Node*& next)
+        {
+            next = node->getNext();
+            ctx.state.stats.numRemoved++;
+            ctx.state.stats.bytesSaved += node->get<Instruction>().getLength();
+            ctx.program.destroy(node);
+        }
+
+        // mov reg, reg
+        static bool removeSelfMove(PeepholeContext& ctx, const Node* node, const Instruction& instr, const Node*& next)
+        {
+            const auto& ops = instr.getOperands();
+            const auto* dst = ops[0].getIf<operands::Reg>();
+            const auto* src = ops[1].getIf<operands::Reg>();
+            if (dst == nullptr || src == nullptr || *dst != *src || !dst->isGp())
+                return false;
+
+            // Writing a 32 bit register clears the upper half in 64 bit mode.
+            if (dst->isGp32() && ctx.state.mode == ZYDIS_MACHINE_MODE_LONG_64)
+                return false;
+
+            remove(ctx, node, next);
+            return true;
+        }
+
+        // mov reg, 0 -> xor reg32, reg32
+        static bool zeroIdiom(PeepholeContext& ctx, const Node* node, const Instruction& instr, const Node*& next)
+        {
+            const auto& ops = instr.getOperands();
+            const auto* dst = ops[0].getIf<operands::Reg>();
+            const auto* imm = ops[1].getIf<operands::Imm>();
+            if (dst == nullptr || imm == nullptr || imm->value<int64_t>() != 0)
+                return false;
+            if (!dst->isGp32() && !dst->isGp64())
+                return false;
+            if (!areFlagsDead(ctx.state, node))
+                return false;
+
+            const auto reg = dst->as<operands::Gp>().r32();
+            return replace(ctx, node, node, next, [&](Assembler& a) { return a.xor_(reg, reg); });
+        }
+
+        // mov reg64, imm -> mov reg32, imm
+        static bool narrowMoveImm(PeepholeContext& ctx, const Node* node, const Instruction& instr, const Node*& next)
+        {
+            const auto& ops = instr.getOperands();
+            const auto* dst = ops[0].getIf<operands::Reg>();
+            const auto* imm = ops[1].getIf<operands::Imm>();
+            if (dst == nullptr || imm == nullptr || !dst->isGp64())
+                return false;
+
+            const auto value = imm->value<int64_t>();
+            if (value < 0 || value > std::numeric_limits<uint32_t>::max())
+                return false;
+
+            const auto reg = dst->as<operands::Gp>().r32();
+            const auto newImm = operands::Imm(static_cast<uint32_t>(value));
+            return replace(ctx, node, node, next, [&](Assembler& a) { return a.mov(reg, newImm); });
+        }
+
+        // jmp label; label:
+        static bool removeJumpToNext(PeepholeContext& ctx, const Node* node, const Instruction& instr, const Node*& next)
+        {
+            const auto* target = instr.getOperands()[0].getIf<operands::Label>();
+            if (target == nullptr)
+                return false;
+
+            // Only labels may be bound between the jump and its target.
+            for (const auto* cur = node->getNext(); cur != nullptr; cur = cur->getNext())
+            {
+                const auto* label = cur->getIf<Label>();
+                if (label == nullptr)
+                    return false;
+
+                if (label->getId() == target->getId())
+                {
+                    remove(ctx, node, next);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        // Value added to the register by add reg, imm or sub reg, imm.
+        static bool getAddend(const Instruction& instr, operands::Reg& reg, int64_t& addend) noexcept
+        {
+            const auto mnemonic = instr.getId();
+            if (mnemonic != ZYDIS_MNEMONIC_ADD && mnemonic != ZYDIS_MNEMONIC_SUB)
+                return false;
+
+            const auto& ops = instr.getOperands();
+            const auto* dst = ops[0].getIf<operands::Reg>();
+            const auto* imm = ops[1].getIf<operands::Imm>();
+            if (dst == nullptr || imm == nullptr || (!dst->isGp32() && !dst->isGp64()))
+                return false;
+
+            reg = *dst;
+            addend = mnemonic == ZYDIS_MNEMONIC_ADD ? imm->value<int64_t>() : -imm->value<int64_t>();
+            return true;
+        }
+
+        // Wraps 32 bit sums, returns false if the sum can not be encoded as a sign extended imm32.
+        static bool normalizeSum(const operands::Reg& reg, int64_t& sum) noexcept
+        {
+            if (reg.isGp32())
+                sum = static_cast<int32_t>(static_cast<uint32_t>(sum));
+            return sum >= std::numeric_limits<int32_t>::min() && sum <= std::numeric_limits<int32_t>::max();
+        }
+
+        // add reg, imm; sub reg, imm; ... -> add reg, sum
+        static bool foldAddSub(PeepholeContext& ctx, const Node* node, const Instruction& instr, const Node*& next)
+        {
+            operands::Reg reg;
+            int64_t sum = 0;
+            if (!getAddend(instr, reg, sum) || !normalizeSum(reg, sum))
+                return false;
+
+            const auto* last = node;
+            size_t count = 1;
+            for (const auto* cur = node->getNext(); cur != nullptr; cur = cur->getNext())
+            {
+                const auto* curInstr = getInstruction(cur);
+                if (curInstr == nullptr)
+                    break;
+
+                operands::Reg curReg;
+                int64_t addend = 0;
+                if (!getAddend(*curInstr, curReg, addend) || curReg != reg)
+                    break;
+
+                auto newSum = sum + addend;
+                if (!normalizeSum(reg, newSum))
+                    break;
+
+                sum = newSum;
+                last = cur;
+                count++;
+            }
+
+            // A single instruction only gets shorter as inc or dec or if it does nothing.
+            if (count == 1 && sum != 0 && sum != 1 && sum != -1)
+                return false;
+            if (!areFlagsDead(ctx.state, last))
+                return false;
+
+            // Writing a 32 bit register clears the upper half in 64 bit mode, the write has to stay.
+            const bool keepsWrite = reg.isGp32() && ctx.state.mode == ZYDIS_MACHINE_MODE_LONG_64;
+            if (sum == 0 && keepsWrite)
+            {
+                const auto gp = reg.as<operands::Gp>();
+                return replace(ctx, node, last, next, [&](Assembler& a) { return a.mov(gp, gp); });
+            }
+
+            if (sum == 0)
+            {
+                for (const auto* cur = node; count > 0; --count)
+                {
+                    const auto* curNext = cur->getNext();
+                    remove(ctx, cur, next);
+                    cur = curNext;
+                }
+                return true;
+            }
+
+            const auto gp = reg.as<operands::Gp>();
+            return replace(ctx, node, last, next, [&](Assembler& a) {
+                if (sum == 1)
+                    return a.inc(gp);
+                if (sum == -1)
+                    return a.dec(gp);
+                return a.add(gp, operands::Imm(sum));
+            });
+        }
+
+        // Rules of the same mnemonic are tried in order.
+        static constexpr PeepholeRule kPeepholeRules[] = {
+            { ZYDIS_MNEMONIC_MOV, removeSelfMove },
+            { ZYDIS_MNEMONIC_MOV, zeroIdiom },
+            { ZYDIS_MNEMONIC_MOV, narrowMoveImm },
+            { ZYDIS_MNEMONIC_JMP, removeJumpToNext },
+            { ZYDIS_MNEMONIC_ADD, foldAddSub },
+            { ZYDIS_MNEMONIC_SUB, foldAddSub },
+        };
+        static_assert(std::size(kPeepholeRules) <= 32);
+
+        // Bit mask of the rules per mnemonic.
+        static const std::array<uint32_t, ZYDIS_MNEMONIC_MAX_VALUE + 1>& getRuleMasks()
+        {
+            static const auto masks = [] {
+                std::array<uint32_t, ZYDIS_MNEMONIC_MAX_VALUE + 1> res{};
+                for (size_t i = 0; i < std::size(kPeepholeRules); ++i)
+                {
+                    res[kPeepholeRules[i].mnemonic] |= 1U << i;
+                }
+                return res;
+            }();
+            return masks;
+        }
+
+        static void computeFlagsLiveOut(PeepholeState& state, const Program& program)
+        {
+            state.liveness.analyze(program);
+            buildBlocks(program, state.blockList);
+
+            state.flagsLiveOut.assign(state.blockList.nodeBlock.size(), analysis::kAllFlags);
+            for (const auto& block : state.blockList.blocks)
+            {
+                if (block.isData)
+                    continue;
+
+                // Liveness at the tail of a block does not require a walk.
+                auto live = state.liveness.getLiveOut(block.tail).flags;
+                for (const auto* node = block.tail;; node = node->getPrev())
+                {
+                    if (const auto* instr = node->getIf<Instruction>(); instr != nullptr)
+                    {
+                        state.flagsLiveOut[static_cast<size_t>(node->getId())] = live;
+
+                        const auto access = analysis::getRegAccess(*instr, state.mode);
+                        live = (live & ~access.flagsDef) | access.flagsUse;
+                    }
+                    if (node == block.head)
+                        break;
+                }
+            }
+        }
+
+    } // namespace detail
+
+    namespace passes
+    {
+        Peephole::Peephole()
+            : _state(new detail::PeepholeState())
+        {
+        }
+
+        Peephole::~Peephole()
+        {
+            delete _state;
+        }
+
+        Error Peephole::run(Program& program)
+        {
+            auto& state = *_state;
+            state.stats = {};
+            state.mode = program.getMode();
+
+            detail::computeFlagsLiveOut(state, program);
+
+            detail::PeepholeContext ctx(state, program);
+            const auto& ruleMasks = detail::getRuleMasks();
+            for (const auto* node = program.getHead(); node != nullptr;)
+            {
+                const auto* next = node->getNext();
+
+                if (const auto* instr = detail::getInstruction(node); instr != nullptr)
+                {
+                    for (auto mask = ruleMasks[instr->getId()]; mask != 0; mask &= mask - 1)
+                    {
+                        const auto& rule = detail::kPeepholeRules[math::findFirstSet(mask)];
+                        if (rule.apply(ctx, node, *instr, next))
+                            break;
+                    }
+                }
+
+                node = next;
+            }
+
+            return Error::None;
+        }
+
+        const PeepholeStats& Peephole::getStats() const noexcept
+        {
+            return _state->stats;
+        }
+
+    } // namespace passes
+
+} // namespace zasm
@@ -0,0 +1,997 @@
+#include "zasm/passes/registerallocator.hpp"
+
+#include "../analysis/blocks.hpp"
+
+#include <algorithm>
+#include <array>
+#include <functional>
+#include <queue>
+#include <utility>
+#include <vector>
+#include <zasm/assembler/assembler.hpp>
+#include <zasm/core/math.hpp>
+
+namespace zasm
+{
+    namespace detail
+    {
+        constexpr size_t kNumGpRegs = 16;
+        constexpr int8_t kSpilled = -1;
+        constexpr uint32_t kNoInterval = 0xFFFFFFFFu;
+
+        // Access of a virtual register by a single instruction, all sizes of the register are merged.
+        constexpr uint8_t kVirtRead = 1U << 0;
+        constexpr uint8_t kVirtWrite = 1U << 1;
+        // The write replaces the entire register, partial writes keep the previous value alive.
+        constexpr uint8_t kVirtFullWrite = 1U << 2;
+
+        struct VirtAccess
+        {
+            uint32_t index{};
+            uint8_t flags{};
+        };
+
+        struct InstrInfo
+        {
+            const zasm::Node* node{};
+            // Range into RegisterAllocatorState::accesses.
+            uint32_t accessBegin{};
+            uint32_t accessEnd{};
+            // Physical registers by index, partial writes are also reads.
+            uint32_t physRead{};
+            uint32_t physWrite{};
+            // Calls also write the call clobbered registers, those are not values produced by the program.
+            bool isCall{};
+        };
+
+        // Positions are 2 * i for the reads and 2 * i + 1 for the writes of the i-th instruction, a
+        // register read for the last time may be assigned to one written by the same instruction.
+        struct LiveRange
+        {
+            uint32_t start{ kNoInterval };
+            uint32_t end{};
+        };
+
+        struct RegisterAllocatorState
+        {
+            analysis::RegSet allocatable;
+            bool hasAllocatable{};
+            analysis::RegSet callClobbered;
+            bool hasCallClobbered{};
+            operands::Gp spillBase;
+            int32_t spillOffset{};
+            passes::RegisterAllocatorStats stats;
+
+            ZydisMachineMode mode{};
+            uint32_t numVirtual{};
+            BlockList blockList;
+            std::vector<InstrInfo> instrs;
+            std::vector<VirtAccess> accesses;
+            // Instructions of block i are instrs[blockFirst[i]] to instrs[blockEnd[i]].
+            std::vector<uint32_t> blockFirst;
+            std::vector<uint32_t> blockEnd;
+            // Live interval per virtual register.
+            std::vector<LiveRange> intervals;
+            // Virtual registers accessed as 8 bit, only the first four registers have those in 32 bit mode.
+            std::vector<uint8_t> usesGp8;
+            // Virtual registers used next to ah, ch, dh or bh, those can not be encoded with REX.
+            std::vector<uint8_t> usesNoRex;
+            // Sorted and disjoint ranges in which the physical register is used by the program.
+            std::array<std::vector<LiveRange>, kNumGpRegs> fixed;
+            // Physical index per virtual register, kSpilled if kept in memory.
+            std::vector<int8_t> assigned;
+            std::vector<int32_t> slots;
+        };
+
+        static uint32_t getRegBit(const operands::Reg& reg) noexcept
+        {
+            const auto physIndex = reg.getPhysicalIndex();
+            if (physIndex < 0 || static_cast<size_t>(physIndex) >= kNumGpRegs)
+                return 0;
+            return 1U << physIndex;
+        }
+
+        static uint32_t getRegMask(const analysis::RegSet& regs, ZydisMachineMode mode) noexcept
+        {
+            uint32_t mask = 0;
+            regs.forEach([&](const operands::Reg& reg) {
+                if (!reg.isGp())
+                    return;
+                // Only the first eight registers exist outside of 64 bit mode.
+                if (mode != ZYDIS_MACHINE_MODE_LONG_64 && reg.getPhysicalIndex() >= 8)
+                    return;
+                mask |= getRegBit(reg);
+            });
+            return mask;
+        }
+
+        static uint32_t getDefaultAllocatableMask(ZydisMachineMode mode) noexcept
+        {
+            constexpr uint32_t kStackRegs = (1U << 4) | (1U << 5);
+            const uint32_t allRegs = mode == ZYDIS_MACHINE_MODE_LONG_64 ? 0xFFFFU : 0xFFU;
+            return allRegs & ~kStackRegs;
+        }
+
+        static bool isFullWrite(const operands::Reg& reg) noexcept
+        {
+            // 32 bit writes clear the upper half in 64 bit mode and are the full register otherwise.
+            return reg.isGp64() || reg.isGp32();
+        }
+
+        static operands::Gp toPhysical(const operands::Reg& reg, int8_t physIndex) noexcept
+        {
+            const operands::Gp root(static_cast<ZydisRegister>(ZYDIS_REGISTER_RAX + physIndex));
+            switch (reg.getClass())
+            {
+                case ZYDIS_REGCLASS_GPR8:
+                    return root.r8();
+                case ZYDIS_REGCLASS_GPR16:
+                    return root.r16();
+                case ZYDIS_REGCLASS_GPR32:
+                    return root.r32();
+                default:
+                    return root.r64();
+            }
+        }
+
+        static bool addVirtAccess(RegisterAllocatorState& state, InstrInfo& info, const operands::Reg& reg, uint8_t flags)
+        {
+            const auto index = reg.getVirtualIndex();
+            if (index >= state.numVirtual)
+                return false;
+
+            if (reg.isGp8())
+                state.usesGp8[index] = 1;
+
+            for (auto i = info.accessBegin; i < info.accessEnd; ++i)
+            {
+                if (state.accesses[i].index == index)
+                {
+                    state.accesses[i].flags |= flags;
+                    return true;
+                }
+            }
+
+            state.accesses.push_back(VirtAccess{ index, flags });
+            info.accessEnd++;
+            return true;
+        }
+
+        static bool addRegAccess(RegisterAllocatorState& state, InstrInfo& info, const operands::Reg& reg, uint8_t access)
+        {
+            const bool isRead = (access & (ZYDIS_OPERAND_ACTION_READ | ZYDIS_OPERAND_ACTION_CONDREAD)) != 0;
+            const bool isWrite = (access & (ZYDIS_OPERAND_ACTION_WRITE | ZYDIS_OPERAND_ACTION_CONDWRITE)) != 0;
+            const bool isFull = (access & ZYDIS_OPERAND_ACTION_WRITE) != 0 && isFullWrite(reg);
+
+            if (reg.isVirtual())
+            {
+                uint8_t flags = 0;
+                if (isRead || (isWrite && !isFull))
+                    flags |= kVirtRead;
+                if (isWrite)
+                    flags |= kVirtWrite;
+                if (isFull)
+                    flags |= kVirtFullWrite;
+                return addVirtAccess(state, info, reg, flags);
+            }
+
+            if (!reg.isGp())
+                return true;
+
+            const auto bit = getRegBit(reg);
+            if (isRead || (isWrite && !isFull))
+                info.physRead |= bit;
+            if (isWrite)
+                info.physWrite |= bit;
+
+            return true;
+        }
+
+        static bool addMemAccess(RegisterAllocatorState& state, InstrInfo& info, const operands::Mem& mem)
+        {
+            constexpr uint8_t kRead = ZYDIS_OPERAND_ACTION_READ;
+            return addRegAccess(state, info, mem.getBase(), kRead) && addRegAccess(state, info, mem.getIndex(), kRead);
+        }
+
+        static Error collectAccesses(RegisterAllocatorState& state, const Program& program, uint32_t callClobbered)
+        {
+            state.instrs.clear();
+            state.accesses.clear();
+
+            for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
+            {
+                const auto* instr = node->getIf<Instruction>();
+                if (instr == nullptr)
+                    continue;
+
+                InstrInfo info{ node, static_cast<uint32_t>(state.accesses.size()),
+                                static_cast<uint32_t>(state.accesses.size()) };
+
+                bool usesGp8Hi = false;
+                const auto& ops = instr->getOperands();
+                for (size_t i = 0; i < instr->getOperandCount(); ++i)
+                {
+                    // Without meta data every register is assumed to be read and partially written.
+                    constexpr uint8_t kUnknownAccess = ZYDIS_OPERAND_ACTION_READ | ZYDIS_OPERAND_ACTION_CONDWRITE;
+                    const uint8_t access = instr->hasMetaData() ? instr->getAccess()[i] : kUnknownAccess;
+
+                    bool valid = true;
+                    if (const auto* reg = ops[i].getIf<operands::Reg>(); reg != nullptr)
+                    {
+                        usesGp8Hi |= reg->isGp8Hi();
+                        valid = addRegAccess(state, info, *reg, access);
+                    }
+                    else if (const auto* mem = ops[i].getIf<operands::Mem>(); mem != nullptr)
+                        valid = addMemAccess(state, info, *mem);
+
+                    if (!valid)
+                        return Error::InvalidParameter;
+                }
+
+                if (usesGp8Hi)
+                {
+                    for (auto j = info.accessBegin; j < info.accessEnd; ++j)
+                        state.usesNoRex[state.accesses[j].index] = 1;
+                }
+
+                if (getBranchKind(*instr) == BranchKind::Call)
+                {
+                    info.physWrite |= callClobbered;
+                    info.isCall = true;
+                }
+
+                state.instrs.push_back(info);
+            }
+
+            const auto numBlocks = state.blockList.blocks.size();
+            state.blockFirst.assign(numBlocks, 0);
+            state.blockEnd.assign(numBlocks, 0);
+            for (uint32_t i = 0; i < state.instrs.size(); ++i)
+            {
+                const auto blockIdx = state.blockList.getBlock(state.instrs[i].node);
+                if (state.blockEnd[blockIdx] == 0)
+                    state.blockFirst[blockIdx] = i;
+                state.blockEnd[blockIdx] = i + 1;
+            }
+
+            return Error::None;
+        }
+
+        // Iterates in reverse block order until no live-in set changes, update returns true if the
+        // live-in set of the block changed.
+        template<typename TUpdate> static void solveBackward(const BlockList& blockList, TUpdate&& update)
+        {
+            const auto numBlocks = static_cast<uint32_t>(blockList.blocks.size());
+
+            std::vector<uint32_t> worklist(numBlocks);
+            std::vector<uint8_t> isQueued(numBlocks, 1);
+            for (uint32_t i = 0; i < numBlocks; ++i)
+            {
+                worklist[i] = i;
+            }
+
+            while (!worklist.empty())
+            {
+                const auto blockIdx = worklist.back();
+                worklist.pop_back();
+                isQueued[blockIdx] = 0;
+
+                if (!update(blockIdx))
+                    continue;
+
+                for (auto i = blockList.predOffsets[blockIdx]; i < blockList.predOffsets[blockIdx + 1]; ++i)
+                {
+                    const auto pred = blockList.preds[i];
+                    if (isQueued[pred] == 0)
+                    {
+                        isQueued[pred] = 1;
+                        worklist.push_back(pred);
+                    }
+                }
+            }
+        }
+
+        template<typename F> static void forEachBit(const uint64_t* words, size_t numWords, F&& func)
+        {
+            for (size_t i = 0; i < numWords; ++i)
+            {
+                for (auto word = words[i]; word != 0; word &= word - 1)
+                {
+                    func(static_cast<uint32_t>(i * 64 + math::findFirstSet(word)));
+                }
+            }
+        }
+
+        static void extendInterval(LiveRange& interval, uint32_t pos) noexcept
+        {
+            interval.start = std::min(interval.start, pos);
+            interval.end = std::max(interval.end, pos);
+        }
+
+        // Live intervals of the virtual registers from their liveness per block, intervals have no holes.
+        static void buildIntervals(RegisterAllocatorState& state)
+        {
+            const auto& blockList = state.blockList;
+            const auto numBlocks = blockList.blocks.size();
+            const auto numWords = (static_cast<size_t>(state.numVirtual) + 63) / 64;
+
+            std::vector<uint64_t> gen(numBlocks * numWords);
+            std::vector<uint64_t> kill(numBlocks * numWords);
+            std::vector<uint64_t> liveIn(numBlocks * numWords);
+            std::vector<uint64_t> liveOut(numWords);
+
+            for (size_t b = 0; b < numBlocks; ++b)
+            {
+                auto* blockGen = gen.data() + b * numWords;
+                auto* blockKill = kill.data() + b * numWords;
+                for (auto i = state.blockFirst[b]; i < state.blockEnd[b]; ++i)
+                {
+                    const auto& info = state.instrs[i];
+                    for (auto j = info.accessBegin; j < info.accessEnd; ++j)
+                    {
+                        const auto& access = state.accesses[j];
+                        const auto word = access.index / 64;
+                        const auto bit = uint64_t{ 1 } << (access.index % 64);
+                        if ((access.flags & kVirtRead) != 0 && (blockKill[word] & bit) == 0)
+                            blockGen[word] |= bit;
+                        if ((access.flags & kVirtFullWrite) != 0)
+                            blockKill[word] |= bit;
+                    }
+                }
+            }
+
+            const auto computeLiveOut = [&](uint32_t blockIdx) {
+                std::fill(liveOut.begin(), liveOut.end(), 0);
+                for (const auto succ : blockList.blocks[blockIdx].succs)
+                {
+                    if (succ == kInvalidBlock)
+                        continue;
+                    for (size_t w = 0; w < numWords; ++w)
+                        liveOut[w] |= liveIn[succ * numWords + w];
+                }
+            };
+
+            solveBackward(blockList, [&](uint32_t blockIdx) {
+                computeLiveOut(blockIdx);
+
+                bool changed = false;
+                for (size_t w = 0; w < numWords; ++w)
+                {
+                    const auto idx = blockIdx * numWords + w;
+                    const auto newIn = gen[idx] | (liveOut[w] & ~kill[idx]);
+                    if (newIn != liveIn[idx])
+                    {
+                        liveIn[idx] = newIn;
+                        changed = true;
+                    }
+                }
+                return changed;
+            });
+
+            state.intervals.assign(state.numVirtual, LiveRange{});
+            for (uint32_t b = 0; b < numBlocks; ++b)
+            {
+                if (state.blockFirst[b] == state.blockEnd[b])
+                    continue;
+
+                const auto blockStart = state.blockFirst[b] * 2;
+                const auto blockLast = state.blockEnd[b] * 2 - 1;
+
+                computeLiveOut(b);
+                forEachBit(liveIn.data() + b * numWords, numWords, [&](uint32_t v) {
+                    extendInterval(state.intervals[v], blockStart);
+                });
+                forEachBit(liveOut.data(), numWords, [&](uint32_t v) { extendInterval(state.intervals[v], blockLast); });
+
+                for (auto i = state.blockFirst[b]; i < state.blockEnd[b]; ++i)
+                {
+                    const auto& info = state.instrs[i];
+                    for (auto j = info.accessBegin; j < info.accessEnd; ++j)
+                    {
+                        const auto& access = state.accesses[j];
+                        if ((access.flags & kVirtRead) != 0)
+                            extendInterval(state.intervals[access.index], i * 2);
+                        if ((access.flags & kVirtWrite) != 0)
+                            extendInterval(state.intervals[access.index], i * 2 + 1);
+                    }
+                }
+            }
+        }
+
+        // Registers the program may have written before each block, registers that only hold the value
+        // they had on entry are free to be assigned if allocatable. Calls and exits read all of them as
+        // their arguments and results are unknown.
+        static void addCallAndExitReads(RegisterAllocatorState& state, std::vector<uint32_t>& exitLive)
+        {
+            const auto& blockList = state.blockList;
+            const auto numBlocks = static_cast<uint32_t>(blockList.blocks.size());
+
+            std::vector<uint32_t> writes(numBlocks);
+            uint32_t allWrites = 0;
+            for (uint32_t b = 0; b < numBlocks; ++b)
+            {
+                for (auto i = state.blockFirst[b]; i < state.blockEnd[b]; ++i)
+                {
+                    if (!state.instrs[i].isCall)
+                        writes[b] |= state.instrs[i].physWrite;
+                }
+                allWrites |= writes[b];
+            }
+
+            // Blocks entered from elsewhere than the start of the program, such as called labels, may see
+            // anything written by the program.
+            std::vector<uint32_t> entryDefs(numBlocks);
+            for (const auto entry : blockList.entries)
+            {
+                if (entry != 0)
+                    entryDefs[entry] = allWrites;
+            }
+
+            std::vector<uint32_t> defIn(numBlocks);
+            exitLive.assign(numBlocks, 0);
+            for (bool changed = true; changed;)
+            {
+                changed = false;
+                for (uint32_t b = 0; b < numBlocks; ++b)
+                {
+                    auto newIn = entryDefs[b];
+                    for (auto i = blockList.predOffsets[b]; i < blockList.predOffsets[b + 1]; ++i)
+                    {
+                        const auto pred = blockList.preds[i];
+                        newIn |= defIn[pred] | writes[pred];
+                    }
+                    if (newIn != defIn[b])
+                    {
+                        defIn[b] = newIn;
+                        changed = true;
+                    }
+                }
+            }
+
+            for (uint32_t b = 0; b < numBlocks; ++b)
+            {
+                auto defined = defIn[b];
+                for (auto i = state.blockFirst[b]; i < state.blockEnd[b]; ++i)
+                {
+                    auto& info = state.instrs[i];
+                    if (info.isCall)
+                        info.physRead |= defined;
+                    else
+                        defined |= info.physWrite;
+                }
+
+                const auto& block = blockList.blocks[b];
+                if (block.isData || block.hasUnknownSucc)
+                    exitLive[b] = defined;
+            }
+        }
+
+        // Ranges in which the program itself uses the physical registers.
+        static void buildFixedRanges(RegisterAllocatorState& state)
+        {
+            const auto& blockList = state.blockList;
+            const auto numBlocks = static_cast<uint32_t>(blockList.blocks.size());
+
+            std::vector<uint32_t> exitLive;
+            addCallAndExitReads(state, exitLive);
+
+            std::vector<uint32_t> gen(numBlocks);
+            std::vector<uint32_t> kill(numBlocks);
+            std::vector<uint32_t> liveIn(numBlocks);
+
+            for (uint32_t b = 0; b < numBlocks; ++b)
+            {
+                for (auto i = state.blockFirst[b]; i < state.blockEnd[b]; ++i)
+                {
+                    gen[b] |= state.instrs[i].physRead & ~kill[b];
+                    kill[b] |= state.instrs[i].physWrite;
+                }
+            }
+
+            const auto getLiveOut = [&](uint32_t blockIdx) {
+                uint32_t res = exitLive[blockIdx];
+                for (const auto succ : blockList.blocks[blockIdx].succs)
+                {
+                    if (succ != kInvalidBlock)
+                        res |= liveIn[succ];
+                }
+                return res;
+            };
+
+            solveBackward(blockList, [&](uint32_t blockIdx) {
+                const auto newIn = gen[blockIdx] | (getLiveOut(blockIdx) & ~kill[blockIdx]);
+                if (newIn == liveIn[blockIdx])
+                    return false;
+                liveIn[blockIdx] = newIn;
+                return true;
+            });
+
+            for (auto& ranges : state.fixed)
+            {
+                ranges.clear();
+            }
+
+            std::array<uint32_t, kNumGpRegs> rangeEnd{};
+            for (uint32_t b = 0; b < numBlocks; ++b)
+            {
+                if (state.blockFirst[b] == state.blockEnd[b])
+                    continue;
+
+                auto live = getLiveOut(b);
+                for (size_t r = 0; r < kNumGpRegs; ++r)
+                {
+                    rangeEnd[r] = state.blockEnd[b] * 2 - 1;
+                }
+
+                for (auto i = state.blockEnd[b]; i-- > state.blockFirst[b];)
+                {
+                    const auto& info = state.instrs[i];
+                    for (size_t r = 0; r < kNumGpRegs; ++r)
+                    {
+                        const auto bit = 1U << r;
+                        if ((info.physWrite & bit) != 0)
+                        {
+                            state.fixed[r].push_back({ i * 2 + 1, (live & bit) != 0 ? rangeEnd[r] : i * 2 + 1 });
+                            live &= ~bit;
+                        }
+                        if ((info.physRead & bit) != 0 && (live & bit) == 0)
+                        {
+                            live |= bit;
+                            rangeEnd[r] = i * 2;
+                        }
+                    }
+                }
+
+                for (size_t r = 0; r < kNumGpRegs; ++r)
+                {
+                    if ((live & (1U << r)) != 0)
+                        state.fixed[r].push_back({ state.blockFirst[b] * 2, rangeEnd[r] });
+                }
+            }
+
+            for (auto& ranges : state.fixed)
+            {
+                std::sort(ranges.begin(), ranges.end(), [](const LiveRange& a, const LiveRange& b) {
+                    return a.start < b.start;
+                });
+
+                size_t count = 0;
+                for (const auto& range : ranges)
+                {
+                    if (count > 0 && range.start <= ranges[count - 1].end + 1)
+                        ranges[count - 1].end = std::max(ranges[count - 1].end, range.end);
+                    else
+                        ranges[count++] = range;
+                }
+                ranges.resize(count);
+            }
+        }
+
+        static bool conflictsWithFixed(const RegisterAllocatorState& state, int8_t physIndex, uint32_t start, uint32_t end)
+        {
+            const auto& ranges = state.fixed[physIndex];
+            const auto it = std::lower_bound(
+                ranges.begin(), ranges.end(), start, [](const LiveRange& range, uint32_t pos) { return range.end < pos; });
+            return it != ranges.end() && it->start <= end;
+        }
+
+        // Poletto and Sarkar, "Linear Scan Register Allocation". Returns the highest number of spilled
+        // registers used by a single instruction.
+        // Registers the virtual register can be assigned to, without REX the 8 bit registers are al to bl
+        // and the other registers are limited to the first eight.
+        static uint32_t getAllowedMask(const RegisterAllocatorState& state, uint32_t v)
+        {
+            if (state.mode != ZYDIS_MACHINE_MODE_LONG_64 || state.usesNoRex[v] != 0)
+                return state.usesGp8[v] != 0 ? 0xFU : 0xFFU;
+            return ~0U;
+        }
+
+        static size_t linearScan(RegisterAllocatorState& state, const std::vector<uint32_t>& order, uint32_t poolMask)
+        {
+            state.assigned.assign(state.numVirtual, kSpilled);
+
+            const auto& intervals = state.intervals;
+
+            // Sorted by the end of the intervals.
+            std::vector<uint32_t> active;
+            uint32_t freeMask = poolMask;
+
+            for (const auto v : order)
+            {
+                const auto& interval = intervals[v];
+
+                size_t expired = 0;
+                while (expired < active.size() && intervals[active[expired]].end < interval.start)
+                {
+                    freeMask |= 1U << state.assigned[active[expired]];
+                    expired++;
+                }
+                active.erase(active.begin(), active.begin() + expired);
+
+                const auto allowedMask = poolMask & getAllowedMask(state, v);
+
+                int8_t physIndex = kSpilled;
+                for (auto mask = freeMask & allowedMask; mask != 0; mask &= mask - 1)
+                {
+                    const auto candidate = static_cast<int8_t>(math::findFirstSet(mask));
+                    if (!conflictsWithFixed(state, candidate, interval.start, interval.end))
+                    {
+                        physIndex = candidate;
+                        break;
+                    }
+                }
+
+                if (physIndex != kSpilled)
+                {
+                    freeMask &= ~(1U << physIndex);
+                }
+                else
+                {
+                    // Take the register of the active interval ending last if that one ends after this one.
+                    for (auto i = active.size(); i-- > 0;)
+                    {
+                        const auto other = active[i];
+                        if (intervals[other].end <= interval.end)
+                            break;
+
+                        const auto candidate = state.assigned[other];
+                        if ((allowedMask & (1U << candidate)) == 0
+                            || conflictsWithFixed(state, candidate, interval.start, interval.end))
+                            continue;
+
+                        physIndex = candidate;
+                        state.assigned[other] = kSpilled;
+                        active.erase(active.begin() + i);
+                        break;
+                    }
+                }
+
+                if (physIndex == kSpilled)
+                    continue;
+
+                state.assigned[v] = physIndex;
+                const auto pos = std::upper_bound(
+                    active.begin(), active.end(), interval.end,
+                    [&](uint32_t end, uint32_t other) { return end < intervals[other].end; });
+                active.insert(pos, v);
+            }
+
+            size_t maxSpilled = 0;
+            for (const auto& info : state.instrs)
+            {
+                size_t numSpilled = 0;
+                for (auto j = info.accessBegin; j < info.accessEnd; ++j)
+                {
+                    if (state.assigned[state.accesses[j].index] == kSpilled)
+                        numSpilled++;
+                }
+                maxSpilled = std::max(maxSpilled, numSpilled);
+            }
+
+            return maxSpilled;
+        }
+
+        // Registers least used by the program, preferring the ones last in the allocation order.
+        static uint32_t pickScratchRegs(const RegisterAllocatorState& state, uint32_t poolMask, size_t count)
+        {
+            std::vector<int8_t> candidates;
+            for (auto mask = poolMask; mask != 0; mask &= mask - 1)
+            {
+                candidates.push_back(static_cast<int8_t>(math::findFirstSet(mask)));
+            }
+
+            std::stable_sort(candidates.begin(), candidates.end(), [&](int8_t a, int8_t b) {
+                if (state.fixed[a].size() != state.fixed[b].size())
+                    return state.fixed[a].size() < state.fixed[b].size();
+                return a > b;
+            });
+
+            uint32_t res = 0;
+            for (size_t i = 0; i < count && i < candidates.size(); ++i)
+            {
+                res |= 1U << candidates[i];
+            }
+            return res;
+        }
+
+        // Spilled registers whose intervals do not overlap share a slot.
+        static int32_t assignSlots(RegisterAllocatorState& state, const std::vector<uint32_t>& order)
+        {
+            state.slots.assign(state.numVirtual, -1);
+
+            using SlotEnd = std::pair<uint32_t, int32_t>;
+            std::priority_queue<SlotEnd, std::vector<SlotEnd>, std::greater<SlotEnd>> activeSlots;
+            std::vector<int32_t> freeSlots;
+            int32_t numSlots = 0;
+
+            for (const auto v : order)
+            {
+                if (state.assigned[v] != kSpilled)
+                    continue;
+
+                const auto& interval = state.intervals[v];
+                while (!activeSlots.empty() && activeSlots.top().first < interval.start)
+                {
+                    freeSlots.push_back(activeSlots.top().second);
+                    activeSlots.pop();
+                }
+
+                int32_t slot = numSlots;
+                if (!freeSlots.empty())
+                {
+                    slot = freeSlots.back();
+                    freeSlots.pop_back();
+                }
+                else
+                {
+                    numSlots++;
+                }
+
+                state.slots[v] = slot;
+                activeSlots.emplace(interval.end, slot);
+            }
+
+            return numSlots;
+        }
+
+        static operands::Mem replaceMemRegs(
+            const operands::Mem& mem, const operands::Reg& base, const operands::Reg& index) noexcept
+        {
+            if (mem.hasLabel())
+            {
+                return operands::Mem(
+                    mem.getBitSize(), mem.getSegment(), mem.getLabel(), base, index, mem.getScale(), mem.getDisplacement());
+            }
+            return operands::Mem(mem.getBitSize(), mem.getSegment(), base, index, mem.getScale(), mem.getDisplacement());
+        }
+
+        static operands::Gp getSpillBase(const RegisterAllocatorState& state) noexcept
+        {
+            if (state.spillBase.isValid())
+                return state.spillBase;
+            return state.mode == ZYDIS_MACHINE_MODE_LONG_64 ? operands::Gp(ZYDIS_REGISTER_RSP)
+                                                            : operands::Gp(ZYDIS_REGISTER_ESP);
+        }
+
+        // The slots are addressed relative to the spill base, once the program moves it, ex. with push or pop,
+        // the loads and stores would access other memory. Calls and returns restore the stack pointer.
+        static bool writesSpillBase(const RegisterAllocatorState& state) noexcept
+        {
+            const auto baseBit = getRegBit(getSpillBase(state));
+            for (const auto& info : state.instrs)
+            {
+                if ((info.physWrite & baseBit) == 0 || info.isCall)
+                    continue;
+
+                if (getBranchKind(info.node->get<Instruction>()) != BranchKind::Exit)
+                    return true;
+            }
+            return false;
+        }
+
+        static Error rewrite(RegisterAllocatorState& state, Program& program, uint32_t scratchMask)
+        {
+            const bool is64 = state.mode == ZYDIS_MACHINE_MODE_LONG_64;
+            const auto slotSize = is64 ? 8 : 4;
+            const auto slotBitSize = is64 ? BitSize::_64 : BitSize::_32;
+            const auto spillBase = getSpillBase(state);
+
+            Assembler assembler(program);
+
+            std::vector<std::pair<uint32_t, int8_t>> regMap;
+            for (uint32_t i = 0; i < state.instrs.size(); ++i)
+            {
+                const auto& info = state.instrs[i];
+                if (info.accessBegin == info.accessEnd)
+                    continue;
+
+                // Spilled registers use a scratch register not used by the program at this instruction.
+                regMap.clear();
+                uint32_t usedScratch = 0;
+                for (auto j = info.accessBegin; j < info.accessEnd; ++j)
+                {
+                    const auto v = state.accesses[j].index;
+                    auto physIndex = state.assigned[v];
+                    if (physIndex == kSpilled)
+                    {
+                        const auto allowedMask = scratchMask & getAllowedMask(state, v) & ~usedScratch;
+                        for (auto mask = allowedMask; mask != 0; mask &= mask - 1)
+                        {
+                            const auto candidate = static_cast<int8_t>(math::findFirstSet(mask));
+                            if (!conflictsWithFixed(state, candidate, i * 2, i * 2 + 1))
+                            {
+                                physIndex = candidate;
+                                break;
+                            }
+                        }
+                        if (physIndex == kSpilled)
+                            return Error::ImpossibleInstruction;
+
+                        usedScratch |= 1U << physIndex;
+                    }
+                    regMap.emplace_back(v, physIndex);
+                }
+
+                const auto mapReg = [&](const operands::Reg& reg) -> operands::Reg {
+                    if (!reg.isVirtual())
+                        return reg;
+                    for (const auto& [v, physIndex] : regMap)
+                    {
+                        if (v == reg.getVirtualIndex())
+                            return toPhysical(reg, physIndex);
+                    }
+                    return reg;
+                };
+
+                const auto& instr = info.node->get<Instruction>();
+                auto newOps = instr.getOperands();
+                for (size_t k = 0; k < instr.getOperandCount(); ++k)
+                {
+                    if (const auto* reg = newOps[k].getIf<operands::Reg>(); reg != nullptr)
+                        newOps[k] = mapReg(*reg);
+                    else if (const auto* mem = newOps[k].getIf<operands::Mem>(); mem != nullptr)
+                        newOps[k] = replaceMemRegs(*mem, mapReg(mem->getBase()), mapReg(mem->getIndex()));
+                }
+
+                // Generated again with the physical registers, the length of the form with the placeholders
+                // is not the final one and some combinations such as ah with r8b can not be encoded.
+                size_t numOps = 0;
+                while (numOps < std::min<size_t>(instr.getOperandCount(), ZYDIS_ENCODER_MAX_OPERANDS)
+                       && !instr.isOperandHidden(numOps) && !newOps[numOps].holds<operands::None>())
+                {
+                    numOps++;
+                }
+
+                assembler.setCursor(info.node);
+                if (auto err = assembler.emit(instr.getAttribs(), instr.getId(), numOps, newOps.data()); err != Error::None)
+                    return err;
+
+                const auto* newNode = assembler.getCursor();
+                program.destroy(info.node);
+
+                for (auto j = info.accessBegin; j < info.accessEnd; ++j)
+                {
+                    const auto& access = state.accesses[j];
+                    if (state.assigned[access.index] != kSpilled)
+                        continue;
+
+                    const auto physIndex = regMap[j - info.accessBegin].second;
+                    const auto scratch = is64 ? toPhysical(operands::Gp(ZYDIS_REGISTER_RAX), physIndex)
+                                              : toPhysical(operands::Gp(ZYDIS_REGISTER_EAX), physIndex);
+                    const auto slot = operands::ptr(
+                        slotBitSize, spillBase, static_cast<int64_t>(state.spillOffset) + state.slots[access.index] * slotSize);
+
+                    if ((access.flags & kVirtRead) != 0)
+                    {
+                        const auto* prev = newNode->getPrev();
+                        assembler.setCursor(prev != nullptr ? prev : program.getTail());
+                        if (auto err = assembler.mov(scratch, slot); err != Error::None)
+                            return err;
+                        if (prev == nullptr)
+                            program.moveBefore(newNode, assembler.getCursor());
+                        state.stats.numSpillInstructions++;
+                    }
+
+                    if ((access.flags & kVirtWrite) != 0)
+                    {
+                        assembler.setCursor(newNode);
+                        if (auto err = assembler.mov(slot, scratch); err != Error::None)
+                            return err;
+                        state.stats.numSpillInstructions++;
+                    }
+                }
+            }
+
+            return Error::None;
+        }
+
+    } // namespace detail
+
+    namespace passes
+    {
+        RegisterAllocator::RegisterAllocator()
+            : _state(new detail::RegisterAllocatorState())
+        {
+        }
+
+        RegisterAllocator::~RegisterAllocator()
+        {
+            delete _state;
+        }
+
+        void RegisterAllocator::setAllocatable(const analysis::RegSet& regs)
+        {
+            _state->allocatable = regs;
+            _state->hasAllocatable = true;
+        }
+
+        void RegisterAllocator::setCallClobbered(const analysis::RegSet& regs)
+        {
+            _state->callClobbered = regs;
+            _state->hasCallClobbered = true;
+        }
+
+        void RegisterAllocator::setSpillArea(const operands::Gp& base, int32_t offset)
+        {
+            _state->spillBase = base;
+            _state->spillOffset = offset;
+        }
+
+        Error RegisterAllocator::run(Program& program)
+        {
+            auto& state = *_state;
+            state.stats = {};
+            state.mode = program.getMode();
+
+            if (state.mode != ZYDIS_MACHINE_MODE_LONG_64 && state.mode != ZYDIS_MACHINE_MODE_LONG_COMPAT_32
+                && state.mode != ZYDIS_MACHINE_MODE_LEGACY_32)
+            {
+                return Error::InvalidMode;
+            }
+
+            state.numVirtual = static_cast<uint32_t>(program.getVirtualRegCount());
+            if (state.numVirtual == 0)
+                return Error::None;
+
+            const auto poolMask = state.hasAllocatable ? detail::getRegMask(state.allocatable, state.mode)
+                                                       : detail::getDefaultAllocatableMask(state.mode);
+            const auto callClobbered = state.hasCallClobbered ? detail::getRegMask(state.callClobbered, state.mode)
+                                                              : poolMask;
+
+            detail::buildBlocks(program, state.blockList);
+
+            state.usesGp8.assign(state.numVirtual, 0);
+            state.usesNoRex.assign(state.numVirtual, 0);
+            if (auto err = detail::collectAccesses(state, program, callClobbered); err != Error::None)
+                return err;
+
+            detail::buildIntervals(state);
+            detail::buildFixedRanges(state);
+
+            std::vector<uint32_t> order;
+            for (uint32_t v = 0; v < state.numVirtual; ++v)
+            {
+                if (state.intervals[v].start != detail::kNoInterval)
+                    order.push_back(v);
+            }
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return state.intervals[a].start < state.intervals[b].start;
+            });
+
+            // Spilled registers need scratch registers, reserve as many as a single instruction uses and
+            // allocate again without them until the reservation suffices.
+            uint32_t scratchMask = 0;
+            for (;;)
+            {
+                const auto numScratch = static_cast<size_t>(math::popCount(scratchMask));
+                const auto maxSpilled = detail::linearScan(state, order, poolMask & ~scratchMask);
+                if (maxSpilled <= numScratch)
+                    break;
+
+                if (maxSpilled > static_cast<size_t>(math::popCount(poolMask)))
+                    return Error::InvalidParameter;
+
+                scratchMask = detail::pickScratchRegs(state, poolMask, maxSpilled);
+            }
+
+            const auto numSlots = detail::assignSlots(state, order);
+
+            state.stats.numVirtualRegs = order.size();
+            state.stats.numSpilled = static_cast<size_t>(
+                std::count_if(order.begin(), order.end(), [&](uint32_t v) { return state.assigned[v] == detail::kSpilled; }));
+            state.stats.spillAreaSize = numSlots * (state.mode == ZYDIS_MACHINE_MODE_LONG_64 ? 8 : 4);
+
+            if (state.stats.numSpilled > 0 && detail::writesSpillBase(state))
+                return Error::InvalidOperation;
+
+            return detail::rewrite(state, program, scratchMask);
+        }
+
+        const RegisterAllocatorStats& RegisterAllocator::getStats() const noexcept
+        {
+            return _state->stats;
+        }
+
+    } // namespace passes
+
+} // namespace zasm
@@ -1,39 +1,162 @@
+#include "program.state.hpp"
+
 #include <algorithm>
-#include <cinttypes>
-#include <cmath>
+#include <charconv>
+#include <cstring>
+#include <thread>
+#include <vector>
 #include <zasm/program/formatter.hpp>
 #include <zasm/program/instruction.hpp>
 #include <zasm/program/node.hpp>
 #include <zasm/program/register.hpp>
 #include <zasm/program/program.hpp>
+#include <zasm/serialization/serializer.hpp>
 
 namespace zasm::formatter
 {
     namespace detail
     {
+        // Collects output in a fixed buffer and hands it to the callback in chunks.
+        class Writer
+        {
+            WriteCallback _callback{};
+            void* _userData{};
+            size_t _total{};
+            size_t _size{};
+            char _buf[4096];
+
+        public:
+            Writer(WriteCallback callback, void* userData)
+                : _callback(callback)
+                , _userData(userData)
+            {
+            }
+
+            ~Writer()
+            {
+                flush();
+            }
+
+            void write(const char* data, size_t len)
+            {
+                if (_size + len > std::size(_buf))
+                {
+                    flush();
+                    if (len >= std::size(_buf))
+                    {
+                        _callback(_userData, data, len);
+                        _total += len;
+                        return;
+                    }
+                }
+                std::memcpy(_buf + _size, data, len);
+                _size += len;
+            }
+
+            void flush()
+            {
+                if (_size == 0)
+                    return;
+                _callback(_userData, _buf, _size);
+                _total += _size;
+                _size = 0;
+            }
+
+            size_t getTotal() const noexcept
+            {
+                return _total + _size;
+            }
+        };
+
+        struct LabelAddress
+        {
+            int64_t address;
+            Label::Id id;
+
+            bool operator<(const LabelAddress& other) const noexcept
+            {
+                return address < other.address;
+            }
+        };
+
         struct Context
         {
             Program& program;
             Options options{};
-            char buf[256]{};
-            size_t size{};
+            Writer& writer;
+
+            // Set when the output is annotated with the serialized layout.
+            const Serializer* serializer{};
+            size_t nodeIndex{};
+            std::vector<LabelAddress> labelAddresses;
 
-            constexpr Context(Program& p, Options o)
+            // The instruction currently being formatted.
+            const Instruction* instr{};
+
+            Context(Program& p, Options o, Writer& w)
                 : program(p)
                 , options(o)
+                , writer(w)
             {
             }
 
             void append(const char* str)
             {
-                int len = snprintf(buf + size, std::size(buf) - size, "%s", str);
-                size += len;
+                writer.write(str, std::strlen(str));
+            }
+
+            void append(char c)
+            {
+                writer.write(&c, 1);
+            }
+
+            void appendInt(int64_t val)
+            {
+                char buf[24];
+                const auto res = std::to_chars(std::begin(buf), std::end(buf), val);
+                writer.write(buf, res.ptr - buf);
+            }
+
+            void appendUInt(uint64_t val)
+            {
+                char buf[24];
+                const auto res = std::to_chars(std::begin(buf), std::end(buf), val);
+                writer.write(buf, res.ptr - buf);
+            }
+
+            // Writes the value as hex digits, padded with zeros to at least minDigits.
+            void appendHexDigits(uint64_t val, size_t minDigits, bool upperCase)
+            {
+                char buf[24];
+                const auto res = std::to_chars(std::begin(buf), std::end(buf), val, 16);
+                const size_t len = res.ptr - buf;
+
+                if (upperCase)
+                {
+                    std::transform(buf, res.ptr, buf, [](char c) { return c >= 'a' && c <= 'f' ? c - ('a' - 'A') : c; });
+                }
+
+                for (size_t i = len; i < minDigits; ++i)
+                    append('0');
+                writer.write(buf, len);
+            }
+
+            // Writes the value as hex with 0x prefix, padded with zeros to at least minDigits.
+            void appendHex(uint64_t val, size_t minDigits, bool upperCase)
+            {
+                writer.write("0x", 2);
+                appendHexDigits(val, minDigits, upperCase);
             }
 
-            template<typename TFmt, typename... TArgs> void format(TFmt&& fmt, TArgs&&... args)
+            void appendPadding(size_t count)
             {
-                int len = snprintf(buf + size, std::size(buf) - size, std::forward<TFmt>(fmt), std::forward<TArgs>(args)...);
-                size += len;
+                static constexpr char kSpaces[] = "                                                                ";
+                while (count > 0)
+                {
+                    const size_t len = std::min(count, std::size(kSpaces) - 1);
+                    writer.write(kSpaces, len);
+                    count -= len;
+                }
             }
 
             bool hasOption(Options opt) const noexcept
@@ -54,29 +177,84 @@ namespace zasm::formatter
 
         static void opToString(Context& ctx, const operands::Reg& op)
         {
+            // Virtual registers are printed with their index and a size suffix, e.g. v3d for 32 bit.
+            if (op.isVirtual())
+            {
+                ctx.append('v');
+                ctx.appendUInt(op.getVirtualIndex());
+                switch (op.getClass())
+                {
+                    case ZYDIS_REGCLASS_GPR8:
+                        ctx.append('b');
+                        break;
+                    case ZYDIS_REGCLASS_GPR16:
+                        ctx.append('w');
+                        break;
+                    case ZYDIS_REGCLASS_GPR32:
+                        ctx.append('d');
+                        break;
+                    default:
+                        ctx.append('q');
+                        break;
+                }
+                return;
+            }
+
             const char* str = ZydisRegisterGetString(op.getId());
             ctx.append(str);
         }
 
+        static void labelToString(Context& ctx, const Label& label)
+        {
+            const bool useName = ctx.serializer != nullptr || ctx.hasOption(Options::LabelNames);
+            const char* name = useName ? ctx.program.getLabelName(label) : nullptr;
+            if (name != nullptr)
+            {
+                ctx.append(name);
+                return;
+            }
+
+            ctx.append('L');
+            ctx.appendInt(static_cast<int64_t>(label.getId()));
+        }
+
+        static bool isBranch(const Instruction& instr)
+        {
+            const auto category = instr.getCategory();
+            return category == Instruction::Category::CondBr || category == Instruction::Category::UncondBR
+                || category == Instruction::Category::Call;
+        }
+
         static void opToString(Context& ctx, const operands::Imm& op)
         {
             int64_t val = op.value<int64_t>();
             if (ctx.hasOption(Options::HexImmediates))
             {
                 if (val < 0)
-                    ctx.format("-%" PRId64 "X", -val);
+                {
+                    ctx.append('-');
+                    ctx.appendHex(0ULL - static_cast<uint64_t>(val), 0, true);
+                }
                 else
-                    ctx.format("%" PRId64 "X", val);
+                    ctx.appendHex(static_cast<uint64_t>(val), 0, true);
             }
             else
             {
-                ctx.format("%" PRId64, val);
+                ctx.appendInt(val);
             }
-        }
 
-        static void labelToString(Context& ctx, const Label& label)
-        {
-            ctx.format("L%u", label.getId());
+            // Branch targets are resolved to the label bound at that address.
+            if (!ctx.labelAddresses.empty() && ctx.instr != nullptr && isBranch(*ctx.instr))
+            {
+                const auto it = std::lower_bound(
+                    ctx.labelAddresses.begin(), ctx.labelAddresses.end(), LabelAddress{ val, Label::Id::Invalid });
+                if (it != ctx.labelAddresses.end() && it->address == val)
+                {
+                    ctx.append(" <");
+                    labelToString(ctx, Label{ it->id });
+                    ctx.append('>');
+                }
+            }
         }
 
         static void opToString(Context& ctx, const operands::Label& op)
@@ -92,6 +270,8 @@ namespace zasm::formatter
                 ctx.append("word ptr ");
             else if (op.getByteSize() == 4)
                 ctx.append("dword ptr ");
+            else if (op.getByteSize() == 6)
+                ctx.append("fword ptr ");
             else if (op.getByteSize() == 8)
                 ctx.append("qword ptr ");
             else if (op.getByteSize() == 10)
@@ -128,7 +308,8 @@ namespace zasm::formatter
 
                 if (op.getScale() > 1)
                 {
-                    ctx.format("*%d", op.getScale());
+                    ctx.append('*');
+                    ctx.appendInt(op.getScale());
                 }
             }
 
@@ -145,17 +326,16 @@ namespace zasm::formatter
             bool hasDisp = false;
             if (auto disp = op.getDisplacement(); disp != 0)
             {
-                if (hasBase || hasIndex || hasLabel)
-                {
-                    if (disp < 0)
-                        ctx.append("-");
-                    else
-                        ctx.append("+");
-                }
                 if (disp < 0)
-                    ctx.format("%" PRId64, -disp);
+                    ctx.append("-");
+                else if (hasBase || hasIndex || hasLabel)
+                    ctx.append("+");
+
+                const uint64_t absDisp = disp < 0 ? 0ULL - static_cast<uint64_t>(disp) : static_cast<uint64_t>(disp);
+                if (ctx.hasOption(Options::HexOffsets))
+                    ctx.appendHex(absDisp, 0, true);
                 else
-                    ctx.format("%" PRId64, disp);
+                    ctx.appendUInt(absDisp);
                 hasDisp = true;
             }
             else
@@ -201,22 +381,22 @@ namespace zasm::formatter
             if (node.isU8())
             {
                 dataPrefix(ctx, BitSize::_8);
-                ctx.format("0x%02" PRIx8, node.valueAsU8());
+                ctx.appendHex(node.valueAsU8(), 2, false);
             }
             else if (node.isU16())
             {
                 dataPrefix(ctx, BitSize::_16);
-                ctx.format("0x%04" PRIx16, node.valueAsU16());
+                ctx.appendHex(node.valueAsU16(), 4, false);
             }
             else if (node.isU32())
             {
                 dataPrefix(ctx, BitSize::_32);
-                ctx.format("0x%08" PRIx32, node.valueAsU32());
+                ctx.appendHex(node.valueAsU32(), 8, false);
             }
             else if (node.isU64())
             {
                 dataPrefix(ctx, BitSize::_64);
-                ctx.format("0x%016" PRIx64, node.valueAsU64());
+                ctx.appendHex(node.valueAsU64(), 16, false);
             }
             else
             {
@@ -232,7 +412,7 @@ namespace zasm::formatter
                     if (bytesOnLine > 0)
                         ctx.append(", ");
 
-                    ctx.format("0x%02" PRIx8, data[i]);
+                    ctx.appendHex(data[i], 2, false);
                     bytesOnLine++;
 
                     if (bytesOnLine >= bytesPerLine)
@@ -252,8 +432,17 @@ namespace zasm::formatter
 
         static void nodeToString(Context& ctx, const Section& node)
         {
-            const char* str = ctx.program.getSectionName(node);
-            ctx.format(".section %s", str);
+            ctx.append(".section ");
+            if (const char* str = ctx.program.getSectionName(node); str != nullptr)
+                ctx.append(str);
+        }
+
+        static void nodeToString(Context& ctx, const Align& node)
+        {
+            ctx.append(".align ");
+            ctx.appendInt(node.getAlign());
+            if (node.getType() == Align::Type::Data)
+                ctx.append(", data");
         }
 
         static void nodeToString(Context& ctx, const EmbeddedLabel& node)
@@ -278,6 +467,8 @@ namespace zasm::formatter
             if (node.hasAttrib(Instruction::Attribs::Repne))
                 ctx.append("repne ");
 
+            ctx.instr = &node;
+
             mnemonictoString(ctx, node.getId());
 
             size_t opIndex = 0;
@@ -300,71 +491,329 @@ namespace zasm::formatter
 
                 opIndex++;
             }
+
+            ctx.instr = nullptr;
         }
 
-    } // namespace detail
+        // Prefixes the node with its address, length and encoded bytes.
+        static void annotateNode(Context& ctx)
+        {
+            // Instructions are at most 15 bytes, longer data is truncated.
+            constexpr size_t kMaxBytes = 15;
 
-    std::string toString(Program& program, Options options /*= {}*/)
-    {
-        std::string res;
+            const auto* info = ctx.serializer->getNodeInfo(ctx.nodeIndex++);
+            if (info == nullptr)
+                return;
+
+            ctx.appendHexDigits(static_cast<uint64_t>(info->address), 16, true);
+            ctx.appendPadding(2);
+
+            if (info->length < 10)
+                ctx.append(' ');
+            ctx.appendInt(info->length);
+            ctx.appendPadding(2);
+
+            const uint8_t* code = ctx.serializer->getCode();
+            const size_t byteCount = std::min<size_t>(info->length, kMaxBytes);
+            for (size_t i = 0; i < byteCount; ++i)
+            {
+                ctx.appendHexDigits(code[info->offset + i], 2, true);
+                ctx.append(' ');
+            }
+
+            // Truncated bytes are marked, the column after the bytes stays aligned either way.
+            size_t width = byteCount * 3;
+            if (static_cast<size_t>(info->length) > kMaxBytes)
+            {
+                ctx.append("..");
+                width += 2;
+            }
+            ctx.appendPadding(kMaxBytes * 3 + 2 - width);
+        }
 
-        auto* node = program.getHead();
-        while (node != nullptr)
+        // Formats the nodes in the range, 'to' is not inclusive. When the range
+        // continues previously written text the first node is also separated.
+        static void formatRange(Context& ctx, const Node* from, const Node* to, bool hasPrecedingText = false)
         {
-            if (!res.empty())
-                res.append("\n");
+            auto* node = from;
+            while (node != nullptr && node != to)
+            {
+                if (hasPrecedingText || ctx.writer.getTotal() != 0)
+                    ctx.append('\n');
 
-            auto ctx = detail::Context(program, options);
+                if (ctx.serializer != nullptr)
+                    annotateNode(ctx);
 
-            node->visit([&](auto&& n) { detail::nodeToString(ctx, n); });
+                node->visit([&](auto&& n) { detail::nodeToString(ctx, n); });
+
+                node = node->getNext();
+            }
+        }
+
+        static void writeToString(void* userData, const char* data, size_t len)
+        {
+            static_cast<std::string*>(userData)->append(data, len);
+        }
 
-            res.append(ctx.buf, ctx.size);
+        static void writeToBuffer(void* userData, const char* data, size_t len)
+        {
+            static_cast<Buffer*>(userData)->append(data, len);
+        }
 
-            node = node->getNext();
+        static void writeToFile(void* userData, const char* data, size_t len)
+        {
+            std::fwrite(data, 1, len, static_cast<std::FILE*>(userData));
         }
 
+    } // namespace detail
+
+    void Buffer::append(const char* data, size_t len)
+    {
+        while (len > 0)
+        {
+            const size_t chunkIndex = _size / kChunkSize;
+            const size_t chunkOffset = _size % kChunkSize;
+            if (chunkIndex >= _chunks.size())
+            {
+                _chunks.push_back(std::make_unique<char[]>(kChunkSize));
+            }
+
+            const size_t count = std::min(len, kChunkSize - chunkOffset);
+            std::memcpy(_chunks[chunkIndex].get() + chunkOffset, data, count);
+
+            _size += count;
+            data += count;
+            len -= count;
+        }
+    }
+
+    void Buffer::clear() noexcept
+    {
+        _size = 0;
+    }
+
+    size_t Buffer::size() const noexcept
+    {
+        return _size;
+    }
+
+    size_t Buffer::getChunkCount() const noexcept
+    {
+        return (_size + kChunkSize - 1) / kChunkSize;
+    }
+
+    std::string_view Buffer::getChunk(size_t index) const noexcept
+    {
+        if (index >= getChunkCount())
+            return {};
+
+        const size_t len = std::min(kChunkSize, _size - index * kChunkSize);
+        return { _chunks[index].get(), len };
+    }
+
+    std::string Buffer::str() const
+    {
+        std::string res;
+        res.reserve(_size);
+        for (size_t i = 0; i < getChunkCount(); ++i)
+        {
+            res.append(getChunk(i));
+        }
         return res;
     }
 
-    std::string toString(Program& program, const Node* node, Options options /*= {}*/)
+    size_t format(Program& program, const Node* from, const Node* to, WriteCallback callback, void* userData, Options options /*= {}*/)
     {
-        auto ctx = detail::Context(program, options);
+        auto writer = detail::Writer(callback, userData);
+        auto ctx = detail::Context(program, options, writer);
 
-        node->visit([&](auto&& n) { detail::nodeToString(ctx, n); });
+        detail::formatRange(ctx, from, to);
 
-        return { ctx.buf, ctx.size };
+        writer.flush();
+        return writer.getTotal();
     }
 
-    std::string toString(Program& program, const Node* from, const Node* to, Options options /*= {}*/)
+    size_t format(Program& program, WriteCallback callback, void* userData, Options options /*= {}*/)
+    {
+        return format(program, program.getHead(), nullptr, callback, userData, options);
+    }
+
+    size_t format(
+        Program& program, const Serializer& serializer, WriteCallback callback, void* userData, Options options /*= {}*/)
+    {
+        auto writer = detail::Writer(callback, userData);
+        auto ctx = detail::Context(program, options, writer);
+
+        // The serialized layout is only usable if the program did not change since.
+        if (serializer.isUpToDate(program) && serializer.getCode() != nullptr)
+        {
+            ctx.serializer = &serializer;
+
+            const auto& labels = program.getState().labels;
+            for (const auto& label : labels)
+            {
+                const auto address = serializer.getLabelAddress(label.id);
+                if (address != -1)
+                    ctx.labelAddresses.push_back({ address, label.id });
+            }
+            std::sort(ctx.labelAddresses.begin(), ctx.labelAddresses.end());
+        }
+
+        detail::formatRange(ctx, program.getHead(), nullptr);
+
+        writer.flush();
+        return writer.getTotal();
+    }
+
+    std::string toString(Program& program, const Serializer& serializer, Options options /*= {}*/)
     {
         std::string res;
 
-        auto* node = from;
-        while (node != nullptr && node != to)
+        format(program, serializer, detail::writeToString, &res, options);
+
+        return res;
+    }
+
+    size_t toFile(Program& program, const Serializer& serializer, std::FILE* file, Options options /*= {}*/)
+    {
+        return format(program, serializer, detail::writeToFile, file, options);
+    }
+
+    size_t formatParallel(
+        Program& program, WriteCallback callback, void* userData, Options options /*= {}*/, size_t threadCount /*= 0*/)
+    {
+        // Ranges smaller than this are not worth a thread.
+        constexpr size_t kMinNodesPerRange = 4096;
+
+        if (threadCount == 0)
+            threadCount = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+
+        const size_t nodeCount = program.size();
+        const size_t rangeCount = std::min(threadCount, nodeCount / kMinNodesPerRange);
+        if (rangeCount <= 1)
         {
-            if (!res.empty())
-                res.append("\n");
+            return format(program, callback, userData, options);
+        }
 
-            auto ctx = detail::Context(program, options);
+        // Split the list into ranges with the same amount of nodes, the last range ends at nullptr.
+        std::vector<const Node*> bounds;
+        bounds.reserve(rangeCount + 1);
 
-            node->visit([&](auto&& n) { detail::nodeToString(ctx, n); });
+        const size_t nodesPerRange = nodeCount / rangeCount;
 
-            res.append(ctx.buf, ctx.size);
+        size_t index = 0;
+        for (auto* node = program.getHead(); node != nullptr; node = node->getNext(), ++index)
+        {
+            if (index % nodesPerRange == 0 && bounds.size() < rangeCount)
+                bounds.push_back(node);
+        }
+        bounds.push_back(nullptr);
 
-            node = node->getNext();
+        std::vector<Buffer> buffers(rangeCount);
+
+        const auto formatRangeToBuffer = [&](size_t rangeIndex, bool hasPrecedingText) {
+            auto writer = detail::Writer(detail::writeToBuffer, &buffers[rangeIndex]);
+            auto ctx = detail::Context(program, options, writer);
+
+            detail::formatRange(ctx, bounds[rangeIndex], bounds[rangeIndex + 1], hasPrecedingText);
+        };
+
+        // The first range is formatted on the calling thread.
+        std::vector<std::thread> workers;
+        workers.reserve(rangeCount - 1);
+        for (size_t i = 1; i < rangeCount; ++i)
+        {
+            workers.emplace_back(formatRangeToBuffer, i, true);
+        }
+        formatRangeToBuffer(0, false);
+
+        size_t total = 0;
+        for (size_t i = 0; i < rangeCount; ++i)
+        {
+            if (i > 0)
+            {
+                workers[i - 1].join();
+
+                // Ranges assume text was written before them, only nodes that produce no
+                // text can violate that, redo the range serially in that case.
+                if (total == 0)
+                {
+                    buffers[i].clear();
+                    formatRangeToBuffer(i, false);
+                }
+            }
+
+            const auto& buffer = buffers[i];
+            for (size_t n = 0; n < buffer.getChunkCount(); ++n)
+            {
+                const auto chunk = buffer.getChunk(n);
+                callback(userData, chunk.data(), chunk.size());
+            }
+
+            total += buffer.size();
         }
 
+        return total;
+    }
+
+    std::string toStringParallel(Program& program, Options options /*= {}*/, size_t threadCount /*= 0*/)
+    {
+        std::string res;
+
+        formatParallel(program, detail::writeToString, &res, options, threadCount);
+
         return res;
     }
 
-    std::string toString(Program& program, const Instruction* instr, Options options /*= {}*/)
+    size_t toFile(Program& program, std::FILE* file, Options options /*= {}*/)
+    {
+        return format(program, detail::writeToFile, file, options);
+    }
+
+    size_t toBuffer(Program& program, Buffer& buffer, Options options /*= {}*/)
+    {
+        return format(program, detail::writeToBuffer, &buffer, options);
+    }
+
+    std::string toString(Program& program, Options options /*= {}*/)
     {
-        auto ctx = detail::Context(program, options);
+        std::string res;
+
+        format(program, detail::writeToString, &res, options);
+
+        return res;
+    }
+
+    std::string toString(Program& program, const Node* node, Options options /*= {}*/)
+    {
+        std::string res;
+
+        format(program, node, node->getNext(), detail::writeToString, &res, options);
+
+        return res;
+    }
+
+    std::string toString(Program& program, const Node* from, const Node* to, Options options /*= {}*/)
+    {
+        std::string res;
 
-        detail::nodeToString(ctx, *instr);
+        format(program, from, to, detail::writeToString, &res, options);
 
-        return { ctx.buf, ctx.size };
+        return res;
     }
 
+    std::string toString(Program& program, const Instruction* instr, Options options /*= {}*/)
+    {
+        std::string res;
+
+        {
+            auto writer = detail::Writer(detail::writeToString, &res);
+            auto ctx = detail::Context(program, options, writer);
+
+            detail::nodeToString(ctx, *instr);
+        }
+
+        return res;
+    }
 
-} // namespace zasm::formatter
\ No newline at end of file
+} // namespace zasm::formatter
@@ -0,0 +1,79 @@
+#include "zasm/program/instruction.hpp"
+
+#include <array>
+#include <mutex>
+#include <unordered_set>
+
+namespace zasm::detail
+{
+    static bool operator==(const InstructionMeta& a, const InstructionMeta& b) noexcept
+    {
+        return a.access == b.access && a.opsVisibility == b.opsVisibility && a.opsEncoding == b.opsEncoding
+            && a.flags.read == b.flags.read && a.flags.write == b.flags.write && a.flags.undefined == b.flags.undefined
+            && a.encoding == b.encoding && a.category == b.category;
+    }
+
+    struct InstructionMetaHash
+    {
+        size_t operator()(const InstructionMeta& meta) const noexcept
+        {
+            uint64_t h = static_cast<uint64_t>(meta.encoding) | (static_cast<uint64_t>(meta.category) << 8);
+            const auto combine = [&h](uint64_t val) {
+                h = (h ^ val) * 0x9E3779B97F4A7C15ULL;
+                h ^= h >> 29;
+            };
+            for (size_t i = 0; i < ZYDIS_MAX_OPERAND_COUNT; ++i)
+            {
+                combine(
+                    static_cast<uint64_t>(meta.access[i]) | (static_cast<uint64_t>(meta.opsVisibility[i]) << 8)
+                    | (static_cast<uint64_t>(meta.opsEncoding[i]) << 16));
+            }
+            combine(meta.flags.read | (static_cast<uint64_t>(meta.flags.write) << 32));
+            combine(meta.flags.undefined);
+            return static_cast<size_t>(h);
+        }
+    };
+
+    struct InstructionMetaTable
+    {
+        std::mutex mutex;
+        // Node based, the address of an entry stays valid.
+        std::unordered_set<InstructionMeta, InstructionMetaHash> entries;
+    };
+
+    static InstructionMetaTable& getMetaTable()
+    {
+        // Intentionally leaked, instructions in static storage may outlive the table otherwise.
+        static auto* table = new InstructionMetaTable();
+        return *table;
+    }
+
+    const InstructionMeta* internInstructionMeta(const InstructionMeta& meta)
+    {
+        if (meta == kEmptyInstructionMeta)
+        {
+            return &kEmptyInstructionMeta;
+        }
+
+        const auto hash = InstructionMetaHash{}(meta);
+
+        // Decoding mostly sees the same few forms, a small per thread cache avoids taking the lock.
+        constexpr size_t kCacheSize = 256;
+        thread_local std::array<const InstructionMeta*, kCacheSize> cache{};
+
+        auto& cached = cache[hash % kCacheSize];
+        if (cached != nullptr && *cached == meta)
+        {
+            return cached;
+        }
+
+        auto& table = getMetaTable();
+        std::lock_guard lock(table.mutex);
+
+        auto it = table.entries.insert(meta).first;
+        cached = &*it;
+
+        return cached;
+    }
+
+} // namespace zasm::detail
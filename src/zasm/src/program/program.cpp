@@ -64,6 +64,7 @@ namespace zasm
 
         _state->head = node;
         _state->nodeCount++;
+        _state->modificationCount++;
 
         return _state->head;
     }
@@ -87,6 +88,7 @@ namespace zasm
         }
 
         _state->nodeCount++;
+        _state->modificationCount++;
 
         return node;
     }
@@ -107,6 +109,7 @@ namespace zasm
         pos->setPrev(node);
 
         _state->nodeCount++;
+        _state->modificationCount++;
 
         return node;
     }
@@ -131,6 +134,7 @@ namespace zasm
         node->setNext(next);
 
         _state->nodeCount++;
+        _state->modificationCount++;
 
         return node;
     }
@@ -157,6 +161,7 @@ namespace zasm
         n->setNext(nullptr);
 
         _state->nodeCount--;
+        _state->modificationCount++;
 
         return post;
     }
@@ -180,6 +185,14 @@ namespace zasm
         // Ensure node is not in the list anymore.
         detach(node);
 
+        // The label is no longer bound.
+        if (const auto* label = node->getIf<Label>(); label != nullptr)
+        {
+            auto& entry = _state->labels[static_cast<size_t>(label->getId())];
+            if (entry.node == node)
+                entry.node = nullptr;
+        }
+
         // Release.
         _state->nodePool.destroy(n);
         _state->nodePool.deallocate(n, 1);
@@ -190,6 +203,11 @@ namespace zasm
         return _state->nodeCount;
     }
 
+    uint64_t Program::getModificationCount() const noexcept
+    {
+        return _state->modificationCount;
+    }
+
     void Program::clear() noexcept
     {
         const Node* node = _state->head;
@@ -203,37 +221,61 @@ namespace zasm
         _state->sections.clear();
         _state->labels.clear();
         _state->symbolNames.clear();
+        _state->nextNodeId = 0;
+        _state->numVirtualRegs = 0;
     }
 
-    template<typename TPool, typename... TArgs> const Node* createNode_(TPool& pool, TArgs&&... args)
+    template<typename... TArgs> const Node* createNode_(detail::ProgramState& state, TArgs&&... args)
     {
-        auto* node = detail::toInternal(pool.allocate(1));
+        auto* node = detail::toInternal(state.nodePool.allocate(1));
         if (node == nullptr)
             return nullptr;
 
-        ::new ((void*)node) detail::Node(std::forward<TArgs&&>(args)...);
+        ::new ((void*)node) detail::Node(std::forward<TArgs>(args)...);
+        node->setId(static_cast<Node::Id>(state.nextNodeId++));
 
         return node;
     }
 
     const Node* Program::createNode(const Instruction& instr)
     {
-        return createNode_(_state->nodePool, instr);
+        return createNode_(*_state, instr);
+    }
+
+    const Node* Program::createNode(Instruction&& instr)
+    {
+        return createNode_(*_state, std::move(instr));
+    }
+
+    const Node* Program::createNode(const Instruction& form, const Instruction::Operands& operands)
+    {
+        return createNode_(*_state, std::in_place_type<Instruction>, form, operands);
+    }
+
+    const Node* Program::createNode(
+        Instruction::Attribs attribs, ZydisMnemonic mnemonic, size_t opCount, const Instruction::Operands& operands)
+    {
+        return createNode_(*_state, std::in_place_type<Instruction>, attribs, mnemonic, opCount, operands);
     }
 
     const Node* Program::createNode(const Data& data)
     {
-        return createNode_(_state->nodePool, data);
+        return createNode_(*_state, data);
     }
 
     const Node* Program::createNode(Data&& data)
     {
-        return createNode_(_state->nodePool, std::move(data));
+        return createNode_(*_state, std::move(data));
     }
 
     const zasm::Node* Program::createNode(const EmbeddedLabel& value)
     {
-        return createNode_(_state->nodePool, value);
+        return createNode_(*_state, value);
+    }
+
+    const zasm::Node* Program::createNode(const Align& value)
+    {
+        return createNode_(*_state, value);
     }
 
     const Label Program::createLabel(const char* name /*= nullptr*/)
@@ -264,12 +306,24 @@ namespace zasm
             return makeUnexpected(Error::LabelAlreadyBound);
         }
 
-        const auto* node = createNode_(_state->nodePool, label);
+        const auto* node = createNode_(*_state, label);
         entry.node = node;
 
         return node;
     }
 
+    const char* Program::getLabelName(const Label& label) const noexcept
+    {
+        const auto entryIdx = static_cast<size_t>(label.getId());
+        if (entryIdx >= _state->labels.size())
+        {
+            return nullptr;
+        }
+
+        const auto& entry = _state->labels[entryIdx];
+        return _state->symbolNames.get(entry.nameId);
+    }
+
     template<typename T> Data createDataInline(const void* ptr)
     {
         T temp;
@@ -290,6 +344,39 @@ namespace zasm
         return Data(ptr, len);
     }
 
+    operands::Gp Program::createVirtualGp(BitSize size)
+    {
+        int32_t sizeIndex{};
+        switch (size)
+        {
+            case BitSize::_8:
+                sizeIndex = 0;
+                break;
+            case BitSize::_16:
+                sizeIndex = 1;
+                break;
+            case BitSize::_32:
+                sizeIndex = 2;
+                break;
+            case BitSize::_64:
+                sizeIndex = 3;
+                break;
+            default:
+                return operands::Gp{};
+        }
+
+        if (_state->numVirtualRegs >= detail::kMaxVirtualRegs)
+            return operands::Gp{};
+
+        const auto regId = detail::getVirtualRegId(_state->numVirtualRegs++, sizeIndex);
+        return operands::Gp{ static_cast<operands::Reg::Id>(regId) };
+    }
+
+    size_t Program::getVirtualRegCount() const noexcept
+    {
+        return _state->numVirtualRegs;
+    }
+
     const Section Program::createSection(const char* name, Section::Attribs attribs, int32_t align)
     {
         const auto sectId = static_cast<Section::Id>(_state->sections.size());
@@ -331,7 +418,7 @@ namespace zasm
             return makeUnexpected(Error::SectionAlreadyBound);
         }
 
-        const auto* node = createNode_(_state->nodePool, section);
+        const auto* node = createNode_(*_state, section);
         entry->node = node;
 
         return node;
@@ -2,6 +2,8 @@
 
 #include "zasm/program/node.hpp"
 
+#include <type_traits>
+
 namespace zasm
 {
     namespace detail
@@ -15,11 +17,15 @@ namespace zasm
             {
             }
 
-            template<typename T>
-            constexpr Node(const T& val)
-                : ::zasm::Node(val)
+            // Never picked over the copy and move constructors.
+            template<
+                typename T, typename... TArgs,
+                typename = std::enable_if_t<!std::is_same_v<std::decay_t<T>, Node>>>
+            constexpr Node(T&& arg, TArgs&&... args)
+                : ::zasm::Node(std::forward<T>(arg), std::forward<TArgs>(args)...)
             {
             }
+
             void setPrev(const ::zasm::Node* node)
             {
                 _prev = node;
@@ -28,6 +34,10 @@ namespace zasm
             {
                 _next = node;
             }
+            void setId(Id id)
+            {
+                _id = id;
+            }
         };
 
         static_assert(sizeof(Node) == sizeof(::zasm::Node));
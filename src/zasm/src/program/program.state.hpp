@@ -9,6 +9,7 @@
 #include "zasm/program/section.hpp"
 
 #include <Zydis/Zydis.h>
+#include <atomic>
 
 namespace zasm::detail
 {
@@ -42,6 +43,10 @@ namespace zasm::detail
         Node* head{};
         Node* tail{};
         size_t nodeCount{};
+        // Changed by every link and unlink, tells if layouts computed from the list are outdated.
+        uint64_t modificationCount{};
+        // Id of the next created node, also the upper bound of all node ids.
+        uint32_t nextNodeId{};
     };
 
     struct Symbols
@@ -49,12 +54,21 @@ namespace zasm::detail
         StringPool symbolNames;
     };
 
+    // Unique for the lifetime of the process, unlike the address of a program.
+    inline uint64_t createProgramId() noexcept
+    {
+        static std::atomic<uint64_t> nextId{ 1 };
+        return nextId.fetch_add(1, std::memory_order_relaxed);
+    }
+
     struct ProgramState : NodeList, Symbols
     {
+        const uint64_t id{ createProgramId() };
         ZydisMachineMode mode{};
 
         std::vector<LabelData> labels;
         std::vector<SectionData> sections;
+        uint32_t numVirtualRegs{};
 
         ProgramState(ZydisMachineMode m)
             : mode(m)
@@ -1,5 +1,6 @@
 #include "zasm/serialization/serializer.hpp"
 
+#include "../analysis/blocks.hpp"
 #include "../encoder/encoder.context.hpp"
 #include "../program/program.state.hpp"
 #include "zasm/core/math.hpp"
@@ -10,10 +11,29 @@
 
 namespace zasm
 {
+    struct JccErratumContext
+    {
+        bool enabled{};
+        // Padding inserted before each node in the previous pass.
+        std::vector<int32_t> padding;
+        // Set on the first instruction of a fused pair, the pair is placed as a whole.
+        bool isFusedPair{};
+        JccErratumStats stats;
+    };
+
+    // Set once the size of a node or its jcc padding grew, from then on it never shrinks again.
+    struct GrowOnly
+    {
+        bool node{};
+        bool jccPadding{};
+    };
+
     struct SerializeContext
     {
         EncoderContext& ctx;
         std::vector<uint8_t> buffer;
+        JccErratumContext jcc;
+        std::vector<GrowOnly> growOnly;
     };
 
     struct LabelInfo
@@ -32,6 +52,13 @@ namespace zasm
             std::vector<uint8_t> code;
             std::vector<RelocationInfo> relocations;
             std::vector<LabelInfo> labels;
+            std::vector<NodeInfo> nodes;
+            const Node* errorNode{};
+            // Program id and its modification count at the time of the last serialization, 0 if none.
+            uint64_t programId{};
+            uint64_t modificationCount{};
+            bool mitigateJccErratum{};
+            JccErratumStats jccErratumStats;
         };
 
     } // namespace detail
@@ -55,6 +82,25 @@ namespace zasm
         return Error::None;
     }
 
+    // Sizes may shrink while the estimates of the first pass are relaxed, once a size grew it keeps the largest
+    // size seen so the layout can not oscillate between passes. Padding grows in multiples of step to stay aligned.
+    static int32_t getMonotoneSize(int32_t pass, bool& growOnly, int32_t prevSize, int32_t size, int32_t step) noexcept
+    {
+        if (pass <= 1)
+            return size;
+
+        if (size > prevSize)
+        {
+            growOnly = true;
+        }
+        else if (size < prevSize && growOnly)
+        {
+            return size + math::alignTo<int32_t>(prevSize - size, step);
+        }
+
+        return size;
+    }
+
     static Error serializeNode(detail::ProgramState& prog, SerializeContext& state, const Instruction& instr)
     {
         auto& ctx = state.ctx;
@@ -67,36 +113,41 @@ namespace zasm
             return status;
         }
 
-        {
-            auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
-            if (nodeEntry.length != 0)
-            {
-                if (res.length < nodeEntry.length)
-                {
-                    ctx.drift += nodeEntry.length - res.length;
-                }
-                else if (res.length > nodeEntry.length)
-                {
-                    ctx.drift -= res.length - nodeEntry.length;
-                }
-            }
-            nodeEntry.length = res.length;
-            nodeEntry.offset = ctx.offset;
-            nodeEntry.address = ctx.va;
-            nodeEntry.relocKind = res.relocKind;
+        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+        const auto length = getMonotoneSize(
+            ctx.pass, state.growOnly[ctx.nodeIndex].node, nodeEntry.length, res.length, 1);
 
-            ctx.nodeIndex++;
+        if (nodeEntry.length != 0)
+        {
+            // Changes in both directions are counted, alignment padding absorbs the changes of the
+            // code before it so they would cancel out while the labels in between still moved.
+            ctx.drift += std::abs(length - nodeEntry.length);
         }
+        nodeEntry.length = length;
+        nodeEntry.offset = ctx.offset;
+        nodeEntry.address = ctx.va;
+        nodeEntry.relocKind = res.relocKind;
+
+        ctx.nodeIndex++;
 
         auto& sect = ctx.sections[ctx.sectionIndex];
-        sect.rawSize += res.length;
+        sect.rawSize += length;
 
-        ctx.va += res.length;
-        ctx.offset += res.length;
+        ctx.va += length;
+        ctx.offset += length;
 
         auto& buffer = state.buffer;
         buffer.insert(buffer.end(), std::begin(res.data), std::begin(res.data) + res.length);
 
+        // Keeps the size of an instruction that could be encoded shorter.
+        if (length > res.length)
+        {
+            const auto oldSize = buffer.size();
+            buffer.resize(oldSize + (length - res.length));
+            encodePadding(
+                buffer.data() + oldSize, static_cast<size_t>(length - res.length), prog.mode, Align::Type::Code);
+        }
+
         return Error::None;
     }
 
@@ -319,6 +370,202 @@ namespace zasm
         return Error::None;
     }
 
+    static Error serializeNode(detail::ProgramState& prog, SerializeContext& state, const Align& align)
+    {
+        auto& ctx = state.ctx;
+
+        if (align.getAlign() <= 0)
+        {
+            return Error::InvalidParameter;
+        }
+
+        auto& nodeEntry = ctx.nodes[ctx.nodeIndex];
+        const auto padding = getMonotoneSize(
+            ctx.pass, state.growOnly[ctx.nodeIndex].node, nodeEntry.length,
+            static_cast<int32_t>(math::alignTo<int64_t>(ctx.va, align.getAlign()) - ctx.va), align.getAlign());
+
+        if (ctx.pass > 1 && nodeEntry.length != padding)
+        {
+            // The padding changes with the size of the code before it, same as relaxed instructions.
+            ctx.drift += std::abs(nodeEntry.length - padding);
+        }
+        nodeEntry.offset = ctx.offset;
+        nodeEntry.address = ctx.va;
+        nodeEntry.length = padding;
+        ctx.nodeIndex++;
+
+        ctx.va += padding;
+        ctx.offset += padding;
+
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += padding;
+
+        auto& buffer = state.buffer;
+        const auto oldSize = buffer.size();
+        buffer.resize(oldSize + padding);
+        encodePadding(buffer.data() + oldSize, static_cast<size_t>(padding), prog.mode, align.getType());
+
+        return Error::None;
+    }
+
+    static constexpr int64_t kJccErratumBoundary = 32;
+
+    // Jumps, calls and returns including indirect ones.
+    static bool isJccErratumBranch(const Instruction& instr) noexcept
+    {
+        if (instr.hasMetaData())
+        {
+            switch (instr.getCategory())
+            {
+                case Instruction::Category::CondBr:
+                case Instruction::Category::UncondBR:
+                case Instruction::Category::Call:
+                case Instruction::Category::Ret:
+                    return true;
+                default:
+                    return false;
+            }
+        }
+
+        // Record-only instructions have no category.
+        switch (detail::getBranchKind(instr))
+        {
+            case detail::BranchKind::Jmp:
+            case detail::BranchKind::Jcc:
+            case detail::BranchKind::Call:
+                return true;
+            default:
+                return instr.getId() == ZYDIS_MNEMONIC_RET;
+        }
+    }
+
+    // First instruction of a pair that may be macro-fused with the following jcc.
+    static bool isMacroFusible(const Instruction& instr, const Instruction& next) noexcept
+    {
+        switch (next.getId())
+        {
+            case ZYDIS_MNEMONIC_JCXZ:
+            case ZYDIS_MNEMONIC_JECXZ:
+            case ZYDIS_MNEMONIC_JRCXZ:
+            case ZYDIS_MNEMONIC_LOOP:
+            case ZYDIS_MNEMONIC_LOOPE:
+            case ZYDIS_MNEMONIC_LOOPNE:
+                return false;
+            default:
+                if (detail::getBranchKind(next) != detail::BranchKind::Jcc)
+                    return false;
+                break;
+        }
+
+        switch (instr.getId())
+        {
+            case ZYDIS_MNEMONIC_CMP:
+            case ZYDIS_MNEMONIC_TEST:
+            case ZYDIS_MNEMONIC_ADD:
+            case ZYDIS_MNEMONIC_SUB:
+            case ZYDIS_MNEMONIC_AND:
+            case ZYDIS_MNEMONIC_INC:
+            case ZYDIS_MNEMONIC_DEC:
+                break;
+            default:
+                return false;
+        }
+
+        if (instr.hasMetaData() && instr.getCategory() != Instruction::Category::Binary
+            && instr.getCategory() != Instruction::Category::Logical)
+        {
+            return false;
+        }
+
+        // Memory with an immediate does not fuse.
+        bool hasMem = false;
+        bool hasImm = false;
+        const auto& ops = instr.getOperands();
+        for (size_t i = 0; i < instr.getOperandCount(); ++i)
+        {
+            hasMem |= ops[i].holds<operands::Mem>();
+            hasImm |= ops[i].holds<operands::Imm>();
+        }
+
+        return !(hasMem && hasImm);
+    }
+
+    static int32_t getPredictedLength(const EncoderContext& ctx, size_t nodeIndex, const Instruction& instr) noexcept
+    {
+        // Same as the encoder, the length of the previous pass is preferred.
+        if (nodeIndex < ctx.nodes.size() && ctx.nodes[nodeIndex].length != 0)
+            return ctx.nodes[nodeIndex].length;
+
+        return instr.getLength();
+    }
+
+    static int32_t getJccErratumPadding(SerializeContext& state, const Node* node) noexcept
+    {
+        auto& ctx = state.ctx;
+        auto& jcc = state.jcc;
+
+        const auto* instr = node->getIf<Instruction>();
+        if (instr == nullptr || jcc.isFusedPair)
+        {
+            // The jcc of a fused pair was placed with the first instruction.
+            jcc.isFusedPair = false;
+            return 0;
+        }
+
+        int32_t length = 0;
+
+        const auto* next = node->getNext() != nullptr ? node->getNext()->getIf<Instruction>() : nullptr;
+        if (next != nullptr && isMacroFusible(*instr, *next))
+        {
+            length = getPredictedLength(ctx, ctx.nodeIndex, *instr) + getPredictedLength(ctx, ctx.nodeIndex + 1, *next);
+            jcc.isFusedPair = true;
+        }
+        else if (isJccErratumBranch(*instr))
+        {
+            length = getPredictedLength(ctx, ctx.nodeIndex, *instr);
+        }
+
+        // Crossing or ending on a boundary.
+        if (length == 0 || ctx.va / kJccErratumBoundary == (ctx.va + length) / kJccErratumBoundary)
+            return 0;
+
+        return static_cast<int32_t>(math::alignTo<int64_t>(ctx.va, kJccErratumBoundary) - ctx.va);
+    }
+
+    static void padJccErratum(detail::ProgramState& prog, SerializeContext& state, const Node* node)
+    {
+        auto& ctx = state.ctx;
+        auto& jcc = state.jcc;
+
+        // Changes of the padding move the code after it like relaxed instructions.
+        auto& prevPadding = jcc.padding[ctx.nodeIndex];
+        const auto padding = getMonotoneSize(
+            ctx.pass, state.growOnly[ctx.nodeIndex].jccPadding, prevPadding, getJccErratumPadding(state, node),
+            static_cast<int32_t>(kJccErratumBoundary));
+        if (ctx.pass > 1 && prevPadding != padding)
+        {
+            ctx.drift += std::abs(prevPadding - padding);
+        }
+        prevPadding = padding;
+
+        if (padding == 0)
+            return;
+
+        ctx.va += padding;
+        ctx.offset += padding;
+
+        auto& sect = ctx.sections[ctx.sectionIndex];
+        sect.rawSize += padding;
+
+        auto& buffer = state.buffer;
+        const auto oldSize = buffer.size();
+        buffer.resize(oldSize + padding);
+        encodePadding(buffer.data() + oldSize, static_cast<size_t>(padding), prog.mode, Align::Type::Code);
+
+        jcc.stats.numPadded++;
+        jcc.stats.bytesPadded += padding;
+    }
+
     Serializer::Serializer()
         : _state(new detail::SerializerState())
     {
@@ -333,11 +580,19 @@ namespace zasm
     {
         detail::ProgramState& programState = program.getState();
 
+        _state->errorNode = nullptr;
+
         EncoderContext encoderCtx{};
         encoderCtx.nodes.resize(program.size());
         encoderCtx.baseVA = newBase;
 
-        SerializeContext state{ encoderCtx, {} };
+        SerializeContext state{ encoderCtx, {}, {}, {} };
+        state.growOnly.resize(program.size());
+        state.jcc.enabled = _state->mitigateJccErratum;
+        if (state.jcc.enabled)
+        {
+            state.jcc.padding.resize(program.size());
+        }
 
         int32_t codeDiff = 0;
         int32_t codeSize = 0;
@@ -359,6 +614,8 @@ namespace zasm
             encoderCtx.nodeIndex = 0;
             encoderCtx.sectionIndex = 0;
             encoderCtx.drift = 0;
+            state.jcc.isFusedPair = false;
+            state.jcc.stats = {};
 
             // Setup default section.
             encoderCtx.sections.clear();
@@ -366,9 +623,15 @@ namespace zasm
 
             for (const auto* node = program.getHead(); node != nullptr; node = node->getNext())
             {
+                if (state.jcc.enabled)
+                {
+                    padJccErratum(programState, state, node);
+                }
+
                 auto status = node->visit([&](auto&& n) { return serializeNode(programState, state, n); });
                 if (status != Error::None)
                 {
+                    _state->errorNode = node;
                     return status;
                 }
             }
@@ -395,7 +658,8 @@ namespace zasm
             return Error::UnresolvedLabel;
         }
 
-        // Second or more passes.
+        // Second or more passes, sizes that grew never shrink again so this settles even with alignment
+        // and jcc padding that would otherwise keep flipping the size of the code before them.
         while (encoderCtx.needsExtraPass || encoderCtx.drift != 0)
         {
             if (auto status = serializePass(); status != Error::None)
@@ -411,6 +675,8 @@ namespace zasm
         _state->labels.clear();
         for (auto& labelLink : encoderCtx.labelLinks)
         {
+            // Keep an entry for every link so the vector stays indexable by label id.
+            auto& labelEntry = _state->labels.emplace_back();
             if (labelLink.id == Label::Id::Invalid)
                 continue;
 
@@ -420,7 +686,6 @@ namespace zasm
                 return Error::InvalidLabel;
             }
 
-            auto& labelEntry = _state->labels.emplace_back();
             labelEntry.labelId = labelLink.id;
             labelEntry.boundOffset = labelLink.boundOffset;
             labelEntry.boundAddress = labelLink.boundVA;
@@ -494,6 +759,13 @@ namespace zasm
 
         _state->code = std::move(state.buffer);
 
+        _state->nodes.clear();
+        _state->nodes.reserve(encoderCtx.nodes.size());
+        for (auto& node : encoderCtx.nodes)
+        {
+            _state->nodes.push_back({ node.offset, node.address, node.length });
+        }
+
         _state->sections.clear();
         for (auto& sectionLink : encoderCtx.sections)
         {
@@ -509,11 +781,29 @@ namespace zasm
             sect.index = idx;
         }
 
+        _state->jccErratumStats = state.jcc.stats;
         _state->base = newBase;
+        _state->programId = programState.id;
+        _state->modificationCount = program.getModificationCount();
 
         return Error::None;
     }
 
+    void Serializer::setJccErratumMitigation(bool enable) noexcept
+    {
+        _state->mitigateJccErratum = enable;
+    }
+
+    bool Serializer::hasJccErratumMitigation() const noexcept
+    {
+        return _state->mitigateJccErratum;
+    }
+
+    const JccErratumStats& Serializer::getJccErratumStats() const noexcept
+    {
+        return _state->jccErratumStats;
+    }
+
     Error Serializer::relocate(int64_t newBase)
     {
         if (_state->code.empty())
@@ -578,8 +868,17 @@ namespace zasm
             sect.address += newBase;
         }
 
+        // Adjust nodes.
+        auto nodes = _state->nodes;
+        for (auto& node : nodes)
+        {
+            node.address -= oldBase;
+            node.address += newBase;
+        }
+
         // Update state.
         _state->code = std::move(code);
+        _state->nodes = std::move(nodes);
         _state->labels = std::move(labels);
         _state->sections = std::move(sections);
         _state->relocations = std::move(relocs);
@@ -625,9 +924,11 @@ namespace zasm
         if (idx >= _state->labels.size())
             return -1;
 
-        assert(_state->labels[idx].labelId == labelId);
+        const auto& entry = _state->labels[idx];
+        if (entry.labelId != labelId)
+            return -1;
 
-        return _state->labels[idx].boundOffset;
+        return entry.boundOffset;
     }
 
     int64_t Serializer::getLabelAddress(const Label::Id labelId) const noexcept
@@ -636,9 +937,11 @@ namespace zasm
         if (idx >= _state->labels.size())
             return -1;
 
-        assert(_state->labels[idx].labelId == labelId);
+        const auto& entry = _state->labels[idx];
+        if (entry.labelId != labelId)
+            return -1;
 
-        return _state->labels[idx].boundAddress;
+        return entry.boundAddress;
     }
 
     size_t Serializer::getRelocationCount() const noexcept
@@ -654,12 +957,41 @@ namespace zasm
         return &_state->relocations[index];
     }
 
+    size_t Serializer::getNodeCount() const noexcept
+    {
+        return _state->nodes.size();
+    }
+
+    const NodeInfo* Serializer::getNodeInfo(size_t index) const noexcept
+    {
+        if (index >= _state->nodes.size())
+            return nullptr;
+
+        return &_state->nodes[index];
+    }
+
+    bool Serializer::isUpToDate(const Program& program) const noexcept
+    {
+        const auto& programState = program.getState();
+        return _state->programId == programState.id && _state->modificationCount == program.getModificationCount();
+    }
+
+    const Node* Serializer::getErrorNode() const noexcept
+    {
+        return _state->errorNode;
+    }
+
     void Serializer::clear()
     {
         _state->base = 0;
         _state->code.clear();
         _state->sections.clear();
         _state->labels.clear();
+        _state->nodes.clear();
+        _state->errorNode = nullptr;
+        _state->programId = 0;
+        _state->modificationCount = 0;
+        _state->jccErratumStats = {};
     }
 
 } // namespace zasm
\ No newline at end of file